@@ -0,0 +1,434 @@
+/**************************************************************************
+
+Filename    :   Amp_Capture.cpp
+Content     :   Recording of the AMP message stream to files, and replay
+                of recorded files to an AMP client
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Amp_Capture.h"
+
+#ifdef SF_AMP_SERVER
+
+#include "Amp_Server.h"
+#include "Kernel/SF_SysFile.h"
+#include "Kernel/SF_Timer.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_HeapNew.h"
+
+namespace Scaleform {
+namespace GFx {
+namespace AMP {
+
+static const UInt32 Capture_Magic      = 0x43504D41;   // "AMPC"
+static const UInt32 Capture_HeaderSize = 16;
+static const char   Capture_Extension[] = ".ampcap";
+
+//////////////////////////////////////////////////////////////////////////
+// Server capture support
+
+void Server::SetCaptureWriter(CaptureWriter* writer)
+{
+    Lock::Locker locker(&CaptureLock);
+    Capture = writer;
+}
+
+CaptureWriter* Server::GetCaptureWriter() const
+{
+    Lock::Locker locker(&CaptureLock);
+    return Capture;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CaptureWriter::CaptureWriter(const char* basePath, UPInt maxFileBytes, unsigned maxFiles) :
+    BasePath(basePath),
+    MaxFileBytes(Alg::Max<UPInt>(maxFileBytes, 64 * 1024)),
+    MaxFiles(maxFiles),
+    StartTicks(0),
+    Sequence(0),
+    FileBytes(0)
+{
+    memset(&CStats, 0, sizeof(CStats));
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    Close();
+}
+
+String CaptureWriter::MakeFilename(const char* basePath, unsigned index)
+{
+    char suffix[32];
+    SFsprintf(suffix, sizeof(suffix), "_%04u%s", index, Capture_Extension);
+    return String(basePath) + suffix;
+}
+
+bool CaptureWriter::Start()
+{
+    Lock::Locker locker(&CaptureLock);
+    if (pFile)
+        return true;
+    StartTicks = Timer::GetTicks();
+    Sequence   = 0;
+
+    // Files of an earlier recording under the same base path would be
+    // read as part of this one, either past the last file written or,
+    // in a ring, in place of indices not reached yet. SysFile can't
+    // delete, so truncate them all; CaptureReader stops at an empty file.
+    for (unsigned i = 0; ; i++)
+    {
+        String   path = MakeFilename(BasePath, i);
+        FileStat stat;
+        if (!SysFile::GetFileStat(&stat, path))
+            break;
+        SysFile stale(path, File::Open_Write | File::Open_Truncate);
+    }
+    return openNextFile();
+}
+
+bool CaptureWriter::openNextFile()
+{
+    if (pFile)
+    {
+        pFile->Close();
+        pFile = NULL;
+    }
+
+    unsigned index = MaxFiles ? (Sequence % MaxFiles) : Sequence;
+    Ptr<File> pfile = *SF_HEAP_AUTO_NEW(this) SysFile(MakeFilename(BasePath, index),
+                          File::Open_Write | File::Open_Truncate | File::Open_Create | File::Open_Buffered);
+    if (!pfile->IsValid())
+        return false;
+
+    pfile->WriteUInt32(Capture_Magic);
+    pfile->WriteUInt32(FormatVersion);
+    pfile->WriteUInt32(Message::GetLatestVersion());
+    pfile->WriteUInt32(Sequence);
+    pFile     = pfile;
+    FileBytes = Capture_HeaderSize;
+    Sequence++;
+    CStats.Files++;
+
+    // Repeat the state a client needs before it can make sense of
+    // profile frames.
+    UInt64 now = Timer::GetTicks() - StartTicks;
+    for (UPInt i = 0; i < Sticky.GetSize(); i++)
+        writeRecord(now, Sticky[i].Data.GetDataPtr(), Sticky[i].Data.GetSize());
+    return true;
+}
+
+void CaptureWriter::writeRecord(UInt64 time, const UByte* data, UPInt size)
+{
+    pFile->WriteUInt64(time);
+    pFile->WriteUInt32((UInt32)size);
+    pFile->Write(data, (int)size);
+    FileBytes += 12 + size;
+}
+
+void CaptureWriter::addSticky(const String& name, const Array<UByte>& data)
+{
+    // State messages replace their previous version; SWD and source
+    // files are all kept.
+    bool replace = (name == MessageInitState::GetStaticTypeName() ||
+                    name == MessageCurrentState::GetStaticTypeName() ||
+                    name == MessageAppControl::GetStaticTypeName());
+    bool keep    = replace ||
+                   name == MessageSwdFile::GetStaticTypeName() ||
+                   name == MessageSourceFile::GetStaticTypeName();
+    if (!keep)
+        return;
+
+    UPInt i = 0;
+    if (replace)
+    {
+        while (i < Sticky.GetSize() && Sticky[i].Name != name)
+            i++;
+    }
+    else
+        i = Sticky.GetSize();
+
+    if (i == Sticky.GetSize())
+    {
+        Sticky.PushBack(StickyRecord());
+        Sticky[i].Name = name;
+    }
+    Sticky[i].Data.Resize(data.GetSize());
+    if (data.GetSize())
+        memcpy(Sticky[i].Data.GetDataPtr(), data.GetDataPtr(), data.GetSize());
+}
+
+bool CaptureWriter::WriteMessage(const Message* msg)
+{
+    String name = msg->GetMessageName();
+    if (name == MessageHeartbeat::GetStaticTypeName())
+        return true;
+
+    // Compress outside the lock; it is the expensive part.
+    Array<UByte> data;
+    if (!msg->Compress(data))
+    {
+        Lock::Locker locker(&CaptureLock);
+        CStats.FailedMessages++;
+        return false;
+    }
+
+    Lock::Locker locker(&CaptureLock);
+    if (!pFile)
+    {
+        CStats.FailedMessages++;
+        return false;
+    }
+
+    addSticky(name, data);
+    if (FileBytes + data.GetSize() > MaxFileBytes && FileBytes > Capture_HeaderSize)
+    {
+        if (!openNextFile())
+        {
+            CStats.FailedMessages++;
+            return false;
+        }
+    }
+
+    writeRecord(Timer::GetTicks() - StartTicks, data.GetDataPtr(), data.GetSize());
+    CStats.Messages++;
+    CStats.Bytes += data.GetSize();
+    return true;
+}
+
+void CaptureWriter::Flush()
+{
+    Lock::Locker locker(&CaptureLock);
+    if (pFile)
+        pFile->Flush();
+}
+
+void CaptureWriter::Close()
+{
+    Lock::Locker locker(&CaptureLock);
+    if (pFile)
+    {
+        pFile->Close();
+        pFile = NULL;
+    }
+}
+
+CaptureWriter::Stats CaptureWriter::GetStats() const
+{
+    Lock::Locker locker(&CaptureLock);
+    return CStats;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CaptureReader::CaptureReader() :
+    FileIndex(0),
+    MessageVersion(0),
+    LastTime(0)
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+    Close();
+}
+
+bool CaptureReader::readHeader(File* pfile, UInt32* psequence)
+{
+    if (!pfile->IsValid() || pfile->ReadUInt32() != Capture_Magic)
+        return false;
+    if (pfile->ReadUInt32() != CaptureWriter::FormatVersion)
+        return false;
+    MessageVersion = pfile->ReadUInt32();
+    *psequence     = pfile->ReadUInt32();
+    return true;
+}
+
+struct CaptureReader_FileEntry
+{
+    String  Path;
+    UInt32  Sequence;
+    bool operator<(const CaptureReader_FileEntry& other) const { return Sequence < other.Sequence; }
+};
+
+bool CaptureReader::Open(const char* path)
+{
+    Close();
+
+    Array<CaptureReader_FileEntry> entries;
+    String spath(path);
+    UPInt  extLen = sizeof(Capture_Extension) - 1;
+    bool   single = spath.GetSize() > extLen &&
+                    !SFstrcmp(spath.ToCStr() + spath.GetSize() - extLen, Capture_Extension);
+
+    for (unsigned i = 0; ; i++)
+    {
+        CaptureReader_FileEntry e;
+        e.Path = single ? spath : CaptureWriter::MakeFilename(path, i);
+        SysFile file(e.Path, File::Open_Read | File::Open_Buffered);
+        if (!readHeader(&file, &e.Sequence))
+            break;
+        entries.PushBack(e);
+        if (single)
+            break;
+    }
+    if (entries.GetSize() == 0)
+        return false;
+
+    // Ring-buffered recordings reuse file names, so the index in the
+    // name says nothing about order.
+    Alg::QuickSort(entries);
+    for (UPInt i = 0; i < entries.GetSize(); i++)
+        Files.PushBack(entries[i].Path);
+
+    return openFile(0);
+}
+
+bool CaptureReader::openFile(UPInt index)
+{
+    pFile     = NULL;
+    FileIndex = index;
+    if (index >= Files.GetSize())
+        return false;
+
+    Ptr<File> pfile = *SF_HEAP_AUTO_NEW(this) SysFile(Files[index], File::Open_Read | File::Open_Buffered);
+    UInt32 sequence;
+    if (!readHeader(pfile, &sequence))
+        return false;
+    pFile = pfile;
+    return true;
+}
+
+void CaptureReader::Close()
+{
+    pFile = NULL;
+    Files.Clear();
+    FileIndex      = 0;
+    MessageVersion = 0;
+    LastTime       = 0;
+}
+
+bool CaptureReader::ReadNext(UInt64* ptime, ArrayLH<UByte>* pdata)
+{
+    while (pFile)
+    {
+        UInt64 time = pFile->ReadUInt64();
+        UInt32 size = pFile->ReadUInt32();
+        if (pFile->GetErrorCode() == 0 && size > 0 &&
+            pFile->Tell() + (SInt64)size <= pFile->GetLength())
+        {
+            pdata->Resize(size);
+            if (pFile->Read(pdata->GetDataPtr(), (int)size) == (int)size)
+            {
+                LastTime = Alg::Max(LastTime, time);
+                *ptime   = LastTime;
+                return true;
+            }
+        }
+        // End of this file, or a record truncated by a crash.
+        openFile(FileIndex + 1);
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CaptureReplayer::CaptureReplayer() :
+    Speed(1.0f),
+    Loop(false),
+    Connected(false),
+    StartTicks(0),
+    BaseTime(0),
+    NextTime(0),
+    HasNext(false),
+    MessagesSent(0)
+{
+}
+
+CaptureReplayer::~CaptureReplayer()
+{
+}
+
+bool CaptureReplayer::Open(const char* path)
+{
+    Path    = path;
+    pReader = *SF_HEAP_AUTO_NEW(this) CaptureReader();
+    return restart();
+}
+
+bool CaptureReplayer::restart()
+{
+    if (!pReader->Open(Path))
+        return false;
+    HasNext    = pReader->ReadNext(&NextTime, &NextData);
+    StartTicks = 0;
+    return HasNext;
+}
+
+bool CaptureReplayer::Update()
+{
+    if (!pReader)
+        return false;
+
+    Server& server = static_cast<Server&>(AmpServer::GetInstance());
+    if (!server.IsValidConnection())
+    {
+        // Start over for the next client.
+        if (Connected)
+        {
+            Connected = false;
+            restart();
+        }
+        return HasNext || Loop;
+    }
+    Connected = true;
+
+    if (!HasNext && Loop)
+        restart();
+
+    UInt64 now = Timer::GetTicks();
+    if (HasNext && StartTicks == 0)
+    {
+        StartTicks = now;
+        BaseTime   = NextTime;
+    }
+
+    while (HasNext)
+    {
+        if (Speed > 0 && Double(NextTime - BaseTime) > Double(now - StartTicks) * Speed)
+            break;
+
+        // The server takes ownership of the message.
+        MessageCompressed* pmsg = SF_HEAP_AUTO_NEW(this) MessageCompressed();
+        pmsg->AddCompressedData(NextData.GetDataPtr(), NextData.GetSize());
+        server.SendMessage(pmsg);
+        MessagesSent++;
+
+        HasNext = pReader->ReadNext(&NextTime, &NextData);
+    }
+    return HasNext || Loop;
+}
+
+UInt64 CaptureReplayer::Run(unsigned sleepMs)
+{
+    while (Update())
+    {
+        if (sleepMs)
+            Thread::MSleep(sleepMs);
+    }
+    return MessagesSent;
+}
+
+} // namespace AMP
+} // namespace GFx
+} // namespace Scaleform
+
+#endif  // SF_AMP_SERVER
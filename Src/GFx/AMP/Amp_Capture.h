@@ -0,0 +1,200 @@
+/**************************************************************************
+
+PublicHeader:   AMP
+Filename    :   Amp_Capture.h
+Content     :   Recording of the AMP message stream to files, and replay
+                of recorded files to an AMP client
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INCLUDE_FX_AMP_CAPTURE_H
+#define INCLUDE_FX_AMP_CAPTURE_H
+
+#include "GFxConfig.h"
+
+#ifdef SF_AMP_SERVER
+
+#include "GFx/AMP/Amp_Message.h"
+#include "Kernel/SF_File.h"
+#include "Kernel/SF_Threads.h"
+
+namespace Scaleform {
+namespace GFx {
+namespace AMP {
+
+// Capture files hold the same compressed payloads that the server sends
+// as MessageCompressed, so a recording is replayed byte for byte.
+//
+// File layout (little endian):
+//   header:  UInt32 'AMPC', UInt32 FormatVersion, UInt32 message version,
+//            UInt32 sequence number of the file within the recording
+//   records: UInt64 time since the recording started (microseconds),
+//            UInt32 payload size, payload (output of Message::Compress)
+
+// ***** CaptureWriter
+
+// Records outgoing AMP messages when no client is attached (build farm,
+// soak tests). Install with Server::SetCaptureWriter; the server passes
+// every message it sends to WriteMessage through Server::captureMessage.
+// Server::SendMessage is implemented in Amp_Server.cpp, which is not part
+// of this source tree; until it calls captureMessage ahead of its
+// connection check, nothing is recorded.
+//
+// Start truncates the files left by an earlier recording with the same
+// base path, so a recording never mixes with an older one.
+//
+// Files are named <basePath>_NNNN.ampcap. When a file reaches
+// maxFileBytes the next one is started; with maxFiles set, file names
+// are reused in a ring so only the latest maxFiles files are kept. The
+// latest state messages (InitState, CurrentState, AppControl caps) and
+// all SWD and source file messages are repeated at the start of every
+// file, so each file can be replayed on its own. Heartbeats are not
+// recorded.
+
+class CaptureWriter : public RefCountBase<CaptureWriter, StatAmp_Server>
+{
+public:
+    enum { FormatVersion = 1 };
+
+    struct Stats
+    {
+        UInt64      Messages;
+        UInt64      Bytes;              // Payload bytes written.
+        unsigned    Files;              // Files started.
+        unsigned    FailedMessages;     // Messages that could not be compressed or written.
+    };
+
+    CaptureWriter(const char* basePath, UPInt maxFileBytes = 64 * 1024 * 1024, unsigned maxFiles = 0);
+    virtual ~CaptureWriter();
+
+    // Opens the first file. Returns false if it can't be created.
+    bool            Start();
+    // Thread safe; messages are written in call order.
+    bool            WriteMessage(const Message* msg);
+    void            Flush();
+    void            Close();
+
+    Stats           GetStats() const;
+
+    static String   MakeFilename(const char* basePath, unsigned index);
+
+private:
+    bool            openNextFile();
+    void            writeRecord(UInt64 time, const UByte* data, UPInt size);
+
+    struct StickyRecord
+    {
+        String          Name;
+        ArrayLH<UByte>  Data;
+    };
+    void            addSticky(const String& name, const Array<UByte>& data);
+
+    mutable Lock            CaptureLock;
+    String                  BasePath;
+    UPInt                   MaxFileBytes;
+    unsigned                MaxFiles;
+    UInt64                  StartTicks;
+    unsigned                Sequence;
+    UPInt                   FileBytes;
+    Ptr<File>               pFile;
+    ArrayLH<StickyRecord>   Sticky;
+    Stats                   CStats;
+};
+
+
+// ***** CaptureReader
+
+// Reads the records of a recording in order. Open takes either a single
+// .ampcap file or the base path of a recording, in which case all of its
+// files are read in sequence order.
+
+class CaptureReader : public RefCountBase<CaptureReader, StatAmp_Server>
+{
+public:
+    CaptureReader();
+    virtual ~CaptureReader();
+
+    bool            Open(const char* path);
+    void            Close();
+
+    // Returns false at the end of the recording. Times never decrease.
+    bool            ReadNext(UInt64* ptime, ArrayLH<UByte>* pdata);
+
+    UInt32          GetMessageVersion() const { return MessageVersion; }
+
+private:
+    bool            openFile(UPInt index);
+    bool            readHeader(File* pfile, UInt32* psequence);
+
+    ArrayLH<String>         Files;      // In sequence order.
+    UPInt                   FileIndex;
+    Ptr<File>               pFile;
+    UInt32                  MessageVersion;
+    UInt64                  LastTime;
+};
+
+
+// ***** CaptureReplayer
+
+// Serves a recording to an AMP client through the AMP server of the
+// calling process, so the client connects to it as to a live application
+// (typically on localhost). A replay tool only needs to initialize the
+// system with AMP enabled, set the listening port, and call Run.
+
+class CaptureReplayer : public RefCountBase<CaptureReplayer, StatAmp_Server>
+{
+public:
+    CaptureReplayer();
+    virtual ~CaptureReplayer();
+
+    bool            Open(const char* path);
+
+    // Playback speed; 0 sends as fast as the connection allows.
+    void            SetSpeed(float speed)   { Speed = speed; }
+    void            SetLoop(bool loop)      { Loop = loop; }
+
+    // Sends the messages that are due. Waits for a client before sending
+    // anything and restarts the clock when it connects. Returns false
+    // when the recording is finished.
+    bool            Update();
+
+    // Calls Update until the recording ends; returns the number of
+    // messages sent.
+    UInt64          Run(unsigned sleepMs = 5);
+
+    UInt64          GetMessagesSent() const { return MessagesSent; }
+
+private:
+    bool            restart();
+
+    String                  Path;
+    Ptr<CaptureReader>      pReader;
+    float                   Speed;
+    bool                    Loop;
+    bool                    Connected;
+    // Wall clock and recording time at which playback started; times are
+    // relative to the first record sent, since a ring-buffered recording
+    // may start well into the run.
+    UInt64                  StartTicks;
+    UInt64                  BaseTime;
+    UInt64                  NextTime;
+    ArrayLH<UByte>          NextData;
+    bool                    HasNext;
+    UInt64                  MessagesSent;
+};
+
+} // namespace AMP
+} // namespace GFx
+} // namespace Scaleform
+
+#endif  // SF_AMP_SERVER
+
+#endif  // INCLUDE_FX_AMP_CAPTURE_H
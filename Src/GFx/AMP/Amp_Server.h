@@ -32,6 +32,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "GFx/GFx_ImageResource.h"
 #include "Render/Render_HAL.h"
 #include "GFx/AMP/Amp_Message.h"
+#include "GFx/AMP/Amp_Capture.h"
 
 namespace Scaleform {
 
@@ -191,7 +192,13 @@ public:
     virtual SF_GPA_ITT_ID        GetGpaGroupId();
     virtual SF_GPA_ITT_DOMAIN*   GetGpaDomain();
 
+    // Offline capture: every message sent is also written to the capture
+    // files, whether or not a client is connected (see Amp_Capture.h)
+    void            SetCaptureWriter(CaptureWriter* writer);
+    CaptureWriter*  GetCaptureWriter() const;
+
 private:
+    friend class CaptureReplayer;
 
     // Struct that holds loaded SWF information
     struct SwdInfo : public RefCountBase<SwdInfo, StatAmp_Server>
@@ -284,6 +291,10 @@ private:
     Ptr<MessageAppControl>          AppControlCaps;
 
     MemoryHeap*                     ReportHeap;
+
+    // Offline capture of sent messages
+    Ptr<CaptureWriter>              Capture;
+    mutable Lock                    CaptureLock;
     
     // Recording statistics for server-side display
     // Can record statistics for display when not connected to AMP client
@@ -311,6 +322,14 @@ private:
     bool        GetProfilingState() const;
     void        UpdateProfilingState();
     void        SendMessage(Message* msg);
+    // SendMessage passes every message here first, whether or not a
+    // client is connected.
+    void        captureMessage(const Message* msg)
+    {
+        Ptr<CaptureWriter> capture = GetCaptureWriter();
+        if (capture)
+            capture->WriteMessage(msg);
+    }
 
     // Internal helper methods
     bool        IsSocketCreated() const;
@@ -0,0 +1,293 @@
+/**************************************************************************
+
+Filename    :   AS2_ActionDecoded.cpp
+Content     :   Pre-decoded form of AS2 action buffers
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "GFx/AS2/AS2_ActionDecoded.h"
+#include "GFx/AS2/AS2_ActionTypes.h"
+#include "Kernel/SF_HeapNew.h"
+
+namespace Scaleform { namespace GFx { namespace AS2 {
+
+// Opcodes with branch or block operands.
+enum
+{
+    DecodedOp_WaitForFrame      = 0x8A,
+    DecodedOp_ConstantPool      = 0x88,
+    DecodedOp_WaitForFrame2     = 0x8D,
+    DecodedOp_DefineFunction2   = 0x8E,
+    DecodedOp_Try               = 0x8F,
+    DecodedOp_With              = 0x94,
+    DecodedOp_Jump              = 0x99,
+    DecodedOp_DefineFunction    = 0x9B,
+    DecodedOp_If                = 0x9D
+};
+
+static inline UInt32 DecodedAction_ReadU16(const UByte* p)
+{
+    return UInt32(p[0]) | (UInt32(p[1]) << 8);
+}
+
+// Skips a zero-terminated string within [p, pend); returns pend if the
+// terminator is missing.
+static inline const UByte* DecodedAction_SkipString(const UByte* p, const UByte* pend)
+{
+    while (p < pend && *p)
+        p++;
+    return (p < pend) ? p + 1 : pend;
+}
+
+//------------------------------------------------------------------------
+DecodedActionBuffer::DecodedActionBuffer(const UByte* pbuffer, unsigned length)
+    : pBuffer(pbuffer), Length(length)
+{
+}
+
+DecodedActionBuffer* DecodedActionBuffer::CreateNew(const void* powner, const UByte* pbuffer, unsigned length)
+{
+    DecodedActionBuffer* pdecoded = SF_HEAP_AUTO_NEW(powner) DecodedActionBuffer(pbuffer, length);
+    pdecoded->decode();
+    return pdecoded;
+}
+
+void DecodedActionBuffer::decode()
+{
+    unsigned pc = 0;
+    while (pc < Length)
+    {
+        Instr instr;
+        instr.Pc         = pc;
+        instr.Opcode     = pBuffer[pc];
+        instr.Flags      = 0;
+        instr.PayloadLen = 0;
+        instr.Target     = -1;
+
+        // End action terminates the buffer.
+        if (instr.Opcode == 0)
+        {
+            instr.NextPc = pc + 1;
+            Instrs.PushBack(instr);
+            TargetPcs.PushBack(~0u);
+            break;
+        }
+
+        UInt32 targetPc = ~0u;
+        if (instr.Opcode & 0x80)
+        {
+            if (pc + 3 > Length)
+            {
+                instr.Flags |= Instr_Truncated;
+                instr.NextPc = Length;
+            }
+            else
+            {
+                instr.PayloadLen = (UInt16)DecodedAction_ReadU16(pBuffer + pc + 1);
+                instr.NextPc     = pc + 3 + instr.PayloadLen;
+                if (instr.NextPc > Length)
+                {
+                    instr.Flags |= Instr_Truncated;
+                    instr.NextPc = Length;
+                }
+            }
+
+            const UByte* p    = pBuffer + instr.GetPayloadPc();
+            const UByte* pend = pBuffer + instr.NextPc;
+            if (!(instr.Flags & Instr_Truncated))
+            {
+                switch (instr.Opcode)
+                {
+                case DecodedOp_Jump:
+                case DecodedOp_If:
+                    if (instr.PayloadLen >= 2)
+                        targetPc = UInt32(SInt32(instr.NextPc) + (SInt16)DecodedAction_ReadU16(p));
+                    break;
+
+                case DecodedOp_With:
+                    if (instr.PayloadLen >= 2)
+                        targetPc = instr.NextPc + DecodedAction_ReadU16(p);
+                    break;
+
+                case DecodedOp_DefineFunction:
+                    // name, UInt16 numParams, params..., UInt16 codeSize
+                    {
+                        p = DecodedAction_SkipString(p, pend);
+                        if (p + 2 > pend) break;
+                        unsigned n = DecodedAction_ReadU16(p);
+                        p += 2;
+                        for (unsigned i = 0; i < n; i++)
+                            p = DecodedAction_SkipString(p, pend);
+                        if (p + 2 <= pend)
+                            targetPc = instr.NextPc + DecodedAction_ReadU16(p);
+                    }
+                    break;
+
+                case DecodedOp_DefineFunction2:
+                    // name, UInt16 numParams, UInt8 regCount, UInt16 flags,
+                    // (UInt8 reg, name) * numParams, UInt16 codeSize
+                    {
+                        p = DecodedAction_SkipString(p, pend);
+                        if (p + 5 > pend) break;
+                        unsigned n = DecodedAction_ReadU16(p);
+                        p += 5;
+                        for (unsigned i = 0; i < n && p < pend; i++)
+                            p = DecodedAction_SkipString(p + 1, pend);
+                        if (p + 2 <= pend)
+                            targetPc = instr.NextPc + DecodedAction_ReadU16(p);
+                    }
+                    break;
+
+                case DecodedOp_Try:
+                    // UInt8 flags, UInt16 trySize, catchSize, finallySize
+                    if (instr.PayloadLen >= 7)
+                        targetPc = instr.NextPc + DecodedAction_ReadU16(p + 1);
+                    break;
+
+                case DecodedOp_WaitForFrame:
+                    if (instr.PayloadLen >= 3)
+                        instr.Target = SInt32(Instrs.GetSize() + 1 + p[2]);
+                    break;
+
+                case DecodedOp_WaitForFrame2:
+                    if (instr.PayloadLen >= 1)
+                        instr.Target = SInt32(Instrs.GetSize() + 1 + p[0]);
+                    break;
+
+                case DecodedOp_ConstantPool:
+                    decodeConstantPool(instr);
+                    break;
+                }
+            }
+        }
+        else
+        {
+            instr.NextPc = pc + 1;
+        }
+
+        Instrs.PushBack(instr);
+        TargetPcs.PushBack(targetPc);
+        pc = instr.NextPc;
+    }
+
+    resolveTargets();
+}
+
+void DecodedActionBuffer::decodeConstantPool(Instr& instr)
+{
+    const UByte* p    = pBuffer + instr.GetPayloadPc();
+    const UByte* pend = pBuffer + instr.NextPc;
+    if (p + 2 > pend)
+        return;
+
+    Pool pool;
+    pool.Pc          = instr.Pc;
+    pool.FirstString = (UInt32)PoolStrings.GetSize();
+    pool.Count       = 0;
+
+    unsigned count = DecodedAction_ReadU16(p);
+    p += 2;
+    for (unsigned i = 0; i < count && p < pend; i++)
+    {
+        const UByte* pstr = p;
+        p = DecodedAction_SkipString(p, pend);
+        PoolString s;
+        s.Offset = UInt32(pstr - pBuffer);
+        s.Length = UInt32(p - pstr) - ((p[-1] == 0) ? 1 : 0);
+        PoolStrings.PushBack(s);
+        pool.Count++;
+    }
+
+    instr.Target = SInt32(Pools.GetSize());
+    Pools.PushBack(pool);
+}
+
+void DecodedActionBuffer::resolveTargets()
+{
+    int count = (int)Instrs.GetSize();
+    for (int i = 0; i < count; i++)
+    {
+        Instr& instr = Instrs[i];
+        if (instr.Opcode == DecodedOp_WaitForFrame || instr.Opcode == DecodedOp_WaitForFrame2)
+        {
+            if (instr.Target >= 0)
+            {
+                instr.Target = Alg::Min(instr.Target, count);
+                instr.Flags |= Instr_HasTarget;
+            }
+            continue;
+        }
+        if (TargetPcs[i] == ~0u)
+            continue;
+
+        int target = FindInstr(TargetPcs[i]);
+        if (target >= 0)
+        {
+            instr.Target = target;
+            instr.Flags |= Instr_HasTarget;
+        }
+        else
+            instr.Flags |= Instr_BadTarget;
+    }
+    // Targets are only needed while decoding.
+    TargetPcs.ClearAndRelease();
+}
+
+//------------------------------------------------------------------------
+int DecodedActionBuffer::FindInstr(unsigned pc) const
+{
+    UPInt count = Instrs.GetSize();
+    if (count == 0 || pc >= Instrs[count - 1].NextPc)
+        return (count && pc == Instrs[count - 1].NextPc) ? (int)count : -1;
+
+    UPInt lo = 0, hi = count;
+    while (lo < hi)
+    {
+        UPInt mid = (lo + hi) >> 1;
+        if (Instrs[mid].Pc < pc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < count && Instrs[lo].Pc == pc) ? (int)lo : -1;
+}
+
+int DecodedActionBuffer::FindPool(unsigned pc) const
+{
+    int i = FindInstr(pc);
+    if (i < 0 || i >= (int)Instrs.GetSize() || Instrs[i].Opcode != DecodedOp_ConstantPool)
+        return -1;
+    return Instrs[i].Target;
+}
+
+const char* DecodedActionBuffer::GetPoolString(const Pool& pool, unsigned i, UPInt* plength) const
+{
+    SF_ASSERT(i < pool.Count);
+    const PoolString& s = PoolStrings[pool.FirstString + i];
+    if (plength)
+        *plength = s.Length;
+    return (const char*)pBuffer + s.Offset;
+}
+
+void DecodedActionBuffer::InternPool(ASStringContext* psc, unsigned poolIndex,
+                                     ArrayCC<ASString, StatMV_ActionScript_Mem>* pdictionary) const
+{
+    const Pool& pool = Pools[poolIndex];
+    pdictionary->Resize(pool.Count);
+    for (unsigned i = 0; i < pool.Count; i++)
+    {
+        UPInt       length;
+        const char* pstr = GetPoolString(pool, i, &length);
+        (*pdictionary)[i] = psc->CreateString(pstr, length);
+    }
+}
+
+}}} // namespace Scaleform::GFx::AS2
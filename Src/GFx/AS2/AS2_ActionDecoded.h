@@ -0,0 +1,125 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   AS2_ActionDecoded.h
+Content     :   Pre-decoded form of AS2 action buffers
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_GFX_AS2_ACTIONDECODED_H
+#define INC_SF_GFX_AS2_ACTIONDECODED_H
+
+#include "Kernel/SF_RefCount.h"
+#include "Kernel/SF_Array.h"
+#include "GFx/GFx_ASString.h"
+#include "GFx/GFx_PlayerStats.h"
+
+namespace Scaleform { namespace GFx { namespace AS2 {
+
+class ASStringContext;
+
+// ***** DecodedActionBuffer
+
+// Instruction index of an action buffer, built once per ActionBufferData
+// and therefore shared by every movie view instantiated from the same
+// MovieDataDef. The interpreter can step through Instrs instead of
+// re-parsing opcode lengths, take branches through precomputed instruction
+// indices, and fill its constant pool dictionary from pre-scanned string
+// offsets without walking the pool bytes again.
+//
+// ASStrings themselves can't be shared here: each movie view interns into
+// its own ASStringManager. InternPool produces the per-view dictionary,
+// which ActionBuffer keeps between executions (DeclDictProcessedAt).
+//
+// Offsets refer to the byte code owned by the ActionBufferData that
+// created this object.
+class DecodedActionBuffer : public RefCountBase<DecodedActionBuffer, StatMD_ASBinaryData_Mem>
+{
+public:
+    enum InstrFlags
+    {
+        Instr_HasTarget     = 0x01, // Target is a resolved instruction index.
+        Instr_BadTarget     = 0x02, // Target pc is not on an instruction boundary.
+        Instr_Truncated     = 0x04  // Payload runs past the buffer end.
+    };
+
+    struct Instr
+    {
+        UInt32      Pc;         // Offset of the opcode byte.
+        UInt32      NextPc;     // Offset following the payload.
+        UByte       Opcode;
+        UByte       Flags;
+        UInt16      PayloadLen;
+        // Jump/If: branch target. DefineFunction/DefineFunction2/With:
+        // first instruction after the block. Try: end of the try block.
+        // ConstantPool: pool index. WaitForFrame/WaitForFrame2: instruction
+        // reached after skipping. Otherwise -1.
+        SInt32      Target;
+
+        UInt32      GetPayloadPc() const    { return Pc + 3; }
+        bool        HasTarget() const       { return (Flags & Instr_HasTarget) != 0; }
+    };
+
+    struct PoolString
+    {
+        UInt32      Offset;     // Byte offset of the first character.
+        UInt32      Length;     // Excluding the terminating zero.
+    };
+
+    struct Pool
+    {
+        UInt32      Pc;
+        UInt32      FirstString;
+        UInt32      Count;
+    };
+
+    // Decodes the buffer; never fails, malformed tails are marked
+    // Instr_Truncated so the interpreter can fall back to the byte path.
+    // The result is allocated in the heap that holds powner (the owning
+    // ActionBufferData), so it lives and dies with the data it indexes.
+    static DecodedActionBuffer* CreateNew(const void* powner, const UByte* pbuffer, unsigned length);
+
+    unsigned        GetInstrCount() const           { return (unsigned)Instrs.GetSize(); }
+    const Instr&    GetInstr(unsigned i) const      { return Instrs[i]; }
+    // Index of the instruction that starts at pc; GetInstrCount() for the
+    // end of the buffer, -1 if pc is not on an instruction boundary.
+    int             FindInstr(unsigned pc) const;
+
+    unsigned        GetPoolCount() const            { return (unsigned)Pools.GetSize(); }
+    const Pool&     GetPool(unsigned i) const       { return Pools[i]; }
+    // Pool declared by the ConstantPool instruction at pc, or -1.
+    int             FindPool(unsigned pc) const;
+
+    const char*     GetPoolString(const Pool& pool, unsigned i, UPInt* plength) const;
+
+    // Creates the ASStrings for a pool in the view's string manager.
+    void            InternPool(ASStringContext* psc, unsigned poolIndex,
+                               ArrayCC<ASString, StatMV_ActionScript_Mem>* pdictionary) const;
+
+private:
+    DecodedActionBuffer(const UByte* pbuffer, unsigned length);
+    void            decode();
+    void            decodeConstantPool(Instr& instr);
+    void            resolveTargets();
+
+    const UByte*    pBuffer;
+    unsigned        Length;
+
+    ArrayLH_POD<Instr, StatMD_ASBinaryData_Mem>         Instrs;
+    ArrayLH_POD<Pool, StatMD_ASBinaryData_Mem>          Pools;
+    ArrayLH_POD<PoolString, StatMD_ASBinaryData_Mem>    PoolStrings;
+    // Target pcs of branches and blocks, resolved after decoding.
+    ArrayLH_POD<UInt32, StatMD_ASBinaryData_Mem>        TargetPcs;
+};
+
+}}} // namespace Scaleform::GFx::AS2
+
+#endif // INC_SF_GFX_AS2_ACTIONDECODED_H
@@ -30,6 +30,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "GFx/GFx_Input.h"
 #include "GFx/GFx_ButtonDef.h"
 #include "GFx/AS2/AS2_RefCountCollector.h"
+#include "GFx/AS2/AS2_ActionDecoded.h"
 #include "Render/Text/Text_Core.h"
 
 #include <stdio.h>
@@ -232,7 +233,13 @@ protected:
         //SF_ASSERT(pdataDef);
     }
 public:
-    ~ActionBufferData() { if (pBuffer) SF_FREE(pBuffer); }
+    ~ActionBufferData()
+    {
+        DecodedActionBuffer* pdecoded = pDecoded;
+        if (pdecoded)
+            pdecoded->Release();
+        if (pBuffer) SF_FREE(pBuffer);
+    }
 
     // Use this method to create an instance
     static ActionBufferData* CreateNew();
@@ -255,6 +262,24 @@ public:
 #endif
     }
 
+    // Returns the pre-decoded instruction index, building it on first use.
+    // ActionBufferData lives in the MovieDataDef, so the decoded form is
+    // shared by all movie views of the file. Safe to call from multiple
+    // threads; a losing racer discards its copy.
+    const DecodedActionBuffer* GetDecoded()
+    {
+        DecodedActionBuffer* pdecoded = pDecoded;
+        if (pdecoded || IsNull())
+            return pdecoded;
+        pdecoded = DecodedActionBuffer::CreateNew(this, pBuffer, BufferLen);
+        if (!pDecoded.CompareAndSet_Sync(0, pdecoded))
+        {
+            pdecoded->Release();
+            pdecoded = pDecoded;
+        }
+        return pdecoded;
+    }
+
     // Reads action instructions from the SWF file stream (DoActions/DoInitActions tags)
     void                Read(Stream* in, unsigned actionLength);
     // Reads actions from event handlers.
@@ -267,6 +292,9 @@ protected:
     UInt32              SwdHandle;
     UInt32              SWFFileOffset;
 
+    // Owned reference; see GetDecoded.
+    AtomicPtr<DecodedActionBuffer> pDecoded;
+
 #ifdef SF_BUILD_DEBUG
     StringLH           FileName;
 #endif
@@ -315,6 +343,7 @@ public:
     unsigned     GetLength() const    { return pBufferData->GetLength(); }
     const UByte* GetBufferPtr() const { return pBufferData->GetBufferPtr(); }
     const ActionBufferData* GetBufferData() const { return pBufferData.GetPtr(); }
+    const DecodedActionBuffer* GetDecoded() const { return pBufferData->GetDecoded(); }
 
 protected:
     // Used in GotoFrame2 (0x9F) and WaitForFrame2 (0x8D)
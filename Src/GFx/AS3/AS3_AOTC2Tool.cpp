@@ -0,0 +1,710 @@
+/**************************************************************************
+
+Filename    :   AS3_AOTC2Tool.cpp
+Content     :   Hot method selection and C++ module output for AOTC2
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "AS3_AOTC2Tool.h"
+#include "Kernel/SF_Std.h"
+#include "Kernel/SF_Alg.h"
+
+#if defined(SF_AS3_AOTC2)
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+namespace AOT
+{
+    ///////////////////////////////////////////////////////////////////////////
+    HotMethodProfile::HotMethodProfile(MemoryHeap* heap)
+        : NameToEntry(heap)
+        , Entries(heap)
+        , Forced(heap)
+        , Selected(heap)
+        , TotalTime(0)
+        , SelectedTime(0)
+    {
+    }
+
+#ifdef SF_ENABLE_STATS
+    void HotMethodProfile::AddFunctionStats(const GFx::AMP::MovieFunctionStats& stats)
+    {
+        for (UPInt i = 0; i < stats.FunctionTimings.GetSize(); ++i)
+        {
+            const GFx::AMP::MovieFunctionStats::FuncStats& fs = stats.FunctionTimings[i];
+            const Ptr<GFx::AMP::FunctionDesc>* desc = stats.FunctionInfo.Get(fs.FunctionId);
+
+            // Only AS3 functions with a known name can be matched against
+            // method bodies.
+            if (desc == NULL || (*desc)->ASVersion != 3 || (*desc)->Name.IsEmpty())
+                continue;
+
+            const String name((*desc)->Name.ToCStr());
+            UPInt ind;
+            if (!NameToEntry.Get(name, &ind))
+            {
+                ind = Entries.GetSize();
+                FuncEntry e;
+                e.Name  = name;
+                e.Time  = 0;
+                e.Calls = 0;
+                Entries.PushBack(e);
+                NameToEntry.Add(name, ind);
+            }
+
+            Entries[ind].Time  += fs.TotalTime;
+            Entries[ind].Calls += fs.TimesCalled;
+            TotalTime += fs.TotalTime;
+        }
+    }
+#endif
+
+    bool HotMethodProfile::AddForcedList(File* file)
+    {
+        if (file == NULL || !file->IsValid())
+            return false;
+
+        const int len = file->GetLength();
+        if (len <= 0)
+            return len == 0;
+
+        ArrayDH<char> buf(Memory::GetGlobalHeap());
+        buf.Resize(len + 1);
+        if (file->Read(reinterpret_cast<UByte*>(buf.GetDataPtr()), len) != len)
+            return false;
+        buf[len] = 0;
+
+        char* line = buf.GetDataPtr();
+        while (*line)
+        {
+            char* end = line;
+            while (*end && *end != '\n' && *end != '\r' && *end != '#')
+                ++end;
+            char* next = end;
+            while (*next && *next != '\n')
+                ++next;
+            if (*next)
+                ++next;
+
+            // Trim trailing blanks.
+            while (end > line && (end[-1] == ' ' || end[-1] == '\t'))
+                --end;
+            while (line < end && (*line == ' ' || *line == '\t'))
+                ++line;
+            if (line < end)
+                Forced.Set(String(line, end - line));
+
+            line = next;
+        }
+
+        return true;
+    }
+
+    void HotMethodProfile::Select(float timeShare, unsigned maxCount)
+    {
+        Selected.Clear();
+        SelectedTime = 0;
+
+        for (HashSetDH<String, String::HashFunctor>::ConstIterator it = Forced.Begin(); !it.IsEnd(); ++it)
+            Selected.Set(*it);
+
+        if (Entries.GetSize() == 0)
+            return;
+
+        Alg::QuickSort(Entries, cmpTime);
+        // Sorting invalidates the name index.
+        NameToEntry.Clear();
+        for (UPInt i = 0; i < Entries.GetSize(); ++i)
+            NameToEntry.Add(Entries[i].Name, i);
+
+        const UInt64 limit = UInt64(Double(TotalTime) * Alg::Clamp(timeShare, 0.0f, 1.0f));
+        unsigned count = 0;
+        for (UPInt i = 0; i < Entries.GetSize(); ++i)
+        {
+            if (SelectedTime >= limit || (maxCount && count >= maxCount))
+                break;
+
+            const FuncEntry& e = Entries[i];
+            if (e.Time == 0)
+                break;
+
+            Selected.Set(e.Name);
+            SelectedTime += e.Time;
+            ++count;
+        }
+    }
+
+    bool HotMethodProfile::IsHot(const String& name) const
+    {
+        return Selected.Get(name) != NULL;
+    }
+
+    void HotMethodProfile::GetSelectedMethods(const InfoCollector& info, ArrayDH<UMbiInd>* pmethods) const
+    {
+        for (InfoCollector::TFunctNameHash::ConstIterator it = info.FunctNameHash.Begin(); !it.IsEnd(); ++it)
+        {
+            if (IsHot(it->Second))
+                pmethods->PushBack(it->First);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // VM helpers for the branch conditions, in SNodeIF::OP order. Each pops
+    // its operands off the operand stack and returns whether to branch.
+    static const char* const IFFunct[SNodeIF::opNum] =
+    {
+        "exec_ifnlt", "exec_ifnle", "exec_ifngt", "exec_ifnge",
+        "exec_iftrue", "exec_iffalse",
+        "exec_ifeq", "exec_ifne", "exec_iflt", "exec_ifle", "exec_ifgt", "exec_ifge",
+        "exec_ifstricteq", "exec_ifstrictne",
+
+        "exec_iftrue_tb", "exec_iffalse_tb",
+
+        "exec_ifnlt_ti", "exec_ifnle_ti", "exec_ifngt_ti", "exec_ifnge_ti",
+        "exec_ifeq_ti", "exec_ifge_ti", "exec_ifgt_ti", "exec_ifle_ti",
+        "exec_iflt_ti", "exec_ifne_ti",
+
+        "exec_ifgt_td", "exec_ifle_td", "exec_iflt_td", "exec_ifne_td",
+        "exec_ifnlt_td", "exec_ifnle_td", "exec_ifngt_td", "exec_ifnge_td",
+        "exec_ifeq_td", "exec_ifge_td"
+    };
+
+    // Unary operations in SNode1::OP order: a prefix operator, or a VM
+    // helper called with the operand. NULL means there is no C++ form.
+    struct CppOpInfo
+    {
+        const char* Operator;
+        const char* VMFunct;
+    };
+
+    static const CppOpInfo Op1Info[] =
+    {
+        { NULL, "exec_throw" },         // opThrow
+        { "!",  NULL },                 // opNot
+        { "-",  NULL },                 // opNegate
+        { "++", NULL },                 // opIncr
+        { "--", NULL },                 // opDecr
+        { NULL, "exec_convert_s" },     // opConvertS
+        { NULL, "exec_coerce_s" },      // opCoerceS
+        { NULL, "exec_typeof" },        // opTypeOf
+        { "~",  NULL },                 // opBitNot
+        { NULL, NULL },                 // opDelete
+        { NULL, NULL }                  // opNewClass
+    };
+
+    // Binary operations in SNode2::OP order: an infix operator, or a VM
+    // helper called with both operands.
+    static const CppOpInfo Op2Info[] =
+    {
+        { " = ",   NULL },              // opAssign
+        { " += ",  NULL },              // opAssignAdd
+        { " -= ",  NULL },              // opAssignSub
+        { " *= ",  NULL },              // opAssignMul
+        { " /= ",  NULL },              // opAssignDiv
+        { " %= ",  NULL },              // opAssignModulo
+        { " + ",   NULL },              // opAdd
+        { " - ",   NULL },              // opSub
+        { " * ",   NULL },              // opMul
+        { " / ",   NULL },              // opDiv
+        { " % ",   NULL },              // opModulo
+        { " | ",   NULL },              // opBitOr
+        { " ^ ",   NULL },              // opBitXOr
+        { " & ",   NULL },              // opBitAnd
+        { " << ",  NULL },              // opLSchift
+        { " >> ",  NULL },              // opRSchift
+        { NULL,    "exec_urshift" },    // opURSchift
+        { NULL,    "exec_nextvalue" },  // opNextValue
+        { NULL,    NULL },              // opAsType
+        { NULL,    "exec_astypelate" }  // opAsTypeLate
+    };
+
+    CppPrinter::CppPrinter(MemoryHeap* heap, StringBuffer& out, unsigned indent)
+        : Out(out)
+        , pOut(&out)
+        , BaseIndent(indent)
+        , Indent(indent)
+        , Supported(true)
+        , Collecting(false)
+        , JumpTargets(heap)
+    {
+        SF_COMPILER_ASSERT(sizeof(Op1Info) / sizeof(Op1Info[0]) == SNode1::opNewClass + 1);
+        SF_COMPILER_ASSERT(sizeof(Op2Info) / sizeof(Op2Info[0]) == SNode2::opAsTypeLate + 1);
+    }
+
+    bool CppPrinter::Print(SNodeBlock& body)
+    {
+        // The first pass finds the blocks that gotos jump to, so that only
+        // those get labels; its output is thrown away.
+        StringBuffer scratch(Memory::GetGlobalHeap());
+        JumpTargets.Clear();
+        Supported  = true;
+        Collecting = true;
+        pOut       = &scratch;
+        Indent     = BaseIndent;
+        body.Accept(*this);
+
+        Collecting = false;
+        pOut       = &Out;
+        Indent     = BaseIndent;
+        if (Supported)
+            body.Accept(*this);
+        return Supported;
+    }
+
+    bool CppPrinter::isStatement(const SNode& n)
+    {
+        switch (n.GetType())
+        {
+        case SNode::tBlock:
+        case SNode::tOC:
+        case SNode::tSwitchOC:
+        case SNode::tIF:
+        case SNode::tAbrupt:
+            return true;
+        case SNode::tStr:
+            return static_cast<const SNodeStr&>(n).Is(SNodeStr::tComment);
+        default:
+            break;
+        }
+        return false;
+    }
+
+    void CppPrinter::printIndent()
+    {
+        for (unsigned i = 0; i < Indent; ++i)
+            *pOut << "    ";
+    }
+
+    void CppPrinter::printLabel(UInt32 addr)
+    {
+        // The empty statement keeps a label at the end of a block legal.
+        *pOut << "    L" << unsigned(addr) << ": ;\n";
+    }
+
+    void CppPrinter::printExpr(SNode* n)
+    {
+        if (n)
+            n->Accept(*this);
+        else
+            unsupported("missing operand");
+    }
+
+    void CppPrinter::printNested(SNodeBlock* n)
+    {
+        printIndent();
+        *pOut << "{\n";
+        ++Indent;
+        if (n)
+            n->Accept(*this);
+        --Indent;
+        printIndent();
+        *pOut << "}\n";
+    }
+
+    void CppPrinter::unsupported(const char* what)
+    {
+        Supported = false;
+        *pOut << "/* unsupported: " << what << " */";
+    }
+
+    void CppPrinter::VisitSNodeStr(SNodeStr& n)
+    {
+        if (n.Is(SNodeStr::tComment))
+        {
+            printIndent();
+            *pOut << "// " << n.V << "\n";
+        }
+        else
+            *pOut << n.V;
+    }
+
+    void CppPrinter::VisitSNodeValue(SNodeValue& n)
+    {
+        if (n.Is(SNodeValue::tAbsObject))
+            unsupported("abstract object");
+        else
+            *pOut << n.V;
+    }
+
+    void CppPrinter::VisitSNodeVar(SNodeVar& n)
+    {
+        if (n.Is(SNodeVar::tSubscript))
+            unsupported("subscript");
+        else
+            *pOut << n.Name;
+    }
+
+    void CppPrinter::VisitSNodeMbrAcc(SNodeMbrAcc& n)
+    {
+        if (n.Is(SNodeMbrAcc::tAS3))
+        {
+            unsupported("AS3 member access");
+            return;
+        }
+
+        printExpr(n.Obj);
+        *pOut << (n.Is(SNodeMbrAcc::tCppPtr) ? "->" : ".");
+        printExpr(n.Mbr);
+    }
+
+    void CppPrinter::VisitSNode1(SNode1& n)
+    {
+        const CppOpInfo& info = Op1Info[n.Op];
+        if (info.Operator)
+        {
+            *pOut << "(" << info.Operator;
+            printExpr(n.V);
+            *pOut << ")";
+        }
+        else if (info.VMFunct)
+        {
+            *pOut << "vm." << info.VMFunct << "(";
+            printExpr(n.V);
+            *pOut << ")";
+        }
+        else
+            unsupported("unary operation");
+    }
+
+    void CppPrinter::VisitSNode2(SNode2& n)
+    {
+        const CppOpInfo& info = Op2Info[n.Op];
+        if (info.Operator)
+        {
+            // Assignments are statements; everything else is parenthesized
+            // so the tree's grouping survives C++ precedence.
+            const bool assign = n.Op <= SNode2::opAssignModulo;
+            if (!assign)
+                *pOut << "(";
+            printExpr(n.L);
+            *pOut << info.Operator;
+            printExpr(n.R);
+            if (!assign)
+                *pOut << ")";
+        }
+        else if (info.VMFunct)
+        {
+            *pOut << "vm." << info.VMFunct << "(";
+            printExpr(n.L);
+            *pOut << ", ";
+            printExpr(n.R);
+            *pOut << ")";
+        }
+        else
+            unsupported("binary operation");
+    }
+
+    void CppPrinter::VisitSNodeBlock(SNodeBlock& n)
+    {
+        if (!Collecting && JumpTargets.Get(n.GetAddr()))
+            printLabel(n.GetAddr());
+
+        for (SNode* e = n.Elems.GetFirst(); !n.Elems.IsNull(e); e = e->GetNext())
+        {
+            if (isStatement(*e))
+            {
+                e->Accept(*this);
+                continue;
+            }
+
+            printIndent();
+            e->Accept(*this);
+            *pOut << ";\n";
+        }
+    }
+
+    void CppPrinter::VisitSNodeOC(SNodeOC& n)
+    {
+        const SNodeOC::Info& info = SNodeOC::OCInfo[n.GetOP()];
+        if (info.VMFunct == NULL)
+        {
+            unsupported("opcode");
+            return;
+        }
+
+        printIndent();
+        *pOut << "vm." << info.VMFunct << "(";
+        if (info.ArgNum > 0)
+            *pOut << int(n.GetVal1());
+        if (info.ArgNum > 1)
+            *pOut << ", " << int(n.GetVal2());
+        *pOut << ");\n";
+    }
+
+    void CppPrinter::VisitSNodeSwitchOC(SNodeSwitchOC& n)
+    {
+        printIndent();
+        *pOut << "switch (vm.exec_lookupswitch())\n";
+        printIndent();
+        *pOut << "{\n";
+        for (UPInt i = 0; i < n.GetNumOfCases(); ++i)
+        {
+            printIndent();
+            *pOut << "case " << unsigned(i) << ":\n";
+            printNested(n.GetCase(i));
+            printIndent();
+            *pOut << "    break;\n";
+        }
+        printIndent();
+        *pOut << "default:\n";
+        printNested(n.GetDefault());
+        printIndent();
+        *pOut << "}\n";
+    }
+
+    void CppPrinter::VisitSNodeIF(SNodeIF& n)
+    {
+        printIndent();
+        *pOut << "if (vm." << IFFunct[n.GetOP()] << "())\n";
+        printNested(n.GetTrue());
+        if (n.GetFalse())
+        {
+            printIndent();
+            *pOut << "else\n";
+            printNested(n.GetFalse());
+        }
+    }
+
+    void CppPrinter::VisitSNodeAbrupt(SNodeAbrupt& n)
+    {
+        printIndent();
+        switch (n.Op)
+        {
+        case SNodeAbrupt::opReturn:
+            *pOut << "return;\n";
+            break;
+        case SNodeAbrupt::opReturnValue:
+            *pOut << "result = ";
+            printExpr(n.ReturnValue);
+            *pOut << ";\n";
+            printIndent();
+            *pOut << "return;\n";
+            break;
+        case SNodeAbrupt::opGoto:
+            if (!n.Dest)
+            {
+                unsupported("goto without target");
+                break;
+            }
+            if (Collecting)
+                JumpTargets.Set(n.Dest->GetAddr());
+            *pOut << "goto L" << unsigned(n.Dest->GetAddr()) << ";\n";
+            break;
+        case SNodeAbrupt::opBreak:
+            *pOut << "break;\n";
+            break;
+        case SNodeAbrupt::opContinue:
+            *pOut << "continue;\n";
+            break;
+        }
+    }
+
+    void CppPrinter::VisitSNodeN(SNodeN& n)
+    {
+        *pOut << n.Name << "(";
+        for (UPInt i = 0; i < n.Args.GetSize(); ++i)
+        {
+            if (i > 0)
+                *pOut << ", ";
+            printExpr(n.Args[i]);
+        }
+        *pOut << ")";
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    CppModuleWriter::CppModuleWriter(MemoryHeap* heap, const char* moduleName)
+        : pHeap(heap)
+        , ModuleName(moduleName)
+        , Includes(heap)
+        , Methods(heap)
+    {
+    }
+
+    void CppModuleWriter::AddInclude(const char* header)
+    {
+        Includes.PushBack(String(header));
+    }
+
+    void CppModuleWriter::AddMethod(UInt32 abcHash, const char* abcFileName, Abc::MbiInd mbi,
+                                    const UInt8* code, UPInt codeSize,
+                                    const String& qualifiedName, const StringBuffer& body)
+    {
+        Method m;
+        m.AbcHash       = abcHash;
+        m.FileName      = abcFileName;
+        m.MethodBodyInd = mbi.Get();
+        m.Code.Append(code, codeSize);
+        m.Name          = qualifiedName;
+        m.Body          = String(body.ToCStr(), body.GetSize());
+
+        // Identifiers must be unique within the module; the method body
+        // index already is, the name only makes the output readable.
+        char num[32];
+        SFsprintf(num, sizeof(num), "_%u_%u", unsigned(Methods.GetSize()), unsigned(m.MethodBodyInd));
+        StringBuffer id;
+        id += "aot_";
+        appendCppIdentifier(id, qualifiedName.ToCStr());
+        id += num;
+        m.CppName = String(id.ToCStr(), id.GetSize());
+
+        Methods.PushBack(m);
+    }
+
+    bool CppModuleWriter::AddMethod(UInt32 abcHash, const char* abcFileName, Abc::MbiInd mbi,
+                                    const UInt8* code, UPInt codeSize,
+                                    const String& qualifiedName, SNodeBlock& body)
+    {
+        StringBuffer text(pHeap);
+        CppPrinter   printer(pHeap, text);
+        if (!printer.Print(body))
+            return false;
+
+        AddMethod(abcHash, abcFileName, mbi, code, codeSize, qualifiedName, text);
+        return true;
+    }
+
+    String CppModuleWriter::GetRegisterFunctionName() const
+    {
+        StringBuffer name(pHeap);
+        name += "Register";
+        appendCppIdentifier(name, ModuleName.ToCStr());
+        return String(name.ToCStr(), name.GetSize());
+    }
+
+    void CppModuleWriter::appendCppIdentifier(StringBuffer& out, const char* name)
+    {
+        for (; *name; ++name)
+        {
+            const char c = *name;
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+                out += c;
+            else
+                out += '_';
+        }
+    }
+
+    void CppModuleWriter::appendCString(StringBuffer& out, const String& str)
+    {
+        out += '"';
+        for (const char* p = str.ToCStr(); *p; ++p)
+        {
+            const char c = *p;
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (c == '\n')
+                out += "\\n";
+            else
+                out += c;
+        }
+        out += '"';
+    }
+
+    void CppModuleWriter::Write(StringBuffer& out) const
+    {
+        char num[32];
+
+        out += "// Generated by AOTC2 from module '";
+        out += ModuleName;
+        out += "'. Do not edit.\n\n";
+        out += "#include \"GFx/AS3/AS3_AOTNativeMethods.h\"\n";
+        for (UPInt i = 0; i < Includes.GetSize(); ++i)
+        {
+            out += "#include \"";
+            out += Includes[i];
+            out += "\"\n";
+        }
+        out += "\nnamespace Scaleform { namespace GFx { namespace AS3\n{\n\n";
+        out += "namespace AOT\n{\n";
+
+        for (UPInt i = 0; i < Methods.GetSize(); ++i)
+        {
+            const Method& m = Methods[i];
+            out += "    // ";
+            out += m.Name;
+            out += "\n    static void ";
+            out += m.CppName;
+            out += "(const ThunkInfo& ti, VM& vm, const Value& _this, Value& result, unsigned argc, Value* argv)\n";
+            out += "    {\n";
+            out += "        SF_UNUSED3(ti, vm, _this); SF_UNUSED3(result, argc, argv);\n";
+            out += m.Body;
+            out += "    }\n\n";
+
+            // Bytecode the body was compiled from.
+            out += "    static const UInt8 ";
+            out += m.CppName;
+            out += "_code[] =\n    {";
+            for (UPInt j = 0; j < m.Code.GetSize(); ++j)
+            {
+                SFsprintf(num, sizeof(num), "%s0x%02X,", (j % 16) ? " " : "\n        ", unsigned(m.Code[j]));
+                out += num;
+            }
+            // Keep the array non-empty.
+            out += m.Code.GetSize() ? "\n    };\n\n" : "\n        0\n    };\n\n";
+        }
+
+        // A module without methods still gets a valid, empty table.
+        out += "    static const NativeMethodEntry Entries[] =\n    {\n";
+        for (UPInt i = 0; i < Methods.GetSize(); ++i)
+        {
+            const Method& m = Methods[i];
+            SFsprintf(num, sizeof(num), "        { 0x%08X, %u, ", unsigned(m.AbcHash), unsigned(m.MethodBodyInd));
+            out += num;
+            out += m.CppName;
+            SFsprintf(num, sizeof(num), "_code, %u, ", unsigned(m.Code.GetSize()));
+            out += num;
+            appendCString(out, m.FileName);
+            out += ", ";
+            appendCString(out, m.Name);
+            out += ", &";
+            out += m.CppName;
+            out += " },\n";
+        }
+        out += "        { 0, 0, NULL, 0, NULL, NULL, NULL }\n    };\n\n";
+        SFsprintf(num, sizeof(num), "%u", unsigned(Methods.GetSize()));
+        out += "    static NativeMethodRegistrar Registrar(Entries, ";
+        out += num;
+        out += ");\n\n";
+
+        // An explicit entry point: a static registrar alone would be
+        // dropped along with this object file when it is linked from a
+        // static library.
+        out += "    // Called by the host before it creates VMs.\n";
+        out += "    void ";
+        out += GetRegisterFunctionName();
+        out += "()\n    {\n";
+        out += "        NativeMethodTable::Register(Registrar);\n";
+        out += "    }\n";
+
+        out += "} // namespace AOT\n\n";
+        out += "}}} // namespace Scaleform { namespace GFx { namespace AS3\n";
+    }
+
+    bool CppModuleWriter::Write(File* file) const
+    {
+        if (file == NULL || !file->IsWritable())
+            return false;
+
+        StringBuffer out(Memory::GetGlobalHeap());
+        Write(out);
+
+        const int size = int(out.GetSize());
+        return file->Write(reinterpret_cast<const UByte*>(out.ToCStr()), size) == size;
+    }
+
+} // namespace AOT
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3
+
+#endif // SF_AS3_AOTC2
@@ -0,0 +1,198 @@
+/**************************************************************************
+
+Filename    :   AS3_AOTC2Tool.h
+Content     :   Hot method selection and C++ module output for AOTC2
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_AS3_AOTC2TOOL_H
+#define INC_AS3_AOTC2TOOL_H
+
+#include "GFxConfig.h"
+#include "AS3_AOTNativeMethods.h"
+#include "AS3_AOTC2.h"
+#include "Kernel/SF_File.h"
+#include "GFx/AMP/Amp_ProfileFrame.h"
+
+#if defined(SF_AS3_AOTC2)
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+namespace AOT
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Picks the methods worth compiling ahead of time from AMP function
+    // profiles. Times are accumulated per function over all callers and
+    // all merged profiles; Select keeps the smallest set of functions that
+    // covers the requested share of total AS time.
+    //
+    // AMP identifies functions by name only. GetSelectedMethods maps the
+    // selection to method bodies through the names InfoCollector builds
+    // while the compiler walks the ABC (InfoCollector::FunctNameHash);
+    // selected names without a method body there (native or unreached
+    // functions) are skipped.
+    class HotMethodProfile
+    {
+    public:
+        HotMethodProfile(MemoryHeap* heap);
+
+#ifdef SF_ENABLE_STATS
+        // Merges the function timings of one AMP profile frame (or of a
+        // MovieFunctionStats accumulated over a whole capture).
+        void        AddFunctionStats(const GFx::AMP::MovieFunctionStats& stats);
+#endif
+        // Adds names from a text file, one qualified function name per
+        // line; these are always selected. '#' starts a comment.
+        bool        AddForcedList(File* file);
+
+        // timeShare is in 0..1; maxCount of 0 means no limit.
+        void        Select(float timeShare, unsigned maxCount = 0);
+
+        bool        IsHot(const String& name) const;
+        // Appends the method bodies of all selected functions.
+        void        GetSelectedMethods(const InfoCollector& info, ArrayDH<UMbiInd>* pmethods) const;
+        UPInt       GetSelectedCount() const        { return Selected.GetSize(); }
+        UInt64      GetTotalTime() const            { return TotalTime; }
+        UInt64      GetSelectedTime() const         { return SelectedTime; }
+
+    private:
+        struct FuncEntry
+        {
+            String      Name;
+            UInt64      Time;
+            UInt32      Calls;
+        };
+        static bool cmpTime(const FuncEntry& a, const FuncEntry& b) { return a.Time > b.Time; }
+
+        HashDH<String, UPInt, String::HashFunctor> NameToEntry;
+        ArrayDH<FuncEntry>          Entries;
+        HashSetDH<String, String::HashFunctor> Forced;
+        HashSetDH<String, String::HashFunctor> Selected;
+        UInt64                      TotalTime;
+        UInt64                      SelectedTime;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Prints the SNode tree of a method body as the statements of a C++
+    // function with the ThunkInfo::TThunkFunc signature. Opcode nodes
+    // become calls to the VM function SNodeOC::OCInfo names for them;
+    // conditions, switches and the remaining operations that have no C++
+    // operator are printed as calls to the VM's exec_<opcode> helpers of
+    // the same family. Blocks that are jump targets get an L<addr> label.
+    //
+    // Print returns false if the tree contains a node the printer has no
+    // C++ form for (AS3 member access, subscripts, delete, class creation
+    // and the like). The method must then stay interpreted; the output is
+    // incomplete and is not to be used.
+    class CppPrinter : public Visitor
+    {
+    public:
+        CppPrinter(MemoryHeap* heap, StringBuffer& out, unsigned indent = 2);
+
+        bool            Print(SNodeBlock& body);
+
+    public:
+        virtual void    VisitSNodeStr(SNodeStr& n);
+        virtual void    VisitSNodeValue(SNodeValue& n);
+        virtual void    VisitSNodeVar(SNodeVar& n);
+        virtual void    VisitSNodeMbrAcc(SNodeMbrAcc& n);
+        virtual void    VisitSNode1(SNode1& n);
+        virtual void    VisitSNode2(SNode2& n);
+        virtual void    VisitSNodeBlock(SNodeBlock& n);
+        virtual void    VisitSNodeOC(SNodeOC& n);
+        virtual void    VisitSNodeSwitchOC(SNodeSwitchOC& n);
+        virtual void    VisitSNodeIF(SNodeIF& n);
+        virtual void    VisitSNodeAbrupt(SNodeAbrupt& n);
+        virtual void    VisitSNodeN(SNodeN& n);
+
+    private:
+        static bool     isStatement(const SNode& n);
+
+        void            printIndent();
+        void            printLabel(UInt32 addr);
+        void            printExpr(SNode* n);
+        // Prints a block in braces, one level deeper.
+        void            printNested(SNodeBlock* n);
+        void            unsupported(const char* what);
+
+        StringBuffer&   Out;
+        StringBuffer*   pOut;
+        unsigned        BaseIndent;
+        unsigned        Indent;
+        bool            Supported;
+        // Set on the first pass, which only records jump targets.
+        bool            Collecting;
+        HashSetDH<UInt32> JumpTargets;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Collects generated method bodies and writes one C++ translation unit
+    // that defines them, plus a Register<Module>() function that registers
+    // them with NativeMethodTable. The host declares and calls that
+    // function at startup (see GetRegisterFunctionName). Each body is
+    // placed inside a function with the ThunkInfo::TThunkFunc signature,
+    // with parameters named ti, vm, _this, result, argc, argv. The
+    // method's bytecode is written next to it, so NativeMethodTable can
+    // check it at bind time.
+    class CppModuleWriter
+    {
+    public:
+        CppModuleWriter(MemoryHeap* heap, const char* moduleName);
+
+        void        AddInclude(const char* header);
+        // abcHash is NativeMethodTable::HashAbc of the whole ABC block;
+        // code/codeSize are the bytecode of the method body.
+        void        AddMethod(UInt32 abcHash, const char* abcFileName, Abc::MbiInd mbi,
+                              const UInt8* code, UPInt codeSize,
+                              const String& qualifiedName, const StringBuffer& body);
+        // Prints body with CppPrinter. Returns false, and adds nothing, if
+        // the printer can't express the method in C++.
+        bool        AddMethod(UInt32 abcHash, const char* abcFileName, Abc::MbiInd mbi,
+                              const UInt8* code, UPInt codeSize,
+                              const String& qualifiedName, SNodeBlock& body);
+
+        UPInt       GetMethodCount() const      { return Methods.GetSize(); }
+        // Name of the generated registration function, declared as
+        // "void <name>();" in namespace Scaleform::GFx::AS3::AOT.
+        String      GetRegisterFunctionName() const;
+
+        void        Write(StringBuffer& out) const;
+        bool        Write(File* file) const;
+
+    private:
+        struct Method
+        {
+            UInt32              AbcHash;
+            String              FileName;
+            UInt32              MethodBodyInd;
+            ArrayLH_POD<UInt8>  Code;
+            String              Name;
+            String              CppName;
+            String              Body;
+        };
+
+        static void appendCppIdentifier(StringBuffer& out, const char* name);
+        static void appendCString(StringBuffer& out, const String& str);
+
+        MemoryHeap*         pHeap;
+        String              ModuleName;
+        ArrayDH<String>     Includes;
+        ArrayDH<Method>     Methods;
+    };
+
+} // namespace AOT
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3
+
+#endif // SF_AS3_AOTC2
+
+#endif // INC_AS3_AOTC2TOOL_H
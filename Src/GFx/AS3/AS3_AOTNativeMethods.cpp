@@ -0,0 +1,128 @@
+/**************************************************************************
+
+Filename    :   AS3_AOTNativeMethods.cpp
+Content     :   Registry of AOT-compiled (native C++) AS3 method bodies
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "AS3_AOTNativeMethods.h"
+#include "Kernel/SF_Debug.h"
+#include "Kernel/SF_Std.h"
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+namespace AOT
+{
+    NativeMethodRegistrar*          NativeMethodTable::pFirst = NULL;
+    NativeMethodTable::ModeType     NativeMethodTable::Mode = NativeMethodTable::Mode_Native;
+    AtomicInt<unsigned>             NativeMethodTable::Lookups;
+    AtomicInt<unsigned>             NativeMethodTable::Hits;
+    AtomicInt<unsigned>             NativeMethodTable::CodeMismatches;
+    AtomicInt<unsigned>             NativeMethodTable::Verified;
+    AtomicInt<unsigned>             NativeMethodTable::Mismatches;
+
+    ///////////////////////////////////////////////////////////////////////////
+    UInt32 NativeMethodTable::HashAbc(const UInt8* data, UPInt size)
+    {
+        UInt32 h = 2166136261u;
+        for (UPInt i = 0; i < size; ++i)
+        {
+            h ^= data[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    void NativeMethodTable::Register(NativeMethodRegistrar& registrar)
+    {
+        if (registrar.Registered)
+            return;
+
+        registrar.pNext      = pFirst;
+        registrar.Registered = true;
+        pFirst = &registrar;
+    }
+
+    const NativeMethodEntry* NativeMethodTable::Find(UInt32 abcHash, Abc::MbiInd mbi,
+                                                     const UInt8* code, UPInt codeSize)
+    {
+        if (Mode == Mode_Interpret || !mbi.IsValid() || !code)
+            return NULL;
+
+        Lookups.Increment_NoSync();
+        const UInt32 ind = mbi.Get();
+        for (const NativeMethodRegistrar* r = pFirst; r; r = r->pNext)
+        {
+            for (UPInt i = 0; i < r->Count; ++i)
+            {
+                const NativeMethodEntry& e = r->Entries[i];
+                if (e.MethodBodyInd != ind || e.AbcHash != abcHash)
+                    continue;
+
+                if (e.CodeSize != codeSize || memcmp(e.Code, code, codeSize) != 0)
+                {
+                    CodeMismatches.Increment_NoSync();
+                    SF_DEBUG_WARNING2(1, "AOT: bytecode of %s (%s) doesn't match the compiled body; interpreting",
+                                      e.Name, e.FileName);
+                    return NULL;
+                }
+
+                Hits.Increment_NoSync();
+                return &e;
+            }
+        }
+        return NULL;
+    }
+
+    bool NativeMethodTable::VerifyCall(const NativeMethodEntry& e, const ThunkInfo& ti, VM& vm,
+                                       const Value& _this, const Value& interpreted,
+                                       unsigned argc, Value* argv)
+    {
+        Value native;
+        e.Method(ti, vm, _this, native, argc, argv);
+
+        const bool match = StrictEqual(interpreted, native);
+        ReportVerified(e, match);
+        return match;
+    }
+
+    void NativeMethodTable::ReportVerified(const NativeMethodEntry& e, bool match)
+    {
+        Verified.Increment_NoSync();
+        if (!match)
+        {
+            Mismatches.Increment_NoSync();
+            SF_DEBUG_WARNING2(1, "AOT: native body of %s (%s) differs from interpreted result",
+                              e.Name, e.FileName);
+        }
+    }
+
+    unsigned NativeMethodTable::GetRegisteredCount()
+    {
+        UPInt count = 0;
+        for (const NativeMethodRegistrar* r = pFirst; r; r = r->pNext)
+            count += r->Count;
+        return static_cast<unsigned>(count);
+    }
+
+    void NativeMethodTable::GetStats(Stats* pstats)
+    {
+        pstats->Lookups         = Lookups.Load_Acquire();
+        pstats->Hits            = Hits.Load_Acquire();
+        pstats->CodeMismatches  = CodeMismatches.Load_Acquire();
+        pstats->Verified        = Verified.Load_Acquire();
+        pstats->Mismatches      = Mismatches.Load_Acquire();
+    }
+
+} // namespace AOT
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3 {
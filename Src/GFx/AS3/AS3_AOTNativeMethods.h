@@ -0,0 +1,150 @@
+/**************************************************************************
+
+Filename    :   AS3_AOTNativeMethods.h
+Content     :   Registry of AOT-compiled (native C++) AS3 method bodies
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_AS3_AOTNATIVEMETHODS_H
+#define INC_AS3_AOTNATIVEMETHODS_H
+
+#include "AS3_Value.h"
+#include "Kernel/SF_Atomic.h"
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+namespace AOT
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Native replacement for one ABC method body. Methods use the regular
+    // thunk signature, so the VM can bind them the same way it binds
+    // built-in class methods.
+    //
+    // An entry is identified by the hash of the whole ABC block it was
+    // compiled from (NativeMethodTable::HashAbc) and the method body index
+    // within it. DoABC tag names are not unique and do not change when the
+    // script is rebuilt, so they are kept for logs only. The bytecode of the
+    // body is kept as well and compared before the native body is used, so a
+    // hash collision can never dispatch to code compiled from another body.
+    struct NativeMethodEntry
+    {
+        UInt32                  AbcHash;        // HashAbc of the ABC block.
+        UInt32                  MethodBodyInd;  // Abc::MbiInd within that block.
+        const UInt8*            Code;           // Method body bytecode.
+        UInt32                  CodeSize;
+        const char*             FileName;       // ABC file (DoABC tag) name, for logs.
+        const char*             Name;           // Qualified AS3 name, for logs.
+        ThunkInfo::TThunkFunc   Method;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Each generated module defines a Register<Module>() function that
+    // links its NativeMethodRegistrar into the table; the host calls it
+    // before creating VMs. Registration is explicit rather than done by
+    // a static constructor, because linkers drop object files nothing
+    // references from static libraries, and with them the constructor.
+    // Registration doesn't allocate, so it is safe before the memory
+    // system is initialized.
+    //
+    // The VM looks methods up once, when it creates the method's function
+    // object, and dispatches straight to the native body in Mode_Native.
+    // In Mode_Verify it keeps interpreting the method, and after each
+    // interpreted call runs the native body on a copy of the arguments
+    // through VerifyCall, which compares the two results. It is meant for
+    // correctness runs against the generated code.
+    // Find may be called from several VM threads; statistics are atomic.
+    class NativeMethodRegistrar;
+
+    class NativeMethodTable
+    {
+    public:
+        enum ModeType
+        {
+            Mode_Native,        // Dispatch to registered native bodies.
+            Mode_Interpret,     // Ignore registered bodies.
+            Mode_Verify         // Run both and compare results.
+        };
+
+        struct Stats
+        {
+            unsigned    Lookups;
+            unsigned    Hits;
+            unsigned    CodeMismatches; // Key matched, bytecode didn't.
+            unsigned    Verified;       // Calls compared in Mode_Verify.
+            unsigned    Mismatches;     // Of those, calls whose results differed.
+        };
+
+        // FNV-1a hash of an ABC block, as stored in NativeMethodEntry::AbcHash.
+        static UInt32       HashAbc(const UInt8* data, UPInt size);
+
+        // code/codeSize are the bytecode of the method body being bound.
+        static const NativeMethodEntry* Find(UInt32 abcHash, Abc::MbiInd mbi,
+                                             const UInt8* code, UPInt codeSize);
+
+        // Links a module's entries into the table; registering the same
+        // registrar again does nothing. Not thread-safe: call it before
+        // any VM looks methods up.
+        static void         Register(NativeMethodRegistrar& registrar);
+
+        // Runs the native body of e on the arguments of a call the VM has
+        // just interpreted and compares its result with the interpreted
+        // one (strict equality). argv must be a copy the native body may
+        // modify. Returns true if the results match.
+        static bool         VerifyCall(const NativeMethodEntry& e, const ThunkInfo& ti, VM& vm,
+                                       const Value& _this, const Value& interpreted,
+                                       unsigned argc, Value* argv);
+        static void         ReportVerified(const NativeMethodEntry& e, bool match);
+
+        static void         SetMode(ModeType mode) { Mode = mode; }
+        static ModeType     GetMode() { return Mode; }
+
+        static unsigned     GetRegisteredCount();
+        static void         GetStats(Stats* pstats);
+
+    private:
+        static NativeMethodRegistrar*   pFirst;
+        static ModeType                 Mode;
+        static AtomicInt<unsigned>      Lookups;
+        static AtomicInt<unsigned>      Hits;
+        static AtomicInt<unsigned>      CodeMismatches;
+        static AtomicInt<unsigned>      Verified;
+        static AtomicInt<unsigned>      Mismatches;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Defined as a static object in each generated module and passed to
+    // NativeMethodTable::Register by the module's Register<Module>().
+    class NativeMethodRegistrar
+    {
+    public:
+        NativeMethodRegistrar(const NativeMethodEntry* entries, UPInt count)
+            : Entries(entries)
+            , Count(count)
+            , pNext(NULL)
+            , Registered(false)
+        {
+        }
+
+    private:
+        friend class NativeMethodTable;
+
+        const NativeMethodEntry*    Entries;
+        UPInt                       Count;
+        NativeMethodRegistrar*      pNext;
+        bool                        Registered;
+    };
+
+} // namespace AOT
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3 {
+
+#endif // INC_AS3_AOTNATIVEMETHODS_H
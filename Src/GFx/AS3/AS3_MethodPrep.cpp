@@ -0,0 +1,242 @@
+/**************************************************************************
+
+Filename    :   AS3_MethodPrep.cpp
+Content     :   Background verification and preparation of AS3 methods
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "AS3_MethodPrep.h"
+#include "GFx/GFx_TaskManager.h"
+#include "Kernel/SF_Timer.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_Trace.h"
+
+namespace Scaleform { namespace GFx {
+
+namespace AS3
+{
+
+///////////////////////////////////////////////////////////////////////////
+class MethodPrepTask : public Task
+{
+public:
+    MethodPrepTask(MethodPrepQueue* pqueue)
+        : Task(Id_AS3MethodPrep), pQueue(pqueue) { }
+
+    virtual void Execute()
+    {
+        SF_TRACE_SCOPE(TraceCat_Task, "AS3::MethodPrepTask");
+        pQueue->runWorker();
+    }
+
+private:
+    Ptr<MethodPrepQueue> pQueue;
+};
+
+///////////////////////////////////////////////////////////////////////////
+MethodPrepQueue::MethodPrepQueue(MethodPreparer* preparer, UInt32 methodBodyCount)
+    : pPreparer(preparer)
+    , Cursor(0)
+    , Canceled(0)
+    , BackgroundCount(0)
+    , ActiveWorkers(0)
+{
+    States.Resize(methodBodyCount);
+    for (UInt32 i = 0; i < methodBodyCount; ++i)
+        States[i] = State_NotQueued;
+    memset(&PStats, 0, sizeof(PStats));
+}
+
+MethodPrepQueue::~MethodPrepQueue()
+{
+    // Workers hold a reference, so none can be running here.
+    SF_ASSERT(ActiveWorkers == 0);
+}
+
+bool MethodPrepQueue::Start(TaskManager* ptaskManager, const MethodPrepOptions& options,
+                            const UInt32* order, UPInt orderCount)
+{
+    if (!ptaskManager || options.Mode == MethodPrep_Lazy || options.TaskCount == 0 ||
+        Order.GetSize() != 0 || Canceled != 0)
+        return false;
+
+    const UInt32 count = (UInt32)States.GetSize();
+    for (UPInt i = 0; i < orderCount; ++i)
+    {
+        const UInt32 mbi = order[i];
+        if (mbi < count && States[mbi] == State_NotQueued)
+        {
+            States[mbi] = State_Queued;
+            Order.PushBack(mbi);
+        }
+    }
+    if (options.Mode == MethodPrep_All)
+    {
+        for (UInt32 mbi = 0; mbi < count; ++mbi)
+        {
+            if (States[mbi] == State_NotQueued)
+            {
+                States[mbi] = State_Queued;
+                Order.PushBack(mbi);
+            }
+        }
+    }
+    if (Order.GetSize() == 0)
+        return false;
+
+    // Publish States and Order before any worker can see them.
+    Cursor.Store_Release(0);
+
+    const unsigned taskCount = Alg::Min<unsigned>(options.TaskCount, (unsigned)Order.GetSize());
+    for (unsigned i = 0; i < taskCount; ++i)
+    {
+        Ptr<Task> ptask = *SF_HEAP_AUTO_NEW(this) MethodPrepTask(this);
+        if (!ptaskManager->AddTask(ptask))
+            break;
+        Tasks.PushBack(ptask);
+    }
+    if (Tasks.GetSize())
+        pTaskManager = ptaskManager;
+
+    // Methods left Queued without a worker are simply prepared on first call.
+    return Tasks.GetSize() != 0;
+}
+
+void MethodPrepQueue::Cancel()
+{
+    {
+        Mutex::Locker lock(&StateLock);
+        Canceled = 1;
+    }
+
+    // Tasks that haven't started yet need not run at all; for running
+    // and finished ones AbandonTask fails, and we wait for the running
+    // ones below.
+    if (pTaskManager)
+    {
+        for (UPInt i = 0; i < Tasks.GetSize(); ++i)
+            pTaskManager->AbandonTask(Tasks[i]);
+    }
+
+    Mutex::Locker lock(&StateLock);
+    while (ActiveWorkers != 0)
+        StateChanged.Wait(&StateLock);
+    // Tasks reference this queue; dropping them here breaks the cycle.
+    Tasks.Clear();
+    pTaskManager = NULL;
+}
+
+void MethodPrepQueue::runWorker()
+{
+    {
+        Mutex::Locker lock(&StateLock);
+        if (Canceled != 0)
+            return;
+        ++ActiveWorkers;
+    }
+
+    const UInt32 count = (UInt32)Order.GetSize();
+    for (;;)
+    {
+        if (Canceled.Load_Acquire() != 0)
+            break;
+
+        const UInt32 ind = Cursor.ExchangeAdd_Sync(1);
+        if (ind >= count)
+            break;
+
+        // The VM may have claimed it already on first call.
+        const UInt32 mbi = Order[ind];
+        if (claim(mbi, State_Queued))
+        {
+            prepare(mbi);
+            BackgroundCount.Increment_Sync();
+        }
+    }
+
+    Mutex::Locker lock(&StateLock);
+    --ActiveWorkers;
+    StateChanged.NotifyAll();
+}
+
+bool MethodPrepQueue::claim(UInt32 methodBodyInd, UInt32 expected)
+{
+    return AtomicOps<UInt32>::CompareAndSet_Sync(&States[methodBodyInd], expected, State_Running);
+}
+
+bool MethodPrepQueue::prepare(UInt32 methodBodyInd)
+{
+    const bool ok = pPreparer->PrepareMethod(methodBodyInd);
+
+    // Release store publishes everything PrepareMethod wrote.
+    Mutex::Locker lock(&StateLock);
+    AtomicOps<UInt32>::Store_Release(&States[methodBodyInd], ok ? State_Ready : State_Failed);
+    StateChanged.NotifyAll();
+    return ok;
+}
+
+UInt32 MethodPrepQueue::getState(UInt32 methodBodyInd) const
+{
+    return AtomicOps<UInt32>::Load_Acquire(&States[methodBodyInd]);
+}
+
+bool MethodPrepQueue::EnsurePrepared(UInt32 methodBodyInd)
+{
+    SF_ASSERT(methodBodyInd < States.GetSize());
+    ++PStats.FirstCalls;
+
+    UInt32 state = getState(methodBodyInd);
+    if (state == State_Ready || state == State_Failed)
+    {
+        ++PStats.ReadyOnFirstCall;
+        return state == State_Ready;
+    }
+
+    const UInt64 start = Timer::GetTicks();
+    bool         ok;
+
+    if ((state == State_NotQueued || state == State_Queued) && claim(methodBodyInd, state))
+    {
+        ++PStats.PreparedInline;
+        ok = prepare(methodBodyInd);
+    }
+    else
+    {
+        // A worker is on it (or took it between the load and the claim).
+        ++PStats.Waited;
+        Mutex::Locker lock(&StateLock);
+        while ((state = getState(methodBodyInd)) == State_Running)
+            StateChanged.Wait(&StateLock);
+        ok = (state == State_Ready);
+    }
+
+    const UInt64 stall = Timer::GetTicks() - start;
+    PStats.StallTicks += stall;
+    if (stall > PStats.MaxStallTicks)
+        PStats.MaxStallTicks = stall;
+    return ok;
+}
+
+bool MethodPrepQueue::IsPrepared(UInt32 methodBodyInd) const
+{
+    return methodBodyInd < States.GetSize() && getState(methodBodyInd) == State_Ready;
+}
+
+MethodPrepQueue::Stats MethodPrepQueue::GetStats() const
+{
+    Stats s = PStats;
+    s.PreparedInBackground = BackgroundCount.Load_Acquire();
+    return s;
+}
+
+} // namespace AS3
+
+}} // namespace Scaleform::GFx
@@ -0,0 +1,151 @@
+/**************************************************************************
+
+Filename    :   AS3_MethodPrep.h
+Content     :   Background verification and preparation of AS3 methods
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_AS3_METHODPREP_H
+#define INC_AS3_METHODPREP_H
+
+#include "Kernel/SF_RefCount.h"
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Atomic.h"
+#include "Kernel/SF_Threads.h"
+#include "GFx/GFx_PlayerStats.h"
+
+namespace Scaleform { namespace GFx {
+
+class TaskManager;
+class Task;
+
+namespace AS3
+{
+
+///////////////////////////////////////////////////////////////////////////
+// Method bodies of a loaded ABC file are normally verified and traced
+// (type inference, TypeInfo/Traits resolution) the first time they are
+// called, on the advance thread. MethodPrepQueue moves that work to
+// TaskManager worker threads right after the file is loaded, so a method
+// is usually ready by the time it is first called.
+
+enum MethodPrepMode
+{
+    MethodPrep_Lazy,        // Prepare on first call only (default).
+    MethodPrep_Profiled,    // Prepare the given method list in background.
+    MethodPrep_All          // Prepare the given list first, then the rest.
+};
+
+// Stored in AS3Support.
+struct MethodPrepOptions
+{
+    MethodPrepMode  Mode;
+    // Number of tasks queued per ABC file; each one drains the shared
+    // method list, so this is the maximum parallelism per file.
+    unsigned        TaskCount;
+
+    MethodPrepOptions() : Mode(MethodPrep_Lazy), TaskCount(2) { }
+};
+
+// Implemented by the VM for one ABC file. PrepareMethod may be called
+// from several threads at once, but never twice for the same method
+// body; it must only write state owned by that method body and only read
+// shared file data. Results are handed to the VM through
+// MethodPrepQueue::EnsurePrepared, which provides the memory ordering.
+class MethodPreparer
+{
+public:
+    virtual ~MethodPreparer() { }
+
+    virtual bool PrepareMethod(UInt32 methodBodyInd) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////
+class MethodPrepQueue : public RefCountBase<MethodPrepQueue, StatMV_ActionScript_Mem>
+{
+public:
+    struct Stats
+    {
+        unsigned    FirstCalls;         // EnsurePrepared calls.
+        unsigned    ReadyOnFirstCall;   // Already prepared in background.
+        unsigned    Waited;             // Blocked on a running worker.
+        unsigned    PreparedInline;     // Prepared on the calling thread.
+        unsigned    PreparedInBackground;
+        UInt64      StallTicks;         // Total first-call stall, microseconds.
+        UInt64      MaxStallTicks;
+    };
+
+    MethodPrepQueue(MethodPreparer* preparer, UInt32 methodBodyCount);
+    ~MethodPrepQueue();
+
+    // Queues preparation of the methods in 'order' (profiled methods,
+    // hottest first) and, in MethodPrep_All mode, of all remaining ones.
+    // Returns false if nothing was queued; methods are then prepared on
+    // first call as before.
+    bool        Start(TaskManager* ptaskManager, const MethodPrepOptions& options,
+                      const UInt32* order = NULL, UPInt orderCount = 0);
+
+    // Stops handing out new methods and waits for running workers. Must
+    // be called before the MethodPreparer is destroyed; it also releases
+    // the queued tasks, which hold references to the queue.
+    void        Cancel();
+
+    // Called by the VM before the first call of a method body. Returns
+    // the result of PrepareMethod, preparing it on the calling thread if
+    // no worker got to it yet.
+    bool        EnsurePrepared(UInt32 methodBodyInd);
+
+    bool        IsPrepared(UInt32 methodBodyInd) const;
+
+    // Stats are updated by the EnsurePrepared thread; only
+    // PreparedInBackground is written by workers.
+    Stats       GetStats() const;
+
+private:
+    friend class MethodPrepTask;
+
+    enum StateType
+    {
+        State_NotQueued,
+        State_Queued,
+        State_Running,
+        State_Ready,
+        State_Failed
+    };
+
+    // Worker loop; returns when the list is drained or on Cancel.
+    void        runWorker();
+    bool        claim(UInt32 methodBodyInd, UInt32 expected);
+    bool        prepare(UInt32 methodBodyInd);
+    UInt32      getState(UInt32 methodBodyInd) const;
+
+    MethodPreparer*                             pPreparer;
+    ArrayLH_POD<UInt32, StatMV_ActionScript_Mem> States;
+    ArrayLH_POD<UInt32, StatMV_ActionScript_Mem> Order;
+    AtomicInt<UInt32>                           Cursor;
+    AtomicInt<UInt32>                           Canceled;
+    AtomicInt<UInt32>                           BackgroundCount;
+    Ptr<TaskManager>                            pTaskManager;
+    ArrayLH<Ptr<Task>, StatMV_ActionScript_Mem> Tasks;
+
+    // Guards ActiveWorkers and the waits for Running methods.
+    mutable Mutex                               StateLock;
+    WaitCondition                               StateChanged;
+    unsigned                                    ActiveWorkers;
+
+    Stats                                       PStats;
+};
+
+} // namespace AS3
+
+}} // namespace Scaleform::GFx
+
+#endif // INC_AS3_METHODPREP_H
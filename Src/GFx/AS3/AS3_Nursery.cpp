@@ -0,0 +1,269 @@
+/**************************************************************************
+
+Filename    :   AS3_Nursery.cpp
+Content     :   Bump-pointer nursery for short-lived AS3 objects
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "AS3_Nursery.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_Debug.h"
+
+namespace Scaleform { namespace GFx {
+
+// The descriptor places the stat under the VM group; its id was appended
+// to StatMovieView, out of tree order (see GFx_PlayerStats.h). The player
+// stats table doesn't declare it, so it is declared here, next to its only
+// user.
+SF_DECLARE_MEMORY_STAT(StatMV_VM_Nursery_Mem, "Nursery", StatMV_VM)
+
+namespace AS3
+{
+
+// Chunk descriptor sits at the start of its own block, padded to keep
+// object data 16-byte aligned.
+static const UPInt Nursery_ChunkHeaderSize = 64;
+
+///////////////////////////////////////////////////////////////////////////
+Nursery::Nursery(MemoryHeap* pheap, unsigned maxYoungChunks)
+    : pHeap(pheap)
+    , MaxYoungChunks(Alg::Max(maxYoungChunks, 1u))
+    , pCurrent(NULL)
+    , Collecting(false)
+    , TearingDown(false)
+{
+    SF_COMPILER_ASSERT(sizeof(ObjectHeader) == 16);
+    SF_COMPILER_ASSERT(sizeof(Chunk) <= Nursery_ChunkHeaderSize);
+    memset(&NStats, 0, sizeof(NStats));
+}
+
+Nursery::~Nursery()
+{
+    // Young objects still need their destructors. Promotion must not run
+    // here, since the collector may already be gone, so referenced young
+    // objects are left in place like promoted ones.
+    TearingDown = true;
+    CollectMinor();
+
+    // Promoted objects are owned by the collector and should have been
+    // freed by now. A chunk that still holds one is leaked rather than
+    // freed, so a late reference reads stale memory instead of memory
+    // that was handed out again.
+    unsigned leaked = 0;
+    for (UPInt i = 0; i < Chunks.GetSize(); ++i)
+    {
+        if (Chunks[i]->LiveCount)
+            ++leaked;
+        else
+            SF_FREE_ALIGN(Chunks[i]);
+    }
+    SF_DEBUG_WARNING1(leaked, "Nursery: %u chunks still hold referenced objects and are leaked", leaked);
+    SF_UNUSED(leaked);
+}
+
+Nursery::Chunk* Nursery::newChunk()
+{
+    if (FreeChunks.GetSize())
+    {
+        Chunk* pchunk = FreeChunks.Back();
+        FreeChunks.PopBack();
+        return pchunk;
+    }
+
+    void* pmem = SF_HEAP_MEMALIGN(pHeap, ChunkSize, 16, StatMV_VM_Nursery_Mem);
+    if (!pmem)
+        return NULL;
+
+    Chunk* pchunk     = (Chunk*)pmem;
+    pchunk->pData     = (UByte*)pmem + Nursery_ChunkHeaderSize;
+    pchunk->Top       = 0;
+    pchunk->LiveCount = 0;
+    pchunk->Young     = false;
+
+    // Keep Chunks sorted by address.
+    UPInt pos = Alg::LowerBound(Chunks, pchunk);
+    Chunks.InsertAt(pos, pchunk);
+    return pchunk;
+}
+
+void Nursery::releaseChunk(Chunk* pchunk)
+{
+    pchunk->Top       = 0;
+    pchunk->LiveCount = 0;
+    pchunk->Young     = false;
+
+    // A few spare chunks cover the next frame's temporaries.
+    if (FreeChunks.GetSize() < MaxYoungChunks)
+    {
+        FreeChunks.PushBack(pchunk);
+        return;
+    }
+
+    UPInt pos = Alg::LowerBound(Chunks, pchunk);
+    SF_ASSERT(pos < Chunks.GetSize() && Chunks[pos] == pchunk);
+    Chunks.RemoveAt(pos);
+    SF_FREE_ALIGN(pchunk);
+}
+
+Nursery::Chunk* Nursery::findChunk(const void* p) const
+{
+    const UPInt count = Chunks.GetSize();
+    if (count == 0)
+        return NULL;
+
+    // Last chunk starting at or below p.
+    UPInt lo = 0, hi = count;
+    while (lo < hi)
+    {
+        UPInt mid = (lo + hi) >> 1;
+        if ((const void*)Chunks[mid] <= p)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return NULL;
+
+    Chunk* pchunk = Chunks[lo - 1];
+    const UByte* pb = (const UByte*)p;
+    return (pb >= pchunk->pData && pb < pchunk->pData + pchunk->Top) ? pchunk : NULL;
+}
+
+//------------------------------------------------------------------------
+void* Nursery::Alloc(UPInt size, const ObjectTraits* ptraits)
+{
+    SF_ASSERT(ptraits && ptraits->Destroy && ptraits->IsReferenced);
+
+    const UPInt total = ((size + 15) & ~UPInt(15)) + sizeof(ObjectHeader);
+    if (size > MaxObjectSize || Collecting)
+    {
+        ++NStats.FallbackAllocs;
+        return NULL;
+    }
+
+    if (!pCurrent || pCurrent->Top + total > ChunkSize - Nursery_ChunkHeaderSize)
+    {
+        pCurrent = NULL;
+        if (YoungChunks.GetSize() >= MaxYoungChunks || (pCurrent = newChunk()) == NULL)
+        {
+            ++NStats.FallbackAllocs;
+            return NULL;
+        }
+        pCurrent->Young = true;
+        YoungChunks.PushBack(pCurrent);
+    }
+
+    ObjectHeader* phdr = (ObjectHeader*)(pCurrent->pData + pCurrent->Top);
+    phdr->pTraits = ptraits;
+    phdr->Size    = (UInt32)total;
+    phdr->Flags   = 0;
+    pCurrent->Top += total;
+
+    ++NStats.AllocatedObjects;
+    NStats.AllocatedBytes += total;
+    return phdr + 1;
+}
+
+bool Nursery::IsYoung(const void* p) const
+{
+    const Chunk* pchunk = findChunk(p);
+    if (!pchunk || !pchunk->Young)
+        return false;
+    const ObjectHeader* phdr = (const ObjectHeader*)p - 1;
+    return (phdr->Flags & Obj_Promoted) == 0;
+}
+
+void Nursery::Free(void* p)
+{
+    Chunk* pchunk = findChunk(p);
+    SF_ASSERT(pchunk);
+    if (!pchunk)
+        return;
+
+    ObjectHeader* phdr = (ObjectHeader*)p - 1;
+    SF_ASSERT((phdr->Flags & (Obj_Promoted | Obj_Freed)) == Obj_Promoted);
+    phdr->Flags |= Obj_Freed | Obj_Destroyed;
+
+    SF_ASSERT(pchunk->LiveCount > 0);
+    // Young chunks are settled at the end of CollectMinor.
+    if (--pchunk->LiveCount == 0 && !pchunk->Young)
+        releaseChunk(pchunk);
+}
+
+//------------------------------------------------------------------------
+void Nursery::collectChunk(Chunk* pchunk)
+{
+    ScratchOffsets.Clear();
+    for (UPInt offset = 0; offset < pchunk->Top; )
+    {
+        ScratchOffsets.PushBack(offset);
+        offset += ((ObjectHeader*)(pchunk->pData + offset))->Size;
+    }
+
+    // Newest first: young objects mostly reference older ones, so this
+    // frees whole chains of temporaries in one pass.
+    for (UPInt i = ScratchOffsets.GetSize(); i > 0; --i)
+    {
+        ObjectHeader* phdr = (ObjectHeader*)(pchunk->pData + ScratchOffsets[i - 1]);
+        if (phdr->Flags & (Obj_Destroyed | Obj_Promoted))
+            continue;
+
+        void* pobj = phdr + 1;
+        if (!phdr->pTraits->IsReferenced(pobj))
+        {
+            phdr->Flags |= Obj_Destroyed;
+            phdr->pTraits->Destroy(pobj);
+            ++NStats.ReclaimedObjects;
+        }
+        else
+        {
+            phdr->Flags |= Obj_Promoted;
+            ++pchunk->LiveCount;
+            ++NStats.PromotedObjects;
+            NStats.PromotedBytes += phdr->Size;
+            if (phdr->pTraits->Promote && !TearingDown)
+                phdr->pTraits->Promote(pobj);
+        }
+    }
+}
+
+void Nursery::CollectMinor()
+{
+    if (Collecting)
+        return;
+    Collecting = true;
+    ++NStats.MinorCollections;
+
+    for (UPInt i = YoungChunks.GetSize(); i > 0; --i)
+        collectChunk(YoungChunks[i - 1]);
+
+    for (UPInt i = 0; i < YoungChunks.GetSize(); ++i)
+    {
+        Chunk* pchunk = YoungChunks[i];
+        pchunk->Young = false;
+        if (pchunk->LiveCount == 0)
+            releaseChunk(pchunk);
+    }
+    YoungChunks.Clear();
+    pCurrent   = NULL;
+    Collecting = false;
+}
+
+Nursery::Stats Nursery::GetStats() const
+{
+    Stats s = NStats;
+    s.YoungChunks   = (unsigned)YoungChunks.GetSize();
+    s.FreeChunks    = (unsigned)FreeChunks.GetSize();
+    s.RetiredChunks = (unsigned)(Chunks.GetSize() - YoungChunks.GetSize() - FreeChunks.GetSize());
+    return s;
+}
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3 {
@@ -0,0 +1,157 @@
+/**************************************************************************
+
+Filename    :   AS3_Nursery.h
+Content     :   Bump-pointer nursery for short-lived AS3 objects
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2012 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_AS3_NURSERY_H
+#define INC_AS3_NURSERY_H
+
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Memory.h"
+#include "GFx/GFx_PlayerStats.h"
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+///////////////////////////////////////////////////////////////////////////
+// Nursery is an allocation area for young GC-managed objects (temporary
+// instances, closures, boxed values). Objects are bump-allocated out of
+// fixed-size chunks and are "young" until the next minor collection:
+//
+//  - Reference counting is deferred for young objects. When the count of
+//    a young object drops to zero the VM leaves it alone instead of
+//    destroying it, and it doesn't add young objects to the collector's
+//    root buffer.
+//  - CollectMinor, called at the end of a frame, destroys every young
+//    object that is no longer referenced and promotes the survivors.
+//
+// Objects can't be moved, since references to them are not tracked, so
+// survivors are promoted in place: the collector is told about them
+// (ObjectTraits::Promote), and their chunk is retired from allocation
+// until all of its promoted objects are freed through Free. Chunks
+// without survivors are reused right away, which is the common case for
+// frame-temporary garbage.
+//
+// The nursery should be destroyed after the collector has released every
+// promoted object. Chunks that still hold live objects at that point are
+// leaked, not freed.
+//
+// The nursery is not thread safe; it belongs to one VM.
+class Nursery : public NewOverrideBase<StatMV_VM_Nursery_Mem>
+{
+public:
+    // Per-class callbacks, usually one static instance per AS3 object
+    // implementation class.
+    struct ObjectTraits
+    {
+        // Runs the destructor without freeing memory.
+        void    (*Destroy)(void* pobj);
+        // True if the object's reference count is not zero.
+        bool    (*IsReferenced)(const void* pobj);
+        // Called once for a survivor; the VM hands the object over to the
+        // cycle collector here. May be NULL.
+        void    (*Promote)(void* pobj);
+    };
+
+    struct Stats
+    {
+        unsigned    MinorCollections;
+        UPInt       AllocatedObjects;   // Since creation.
+        UPInt       AllocatedBytes;
+        UPInt       ReclaimedObjects;   // Destroyed by CollectMinor.
+        UPInt       PromotedObjects;
+        UPInt       PromotedBytes;
+        UPInt       FallbackAllocs;     // Alloc returned NULL.
+        unsigned    YoungChunks;
+        unsigned    RetiredChunks;      // Holding promoted objects.
+        unsigned    FreeChunks;
+    };
+
+    enum
+    {
+        ChunkSize       = 64 * 1024,
+        // Larger objects are not worth nursing; they go to the heap.
+        MaxObjectSize   = 1024
+    };
+
+    // maxYoungChunks bounds nursery memory between two minor collections;
+    // once it is used up Alloc fails and objects go to the heap as before.
+    Nursery(MemoryHeap* pheap, unsigned maxYoungChunks = 16);
+    ~Nursery();
+
+    // Returns NULL if the object should be allocated from the heap.
+    void*   Alloc(UPInt size, const ObjectTraits* ptraits);
+
+    // True if p was allocated by this nursery (young or promoted).
+    bool    Contains(const void* p) const { return findChunk(p) != NULL; }
+    // True if p is young, i.e. has not been through a minor collection.
+    bool    IsYoung(const void* p) const;
+
+    // Releases memory of a promoted object after its destructor has run;
+    // this replaces the heap free for objects for which Contains is true.
+    void    Free(void* p);
+
+    // Must be called when no raw (not reference counted) pointers to young
+    // objects are held, e.g. at the end of a frame.
+    void    CollectMinor();
+
+    Stats   GetStats() const;
+
+private:
+    struct Chunk
+    {
+        UByte*      pData;
+        UPInt       Top;            // Bump pointer, offset into pData.
+        unsigned    LiveCount;      // Promoted objects not freed yet.
+        bool        Young;
+    };
+
+    // Prefix of every object; keeps objects 16-byte aligned.
+    struct ObjectHeader
+    {
+        const ObjectTraits* pTraits;
+        UInt32              Size;   // Including header.
+        UInt32              Flags;
+#ifndef SF_64BIT_POINTERS
+        UInt32              Pad;
+#endif
+    };
+
+    enum ObjectFlags
+    {
+        Obj_Destroyed   = 1,
+        Obj_Promoted    = 2,
+        Obj_Freed       = 4
+    };
+
+    Chunk*          newChunk();
+    void            releaseChunk(Chunk* pchunk);
+    Chunk*          findChunk(const void* p) const;
+    void            collectChunk(Chunk* pchunk);
+
+    MemoryHeap*                                 pHeap;
+    unsigned                                    MaxYoungChunks;
+    Chunk*                                      pCurrent;
+    bool                                        Collecting;
+    bool                                        TearingDown;
+    // All chunks sorted by data address, for findChunk.
+    ArrayLH_POD<Chunk*, StatMV_VM_Nursery_Mem>  Chunks;
+    ArrayLH_POD<Chunk*, StatMV_VM_Nursery_Mem>  YoungChunks;
+    ArrayLH_POD<Chunk*, StatMV_VM_Nursery_Mem>  FreeChunks;
+    ArrayLH_POD<UPInt, StatMV_VM_Nursery_Mem>   ScratchOffsets;
+    Stats                                       NStats;
+};
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3 {
+
+#endif // INC_AS3_NURSERY_H
@@ -0,0 +1,536 @@
+/**************************************************************************
+
+Filename    :   AS3_Abc_ThreadedCode.cpp
+Content     :   Direct-threaded method body representation with
+                superinstructions
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "AS3_Abc_ThreadedCode.h"
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+namespace Abc
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // ABC opcodes referenced by the rewriter.
+    enum
+    {
+        abc_ifnlt           = 0x0C,
+        abc_ifnle           = 0x0D,
+        abc_ifngt           = 0x0E,
+        abc_ifnge           = 0x0F,
+        abc_jump            = 0x10,
+        abc_ifeq            = 0x13,
+        abc_ifne            = 0x14,
+        abc_iflt            = 0x15,
+        abc_ifle            = 0x16,
+        abc_ifgt            = 0x17,
+        abc_ifge            = 0x18,
+        abc_ifstricteq      = 0x19,
+        abc_ifstrictne      = 0x1A,
+        abc_lookupswitch    = 0x1B,
+        abc_pushbyte        = 0x24,
+        abc_pushshort       = 0x25,
+        abc_getlocal        = 0x62,
+        abc_getproperty     = 0x66,
+        abc_add             = 0xA0,
+        abc_subtract        = 0xA1,
+        abc_multiply        = 0xA2,
+        abc_divide          = 0xA3,
+        abc_getlocal0       = 0xD0,
+        abc_getlocal3       = 0xD3,
+        abc_debug           = 0xEF
+    };
+
+    // Operand encodings of ABC instructions.
+    enum OperandFormat
+    {
+        OF_None,
+        OF_U30,
+        OF_U30x2,
+        OF_S8,          // pushbyte
+        OF_U8,          // getscopeobject
+        OF_S24,         // branches
+        OF_Switch,      // lookupswitch
+        OF_Debug,       // u8, u30, u8, u30
+        OF_Invalid
+    };
+
+    static OperandFormat GetOperandFormat(unsigned op)
+    {
+        switch (op)
+        {
+        case 0x04: case 0x05: case 0x06: case 0x08:             // getsuper, setsuper, dxns, kill
+        case 0x2C: case 0x2D: case 0x2E: case 0x2F: case 0x31:  // pushstring .. pushnamespace
+        case 0x25:                                              // pushshort
+        case 0x40: case 0x41: case 0x42: case 0x49:             // newfunction, call, construct, constructsuper
+        case 0x53: case 0x55: case 0x56: case 0x58:             // applytype, newobject, newarray, newclass
+        case 0x59: case 0x5A: case 0x5D: case 0x5E:             // getdescendants, newcatch, findpropstrict, findproperty
+        case 0x5F: case 0x60: case 0x61: case 0x62:             // finddef, getlex, setproperty, getlocal
+        case 0x63: case 0x66: case 0x67: case 0x68:             // setlocal, getproperty, getouterscope, initproperty
+        case 0x6A: case 0x6C: case 0x6D: case 0x6E: case 0x6F:  // deleteproperty, getslot .. setglobalslot
+        case 0x80: case 0x86: case 0x92: case 0x94:             // coerce, astype, inclocal, declocal
+        case 0xB2: case 0xC2: case 0xC3:                        // istype, inclocal_i, declocal_i
+        case 0xF0: case 0xF1: case 0xF2:                        // debugline, debugfile, bkptline
+            return OF_U30;
+
+        case 0x32:                                              // hasnext2
+        case 0x43: case 0x44: case 0x45: case 0x46:             // callmethod, callstatic, callsuper, callproperty
+        case 0x4A: case 0x4C: case 0x4E: case 0x4F:             // constructprop, callproplex, callsupervoid, callpropvoid
+            return OF_U30x2;
+
+        case abc_pushbyte:
+            return OF_S8;
+        case 0x65:                                              // getscopeobject
+            return OF_U8;
+
+        case abc_ifnlt: case abc_ifnle: case abc_ifngt: case abc_ifnge:
+        case abc_jump: case 0x11: case 0x12:
+        case abc_ifeq: case abc_ifne: case abc_iflt: case abc_ifle:
+        case abc_ifgt: case abc_ifge: case abc_ifstricteq: case abc_ifstrictne:
+            return OF_S24;
+
+        case abc_lookupswitch:
+            return OF_Switch;
+        case abc_debug:
+            return OF_Debug;
+
+        case 0x01: case 0x02: case 0x03: case 0x07: case 0x09:
+        case 0x1C: case 0x1D: case 0x1E: case 0x1F:
+        case 0x20: case 0x21: case 0x23: case 0x26: case 0x27:
+        case 0x28: case 0x29: case 0x2A: case 0x2B: case 0x30:
+        case 0x35: case 0x36: case 0x37: case 0x38: case 0x39:
+        case 0x3A: case 0x3B: case 0x3C: case 0x3D: case 0x3E:
+        case 0x47: case 0x48: case 0x50: case 0x51: case 0x52:
+        case 0x57: case 0x64: case 0x70: case 0x71: case 0x72:
+        case 0x73: case 0x74: case 0x75: case 0x76: case 0x77:
+        case 0x78: case 0x81: case 0x82: case 0x83: case 0x84:
+        case 0x85: case 0x87: case 0x89:
+        case 0x90: case 0x91: case 0x93: case 0x95: case 0x96:
+        case 0x97: case 0xA0: case 0xA1: case 0xA2: case 0xA3:
+        case 0xA4: case 0xA5: case 0xA6: case 0xA7: case 0xA8:
+        case 0xA9: case 0xAA: case 0xAB: case 0xAC: case 0xAD:
+        case 0xAE: case 0xAF: case 0xB0: case 0xB1: case 0xB3:
+        case 0xB4: case 0xC0: case 0xC1: case 0xC4: case 0xC5:
+        case 0xC6: case 0xC7: case 0xD0: case 0xD1: case 0xD2:
+        case 0xD3: case 0xD4: case 0xD5: case 0xD6: case 0xD7:
+            return OF_None;
+
+        default:
+            return OF_Invalid;
+        }
+    }
+
+    static bool ReadU30(const UInt8* code, UPInt size, UPInt& pos, SInt32& result)
+    {
+        UInt32 value = 0;
+        for (unsigned shift = 0; shift < 35; shift += 7)
+        {
+            if (pos >= size)
+                return false;
+            UInt8 b = code[pos++];
+            value |= UInt32(b & 0x7F) << shift;
+            if (!(b & 0x80))
+            {
+                result = SInt32(value & 0x3FFFFFFF);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool ReadS24(const UInt8* code, UPInt size, UPInt& pos, SInt32& result)
+    {
+        if (pos + 3 > size)
+            return false;
+        UInt32 v = UInt32(code[pos]) | (UInt32(code[pos + 1]) << 8) | (UInt32(code[pos + 2]) << 16);
+        pos += 3;
+        result = (v & 0x800000) ? SInt32(v | 0xFF000000) : SInt32(v);
+        return true;
+    }
+
+    static bool IsIntType(const TypeInfo* ti)    { return ti && ti->IsInt(); }
+    static bool IsNumberType(const TypeInfo* ti) { return ti && ti->IsNumber(); }
+
+    ///////////////////////////////////////////////////////////////////////////
+    ThreadedCode::ThreadedCode()
+    : Bound(false)
+    {
+        memset(&CStats, 0, sizeof(CStats));
+    }
+
+    void ThreadedCode::AddExceptionRange(UInt32 from, UInt32 to, UInt32 target)
+    {
+        RangeOffsets.PushBack(from);
+        RangeOffsets.PushBack(to);
+        RangeOffsets.PushBack(target);
+    }
+
+    unsigned ThreadedCode::GetOperandCount(unsigned op)
+    {
+        switch (op)
+        {
+        case tc_getlocal_getproperty:
+            return 2;
+        case tc_add_imm: case tc_add_imm_i: case tc_add_imm_n:
+        case tc_iflt_ii: case tc_ifle_ii: case tc_ifgt_ii:
+        case tc_ifge_ii: case tc_ifeq_ii: case tc_ifne_ii:
+            return 1;
+        case tc_add_nn: case tc_subtract_nn: case tc_multiply_nn: case tc_divide_nn:
+            return 0;
+        }
+
+        switch (GetOperandFormat(op))
+        {
+        case OF_U30: case OF_S8: case OF_U8: case OF_S24: case OF_Switch:
+            return 1;
+        case OF_U30x2:
+            return 2;
+        case OF_Debug:
+            return 3;
+        default:
+            return 0;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    bool ThreadedCode::decode(const UInt8* code, UPInt size)
+    {
+        UPInt pos = 0;
+        while (pos < size)
+        {
+            AbcInstr in;
+            in.Offset  = UInt32(pos);
+            in.Op      = code[pos++];
+            in.Args[0] = in.Args[1] = in.Args[2] = 0;
+
+            switch (GetOperandFormat(in.Op))
+            {
+            case OF_None:
+                break;
+            case OF_U30:
+                if (!ReadU30(code, size, pos, in.Args[0]))
+                    return false;
+                // pushshort is a sign-extended 16 bit value.
+                if (in.Op == abc_pushshort)
+                    in.Args[0] = SInt16(in.Args[0]);
+                break;
+            case OF_U30x2:
+                if (!ReadU30(code, size, pos, in.Args[0]) || !ReadU30(code, size, pos, in.Args[1]))
+                    return false;
+                break;
+            case OF_S8:
+            case OF_U8:
+                if (pos >= size)
+                    return false;
+                in.Args[0] = (in.Op == abc_pushbyte) ? SInt32(SInt8(code[pos])) : SInt32(code[pos]);
+                pos++;
+                break;
+            case OF_S24:
+                if (!ReadS24(code, size, pos, in.Args[0]))
+                    return false;
+                // Relative to the end of the instruction.
+                in.Args[0] += SInt32(pos);
+                Barriers.PushBack(UInt32(in.Args[0]));
+                break;
+            case OF_Switch:
+                {
+                    // Offsets are relative to the start of lookupswitch.
+                    SInt32 def, count;
+                    if (!ReadS24(code, size, pos, def) || !ReadU30(code, size, pos, count))
+                        return false;
+                    // ABC stores case_count + 1 case offsets.
+                    in.Args[0] = count + 1;
+                    in.Args[1] = SInt32(SwitchTargets.GetSize());
+                    SwitchTargets.PushBack(UInt32(SInt32(in.Offset) + def));
+                    for (SInt32 c = 0; c <= count; ++c)
+                    {
+                        SInt32 off;
+                        if (!ReadS24(code, size, pos, off))
+                            return false;
+                        SwitchTargets.PushBack(UInt32(SInt32(in.Offset) + off));
+                    }
+                    for (UPInt t = UPInt(in.Args[1]); t < SwitchTargets.GetSize(); ++t)
+                        Barriers.PushBack(SwitchTargets[t]);
+                }
+                break;
+            case OF_Debug:
+                {
+                    SInt32 index, extra;
+                    if (pos + 1 > size)
+                        return false;
+                    in.Args[0] = code[pos++];
+                    if (!ReadU30(code, size, pos, index) || pos + 1 > size)
+                        return false;
+                    in.Args[1] = index;
+                    in.Args[2] = code[pos++];
+                    // The trailing extra field is reserved and not kept.
+                    if (!ReadU30(code, size, pos, extra))
+                        return false;
+                }
+                break;
+            default:
+                return false;
+            }
+
+            in.Next = UInt32(pos);
+            Instrs.PushBack(in);
+        }
+
+        Barriers.Append(RangeOffsets.GetDataPtr(), RangeOffsets.GetSize());
+        Alg::QuickSort(Barriers);
+        return true;
+    }
+
+    bool ThreadedCode::isFusionBarrier(UInt32 abcOffset) const
+    {
+        UPInt lo = 0, hi = Barriers.GetSize();
+        while (lo < hi)
+        {
+            UPInt mid = (lo + hi) >> 1;
+            if (Barriers[mid] < abcOffset)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo < Barriers.GetSize() && Barriers[lo] == abcOffset;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    void ThreadedCode::emitInstr(const AbcInstr& in, unsigned op)
+    {
+        Words.PushBack(op);
+        switch (GetOperandFormat(in.Op))
+        {
+        case OF_U30: case OF_S8: case OF_U8:
+            Words.PushBack(UPInt(SPInt(in.Args[0])));
+            break;
+        case OF_U30x2:
+            Words.PushBack(UPInt(in.Args[0]));
+            Words.PushBack(UPInt(in.Args[1]));
+            break;
+        case OF_S24:
+            BranchFixups.PushBack(Words.GetSize());
+            Words.PushBack(UPInt(UInt32(in.Args[0])));
+            break;
+        case OF_Switch:
+            // Case count, then default and case targets.
+            Words.PushBack(UPInt(in.Args[0]));
+            for (SInt32 t = 0; t <= in.Args[0]; ++t)
+            {
+                BranchFixups.PushBack(Words.GetSize());
+                Words.PushBack(SwitchTargets[in.Args[1] + t]);
+            }
+            break;
+        case OF_Debug:
+            Words.PushBack(UPInt(in.Args[0]));
+            Words.PushBack(UPInt(in.Args[1]));
+            Words.PushBack(UPInt(in.Args[2]));
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Fuses the instruction pair starting at i. Returns the number of ABC
+    // instructions consumed, or 0 if no superinstruction applies.
+    unsigned ThreadedCode::tryFuse(unsigned i, const ThreadedCodeOracle* oracle)
+    {
+        if (!oracle || i + 1 >= Instrs.GetSize())
+            return 0;
+
+        const AbcInstr& a = Instrs[i];
+        const AbcInstr& b = Instrs[i + 1];
+        if (isFusionBarrier(b.Offset))
+            return 0;
+
+        // getlocal N; getproperty mn
+        if ((a.Op == abc_getlocal || (a.Op >= abc_getlocal0 && a.Op <= abc_getlocal3)) &&
+            b.Op == abc_getproperty && !oracle->IsRuntimeMultiname(UInt32(b.Args[0])))
+        {
+            UPInt local = (a.Op == abc_getlocal) ? UPInt(a.Args[0]) : UPInt(a.Op - abc_getlocal0);
+            Words.PushBack(tc_getlocal_getproperty);
+            Words.PushBack(local);
+            Words.PushBack(UPInt(b.Args[0]));
+            return 2;
+        }
+
+        // pushbyte/pushshort imm; add
+        if ((a.Op == abc_pushbyte || a.Op == abc_pushshort) && b.Op == abc_add)
+        {
+            // The other operand is below the pushed immediate.
+            const TypeInfo* other = oracle->GetStackType(a.Offset, 0);
+            unsigned op = tc_add_imm;
+            if (IsIntType(other))
+                op = tc_add_imm_i;
+            else if (IsNumberType(other))
+                op = tc_add_imm_n;
+            Words.PushBack(op);
+            Words.PushBack(UPInt(SPInt(a.Args[0])));
+            return 2;
+        }
+        return 0;
+    }
+
+    // Returns the specialized op for a single instruction, or in.Op.
+    unsigned ThreadedCode::specialize(const AbcInstr& in, const ThreadedCodeOracle* oracle)
+    {
+        if (!oracle)
+            return in.Op;
+
+        switch (in.Op)
+        {
+        case abc_add: case abc_subtract: case abc_multiply: case abc_divide:
+            if (IsNumberType(oracle->GetStackType(in.Offset, 0)) &&
+                IsNumberType(oracle->GetStackType(in.Offset, 1)))
+            {
+                static const unsigned ops[] = { tc_add_nn, tc_subtract_nn, tc_multiply_nn, tc_divide_nn };
+                return ops[in.Op - abc_add];
+            }
+            break;
+
+        case abc_iflt: case abc_ifle: case abc_ifgt: case abc_ifge:
+        case abc_ifeq: case abc_ifne: case abc_ifstricteq: case abc_ifstrictne:
+        case abc_ifnlt: case abc_ifnle: case abc_ifngt: case abc_ifnge:
+            if (IsIntType(oracle->GetStackType(in.Offset, 0)) &&
+                IsIntType(oracle->GetStackType(in.Offset, 1)))
+            {
+                // With int operands there is no NaN, so the negated forms
+                // are plain inverse comparisons.
+                switch (in.Op)
+                {
+                case abc_iflt: case abc_ifnge:          return tc_iflt_ii;
+                case abc_ifle: case abc_ifngt:          return tc_ifle_ii;
+                case abc_ifgt: case abc_ifnle:          return tc_ifgt_ii;
+                case abc_ifge: case abc_ifnlt:          return tc_ifge_ii;
+                case abc_ifeq: case abc_ifstricteq:     return tc_ifeq_ii;
+                default:                                return tc_ifne_ii;
+                }
+            }
+            break;
+        }
+        return in.Op;
+    }
+
+    bool ThreadedCode::patchBranches()
+    {
+        for (UPInt f = 0; f < BranchFixups.GetSize(); ++f)
+        {
+            UPInt&      word = Words[BranchFixups[f]];
+            TCodeOffset target = GetWordOffset(UInt32(word));
+            if (target == SF_MAX_UPINT)
+                return false;
+            word = target;
+        }
+        BranchFixups.Clear();
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    bool ThreadedCode::Build(const UInt8* code, UPInt size, const ThreadedCodeOracle* oracle)
+    {
+        Instrs.Clear();
+        Barriers.Clear();
+        SwitchTargets.Clear();
+        Words.Clear();
+        WordOffsets.Clear();
+        EmittedWords.Clear();
+        EmittedAbc.Clear();
+        BranchFixups.Clear();
+        Bound = false;
+        memset(&CStats, 0, sizeof(CStats));
+
+        if (!decode(code, size))
+            return false;
+
+        WordOffsets.Resize(Instrs.GetSize());
+        for (unsigned i = 0; i < Instrs.GetSize(); )
+        {
+            WordOffsets[i] = Words.GetSize();
+            EmittedWords.PushBack(Words.GetSize());
+            EmittedAbc.PushBack(Instrs[i].Offset);
+
+            unsigned consumed = tryFuse(i, oracle);
+            if (consumed)
+            {
+                for (unsigned j = 1; j < consumed; ++j)
+                    WordOffsets[i + j] = SF_MAX_UPINT;
+                CStats.Fused++;
+                i += consumed;
+                continue;
+            }
+
+            const AbcInstr& in = Instrs[i];
+            unsigned op = specialize(in, oracle);
+            if (op != in.Op)
+                CStats.Specialized++;
+            emitInstr(in, op);
+            i++;
+        }
+
+        CStats.AbcInstructions = unsigned(Instrs.GetSize());
+        CStats.Words           = unsigned(Words.GetSize());
+        return patchBranches();
+    }
+
+    void ThreadedCode::Bind(const void* const* handlers)
+    {
+        SF_ASSERT(!Bound);
+        for (UPInt pos = 0; pos < Words.GetSize(); )
+        {
+            unsigned op    = unsigned(Words[pos]);
+            unsigned count = GetOperandCount(op);
+            if (GetOperandFormat(op) == OF_Switch && op <= tc_abc_last)
+                count += unsigned(Words[pos + 1]) + 1;
+            Words[pos] = UPInt(handlers[op]);
+            pos += 1 + count;
+        }
+        Bound = true;
+    }
+
+    TCodeOffset ThreadedCode::GetWordOffset(UInt32 abcOffset) const
+    {
+        UPInt lo = 0, hi = Instrs.GetSize();
+        while (lo < hi)
+        {
+            UPInt mid = (lo + hi) >> 1;
+            if (Instrs[mid].Offset < abcOffset)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < Instrs.GetSize() && Instrs[lo].Offset == abcOffset)
+            return WordOffsets[lo];
+        return SF_MAX_UPINT;
+    }
+
+    UInt32 ThreadedCode::GetAbcOffset(TCodeOffset wordOffset) const
+    {
+        if (wordOffset >= Words.GetSize())
+            return SF_MAX_UINT32;
+        // Last emitted instruction starting at or before wordOffset.
+        UPInt lo = 0, hi = EmittedWords.GetSize();
+        while (lo < hi)
+        {
+            UPInt mid = (lo + hi) >> 1;
+            if (EmittedWords[mid] <= wordOffset)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo ? EmittedAbc[lo - 1] : SF_MAX_UINT32;
+    }
+
+} // namespace Abc
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3 {
@@ -0,0 +1,184 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   AS3_Abc_ThreadedCode.h
+Content     :   Direct-threaded method body representation with
+                superinstructions
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_AS3_Abc_ThreadedCode_H
+#define INC_AS3_Abc_ThreadedCode_H
+
+#include "AS3_Abc_Type.h"
+
+namespace Scaleform { namespace GFx { namespace AS3
+{
+
+namespace Abc
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Type facts proven by the verifier, consulted while rewriting. Returning
+    // NULL/false is always safe: the generic instruction is kept.
+    class ThreadedCodeOracle
+    {
+    public:
+        virtual ~ThreadedCodeOracle() {}
+
+        // Type of the stack value 'depth' slots below the top (0 is the top)
+        // just before the instruction at ABC offset 'abcOffset' executes.
+        virtual const TypeInfo* GetStackType(UInt32 abcOffset, unsigned depth) const = 0;
+        // True if the multiname needs name and/or namespace from the stack.
+        virtual bool IsRuntimeMultiname(UInt32 mnIndex) const = 0;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // ThreadedCode is an optional pre-pass over an ABC method body. The byte
+    // code is rewritten into a word stream: one word for the instruction
+    // followed by its decoded operands, with branch offsets already turned
+    // into word offsets. Adjacent instruction pairs that dominate typical
+    // ActionScript loops are fused into superinstructions, and arithmetic
+    // and int comparisons use specialized instructions when the verifier
+    // proves operand types through ThreadedCodeOracle.
+    //
+    // After Bind() the instruction words hold handler addresses instead of
+    // TOp indices, so the interpreter dispatches with a single indirect
+    // jump per instruction (direct threading) instead of a central switch.
+    //
+    // Fusion never crosses a branch or exception handler target, so every
+    // ABC offset that can be reached by control flow maps to a word offset
+    // (GetWordOffset). Nor does it cross the from/to boundary of an exception
+    // range, so a superinstruction lies entirely inside or outside every
+    // range, and the ABC offset GetAbcOffset reports for a throwing word
+    // selects the same handlers as the original instruction would.
+    class ThreadedCode : public NewOverrideBase<Mem_Stat>
+    {
+    public:
+        // Instruction words. The first 256 values are the ABC opcodes
+        // themselves; superinstructions and specialized forms follow.
+        enum TOp
+        {
+            tc_abc_last = 0xFF,
+
+            // getlocal N; getproperty mn (compile-time multiname).
+            // Operands: local, mn.
+            tc_getlocal_getproperty,
+            // push int immediate; add. Generic add semantics.
+            // Operands: immediate (sign-extended into the word).
+            tc_add_imm,
+            // Same, other operand proven int/Number.
+            tc_add_imm_i,
+            tc_add_imm_n,
+            // Arithmetic with both operands proven Number.
+            tc_add_nn,
+            tc_subtract_nn,
+            tc_multiply_nn,
+            tc_divide_nn,
+            // Conditional branches with both operands proven int.
+            // Operands: word offset of the target.
+            tc_iflt_ii,
+            tc_ifle_ii,
+            tc_ifgt_ii,
+            tc_ifge_ii,
+            tc_ifeq_ii,
+            tc_ifne_ii,
+
+            tc_count
+        };
+
+        struct Stats
+        {
+            unsigned    AbcInstructions;
+            unsigned    Words;
+            unsigned    Fused;          // Superinstructions emitted.
+            unsigned    Specialized;    // Type-specialized instructions emitted.
+        };
+
+        ThreadedCode();
+
+        // Exception ranges must be declared before Build. The handler entry
+        // point is a branch target not visible in the code itself, and
+        // [from, to) bounds instructions that fusion must not merge across.
+        void            AddExceptionRange(UInt32 from, UInt32 to, UInt32 target);
+
+        // Rewrites the method body. Returns false if the code is malformed;
+        // the interpreter should keep using the original code then.
+        bool            Build(const UInt8* code, UPInt size, const ThreadedCodeOracle* oracle);
+
+        // Replaces every instruction word with handlers[op]. Operands are
+        // left as they are. Handlers must be provided for all tc_count ops.
+        void            Bind(const void* const* handlers);
+        bool            IsBound() const { return Bound; }
+
+        const UPInt*    GetCode() const { return Words.GetDataPtr(); }
+        UPInt           GetSize() const { return Words.GetSize(); }
+
+        // Word offset of the instruction at abcOffset, or SF_MAX_UPINT if
+        // that instruction was folded into a superinstruction.
+        TCodeOffset     GetWordOffset(UInt32 abcOffset) const;
+        // ABC offset of the instruction whose words include wordOffset (the
+        // instruction word or one of its operands); for a superinstruction,
+        // the offset of its first ABC instruction. Used to look up the
+        // exception table when a threaded instruction throws. Returns
+        // SF_MAX_UINT32 for offsets past the end of the code.
+        UInt32          GetAbcOffset(TCodeOffset wordOffset) const;
+
+        const Stats&    GetStats() const { return CStats; }
+
+        // Number of operand words following an instruction word. The only
+        // variable-size instruction is lookupswitch: its first operand is
+        // the number of cases N, followed by N + 1 word offsets (default
+        // first).
+        static unsigned GetOperandCount(unsigned op);
+
+    private:
+        struct AbcInstr
+        {
+            UInt32      Offset;
+            UInt32      Next;
+            UInt32      Op;
+            // Decoded operands. Branches hold absolute ABC target offsets;
+            // lookupswitch holds case count and its first SwitchTargets index.
+            SInt32      Args[3];
+        };
+
+        bool            decode(const UInt8* code, UPInt size);
+        bool            isFusionBarrier(UInt32 abcOffset) const;
+        void            emitInstr(const AbcInstr& in, unsigned op);
+        unsigned        tryFuse(unsigned i, const ThreadedCodeOracle* oracle);
+        unsigned        specialize(const AbcInstr& in, const ThreadedCodeOracle* oracle);
+        bool            patchBranches();
+
+        ArrayLH_POD<AbcInstr, Mem_Stat>     Instrs;
+        // Sorted ABC offsets of branch and handler targets and exception
+        // range boundaries.
+        ArrayLH_POD<UInt32, Mem_Stat>       Barriers;
+        // Handler targets and range boundaries from AddExceptionRange.
+        ArrayLH_POD<UInt32, Mem_Stat>       RangeOffsets;
+        ArrayLH_POD<UInt32, Mem_Stat>       SwitchTargets;  // Absolute ABC offsets.
+        ArrayLH_POD<UPInt, Mem_Stat>        Words;
+        // Word offset per ABC instruction (index parallel to Instrs).
+        ArrayLH_POD<UPInt, Mem_Stat>        WordOffsets;
+        // Word offset and ABC offset of each emitted instruction, in word
+        // order; the reverse of WordOffsets.
+        ArrayLH_POD<UPInt, Mem_Stat>        EmittedWords;
+        ArrayLH_POD<UInt32, Mem_Stat>       EmittedAbc;
+        // Word positions of branch operands still holding ABC offsets.
+        ArrayLH_POD<UPInt, Mem_Stat>        BranchFixups;
+        bool                                Bound;
+        Stats                               CStats;
+    };
+
+} // namespace Abc
+
+}}} // namespace Scaleform { namespace GFx { namespace AS3 {
+
+#endif // INC_AS3_Abc_ThreadedCode_H
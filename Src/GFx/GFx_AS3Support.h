@@ -21,6 +21,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "GFx/GFx_Resource.h"
 #include "GFx/GFx_Loader.h"
 #include "GFx/AS3/AS3_StringManager.h"
+#include "GFx/AS3/AS3_MethodPrep.h"
 
 namespace Scaleform { namespace GFx {
 
@@ -82,6 +83,15 @@ public:
         (LoadProcess* , ButtonDef* , TagType ) {}
     virtual void ReadButton2ActionConditions
         (LoadProcess* , ButtonDef* , TagType ) {}
+
+    // Controls whether method bodies of newly loaded ABC files are verified
+    // on TaskManager threads ahead of their first call. Has no effect
+    // unless a TaskManager is installed on the loader.
+    void    SetMethodPrepOptions(const AS3::MethodPrepOptions& options) { MethodPrep = options; }
+    const AS3::MethodPrepOptions& GetMethodPrepOptions() const { return MethodPrep; }
+
+private:
+    AS3::MethodPrepOptions  MethodPrep;
 };
 }} // namespace Scaleform::GFx
 
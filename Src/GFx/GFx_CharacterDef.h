@@ -50,6 +50,7 @@ class SoundStreamDef;
 class DisplayObjectBase;
 class InteractiveObject;
 class TimelineDef;
+class TimelineKeyframes;
 
 // "newable" Scale9Grid rectangle.
 struct Scale9Grid : public NewOverrideBase<StatMD_CharDefs_Mem>
@@ -154,6 +155,8 @@ public:
 class TimelineDef : public CharacterDef
 {
 public:
+    TimelineDef() { }
+    virtual ~TimelineDef();
 
   
     struct Frame
@@ -199,6 +202,13 @@ public:
     virtual void                SetSoundStream(SoundStreamDef*)                      = 0;
     virtual unsigned            GetLoadingFrame() const                                 = 0;
 #endif
+
+    // Keyframe snapshots used by backward seeks, created on first use.
+    // Returns NULL if keyframes are disabled (see GFx_TimelineKeyframes.h).
+    TimelineKeyframes*          GetKeyframes();
+
+private:
+    AtomicPtr<TimelineKeyframes> pKeyframes;
 };
 
 
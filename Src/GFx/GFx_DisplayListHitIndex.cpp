@@ -0,0 +1,301 @@
+/**************************************************************************
+
+Filename    :   GFx_DisplayListHitIndex.cpp
+Content     :   Uniform grid over DisplayList children used to cull
+                hit test candidates
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "GFx/GFx_DisplayListHitIndex.h"
+#include "GFx/GFx_DisplayObjContainer.h"
+#include "Kernel/SF_Alg.h"
+#include <math.h>
+
+namespace Scaleform { namespace GFx {
+
+DisplayListHitIndex::DisplayListHitIndex()
+    : Valid(false), ModId(0), GridBounds(0, 0, 0, 0),
+      GridW(0), GridH(0), CellScaleX(0), CellScaleY(0)
+{
+    ResetStats();
+}
+
+void DisplayListHitIndex::ResetStats()
+{
+    memset(&HitStats, 0, sizeof(HitStats));
+}
+
+bool DisplayListHitIndex::IsValid(const DisplayList& dl) const
+{
+    return Valid && ModId == dl.GetCurModId() && Entries.GetSize() == dl.GetCount();
+}
+
+// A child may be culled by its bounds only if its own PointTestLocal and
+// GetTopMostMouseEntity can't report a hit outside GetBounds(GetMatrix()).
+// Masks, 3D and scale9 children, buttons (hit state shape), text fields and
+// sprites with hitArea relationships don't guarantee that.
+bool DisplayListHitIndex::isCullable(const DisplayObjectBase* ch)
+{
+    if (ch->GetClipDepth() > 0 || ch->Is3D() || ch->HasScale9Grid())
+        return false;
+    if (ch->IsInteractiveObject())
+    {
+        if (!ch->IsSprite())
+            return false;
+        const DisplayObjContainer* pc = ch->CharToDisplayObjContainer_Unsafe();
+        if (pc->GetHitArea() || pc->GetHitAreaHolder())
+            return false;
+    }
+    return true;
+}
+
+int DisplayListHitIndex::cellX(float x) const
+{
+    return Alg::Clamp(int((x - GridBounds.x1) * CellScaleX), 0, GridW - 1);
+}
+
+int DisplayListHitIndex::cellY(float y) const
+{
+    return Alg::Clamp(int((y - GridBounds.y1) * CellScaleY), 0, GridH - 1);
+}
+
+void DisplayListHitIndex::computeEntry(const DisplayObjectBase* ch, Entry* e) const
+{
+    e->X0 = e->Y0 = e->X1 = e->Y1 = 0;
+    if (!isCullable(ch))
+    {
+        e->Kind   = Entry_Always;
+        e->Bounds = RectF(0, 0, 0, 0);
+        return;
+    }
+
+    e->Bounds = ch->GetBounds(ch->GetMatrix());
+    e->Kind   = Entry_Large;
+    if (GridW == 0 || !e->Bounds.IsNormal() || e->Bounds.IsEmpty())
+        return;
+    if (e->Bounds.x1 < GridBounds.x1 || e->Bounds.y1 < GridBounds.y1 ||
+        e->Bounds.x2 > GridBounds.x2 || e->Bounds.y2 > GridBounds.y2)
+        return;
+
+    e->X0 = cellX(e->Bounds.x1);
+    e->Y0 = cellY(e->Bounds.y1);
+    e->X1 = cellX(e->Bounds.x2);
+    e->Y1 = cellY(e->Bounds.y2);
+    if ((e->X1 - e->X0 + 1) * (e->Y1 - e->Y0 + 1) <= MaxCellsPerChild)
+        e->Kind = Entry_Grid;
+}
+
+void DisplayListHitIndex::addEntry(unsigned index)
+{
+    const Entry& e = Entries[index];
+    switch (e.Kind)
+    {
+    case Entry_Grid:
+        for (int y = e.Y0; y <= e.Y1; ++y)
+            for (int x = e.X0; x <= e.X1; ++x)
+                Cells[y * GridW + x].PushBack(index);
+        break;
+    case Entry_Large:
+        LargeList.PushBack(index);
+        break;
+    default:
+        AlwaysList.PushBack(index);
+        break;
+    }
+}
+
+void DisplayListHitIndex::removeFromList(IndexArray& list, unsigned index)
+{
+    for (UPInt i = 0, n = list.GetSize(); i < n; ++i)
+    {
+        if (list[i] == index)
+        {
+            // Lists are unordered; GetCandidates sorts its output.
+            list[i] = list[n - 1];
+            list.PopBack();
+            return;
+        }
+    }
+}
+
+void DisplayListHitIndex::removeEntry(unsigned index)
+{
+    const Entry& e = Entries[index];
+    switch (e.Kind)
+    {
+    case Entry_Grid:
+        for (int y = e.Y0; y <= e.Y1; ++y)
+            for (int x = e.X0; x <= e.X1; ++x)
+                removeFromList(Cells[y * GridW + x], index);
+        break;
+    case Entry_Large:
+        removeFromList(LargeList, index);
+        break;
+    default:
+        removeFromList(AlwaysList, index);
+        break;
+    }
+}
+
+//------------------------------------------------------------------------
+void DisplayListHitIndex::Build(const DisplayList& dl)
+{
+    unsigned count = (unsigned)dl.GetCount();
+    unsigned i;
+
+    HitStats.Rebuilds++;
+    Entries.Resize(count);
+    LargeList.Clear();
+    AlwaysList.Clear();
+    Cells.Clear();
+    GridW = GridH = 0;
+
+    // First pass: bounds of the cullable children define the grid.
+    unsigned cullable = 0;
+    RectF    bounds(0, 0, 0, 0);
+    for (i = 0; i < count; ++i)
+    {
+        computeEntry(dl.GetDisplayObject(i), &Entries[i]);
+        const RectF& b = Entries[i].Bounds;
+        if (Entries[i].Kind == Entry_Always || !b.IsNormal() || b.IsEmpty())
+            continue;
+        if (cullable++ == 0)
+            bounds = b;
+        else
+            bounds.Union(b);
+    }
+
+    if (cullable && !bounds.IsEmpty())
+    {
+        // About two children per cell, with the cell aspect following the
+        // bounds so elongated lists don't collapse into a single row.
+        float w = bounds.Width(), h = bounds.Height();
+        float cells = Alg::Max(1.0f, cullable * 0.5f);
+        float gw = sqrtf(cells * w / h);
+        GridW = Alg::Clamp(int(gw + 0.5f), 1, (int)MaxGridDim);
+        GridH = Alg::Clamp(int(cells / GridW + 0.5f), 1, (int)MaxGridDim);
+        GridBounds = bounds;
+        CellScaleX = GridW / w;
+        CellScaleY = GridH / h;
+        Cells.Resize(GridW * GridH);
+
+        // Second pass bins against the final grid.
+        for (i = 0; i < count; ++i)
+            if (Entries[i].Kind != Entry_Always)
+                computeEntry(dl.GetDisplayObject(i), &Entries[i]);
+    }
+
+    for (i = 0; i < count; ++i)
+        addEntry(i);
+
+    ModId = dl.GetCurModId();
+    Valid = true;
+}
+
+void DisplayListHitIndex::UpdateChild(const DisplayList& dl, const DisplayObjectBase* ch)
+{
+    if (!IsValid(dl))
+        return; // Rebuilt on next query anyway.
+
+    SPInt index = dl.FindDisplayIndex(ch);
+    if (index < 0)
+    {
+        Invalidate();
+        return;
+    }
+
+    HitStats.Updates++;
+    removeEntry((unsigned)index);
+    computeEntry(ch, &Entries[index]);
+    addEntry((unsigned)index);
+}
+
+static bool DisplayListHitIndex_Greater(unsigned a, unsigned b)
+{
+    return a > b;
+}
+
+void DisplayListHitIndex::GetCandidates(const DisplayList& dl, const Render::PointF& pt,
+                                        ArrayPOD<unsigned>* candidates)
+{
+    SF_ASSERT(IsValid(dl));
+    SF_UNUSED(dl);
+
+    candidates->Clear();
+    HitStats.Queries++;
+    HitStats.Children += (unsigned)Entries.GetSize();
+
+    UPInt i;
+    if (GridW && pt.x >= GridBounds.x1 && pt.x <= GridBounds.x2 &&
+        pt.y >= GridBounds.y1 && pt.y <= GridBounds.y2)
+    {
+        const IndexArray& cell = Cells[cellY(pt.y) * GridW + cellX(pt.x)];
+        for (i = 0; i < cell.GetSize(); ++i)
+        {
+            const RectF& b = Entries[cell[i]].Bounds;
+            if (pt.x >= b.x1 && pt.x <= b.x2 && pt.y >= b.y1 && pt.y <= b.y2)
+                candidates->PushBack(cell[i]);
+        }
+    }
+    for (i = 0; i < LargeList.GetSize(); ++i)
+    {
+        const RectF& b = Entries[LargeList[i]].Bounds;
+        if (pt.x >= b.x1 && pt.x <= b.x2 && pt.y >= b.y1 && pt.y <= b.y2)
+            candidates->PushBack(LargeList[i]);
+    }
+    candidates->Append(AlwaysList.GetDataPtr(), AlwaysList.GetSize());
+
+    Alg::QuickSort(*candidates, DisplayListHitIndex_Greater);
+    HitStats.Candidates += (unsigned)candidates->GetSize();
+}
+
+//------------------------------------------------------------------------
+#ifdef GFX_ENABLE_HIT_INDEX
+
+void DisplayObjContainer::EnableHitIndex(bool enable)
+{
+    if (!enable)
+        pHitIndex = NULL;
+    else if (!pHitIndex)
+        pHitIndex = *SF_HEAP_AUTO_NEW(this) DisplayListHitIndex();
+}
+
+DisplayListHitIndex* DisplayObjContainer::GetValidHitIndex()
+{
+    if (!pHitIndex || mDisplayList.GetCount() < HitIndexMinChildren)
+        return NULL;
+    if (!pHitIndex->IsValid(mDisplayList))
+        pHitIndex->Build(mDisplayList);
+    return pHitIndex;
+}
+
+void DisplayObjContainer::NotifyGeometryChanged(DisplayObjectBase* ch)
+{
+    // A child's bounds feed into every ancestor's bounds, so each indexed
+    // ancestor re-bins the child on the path to the root.
+    for (DisplayObjectBase* p = ch; p; )
+    {
+        InteractiveObject* parent = p->GetParent();
+        if (!parent)
+            break;
+        if (parent->IsDisplayObjContainer())
+        {
+            DisplayObjContainer* pc = parent->CharToDisplayObjContainer_Unsafe();
+            if (pc->pHitIndex)
+                pc->pHitIndex->UpdateChild(pc->mDisplayList, p);
+        }
+        p = parent;
+    }
+}
+
+#endif // GFX_ENABLE_HIT_INDEX
+
+}} // namespace Scaleform::GFx
@@ -0,0 +1,130 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   GFx_DisplayListHitIndex.h
+Content     :   Uniform grid over DisplayList children used to cull
+                hit test candidates
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+#ifndef INC_SF_GFX_DISPLAYLISTHITINDEX_H
+#define INC_SF_GFX_DISPLAYLISTHITINDEX_H
+
+#include "Kernel/SF_RefCount.h"
+#include "Kernel/SF_Array.h"
+#include "GFx/GFx_PlayerStats.h"
+#include "GFx/GFx_Types.h"
+
+namespace Scaleform { namespace GFx {
+
+class DisplayList;
+class DisplayObjectBase;
+
+// DisplayListHitIndex bins the children of one DisplayObjContainer into a
+// uniform grid in the container's local space, so that a mouse hit test
+// only calls PointTestLocal/GetTopMostMouseEntity for children whose
+// bounds contain the point. It pays off for flat containers with many
+// children (inventory grids, tile maps, long lists).
+//
+// Culling must never change the hit test result, so only children whose
+// hit region is known to lie within GetBounds(GetMatrix()) are binned:
+// shapes, static text and sprites without hit areas, masks, 3D or
+// scale9. Everything else goes to an "always test" list that's merged
+// back into the candidates unconditionally.
+//
+// The index is rebuilt lazily when the display list's ModId changes
+// (add/remove/swap/depth changes) and updated per child when a child's
+// matrix or subtree bounds change; see
+// DisplayObjContainer::NotifyGeometryChanged. Nothing in this source tree
+// calls that yet, so the index is compiled out of EnableHitIndex unless
+// GFX_ENABLE_HIT_INDEX is defined.
+class DisplayListHitIndex : public RefCountBase<DisplayListHitIndex, StatMV_MovieClip_Mem>
+{
+public:
+    enum
+    {
+        // Containers with fewer children aren't worth indexing.
+        DefaultMinChildren  = 32,
+        MaxGridDim          = 64,
+        // Children spanning more cells than this are kept in a separate
+        // list and tested by bounds only.
+        MaxCellsPerChild    = 16
+    };
+
+    struct Stats
+    {
+        unsigned    Rebuilds;
+        unsigned    Updates;
+        unsigned    Queries;
+        unsigned    Candidates;     // Total candidates returned by queries.
+        unsigned    Children;       // Children seen by queries (linear walk cost).
+    };
+
+    DisplayListHitIndex();
+
+    // Forces a rebuild on next use.
+    void        Invalidate()        { Valid = false; }
+    bool        IsValid(const DisplayList& dl) const;
+
+    void        Build(const DisplayList& dl);
+
+    // Re-bins a single child after its matrix or bounds changed.
+    // Falls back to invalidation if the child isn't in the indexed list.
+    void        UpdateChild(const DisplayList& dl, const DisplayObjectBase* ch);
+
+    // Returns display list indices of the children that may contain the
+    // local point, in descending order (the order GetTopMostMouseEntity
+    // walks children). The index must be valid for dl.
+    void        GetCandidates(const DisplayList& dl, const Render::PointF& pt,
+                              ArrayPOD<unsigned>* candidates);
+
+    const Stats& GetStats() const   { return HitStats; }
+    void        ResetStats();
+
+private:
+    enum EntryKind
+    {
+        Entry_Grid,         // Binned in cells [X0..X1] x [Y0..Y1].
+        Entry_Large,        // Tested by bounds only (large, degenerate or off-grid).
+        Entry_Always        // Always a candidate.
+    };
+
+    struct Entry
+    {
+        RectF       Bounds;
+        unsigned    Kind;
+        int         X0, Y0, X1, Y1;
+    };
+
+    typedef ArrayLH_POD<unsigned, StatMV_MovieClip_Mem> IndexArray;
+
+    static bool isCullable(const DisplayObjectBase* ch);
+    void        computeEntry(const DisplayObjectBase* ch, Entry* e) const;
+    void        addEntry(unsigned index);
+    void        removeEntry(unsigned index);
+    void        removeFromList(IndexArray& list, unsigned index);
+    int         cellX(float x) const;
+    int         cellY(float y) const;
+
+    bool                                        Valid;
+    unsigned                                    ModId;
+    ArrayLH_POD<Entry, StatMV_MovieClip_Mem>    Entries;
+    ArrayLH<IndexArray, StatMV_MovieClip_Mem>   Cells;
+    IndexArray                                  LargeList;
+    IndexArray                                  AlwaysList;
+    RectF                                       GridBounds;
+    int                                         GridW, GridH;
+    float                                       CellScaleX, CellScaleY;
+    Stats                                       HitStats;
+};
+
+}} // namespace Scaleform::GFx
+
+#endif // INC_SF_GFX_DISPLAYLISTHITINDEX_H
@@ -18,6 +18,9 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 #include "GFx/GFx_InteractiveObject.h"
 #include "GFx/GFx_DisplayList.h"
+#ifdef GFX_ENABLE_HIT_INDEX
+#include "GFx/GFx_DisplayListHitIndex.h"
+#endif
 
 namespace Scaleform { namespace GFx {
 
@@ -44,6 +47,12 @@ protected:
     // Null for all non-root sprites.
     MovieDefRootNode*   pRootNode;
 
+#ifdef GFX_ENABLE_HIT_INDEX
+    // Optional spatial index used to cull hit test candidates; null
+    // unless EnableHitIndex(true) was called.
+    Ptr<DisplayListHitIndex> pHitIndex;
+#endif
+
 public:
     DisplayObjContainer
         (MovieDefImpl* pbindingDefImpl, 
@@ -164,6 +173,30 @@ public:
     void                CalcDisplayListHitTestMaskArray(
         ArrayPOD<UByte> *phitTest, const Render::PointF &p, bool testShape) const;
 
+    // Hit index. When enabled and the container has at least
+    // HitIndexMinChildren children, GetTopMostMouseEntity and PointTestLocal
+    // only visit the children returned by GetCandidates, in the same
+    // (descending) order as the linear walk.
+    // The index is only correct if SetMatrix and the shape/text bounds
+    // setters call NotifyGeometryChanged; otherwise it culls against stale
+    // bounds. Those setters are outside this source tree, so the index is
+    // only compiled in when GFX_ENABLE_HIT_INDEX is defined, which should only
+    // be done once the notifications are in place; otherwise containers carry
+    // no index and NotifyGeometryChanged is a no-op.
+#ifdef GFX_ENABLE_HIT_INDEX
+    enum { HitIndexMinChildren = DisplayListHitIndex::DefaultMinChildren };
+    void                EnableHitIndex(bool enable);
+    bool                IsHitIndexEnabled() const { return pHitIndex.GetPtr() != NULL; }
+    // Returns the index rebuilt if the display list changed since the last
+    // use, or null if hit tests should do a linear walk.
+    DisplayListHitIndex* GetValidHitIndex();
+    // Must be called after a change to ch's matrix or to the bounds of its
+    // subtree (SetMatrix, shape/text changes, child add/remove below ch).
+    static void         NotifyGeometryChanged(DisplayObjectBase* ch);
+#else
+    static void         NotifyGeometryChanged(DisplayObjectBase*) { }
+#endif
+
     MovieDefRootNode*   FindRootNode() const;
 
     virtual bool        Has3D();                        // checks object and descendants
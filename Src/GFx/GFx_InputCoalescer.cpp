@@ -0,0 +1,200 @@
+/**************************************************************************
+
+Filename    :   GFx_InputCoalescer.cpp
+Content     :   Per-pointer coalescing of mouse/touch move events
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "GFx/GFx_InputCoalescer.h"
+#include "Kernel/SF_Timer.h"
+
+namespace Scaleform { namespace GFx {
+
+InputCoalescer::InputCoalescer()
+    : PendingMask(0), TouchCount(0), PendingTouchCount(0)
+{
+    // PendingMask has one bit per mouse.
+    SF_COMPILER_ASSERT(GFX_MAX_MICE_SUPPORTED <= 32);
+    SetPolicy(Policy_LatestOnly);
+    for (unsigned i = 0; i < GFX_MAX_MICE_SUPPORTED; ++i)
+        MouseLastDispatch[i] = 0;
+    ResetStats();
+}
+
+void InputCoalescer::SetPolicy(PolicyType policy, float minInterval)
+{
+    Policy           = policy;
+    MinInterval      = (minInterval > 0) ? minInterval : 0;
+    MinIntervalTicks = UInt64(MinInterval * Timer::MksPerSecond);
+}
+
+void InputCoalescer::ResetStats()
+{
+    memset(&CStats, 0, sizeof(CStats));
+}
+
+void InputCoalescer::Reset()
+{
+    CStats.MovesCoalesced += PendingTouchCount;
+    for (unsigned i = 0; i < GFX_MAX_MICE_SUPPORTED; ++i)
+        if (PendingMask & (1u << i))
+            CStats.MovesCoalesced++;
+    PendingMask       = 0;
+    TouchCount        = 0;
+    PendingTouchCount = 0;
+}
+
+bool InputCoalescer::isDue(UInt64 lastDispatch, UInt64 now) const
+{
+    return Policy != Policy_RateLimited || lastDispatch == 0 ||
+           now - lastDispatch >= MinIntervalTicks;
+}
+
+//------------------------------------------------------------------------
+void InputCoalescer::AddMouseMove(InputEventsQueue& q, unsigned mouseIndex, const PointF& pos)
+{
+    SF_ASSERT(mouseIndex < GFX_MAX_MICE_SUPPORTED);
+    CStats.MovesReceived++;
+
+    if (Policy == Policy_All)
+    {
+        q.AddMouseMove(mouseIndex, pos);
+        CStats.MovesDispatched++;
+        return;
+    }
+    if (PendingMask & (1u << mouseIndex))
+        CStats.MovesCoalesced++;
+    MousePos[mouseIndex] = pos;
+    PendingMask |= (1u << mouseIndex);
+}
+
+void InputCoalescer::dispatchMouse(InputEventsQueue& q, unsigned mouseIndex, UInt64 now)
+{
+    q.AddMouseMove(mouseIndex, MousePos[mouseIndex]);
+    MouseLastDispatch[mouseIndex] = now;
+    PendingMask &= ~(1u << mouseIndex);
+    CStats.MovesDispatched++;
+}
+
+void InputCoalescer::FlushMouse(InputEventsQueue& q, unsigned mouseIndex)
+{
+    if (PendingMask & (1u << mouseIndex))
+        dispatchMouse(q, mouseIndex, Timer::GetTicks());
+}
+
+//------------------------------------------------------------------------
+#ifdef GFX_MULTITOUCH_SUPPORT_ENABLE
+
+InputCoalescer::PendingTouch* InputCoalescer::findTouch(unsigned id, bool create)
+{
+    for (unsigned i = 0; i < TouchCount; ++i)
+        if (Touches[i].Id == id)
+            return &Touches[i];
+    if (!create)
+        return 0;
+
+    // Reuse a slot of a touch point that has nothing pending; its rate
+    // limit history is lost, which only allows one early dispatch.
+    unsigned slot = TouchCount;
+    if (TouchCount == MaxTouchPoints)
+    {
+        for (slot = 0; slot < TouchCount && Touches[slot].Pending; ++slot) {}
+        if (slot == TouchCount)
+            return 0;
+    }
+    else
+        TouchCount++;
+
+    PendingTouch& t = Touches[slot];
+    t.Id           = id;
+    t.Pending      = false;
+    t.LastDispatch = 0;
+    return &t;
+}
+
+void InputCoalescer::AddTouchMove(InputEventsQueue& q, unsigned id, const PointF& pos,
+                                  const SizeF& touchSize, float pressure, bool primary)
+{
+    CStats.MovesReceived++;
+
+    PendingTouch* t = (Policy == Policy_All) ? 0 : findTouch(id, true);
+    if (!t)
+    {
+        // Policy_All, or more simultaneous touch points than slots.
+        q.AddTouchMove(id, pos, touchSize, pressure, primary);
+        CStats.MovesDispatched++;
+        return;
+    }
+    if (t->Pending)
+        CStats.MovesCoalesced++;
+    else
+        PendingTouchCount++;
+    t->Pos      = pos;
+    t->Size     = touchSize;
+    t->Pressure = pressure;
+    t->Primary  = primary;
+    t->Pending  = true;
+}
+
+void InputCoalescer::dispatchTouch(InputEventsQueue& q, PendingTouch& t, UInt64 now)
+{
+    q.AddTouchMove(t.Id, t.Pos, t.Size, t.Pressure, t.Primary);
+    t.Pending      = false;
+    t.LastDispatch = now;
+    PendingTouchCount--;
+    CStats.MovesDispatched++;
+}
+
+void InputCoalescer::FlushTouch(InputEventsQueue& q, unsigned id, bool release)
+{
+    PendingTouch* t = findTouch(id, false);
+    if (!t)
+        return;
+    if (t->Pending)
+        dispatchTouch(q, *t, Timer::GetTicks());
+    if (release)
+        *t = Touches[--TouchCount];
+}
+
+#endif // GFX_MULTITOUCH_SUPPORT_ENABLE
+
+//------------------------------------------------------------------------
+void InputCoalescer::Flush(InputEventsQueue& q)
+{
+    if (!HasPending())
+        return;
+
+    UInt64 now = Timer::GetTicks();
+    CStats.Flushes++;
+
+    for (unsigned i = 0; i < GFX_MAX_MICE_SUPPORTED; ++i)
+    {
+        if ((PendingMask & (1u << i)) && isDue(MouseLastDispatch[i], now))
+            dispatchMouse(q, i, now);
+    }
+#ifdef GFX_MULTITOUCH_SUPPORT_ENABLE
+    for (unsigned j = 0; j < TouchCount && PendingTouchCount; ++j)
+    {
+        if (Touches[j].Pending && isDue(Touches[j].LastDispatch, now))
+            dispatchTouch(q, Touches[j], now);
+    }
+#endif
+}
+
+void InputCoalescer::FlushAll(InputEventsQueue& q)
+{
+    PolicyType policy = Policy;
+    Policy = Policy_LatestOnly;
+    Flush(q);
+    Policy = policy;
+}
+
+}} // namespace Scaleform::GFx
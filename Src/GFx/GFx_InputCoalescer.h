@@ -0,0 +1,129 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   GFx_InputCoalescer.h
+Content     :   Per-pointer coalescing of mouse/touch move events
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_GFX_INPUTCOALESCER_H
+#define INC_SF_GFX_INPUTCOALESCER_H
+
+#include "GFx/GFx_Input.h"
+
+namespace Scaleform { namespace GFx {
+
+// ***** InputCoalescer
+// Sits in front of InputEventsQueue and holds back mouse and touch move
+// events, so that a 1000Hz mouse or a high-frequency touch panel produces
+// at most one move per pointer per ProcessInput pass. Every dispatched move
+// costs a top-most entity search plus AS event dispatch in MovieImpl, so
+// the search is done once per coalesced batch instead of once per event.
+//
+// Ordering is preserved per pointer: any non-move event for a pointer
+// (button, wheel, touch begin/end) first flushes that pointer's pending
+// move. Moves of different pointers may be reordered relative to each
+// other, which matches how InputEventsQueue already reports mouse moves.
+class InputCoalescer
+{
+public:
+    enum PolicyType
+    {
+        // Every move is forwarded immediately. Note that InputEventsQueue
+        // still merges consecutive moves of the same mouse on its own.
+        Policy_All,
+        // Only the latest position per pointer is forwarded on Flush.
+        Policy_LatestOnly,
+        // Like LatestOnly, but a pointer's move is held back until
+        // MinInterval seconds have passed since its last dispatched move.
+        Policy_RateLimited
+    };
+
+    struct Stats
+    {
+        unsigned    MovesReceived;
+        unsigned    MovesDispatched;
+        unsigned    MovesCoalesced;     // Replaced by a later move before dispatch.
+        unsigned    Flushes;
+    };
+
+    InputCoalescer();
+
+    void        SetPolicy(PolicyType policy, float minInterval = 1.0f / 60.0f);
+    PolicyType  GetPolicy() const           { return Policy; }
+    float       GetMinInterval() const      { return MinInterval; }
+
+    const Stats& GetStats() const           { return CStats; }
+    void        ResetStats();
+
+    // Queues a mouse move; forwarded to the queue on Flush.
+    void        AddMouseMove(InputEventsQueue& q, unsigned mouseIndex, const PointF& pos);
+    // Must be called before any other event for the mouse is added to q.
+    void        FlushMouse(InputEventsQueue& q, unsigned mouseIndex);
+
+#ifdef GFX_MULTITOUCH_SUPPORT_ENABLE
+    void        AddTouchMove(InputEventsQueue& q, unsigned id, const PointF& pos,
+                             const SizeF& touchSize, float pressure, bool primary);
+    // Must be called before a touch begin/end for id is added to q;
+    // release frees the touch point's slot on Touch_End.
+    void        FlushTouch(InputEventsQueue& q, unsigned id, bool release = false);
+#endif
+
+    // Forwards pending moves that are due under the current policy.
+    // Should be called at the start of ProcessInput, before the queue is
+    // drained.
+    void        Flush(InputEventsQueue& q);
+    // Forwards all pending moves regardless of rate limit.
+    void        FlushAll(InputEventsQueue& q);
+    // Drops pending moves (e.g., on ResetMouseState).
+    void        Reset();
+
+    bool        HasPending() const          { return PendingMask != 0 || PendingTouchCount != 0; }
+
+private:
+    enum { MaxTouchPoints = 16 };
+
+    struct PendingTouch
+    {
+        unsigned    Id;
+        PointF      Pos;
+        SizeF       Size;
+        float       Pressure;
+        bool        Primary;
+        bool        Pending;
+        UInt64      LastDispatch;
+    };
+
+    bool        isDue(UInt64 lastDispatch, UInt64 now) const;
+    void        dispatchMouse(InputEventsQueue& q, unsigned mouseIndex, UInt64 now);
+#ifdef GFX_MULTITOUCH_SUPPORT_ENABLE
+    PendingTouch* findTouch(unsigned id, bool create);
+    void        dispatchTouch(InputEventsQueue& q, PendingTouch& t, UInt64 now);
+#endif
+
+    PolicyType      Policy;
+    float           MinInterval;
+    UInt64          MinIntervalTicks;
+
+    PointF          MousePos[GFX_MAX_MICE_SUPPORTED];
+    UInt64          MouseLastDispatch[GFX_MAX_MICE_SUPPORTED];
+    UInt32          PendingMask;    // Bit i set if mouse i has a pending move.
+
+    PendingTouch    Touches[MaxTouchPoints];
+    unsigned        TouchCount;
+    unsigned        PendingTouchCount;
+
+    Stats           CStats;
+};
+
+}} // namespace Scaleform::GFx
+
+#endif // INC_SF_GFX_INPUTCOALESCER_H
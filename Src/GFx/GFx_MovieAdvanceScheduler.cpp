@@ -0,0 +1,369 @@
+/**************************************************************************
+
+Filename    :   GFx_MovieAdvanceScheduler.cpp
+Content     :   Parallel Advance of independent movie views
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "GFx/GFx_MovieAdvanceScheduler.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_Timer.h"
+#include "Kernel/SF_Trace.h"
+
+namespace Scaleform { namespace GFx {
+
+// ActionScript can recurse deeply, so workers get more than the default
+// Thread stack.
+static const UPInt MovieAdvanceScheduler_StackSize = 512 * 1024;
+
+#ifdef SF_ENABLE_THREADS
+
+class MovieAdvanceScheduler::WorkerThread : public Thread
+{
+public:
+    WorkerThread(MovieAdvanceScheduler* pscheduler, unsigned index)
+        : Thread(MovieAdvanceScheduler_StackSize), pScheduler(pscheduler), Index(index) { }
+
+    virtual int Run()
+    {
+        MovieAdvanceScheduler* ps = pScheduler;
+        ThreadId threadId   = GetCurrentThreadId();
+        unsigned lastFrame  = 0;
+        SF_TRACE_CODE(Trace::SetThreadName("MovieAdvanceScheduler"));
+
+        while (1)
+        {
+            {
+                Mutex::Locker lock(&ps->FrameMutex);
+                while (ps->FrameId == lastFrame && !ps->Exiting)
+                    ps->FrameStart.Wait(&ps->FrameMutex);
+                if (ps->Exiting)
+                    break;
+                lastFrame = ps->FrameId;
+            }
+
+            ps->advanceWorker(Index, threadId);
+
+            Mutex::Locker lock(&ps->FrameMutex);
+            if (--ps->PendingWorkers == 0)
+                ps->FrameDone.NotifyAll();
+        }
+        return 0;
+    }
+
+private:
+    // Not AddRef-ed; the scheduler joins its workers before it is destroyed.
+    MovieAdvanceScheduler*  pScheduler;
+    unsigned                Index;
+};
+
+#endif // SF_ENABLE_THREADS
+
+
+// ***** MovieAdvanceScheduler
+
+MovieAdvanceScheduler::MovieAdvanceScheduler(unsigned threadCount)
+    : RebalanceInterval(60), FrameDeltaT(0.0f), FrameCatchUp(2)
+{
+#ifdef SF_ENABLE_THREADS
+    if (threadCount == 0)
+        threadCount = (unsigned)Alg::Max(Thread::GetCPUCount(), 1);
+    FrameId        = 0;
+    PendingWorkers = 0;
+    Exiting        = false;
+#else
+    threadCount = 1;
+#endif
+    ThreadCount = threadCount;
+
+    NextAdvance.Resize(ThreadCount);
+    FrameWorkerTicks.Resize(ThreadCount);
+    ResetStats();
+
+#ifdef SF_ENABLE_THREADS
+    for (unsigned i = 1; i < ThreadCount; i++)
+    {
+        Ptr<WorkerThread> pworker = *SF_HEAP_AUTO_NEW(this) WorkerThread(this, i);
+        if (!pworker->Start())
+        {
+            // Run with whatever we got; groups are only assigned to
+            // workers that exist.
+            ThreadCount = i;
+            break;
+        }
+        Workers.PushBack(pworker);
+    }
+#endif
+}
+
+MovieAdvanceScheduler::~MovieAdvanceScheduler()
+{
+#ifdef SF_ENABLE_THREADS
+    {
+        Mutex::Locker lock(&FrameMutex);
+        Exiting = true;
+        FrameStart.NotifyAll();
+    }
+    for (UPInt i = 0; i < Workers.GetSize(); i++)
+        Workers[i]->Wait();
+#endif
+    for (UPInt i = 0; i < Views.GetSize(); i++)
+        Views[i].pMovie->Release();
+}
+
+Movie* MovieAdvanceScheduler::CreateView(MovieDef* pdef, const char* heapName,
+                                         const MemoryParams& memParams, bool initFirstFrame,
+                                         Render::ThreadCommandQueue* queue)
+{
+    Ptr<MemoryContext> pmemContext = *pdef->CreateMemoryContext(heapName, memParams, false);
+    if (!pmemContext)
+        return NULL;
+    Movie* pmovie = pdef->CreateInstance(pmemContext, initFirstFrame, NULL, queue);
+    if (pmovie)
+        AddView(pmovie);
+    return pmovie;
+}
+
+unsigned MovieAdvanceScheduler::leastLoadedWorker() const
+{
+    // By view count, since new groups have no measured cost yet.
+    ArrayDH_POD<unsigned> load(Memory::GetHeapByAddress(this));
+    load.Resize(ThreadCount);
+    for (unsigned i = 0; i < ThreadCount; i++)
+        load[i] = 0;
+    for (UPInt i = 0; i < Groups.GetSize(); i++)
+        load[Groups[i].Worker] += Groups[i].ViewCount;
+
+    unsigned best = 0;
+    for (unsigned i = 1; i < ThreadCount; i++)
+    {
+        if (load[i] < load[best])
+            best = i;
+    }
+    return best;
+}
+
+int MovieAdvanceScheduler::AddView(Movie* pmovie, int group)
+{
+    SF_ASSERT(pmovie);
+    Lock::Locker lock(&ViewLock);
+
+    if (group == Group_Auto || group >= (int)Groups.GetSize())
+    {
+        // Reuse an empty group before making a new one.
+        group = -1;
+        for (UPInt i = 0; i < Groups.GetSize(); i++)
+        {
+            if (Groups[i].ViewCount == 0)
+            {
+                group = (int)i;
+                break;
+            }
+        }
+        if (group < 0)
+        {
+            group = (int)Groups.GetSize();
+            Groups.PushBack(GroupEntry());
+        }
+        Groups[group].Worker    = leastLoadedWorker();
+        Groups[group].ViewCount = 0;
+        Groups[group].LastTicks = 0;
+    }
+
+    ViewEntry e;
+    e.pMovie        = pmovie;
+    e.Group         = group;
+    pmovie->AddRef();
+    e.CaptureWorker = -1;
+    Views.PushBack(e);
+    Groups[group].ViewCount++;
+    return group;
+}
+
+void MovieAdvanceScheduler::RemoveView(Movie* pmovie)
+{
+    Lock::Locker lock(&ViewLock);
+    for (UPInt i = 0; i < Views.GetSize(); i++)
+    {
+        if (Views[i].pMovie == pmovie)
+        {
+            Groups[Views[i].Group].ViewCount--;
+            pmovie->SetCaptureThread(GetCurrentThreadId());
+            Views.RemoveAt(i);
+            pmovie->Release();
+            return;
+        }
+    }
+}
+
+unsigned MovieAdvanceScheduler::GetViewCount() const
+{
+    Lock::Locker lock(&ViewLock);
+    return (unsigned)Views.GetSize();
+}
+
+void MovieAdvanceScheduler::advanceWorker(unsigned worker, ThreadId threadId)
+{
+    UInt64 startTicks = Timer::GetTicks();
+    float  nextAdvance = 1.0f;
+
+    // Groups are costed in the same pass; only this worker writes the
+    // LastTicks of its own groups.
+    for (UPInt i = 0; i < Groups.GetSize(); i++)
+    {
+        if (Groups[i].Worker == worker)
+            Groups[i].LastTicks = 0;
+    }
+
+    for (UPInt i = 0; i < Views.GetSize(); i++)
+    {
+        ViewEntry&  e     = Views[i];
+        GroupEntry& group = Groups[e.Group];
+        if (group.Worker != worker)
+            continue;
+
+        // The previous owner is idle, so the capture thread can be moved
+        // from here.
+        if (e.CaptureWorker != (int)worker)
+        {
+            e.pMovie->SetCaptureThread(threadId);
+            e.CaptureWorker = (int)worker;
+        }
+
+        SF_TRACE_SCOPE(TraceCat_Advance, "Movie::Advance");
+        UInt64 viewStart = Timer::GetTicks();
+        float  next      = e.pMovie->Advance(FrameDeltaT, FrameCatchUp, true);
+        group.LastTicks += Timer::GetTicks() - viewStart;
+        nextAdvance = Alg::Min(nextAdvance, next);
+    }
+
+    NextAdvance[worker]      = nextAdvance;
+    FrameWorkerTicks[worker] = Timer::GetTicks() - startTicks;
+}
+
+float MovieAdvanceScheduler::Advance(float deltaT, unsigned frameCatchUpCount)
+{
+    Lock::Locker lock(&ViewLock);
+    UInt64 startTicks = Timer::GetTicks();
+
+    FrameDeltaT  = deltaT;
+    FrameCatchUp = frameCatchUpCount;
+
+#ifdef SF_ENABLE_THREADS
+    if (ThreadCount > 1)
+    {
+        {
+            Mutex::Locker frameLock(&FrameMutex);
+            PendingWorkers = ThreadCount - 1;
+            // Never 0, which is the workers' initial "seen" value.
+            if (++FrameId == 0)
+                FrameId = 1;
+            FrameStart.NotifyAll();
+        }
+
+        advanceWorker(0, GetCurrentThreadId());
+
+        Mutex::Locker frameLock(&FrameMutex);
+        while (PendingWorkers > 0)
+            FrameDone.Wait(&FrameMutex);
+    }
+    else
+#endif
+    {
+        advanceWorker(0, GetCurrentThreadId());
+    }
+
+    float nextAdvance = NextAdvance[0];
+    for (unsigned i = 0; i < ThreadCount; i++)
+    {
+        nextAdvance = Alg::Min(nextAdvance, NextAdvance[i]);
+        SStats.WorkerTicks[i] += FrameWorkerTicks[i];
+    }
+    for (UPInt i = 0; i < Groups.GetSize(); i++)
+        SStats.ViewTicks += Groups[i].LastTicks;
+    SStats.WallTicks += Timer::GetTicks() - startTicks;
+    SStats.Frames++;
+
+    if (RebalanceInterval && (SStats.Frames % RebalanceInterval) == 0)
+        Rebalance();
+    return nextAdvance;
+}
+
+struct MovieAdvanceScheduler_GroupCostLess
+{
+    const UInt64* pCosts;
+    bool operator()(unsigned a, unsigned b) const { return pCosts[a] > pCosts[b]; }
+};
+
+void MovieAdvanceScheduler::Rebalance()
+{
+    Lock::Locker lock(&ViewLock);
+    if (ThreadCount < 2 || Groups.GetSize() < 2)
+        return;
+
+    MemoryHeap* pheap = Memory::GetHeapByAddress(this);
+    ArrayDH_POD<UInt64>   costs(pheap);
+    ArrayDH_POD<unsigned> order(pheap);
+    ArrayDH_POD<UInt64>   load(pheap);
+    costs.Resize(Groups.GetSize());
+    order.Resize(Groups.GetSize());
+    load.Resize(ThreadCount);
+
+    for (UPInt i = 0; i < Groups.GetSize(); i++)
+    {
+        // Unmeasured groups still cost something, so they get spread too.
+        costs[i] = Groups[i].ViewCount ? Alg::Max<UInt64>(Groups[i].LastTicks, 1) : 0;
+        order[i] = (unsigned)i;
+    }
+    for (unsigned i = 0; i < ThreadCount; i++)
+        load[i] = 0;
+
+    MovieAdvanceScheduler_GroupCostLess less = { &costs[0] };
+    Alg::QuickSortSliced(order, 0, order.GetSize(), less);
+
+    // Longest processing time first.
+    for (UPInt i = 0; i < order.GetSize(); i++)
+    {
+        unsigned best = 0;
+        for (unsigned w = 1; w < ThreadCount; w++)
+        {
+            if (load[w] < load[best])
+                best = w;
+        }
+        Groups[order[i]].Worker = best;
+        load[best] += costs[order[i]];
+    }
+    SStats.Rebalances++;
+}
+
+void MovieAdvanceScheduler::GetStats(Stats* pstats) const
+{
+    Lock::Locker lock(&ViewLock);
+    pstats->Frames      = SStats.Frames;
+    pstats->WallTicks   = SStats.WallTicks;
+    pstats->ViewTicks   = SStats.ViewTicks;
+    pstats->Rebalances  = SStats.Rebalances;
+    pstats->WorkerTicks = SStats.WorkerTicks;
+}
+
+void MovieAdvanceScheduler::ResetStats()
+{
+    Lock::Locker lock(&ViewLock);
+    SStats.Frames     = 0;
+    SStats.WallTicks  = 0;
+    SStats.ViewTicks  = 0;
+    SStats.Rebalances = 0;
+    SStats.WorkerTicks.Resize(ThreadCount);
+    for (unsigned i = 0; i < ThreadCount; i++)
+        SStats.WorkerTicks[i] = 0;
+}
+
+}} // namespace Scaleform::GFx
@@ -0,0 +1,153 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   GFx_MovieAdvanceScheduler.h
+Content     :   Parallel Advance of independent movie views
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_GFX_MovieAdvanceScheduler_H
+#define INC_SF_GFX_MovieAdvanceScheduler_H
+
+#include "GFx/GFx_Player.h"
+#include "Kernel/SF_Threads.h"
+
+namespace Scaleform { namespace GFx {
+
+// ***** MovieAdvanceScheduler
+
+// Applications with many small movie views (HUD widgets, world-space
+// panels) usually advance them one after another on the main thread.
+// Views that don't share any state can be advanced at the same time:
+// MovieAdvanceScheduler spreads them over a fixed set of worker threads
+// and waits for all of them, so Advance behaves like the serial loop
+// from the caller's point of view.
+//
+// Views are placed in groups. A group is always advanced on one thread,
+// in the order its views were added; different groups may run in
+// parallel. Views created from the same MemoryContext share a heap and
+// garbage collector and must be in the same group, as must views that
+// talk to each other (e.g. through shared ExternalInterface handlers).
+// CreateView creates each view with its own MemoryContext, so views
+// don't contend on one heap and can be placed in separate groups.
+//
+// A group stays on the same worker between calls to Rebalance, and each
+// view is captured by the thread that advanced it; the scheduler moves
+// the view's capture thread (Movie::SetCaptureThread) whenever a group
+// changes worker. Handlers invoked from Advance (FSCommand,
+// ExternalInterface, user event handlers) run on worker threads.
+//
+// Without SF_ENABLE_THREADS, or with a thread count of 1, all views are
+// advanced on the calling thread.
+
+class MovieAdvanceScheduler : public RefCountBase<MovieAdvanceScheduler, Stat_Default_Mem>
+{
+public:
+    enum { Group_Auto = -1 };
+
+    struct Stats
+    {
+        unsigned    Frames;
+        UInt64      WallTicks;      // Total time spent in Advance, in microseconds.
+        UInt64      ViewTicks;      // Sum of time spent in individual views.
+        unsigned    Rebalances;
+        // Busy time per worker over all frames; index 0 is the calling thread.
+        ArrayPOD<UInt64>    WorkerTicks;
+    };
+
+    // threadCount includes the calling thread; 0 uses the CPU count.
+    MovieAdvanceScheduler(unsigned threadCount = 0);
+    virtual ~MovieAdvanceScheduler();
+
+    // Creates a view with its own MemoryContext (and thus its own heap and
+    // garbage collector) and adds it to a new group. Returns the AddRef-ed
+    // movie or null.
+    Movie*          CreateView(MovieDef* pdef, const char* heapName, const MemoryParams& memParams,
+                               bool initFirstFrame = true, Render::ThreadCommandQueue* queue = 0);
+
+    // Adds a view to the given group, or to a new one for Group_Auto.
+    // Returns the group index.
+    int             AddView(Movie* pmovie, int group = Group_Auto);
+    // Removes the view, handing its capture thread back to the caller.
+    void            RemoveView(Movie* pmovie);
+    unsigned        GetViewCount() const;
+
+    // Advances all views by deltaT (see Movie::Advance) and captures them.
+    // Returns the smallest time until the next Advance of any view.
+    // Must be called from one thread at a time; views must not be used
+    // from other threads until it returns.
+    float           Advance(float deltaT, unsigned frameCatchUpCount = 2);
+
+    // Reassigns groups to workers based on their cost in the last frame,
+    // largest first to the least loaded worker. Called automatically every
+    // RebalanceInterval frames (0 disables automatic rebalancing).
+    void            Rebalance();
+    void            SetRebalanceInterval(unsigned frames) { RebalanceInterval = frames; }
+
+    unsigned        GetThreadCount() const { return ThreadCount; }
+
+    void            GetStats(Stats* pstats) const;
+    void            ResetStats();
+
+private:
+    // Plain data, so Views can be a POD array; the movie reference is
+    // managed by AddView, RemoveView and the destructor.
+    struct ViewEntry
+    {
+        Movie*      pMovie;         // AddRef-ed.
+        int         Group;
+        // Worker whose thread is the movie's capture thread, -1 if none.
+        int         CaptureWorker;
+    };
+
+    struct GroupEntry
+    {
+        unsigned    Worker;
+        unsigned    ViewCount;
+        UInt64      LastTicks;
+    };
+
+    class WorkerThread;
+    friend class WorkerThread;
+
+    void            advanceWorker(unsigned worker, ThreadId threadId);
+    unsigned        leastLoadedWorker() const;
+
+    unsigned                ThreadCount;
+    unsigned                RebalanceInterval;
+
+    mutable Lock            ViewLock;
+    ArrayLH_POD<ViewEntry>  Views;
+    ArrayLH_POD<GroupEntry> Groups;
+
+    // Per-frame parameters, written by Advance before the workers start.
+    float                   FrameDeltaT;
+    unsigned                FrameCatchUp;
+    // Indexed by worker.
+    ArrayLH_POD<float>      NextAdvance;
+    ArrayLH_POD<UInt64>     FrameWorkerTicks;
+
+    Stats                   SStats;
+
+#ifdef SF_ENABLE_THREADS
+    ArrayLH<Ptr<WorkerThread> > Workers;
+    Mutex                   FrameMutex;
+    WaitCondition           FrameStart;
+    WaitCondition           FrameDone;
+    unsigned                FrameId;
+    unsigned                PendingWorkers;
+    bool                    Exiting;
+#endif
+};
+
+}} // namespace Scaleform::GFx
+
+#endif // INC_SF_GFX_MovieAdvanceScheduler_H
@@ -51,6 +51,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Kernel/SF_HeapNew.h"
 
 #include "GFx/GFx_Input.h"
+#include "GFx/GFx_InputCoalescer.h"
 
 
 #include "GFx/GFx_ASMovieRootBase.h"
@@ -625,6 +626,21 @@ public:
             return NULL;
         return &mMouseState[mouseIndex];
     }
+    // Move event coalescing policy and stats. These only configure
+    // MoveCoalescer: HandleEvent and ProcessInput are defined outside this
+    // source tree and don't route moves through it yet. Until they call
+    // AddMouseMove/AddTouchMove, the per-pointer Flush functions and
+    // Flush(InputEventsQueue), moves reach InputEventsQueue directly and the
+    // policy has no effect.
+    void                SetInputCoalescePolicy(InputCoalescer::PolicyType policy,
+                                               float minInterval = 1.0f / 60.0f)
+    {
+        MoveCoalescer.SetPolicy(policy, minInterval);
+    }
+    InputCoalescer::PolicyType GetInputCoalescePolicy() const { return MoveCoalescer.GetPolicy(); }
+    const InputCoalescer::Stats& GetInputCoalesceStats() const { return MoveCoalescer.GetStats(); }
+    void                ResetInputCoalesceStats() { MoveCoalescer.ResetStats(); }
+
     void                SetMouseCursorCount(unsigned n)
     {
         MouseCursorCount = (n <= GFX_MAX_MICE_SUPPORTED) ? n : GFX_MAX_MICE_SUPPORTED;
@@ -1343,6 +1359,7 @@ public: // data
     unsigned                    ForceFrameCatchUp;
 
     GFx::InputEventsQueue			InputEventsQueue;
+    GFx::InputCoalescer             MoveCoalescer;
 
 	/*
 #ifdef GFX_GESTURE_RECOGNIZE
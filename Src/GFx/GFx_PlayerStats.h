@@ -105,7 +105,12 @@ enum StatMovieView
     StatMV_Counters,
       StatMV_Invoke_Cnt,
       StatMV_MCAdvance_Cnt,
-      StatMV_Tessellate_Cnt
+      StatMV_Tessellate_Cnt,
+
+    // Later additions go last so that existing ids, which are saved in
+    // AMP captures, keep their values; their StatDesc places them in the
+    // tree. StatMV_VM_Nursery_Mem is declared in AS3_Nursery.cpp.
+    StatMV_VM_Nursery_Mem
 };
 
 
@@ -26,6 +26,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Kernel/SF_Threads.h"
 
 #include "GFx/GFx_String.h"
+#include "GFx/GFx_ResourceCache.h"
 
 namespace Scaleform { namespace GFx {
 
@@ -38,6 +39,7 @@ class ResourceReport;
 
 class ResourceLib;
 class ResourceWeakLib;
+class ResourceRetainCache;
 
 
 
@@ -655,6 +657,7 @@ public:
         ~ResourceSlot();
         
         const ResourceKey& GetKey() const { return Key; }
+        ResourceWeakLib*   GetLib() const { return pLib; }
 
         // *** Interface for Waiter
         // If we are not responsible, wait to receive resource.
@@ -749,11 +752,7 @@ public:
         // *** Interface for resolver
 
         // If we are responsible call one of these two:
-        inline void    ResolveResource(Resource* pres)
-        {
-            SF_ASSERT(State == RS_NeedsResolve);
-            pSlot->Resolve(pres);
-        }
+        inline void    ResolveResource(Resource* pres);
 
         inline void    CancelResolve(const char* perrorMessage)
         {
@@ -777,6 +776,13 @@ public:
     // Obtain heap that should be used for image allocations with this resource library.
     inline MemoryHeap*      GetImageHeap() const;
 
+    // Optional strong LRU layer that keeps released resources alive up to a
+    // memory budget; see GFx_ResourceCache.h.
+    void                    SetRetainCache(ResourceRetainCache* pcache) { pRetainCache = pcache; }
+    ResourceRetainCache*    GetRetainCache() const                      { return pRetainCache; }
+
+private:
+    Ptr<ResourceRetainCache> pRetainCache;
 };
 
 
@@ -897,12 +903,37 @@ public:
 // ResourceLib inlines.
 inline Resource* ResourceLib::GetResource(const ResourceKey &k)
 {
-    return pWeakLib->GetResource(k);
+    Resource* pres = pWeakLib->GetResource(k);
+    if (pRetainCache)
+    {
+        if (pres)
+            pRetainCache->OnAccess(pres);
+        else
+            pRetainCache->OnMiss();
+    }
+    return pres;
 }
 inline ResourceLib::ResolveState ResourceLib::BindResourceKey(
                 ResourceLib::BindHandle *phandle, const ResourceKey &k)
 {
-    return pWeakLib->BindResourceKey(phandle, k);
+    ResolveState state = pWeakLib->BindResourceKey(phandle, k);
+    if (pRetainCache)
+    {
+        if (state == RS_Available)
+            pRetainCache->OnAccess(phandle->GetResource());
+        else if (state == RS_NeedsResolve)
+            pRetainCache->OnMiss();
+    }
+    return state;
+}
+inline void ResourceLib::BindHandle::ResolveResource(Resource* pres)
+{
+    SF_ASSERT(State == RS_NeedsResolve);
+    pSlot->Resolve(pres);
+
+    ResourceLib* pstrongLib = pSlot->GetLib()->GetResourceLib();
+    if (pres && pstrongLib && pstrongLib->GetRetainCache())
+        pstrongLib->GetRetainCache()->OnResolved(pres);
 }
 inline void ResourceLib::GetResourceArray(Array<Ptr<Resource> > *presources)
 {
@@ -0,0 +1,324 @@
+/**************************************************************************
+
+Filename    :   GFx_ResourceCache.cpp
+Content     :   Memory-budgeted retention of released resources and
+                movie prefetching
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "GFx/GFx_ResourceCache.h"
+#include "GFx/GFx_Resource.h"
+#include "GFx/GFx_ImageResource.h"
+#include "GFx/GFx_PlayerImpl.h"
+#include "GFx/GFx_PlayerTasks.h"
+#include "GFx/GFx_TaskManager.h"
+
+namespace Scaleform { namespace GFx {
+
+// Size charged for resources we can't measure (fonts, sounds, etc).
+static const UPInt ResourceCache_NominalSize = 4 * 1024;
+
+// ***** ResourceRetainCache
+
+ResourceRetainCache::ResourceRetainCache(UPInt budgetBytes)
+    : Budget(budgetBytes)
+    , TotalBytes(0)
+{
+    memset(&CStats, 0, sizeof(CStats));
+}
+
+ResourceRetainCache::~ResourceRetainCache()
+{
+    Clear();
+}
+
+void ResourceRetainCache::SetBudget(UPInt budgetBytes)
+{
+    Array<Resource*> released;
+    {
+        Lock::Locker lock(&CacheLock);
+        Budget = budgetBytes;
+        evict(Budget, &released);
+    }
+    releaseAll(released);
+}
+
+UPInt ResourceRetainCache::GetBudget() const
+{
+    Lock::Locker lock(&CacheLock);
+    return Budget;
+}
+
+bool ResourceRetainCache::isRetained(const Entry* pentry) const
+{
+    // Ours is the only reference.
+    return pentry->pResource->GetRefCount() == 1;
+}
+
+void ResourceRetainCache::OnAccess(Resource* pres)
+{
+    if (pres)
+        touch(pres, true);
+}
+
+void ResourceRetainCache::OnResolved(Resource* pres)
+{
+    if (pres)
+        touch(pres, false);
+}
+
+void ResourceRetainCache::touch(Resource* pres, bool lookup)
+{
+    Array<Resource*> released;
+    {
+        Lock::Locker lock(&CacheLock);
+
+        Entry** ppentry = Entries.Get(pres);
+        if (ppentry)
+        {
+            if (lookup)
+            {
+                CStats.Hits++;
+                // The caller's reference is already counted, so "only the
+                // cache and the caller" means it was kept alive by us.
+                if (pres->GetRefCount() == 2)
+                    CStats.RetainedHits++;
+            }
+            Entry* pentry = *ppentry;
+            LRU.Remove(pentry);
+            LRU.PushBack(pentry);
+            // Movie data keeps growing while it is being loaded.
+            updateSize(pentry);
+            evict(Budget, &released);
+        }
+        else
+        {
+            if (lookup)
+                CStats.Hits++;
+
+            Entry* pentry     = SF_NEW Entry;
+            pentry->pResource = pres;
+            pentry->Size      = GetResourceSize(pres);
+            pres->AddRef();
+            LRU.PushBack(pentry);
+            Entries.Add(pres, pentry);
+            TotalBytes += pentry->Size;
+
+            evict(Budget, &released);
+        }
+    }
+    releaseAll(released);
+}
+
+void ResourceRetainCache::OnMiss()
+{
+    Lock::Locker lock(&CacheLock);
+    CStats.Misses++;
+}
+
+void ResourceRetainCache::Trim()
+{
+    Array<Resource*> released;
+    {
+        Lock::Locker lock(&CacheLock);
+        evict(0, &released);
+    }
+    releaseAll(released);
+}
+
+void ResourceRetainCache::Clear()
+{
+    Array<Resource*> released;
+    {
+        Lock::Locker lock(&CacheLock);
+        while (!LRU.IsEmpty())
+        {
+            Entry* pentry = LRU.GetFirst();
+            LRU.Remove(pentry);
+            released.PushBack(pentry->pResource);
+            delete pentry;
+        }
+        Entries.Clear();
+        TotalBytes = 0;
+    }
+    releaseAll(released);
+}
+
+void ResourceRetainCache::updateSize(Entry* pentry)
+{
+    UPInt size   = GetResourceSize(pentry->pResource);
+    TotalBytes  += size - pentry->Size;
+    pentry->Size = size;
+}
+
+void ResourceRetainCache::evict(UPInt budget, Array<Resource*>* preleased)
+{
+    if (TotalBytes <= budget)
+        return;
+
+    // Walk from the least recently used end, evicting retained entries
+    // until the retained bytes left fit. Entries still in use elsewhere
+    // are moved to the most recently used end, since they are alive
+    // anyway, so the next walk reaches retained entries first. Each entry
+    // is visited at most once, and re-measured when it is.
+    UPInt  inUseBytes = 0;
+    UPInt  count      = Entries.GetSize();
+    Entry* p          = LRU.GetFirst();
+    while (count-- > 0 && TotalBytes - inUseBytes > budget)
+    {
+        Entry* pnext = LRU.GetNext(p);
+        updateSize(p);
+        if (isRetained(p))
+        {
+            TotalBytes -= p->Size;
+            LRU.Remove(p);
+            Entries.Remove(p->pResource);
+            preleased->PushBack(p->pResource);
+            delete p;
+            CStats.Evictions++;
+        }
+        else
+        {
+            inUseBytes += p->Size;
+            LRU.Remove(p);
+            LRU.PushBack(p);
+        }
+        p = pnext;
+    }
+}
+
+void ResourceRetainCache::releaseAll(const Array<Resource*>& released)
+{
+    for (UPInt i = 0; i < released.GetSize(); i++)
+        released[i]->Release();
+}
+
+ResourceRetainCache::Stats ResourceRetainCache::GetStats() const
+{
+    Lock::Locker lock(&CacheLock);
+    Stats s         = CStats;
+    s.Entries       = (unsigned)Entries.GetSize();
+    s.BudgetBytes   = Budget;
+    s.RetainedBytes = 0;
+    for (const Entry* p = LRU.GetFirst(); !LRU.IsNull(p); p = LRU.GetNext(p))
+    {
+        if (isRetained(p))
+            s.RetainedBytes += p->Size;
+    }
+    return s;
+}
+
+void ResourceRetainCache::ResetStats()
+{
+    Lock::Locker lock(&CacheLock);
+    CStats.Hits = CStats.RetainedHits = CStats.Misses = CStats.Evictions = 0;
+}
+
+UPInt ResourceRetainCache::GetResourceSize(Resource* pres) const
+{
+    // Movie data and other resources with their own heap.
+    ResourceReport* preport = pres->GetResourceReport();
+    MemoryHeap*     pheap   = preport ? preport->GetResourceHeap() : 0;
+    if (pheap)
+        return pheap->GetTotalFootprint();
+
+    if (pres->GetResourceType() == Resource::RT_Image)
+    {
+        const Render::ImageBase* pimage = static_cast<ImageResource*>(pres)->GetImage();
+        if (pimage)
+        {
+            ImageSize size = pimage->GetSize();
+            unsigned  bpp  = Render::ImageData::GetFormatBitsPerPixel(pimage->GetFormatNoConv());
+            return Alg::Max<UPInt>(UPInt(size.Width) * size.Height * bpp / 8,
+                                   ResourceCache_NominalSize);
+        }
+    }
+    return ResourceCache_NominalSize;
+}
+
+
+// ***** MoviePrefetcher
+
+MoviePrefetcher::MoviePrefetcher()
+{
+}
+
+MoviePrefetcher::~MoviePrefetcher()
+{
+    Cancel();
+}
+
+bool MoviePrefetcher::Prefetch(MovieImpl* pmovie, const String& url)
+{
+    if (!pmovie || url.IsEmpty() || IsPending(url))
+        return false;
+
+    Ptr<TaskManager> ptaskManager = pmovie->GetStateBagImpl()->GetTaskManager();
+    if (!ptaskManager)
+        return false;
+
+    // Match the stripped flag of the movie requesting the prefetch, the
+    // way loadMovie does for its children.
+    bool stripped = pmovie->GetMovieDefImpl() &&
+                    (pmovie->GetMovieDefImpl()->GetSWFFlags() & MovieInfo::SWF_Stripped) != 0;
+
+    PrefetchEntry* pentry = SF_NEW PrefetchEntry;
+    pentry->Url   = url;
+    pentry->pTask = *SF_NEW MoviePreloadTask(pmovie, url, stripped, true);
+    if (!ptaskManager->AddTask(pentry->pTask))
+    {
+        delete pentry;
+        return false;
+    }
+
+    pTaskManager = ptaskManager;
+    Tasks.PushBack(pentry);
+    return true;
+}
+
+unsigned MoviePrefetcher::Update()
+{
+    // Once the preload has bound the movie, its data lives in the resource
+    // library (and in ResourceRetainCache, if one is installed).
+    for (UPInt i = Tasks.GetSize(); i > 0; i--)
+    {
+        if (Tasks[i - 1]->pTask->IsDone())
+        {
+            delete Tasks[i - 1];
+            Tasks.RemoveAt(i - 1);
+        }
+    }
+    return (unsigned)Tasks.GetSize();
+}
+
+void MoviePrefetcher::Cancel()
+{
+    for (UPInt i = 0; i < Tasks.GetSize(); i++)
+    {
+        if (pTaskManager)
+            pTaskManager->AbandonTask(Tasks[i]->pTask);
+        delete Tasks[i];
+    }
+    Tasks.Clear();
+    pTaskManager = 0;
+}
+
+bool MoviePrefetcher::IsPending(const String& url) const
+{
+    for (UPInt i = 0; i < Tasks.GetSize(); i++)
+    {
+        if (Tasks[i]->Url == url)
+            return true;
+    }
+    return false;
+}
+
+}} // namespace Scaleform::GFx
@@ -0,0 +1,165 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   GFx_ResourceCache.h
+Content     :   Memory-budgeted retention of released resources and
+                movie prefetching
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_GFX_ResourceCache_H
+#define INC_SF_GFX_ResourceCache_H
+
+#include "Kernel/SF_RefCount.h"
+#include "Kernel/SF_Hash.h"
+#include "Kernel/SF_List.h"
+#include "Kernel/SF_Threads.h"
+#include "Kernel/SF_String.h"
+
+namespace Scaleform { namespace GFx {
+
+class Resource;
+class MovieImpl;
+class MoviePreloadTask;
+class TaskManager;
+
+// ***** ResourceRetainCache
+
+// ResourceWeakLib only keeps resources alive while somebody references
+// them, so a movie that is unloaded and loaded again (e.g. navigating back
+// to a screen) is read and parsed from scratch. ResourceRetainCache is an
+// optional strong layer on top of ResourceLib: it holds a reference to
+// every resource that goes through the library, ordered by last use.
+// Resources referenced only by the cache are "retained"; when their total
+// size exceeds the byte budget the least recently used ones are released.
+// Resources that are still in use elsewhere never count against the budget.
+//
+// Install with ResourceLib::SetRetainCache. The cache is thread safe,
+// since resources are bound from loading threads.
+
+class ResourceRetainCache : public RefCountBase<ResourceRetainCache, Stat_Default_Mem>
+{
+public:
+    struct Stats
+    {
+        unsigned    Hits;           // Lookups that found a loaded resource.
+        unsigned    RetainedHits;   // ... that was only alive thanks to the cache.
+        unsigned    Misses;         // Lookups that required loading.
+        unsigned    Evictions;
+        unsigned    Entries;
+        UPInt       RetainedBytes;
+        UPInt       BudgetBytes;
+    };
+
+    ResourceRetainCache(UPInt budgetBytes);
+    virtual ~ResourceRetainCache();
+
+    // Changing the budget evicts immediately if necessary.
+    void            SetBudget(UPInt budgetBytes);
+    UPInt           GetBudget() const;
+
+    // Called by ResourceLib. OnAccess (successful lookup) and OnResolved
+    // (newly loaded resource) AddRef the resource on first sight and move
+    // it to the most-recently-used end.
+    void            OnAccess(Resource* pres);
+    void            OnResolved(Resource* pres);
+    void            OnMiss();
+
+    // Releases every retained resource not in use elsewhere.
+    void            Trim();
+    // Releases everything; resources in use elsewhere stay alive through
+    // their other references.
+    void            Clear();
+
+    Stats           GetStats() const;
+    void            ResetStats();
+
+    // Estimated memory held by a resource: the resource heap footprint for
+    // movie data, pixel storage for images, and a nominal size otherwise.
+    // Override to customize.
+    virtual UPInt   GetResourceSize(Resource* pres) const;
+
+private:
+    struct Entry : public ListNode<Entry>, public NewOverrideBase<Stat_Default_Mem>
+    {
+        Resource*   pResource;      // AddRefed.
+        UPInt       Size;
+    };
+
+    struct ResourcePtrHashFunc
+    {
+        UPInt operator()(const Resource* p) const { return (((UPInt)p) >> 6) ^ ((UPInt)p); }
+    };
+    typedef Hash<Resource*, Entry*, ResourcePtrHashFunc> EntryHash;
+
+    void            touch(Resource* pres, bool lookup);
+    // Collects entries to release under the lock; the caller releases the
+    // resources after unlocking, since Release takes the library lock.
+    void            evict(UPInt budget, Array<Resource*>* preleased);
+    static void     releaseAll(const Array<Resource*>& released);
+    bool            isRetained(const Entry* pentry) const;
+    // Re-measures an entry and updates TotalBytes.
+    void            updateSize(Entry* pentry);
+
+    mutable Lock    CacheLock;
+    UPInt           Budget;
+    // Sum of Entry::Size over all entries, retained or not. While it is
+    // within the budget, the retained bytes are too and nothing needs to
+    // be walked.
+    UPInt           TotalBytes;
+    // Least recently used first.
+    List<Entry>     LRU;
+    EntryHash       Entries;
+    Stats           CStats;
+};
+
+
+// ***** MoviePrefetcher
+
+// Starts loading movies that are likely to be needed soon (the predicted
+// next screens) on the TaskManager, using the same MoviePreloadTask as
+// loadMovie. Together with ResourceRetainCache the loaded data stays in
+// the resource library, so the later real load is a library hit.
+
+class MoviePrefetcher : public RefCountBase<MoviePrefetcher, Stat_Default_Mem>
+{
+public:
+    MoviePrefetcher();
+    ~MoviePrefetcher();
+
+    // Returns false if no TaskManager is installed on the movie, or the
+    // url is already being prefetched.
+    bool            Prefetch(MovieImpl* pmovie, const String& url);
+
+    // Drops finished tasks; returns the number still running. Call
+    // periodically, e.g. once per Advance.
+    unsigned        Update();
+
+    // Abandons tasks that haven't started yet.
+    void            Cancel();
+
+    bool            IsPending(const String& url) const;
+
+private:
+    struct PrefetchEntry : public NewOverrideBase<Stat_Default_Mem>
+    {
+        String                  Url;
+        Ptr<MoviePreloadTask>   pTask;
+    };
+
+    Ptr<TaskManager>        pTaskManager;
+    // Owned; stored by pointer so the array only moves POD data.
+    ArrayPOD<PrefetchEntry*> Tasks;
+};
+
+}} // namespace Scaleform::GFx
+
+#endif // INC_SF_GFX_ResourceCache_H
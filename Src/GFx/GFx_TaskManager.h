@@ -62,6 +62,7 @@ public:
     {
         Id_Unknown          = Type_Computation | 1,
         Id_MovieDecoding    = Type_Computation | 2,
+        Id_AS3MethodPrep    = Type_Computation | 3,
         // Right now we make use of IO related tasks only.
         Id_MovieDataLoad    = Type_IO | 1,
         Id_MovieImageLoad   = Type_IO | 2,
@@ -0,0 +1,211 @@
+/**************************************************************************
+
+Filename    :   GFx_TimelineKeyframes.cpp
+Content     :   Cached keyframe snapshots for timeline seeks
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "GFx/GFx_TimelineKeyframes.h"
+#include "GFx/GFx_SpriteDef.h"
+#include "Kernel/SF_HeapNew.h"
+
+namespace Scaleform { namespace GFx {
+
+static unsigned TimelineKeyframes_DefaultInterval = 32;
+
+// ***** TimelineDef keyframe support
+
+TimelineDef::~TimelineDef()
+{
+    delete pKeyframes.Load_Acquire();
+}
+
+TimelineKeyframes* TimelineDef::GetKeyframes()
+{
+    TimelineKeyframes* pkeyframes = pKeyframes;
+    if (pkeyframes)
+        return pkeyframes;
+
+    unsigned interval = TimelineKeyframes::GetDefaultInterval();
+    if (interval == 0)
+        return NULL;
+
+    // Several instances may seek at once; one of them wins.
+    pkeyframes = SF_HEAP_AUTO_NEW(this) TimelineKeyframes(interval);
+    if (!pKeyframes.CompareAndSet_Sync(0, pkeyframes))
+    {
+        delete pkeyframes;
+        pkeyframes = pKeyframes;
+    }
+    return pkeyframes;
+}
+
+// ***** TimelineKeyframes
+
+TimelineKeyframes::TimelineKeyframes(unsigned interval)
+    : Interval(Alg::Max(interval, 1u))
+{
+    memset(&KStats, 0, sizeof(KStats));
+}
+
+TimelineKeyframes::~TimelineKeyframes()
+{
+}
+
+void TimelineKeyframes::SetDefaultInterval(unsigned interval)
+{
+    TimelineKeyframes_DefaultInterval = interval;
+}
+
+unsigned TimelineKeyframes::GetDefaultInterval()
+{
+    return TimelineKeyframes_DefaultInterval;
+}
+
+void TimelineKeyframes::MakeSnapshot(TimelineSnapshot* psnapshot, TimelineDef* pdef, unsigned targetFrame)
+{
+    SF_ASSERT(psnapshot->Direction == TimelineSnapshot::Direction_Forward);
+    SF_ASSERT(psnapshot->SnapshotList.IsEmpty());
+
+    Lock::Locker lock(&KeyframeLock);
+    KStats.Seeks++;
+
+    // Keyframe i holds the state after frame (i + 1) * Interval - 1, and
+    // keyframes are always recorded in order, so the nearest one is found
+    // by division.
+    UPInt    kfIndex    = Alg::Min<UPInt>((targetFrame + 1) / Interval, Keyframes.GetSize());
+    unsigned startFrame = 0;
+    if (kfIndex > 0)
+    {
+        const Keyframe& kf = Keyframes[kfIndex - 1];
+        restore(psnapshot, kf);
+        startFrame = kf.Frame + 1;
+        KStats.KeyframeHits++;
+        KStats.FramesSkipped += startFrame;
+    }
+
+    // Replay the remaining frames one interval at a time, recording the
+    // keyframes we pass.
+    while (startFrame <= targetFrame)
+    {
+        unsigned boundary = (startFrame / Interval + 1) * Interval - 1;
+        unsigned endFrame = Alg::Min(boundary, targetFrame);
+
+        psnapshot->MakeSnapshot(pdef, startFrame, endFrame);
+        KStats.FramesReplayed += endFrame - startFrame + 1;
+
+        if (endFrame == boundary && Keyframes.GetSize() == boundary / Interval)
+            capture(psnapshot, boundary);
+        startFrame = endFrame + 1;
+    }
+}
+
+void TimelineKeyframes::capture(const TimelineSnapshot* psnapshot, unsigned frame)
+{
+    Keyframe kf;
+    kf.Frame        = frame;
+    kf.FirstElement = (UInt32)Elements.GetSize();
+    kf.ElementCount = 0;
+    kf.FirstSorted  = (UInt32)Sorted.GetSize();
+
+    const List<TimelineSnapshot::SnapshotElement>& list = psnapshot->SnapshotList;
+    for (const TimelineSnapshot::SnapshotElement* pse = list.GetFirst();
+         !list.IsNull(pse); pse = list.GetNext(pse))
+    {
+        Element e;
+        e.Depth       = pse->Depth;
+        e.CreateFrame = pse->CreateFrame;
+        e.PlaceType   = pse->PlaceType;
+        e.Flags       = pse->Flags;
+        e.FirstTag    = (UInt32)Tags.GetSize();
+
+        GFxPlaceObjectBase* const slots[10] =
+        {
+            pse->Tags.pMainTag,     pse->Tags.pMatrixTag,    pse->Tags.pCxFormTag,
+            pse->Tags.pFiltersTag,  pse->Tags.pBlendModeTag, pse->Tags.pDepthTag,
+            pse->Tags.pClipDepthTag,pse->Tags.pRatioTag,     pse->Tags.pCharIdTag,
+            pse->Tags.pClassNameTag
+        };
+        // Most entries come from one or two tags, so the distinct list is
+        // short and a linear search is fine.
+        for (unsigned i = 0; i < 10; i++)
+        {
+            e.TagSlots[i] = 0xFF;
+            if (!slots[i])
+                continue;
+            UPInt j = e.FirstTag;
+            while (j < Tags.GetSize() && Tags[j] != slots[i])
+                j++;
+            if (j == Tags.GetSize())
+                Tags.PushBack(slots[i]);
+            e.TagSlots[i] = (UInt8)(j - e.FirstTag);
+        }
+
+        Elements.PushBack(e);
+        kf.ElementCount++;
+    }
+
+    // Depth order as positions in list order.
+    Hash<const void*, UInt32> positions;
+    UInt32 pos = 0;
+    for (const TimelineSnapshot::SnapshotElement* pse = list.GetFirst();
+         !list.IsNull(pse); pse = list.GetNext(pse))
+        positions.Add(pse, pos++);
+
+    const ArrayDH_POD<TimelineSnapshot::SnapshotElement*>& sorted = psnapshot->SnapshotSortedArray;
+    for (UPInt i = 0; i < sorted.GetSize(); i++)
+        Sorted.PushBack(*positions.Get(sorted[i]));
+
+    Keyframes.PushBack(kf);
+    KStats.Keyframes      = (unsigned)Keyframes.GetSize();
+    KStats.StoredElements = Elements.GetSize();
+}
+
+void TimelineKeyframes::restore(TimelineSnapshot* psnapshot, const Keyframe& kf) const
+{
+    ArrayDH_POD<TimelineSnapshot::SnapshotElement*> created(Memory::GetHeapByAddress(this));
+    created.Resize(kf.ElementCount);
+
+    for (UInt32 i = 0; i < kf.ElementCount; i++)
+    {
+        const Element& e = Elements[kf.FirstElement + i];
+        TimelineSnapshot::SnapshotElement* pse = psnapshot->SnapshotHeap.Alloc();
+        pse->Depth       = e.Depth;
+        pse->CreateFrame = e.CreateFrame;
+        pse->PlaceType   = e.PlaceType;
+        pse->Flags       = e.Flags;
+
+        GFxPlaceObjectBase** slots[10] =
+        {
+            &pse->Tags.pMainTag,     &pse->Tags.pMatrixTag,    &pse->Tags.pCxFormTag,
+            &pse->Tags.pFiltersTag,  &pse->Tags.pBlendModeTag, &pse->Tags.pDepthTag,
+            &pse->Tags.pClipDepthTag,&pse->Tags.pRatioTag,     &pse->Tags.pCharIdTag,
+            &pse->Tags.pClassNameTag
+        };
+        for (unsigned j = 0; j < 10; j++)
+            *slots[j] = (e.TagSlots[j] == 0xFF) ? 0 : Tags[e.FirstTag + e.TagSlots[j]];
+
+        psnapshot->SnapshotList.PushBack(pse);
+        created[i] = pse;
+    }
+
+    psnapshot->SnapshotSortedArray.Resize(kf.ElementCount);
+    for (UInt32 i = 0; i < kf.ElementCount; i++)
+        psnapshot->SnapshotSortedArray[i] = created[Sorted[kf.FirstSorted + i]];
+}
+
+TimelineKeyframes::Stats TimelineKeyframes::GetStats() const
+{
+    Lock::Locker lock(&KeyframeLock);
+    return KStats;
+}
+
+}} // namespace Scaleform::GFx
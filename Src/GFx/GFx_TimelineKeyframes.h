@@ -0,0 +1,126 @@
+/**************************************************************************
+
+PublicHeader:   GFx
+Filename    :   GFx_TimelineKeyframes.h
+Content     :   Cached keyframe snapshots for timeline seeks
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_GFX_TimelineKeyframes_H
+#define INC_SF_GFX_TimelineKeyframes_H
+
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Threads.h"
+#include "GFx/GFx_PlayerStats.h"
+
+namespace Scaleform { namespace GFx {
+
+class TimelineDef;
+class TimelineSnapshot;
+class GFxPlaceObjectBase;
+
+// ***** TimelineKeyframes
+
+// A backward gotoAndPlay/gotoAndStop builds a forward TimelineSnapshot by
+// replaying every PlaceObject/RemoveObject tag from frame 0 up to the
+// target frame, so its cost grows with the frame number. TimelineKeyframes
+// keeps the snapshot state at every Interval-th frame, so a seek replays at
+// most Interval frames after restoring the nearest keyframe.
+//
+// Keyframes are recorded as a side effect of seeks, so only the parts of
+// a timeline that are actually seeked into are stored. A keyframe only
+// holds tag pointers and a few bytes per display list entry; tags are
+// owned by the MovieDataDef, which outlives this object.
+//
+// Keyframes are owned by the TimelineDef (see TimelineDef::GetKeyframes)
+// and shared by all instances of it, possibly on different threads.
+//
+// The cache assumes two properties of TimelineSnapshot::MakeSnapshot,
+// which is implemented with Sprite and not checked here:
+//  - It is incremental: MakeSnapshot(def, 0, b) followed by
+//    MakeSnapshot(def, b + 1, c) gives the same snapshot as
+//    MakeSnapshot(def, 0, c), which is what lets a seek continue from a
+//    restored keyframe.
+//  - A forward snapshot depends only on the TimelineDef's tags, not on
+//    pOwnerSprite, so a keyframe recorded through one instance is valid
+//    for every other. The owner is expected to matter only to
+//    ExecuteSnapshot and to backward snapshots, which this class doesn't
+//    build.
+// If either stops holding, disable the cache with SetDefaultInterval(0).
+// BenchmarkRunner::RunSeeks measures seeks with and without it.
+
+class TimelineKeyframes : public NewOverrideBase<StatMD_Other_Mem>
+{
+public:
+    struct Stats
+    {
+        unsigned    Seeks;
+        unsigned    KeyframeHits;       // Seeks that started from a keyframe.
+        UInt64      FramesReplayed;
+        UInt64      FramesSkipped;      // Frames not replayed thanks to keyframes.
+        unsigned    Keyframes;
+        UPInt       StoredElements;
+    };
+
+    TimelineKeyframes(unsigned interval);
+    ~TimelineKeyframes();
+
+    // Interval for keyframe caches created from now on (caches are
+    // created on the first seek of each TimelineDef); 0 disables them.
+    // The default is 32.
+    static void     SetDefaultInterval(unsigned interval);
+    static unsigned GetDefaultInterval();
+
+    unsigned        GetInterval() const { return Interval; }
+
+    // Same result as psnapshot->MakeSnapshot(pdef, 0, targetFrame) for an
+    // empty forward snapshot. targetFrame must be loaded.
+    void            MakeSnapshot(TimelineSnapshot* psnapshot, TimelineDef* pdef, unsigned targetFrame);
+
+    Stats           GetStats() const;
+
+private:
+    // One display list entry of a snapshot.
+    struct Element
+    {
+        int         Depth;
+        unsigned    CreateFrame;
+        // Distinct source tags of the entry are stored in Tags starting
+        // at FirstTag; TagSlots index them (0xFF means no tag).
+        UInt32      FirstTag;
+        UInt8       TagSlots[10];
+        UInt8       PlaceType;
+        UInt8       Flags;
+    };
+
+    struct Keyframe
+    {
+        unsigned    Frame;
+        UInt32      FirstElement;   // In list order.
+        UInt32      ElementCount;
+        UInt32      FirstSorted;    // Depth order, as indices relative to FirstElement.
+    };
+
+    void            capture(const TimelineSnapshot* psnapshot, unsigned frame);
+    void            restore(TimelineSnapshot* psnapshot, const Keyframe& kf) const;
+
+    unsigned                                    Interval;
+    mutable Lock                                KeyframeLock;
+    ArrayLH_POD<Keyframe, StatMD_Other_Mem>     Keyframes;
+    ArrayLH_POD<Element, StatMD_Other_Mem>      Elements;
+    ArrayLH_POD<UInt32, StatMD_Other_Mem>       Sorted;
+    ArrayLH_POD<GFxPlaceObjectBase*, StatMD_Other_Mem> Tags;
+    Stats                                       KStats;
+};
+
+}} // namespace Scaleform::GFx
+
+#endif // INC_SF_GFX_TimelineKeyframes_H
@@ -0,0 +1,477 @@
+/**************************************************************************
+
+Filename    :   HeapPT_SysAllocReservedMMAP.cpp
+Platform    :   Unix, Linux, MacOS
+Content     :   MMAP based System Allocator that carves segments out of
+                large reserved regions backed by huge pages
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "HeapPT_SysAllocReservedMMAP.h"
+#include "../SF_Alg.h"
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(SF_OS_LINUX)
+#include <sys/syscall.h>
+#if defined(SYS_mbind)
+#define SF_SYSALLOC_RESERVED_MBIND
+#endif
+#endif
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+namespace Scaleform {
+
+namespace {
+
+// Region bitmaps hold one bit per Granularity unit.
+enum { SysAllocReserved_WordBits = sizeof(UPInt) * 8 };
+
+inline bool SysAllocReserved_Test(const UPInt* bits, UPInt i)
+{
+    return (bits[i / SysAllocReserved_WordBits] >> (i % SysAllocReserved_WordBits)) & 1;
+}
+
+inline void SysAllocReserved_Set(UPInt* bits, UPInt i)
+{
+    bits[i / SysAllocReserved_WordBits] |= UPInt(1) << (i % SysAllocReserved_WordBits);
+}
+
+inline void SysAllocReserved_Clear(UPInt* bits, UPInt i)
+{
+    bits[i / SysAllocReserved_WordBits] &= ~(UPInt(1) << (i % SysAllocReserved_WordBits));
+}
+
+// Returns the first set bit in [start, end), or end if there is none.
+// Clear words are skipped whole.
+UPInt SysAllocReserved_FindSet(const UPInt* bits, UPInt start, UPInt end)
+{
+    while (start < end)
+    {
+        UPInt word = bits[start / SysAllocReserved_WordBits] >> (start % SysAllocReserved_WordBits);
+        if (word == 0)
+        {
+            start = (start / SysAllocReserved_WordBits + 1) * SysAllocReserved_WordBits;
+            continue;
+        }
+        while ((word & 1) == 0)
+        {
+            word >>= 1;
+            start++;
+        }
+        return Alg::Min(start, end);
+    }
+    return end;
+}
+
+inline UPInt SysAllocReserved_AlignUp(UPInt v, UPInt align)
+{
+    return (v + align - 1) / align * align;
+}
+
+void* SysAllocReserved_Map(UPInt size, int flags)
+{
+    void* p = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return (p == MAP_FAILED) ? 0 : p;
+}
+
+// Prefers the node for pages first touched in the range.
+void SysAllocReserved_BindNode(void* p, UPInt size, int node)
+{
+#if defined(SF_SYSALLOC_RESERVED_MBIND)
+    enum { MaxNodes = 1024, Mpol_Preferred = 1 };
+    if (node < 0 || node >= MaxNodes)
+        return;
+    unsigned long mask[MaxNodes / (sizeof(unsigned long) * 8)];
+    memset(mask, 0, sizeof(mask));
+    mask[node / (sizeof(unsigned long) * 8)] = 1UL << (node % (sizeof(unsigned long) * 8));
+    // The kernel reads one bit less than maxnode.
+    syscall(SYS_mbind, p, (unsigned long)size, Mpol_Preferred, mask, (unsigned long)MaxNodes + 1, 0U);
+#else
+    SF_UNUSED3(p, size, node);
+#endif
+}
+
+} // namespace
+
+
+//------------------------------------------------------------------------
+// Region header and bitmaps live in their own small mapping, so the
+// reserved space is only touched by the heap. Used marks allocated units;
+// Committed marks units that may be backed by memory (allocated, or freed
+// but not released yet).
+struct SysAllocReservedMMAP::Region
+{
+    Region*     pNext;
+    UByte*      pBase;
+    UPInt       Size;
+    UPInt       Units;
+    UPInt       UsedUnits;
+    UPInt       MetaSize;
+    UPInt*      pUsed;
+    UPInt*      pCommitted;
+    bool        HugeTLB;
+    bool        HugePages;
+};
+
+
+//------------------------------------------------------------------------
+SysAllocReservedMMAP::SysAllocReservedMMAP(const Params& params) :
+    pRegions(0),
+    AllocParams(params),
+    Reserved(0),
+    Committed(0),
+    Used(0),
+    HugePageBytes(0),
+    Released(0),
+    RegionCount(0),
+    ReleaseCalls(0)
+{
+    PageSize    = (UPInt)::sysconf(_SC_PAGESIZE);
+    Granularity = MinGranularity;
+    while (Granularity < params.Granularity || Granularity < PageSize)
+        Granularity <<= 1;
+    AllocParams.ReserveSize = SysAllocReserved_AlignUp(Alg::Max(params.ReserveSize, Granularity),
+                                                       Alg::Max(Granularity, (UPInt)HugePageSize));
+}
+
+SysAllocReservedMMAP::~SysAllocReservedMMAP()
+{
+    // Segments still allocated at this point go with their regions.
+    while (pRegions)
+    {
+        Region* pregion = pRegions;
+        pRegions = pregion->pNext;
+        ::munmap(pregion->pBase, pregion->Size);
+        ::munmap(pregion, pregion->MetaSize);
+    }
+}
+
+//------------------------------------------------------------------------
+void SysAllocReservedMMAP::GetInfo(Info* i) const
+{
+    i->MinAlign             = Granularity;
+    i->MaxAlign             = Alg::Max(Granularity, (UPInt)HugePageSize);
+    i->Granularity          = Granularity;
+    i->SysDirectThreshold   = 0;
+    i->MaxHeapGranularity   = 0;
+    i->HasRealloc           = true;
+}
+
+//------------------------------------------------------------------------
+SysAllocReservedMMAP::Region* SysAllocReservedMMAP::reserveRegion(UPInt minSize)
+{
+    UPInt  hugeSize = Alg::Max(Granularity, (UPInt)HugePageSize);
+    UPInt  size     = Alg::Max(AllocParams.ReserveSize, SysAllocReserved_AlignUp(minSize, hugeSize));
+    UByte* pbase    = 0;
+    bool   hugeTLB  = false;
+
+#if defined(MAP_HUGETLB)
+    // Explicit huge pages are taken from the pool when the region is mapped,
+    // so a short pool fails here rather than on first touch.
+    if (AllocParams.HugePages == HugePage_Explicit)
+    {
+        pbase   = (UByte*)SysAllocReserved_Map(size, MAP_HUGETLB);
+        hugeTLB = (pbase != 0);
+    }
+#endif
+
+    if (!pbase)
+    {
+        // Over-reserve by a huge page and trim, so the region starts
+        // and ends on huge page boundaries.
+        UByte* p = (UByte*)SysAllocReserved_Map(size + hugeSize, MAP_NORESERVE);
+        if (!p)
+            return 0;
+        pbase = (UByte*)SysAllocReserved_AlignUp((UPInt)p, hugeSize);
+        if (pbase > p)
+            ::munmap(p, pbase - p);
+        if (p + hugeSize > pbase)
+            ::munmap(pbase + size, (p + hugeSize) - pbase);
+    }
+
+    bool hugePages = hugeTLB;
+#if defined(MADV_HUGEPAGE)
+    if (!hugeTLB && AllocParams.HugePages != HugePage_None)
+        hugePages = (::madvise(pbase, size, MADV_HUGEPAGE) == 0);
+#endif
+
+    if (AllocParams.NumaNode >= 0)
+        SysAllocReserved_BindNode(pbase, size, AllocParams.NumaNode);
+
+    UPInt units    = size / Granularity;
+    UPInt words    = (units + SysAllocReserved_WordBits - 1) / SysAllocReserved_WordBits;
+    UPInt metaSize = SysAllocReserved_AlignUp(sizeof(Region) + 2 * words * sizeof(UPInt), PageSize);
+    Region* pregion = (Region*)SysAllocReserved_Map(metaSize, 0);
+    if (!pregion)
+    {
+        ::munmap(pbase, size);
+        return 0;
+    }
+
+    // Fresh anonymous memory is zeroed, so both bitmaps start clear.
+    pregion->pNext      = 0;
+    pregion->pBase      = pbase;
+    pregion->Size       = size;
+    pregion->Units      = units;
+    pregion->UsedUnits  = 0;
+    pregion->MetaSize   = metaSize;
+    pregion->pUsed      = (UPInt*)(pregion + 1);
+    pregion->pCommitted = pregion->pUsed + words;
+    pregion->HugeTLB    = hugeTLB;
+    pregion->HugePages  = hugePages;
+
+    // Keep regions in creation order; Alloc fills earlier regions first,
+    // so later ones empty out and can be unmapped.
+    Region** plink = &pRegions;
+    while (*plink)
+        plink = &(*plink)->pNext;
+    *plink = pregion;
+
+    Reserved += size;
+    if (hugePages)
+        HugePageBytes += size;
+    RegionCount++;
+    return pregion;
+}
+
+SysAllocReservedMMAP::Region* SysAllocReservedMMAP::findRegion(const void* ptr) const
+{
+    for (Region* pregion = pRegions; pregion; pregion = pregion->pNext)
+    {
+        if ((const UByte*)ptr >= pregion->pBase && (const UByte*)ptr < pregion->pBase + pregion->Size)
+            return pregion;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------
+void* SysAllocReservedMMAP::Alloc(UPInt size, UPInt align)
+{
+    Lock::Locker lock(&RegionLock);
+
+    size  = SysAllocReserved_AlignUp(size ? size : 1, Granularity);
+    align = Alg::Max(align, Granularity);
+
+    UPInt   count     = size / Granularity;
+    UPInt   alignStep = align / Granularity;
+    Region* pregion   = pRegions;
+
+    for (;;)
+    {
+        if (!pregion)
+        {
+            pregion = reserveRegion(size + (align > HugePageSize ? align : 0));
+            if (!pregion)
+                return 0;
+        }
+
+        // First fit on aligned unit boundaries, lowest address first, to
+        // keep the committed part of the region compact.
+        UPInt first = (SysAllocReserved_AlignUp((UPInt)pregion->pBase, align) - (UPInt)pregion->pBase) / Granularity;
+        UPInt start = first;
+        while (start + count <= pregion->Units)
+        {
+            UPInt used = SysAllocReserved_FindSet(pregion->pUsed, start, start + count);
+            if (used == start + count)
+            {
+                for (UPInt i = start; i < start + count; i++)
+                {
+                    SysAllocReserved_Set(pregion->pUsed, i);
+                    if (!SysAllocReserved_Test(pregion->pCommitted, i))
+                    {
+                        SysAllocReserved_Set(pregion->pCommitted, i);
+                        Committed += Granularity;
+                    }
+                }
+                pregion->UsedUnits += count;
+                Used += size;
+                return pregion->pBase + start * Granularity;
+            }
+            start = first + SysAllocReserved_AlignUp(used + 1 - first, alignStep);
+        }
+        pregion = pregion->pNext;
+    }
+}
+
+//------------------------------------------------------------------------
+bool SysAllocReservedMMAP::ReallocInPlace(void* oldPtr, UPInt oldSize,
+                                          UPInt newSize, UPInt align)
+{
+    SF_UNUSED(align);
+    Lock::Locker lock(&RegionLock);
+
+    Region* pregion = findRegion(oldPtr);
+    SF_ASSERT(pregion);
+
+    UPInt start    = ((UByte*)oldPtr - pregion->pBase) / Granularity;
+    UPInt oldCount = SysAllocReserved_AlignUp(oldSize, Granularity) / Granularity;
+    UPInt newCount = SysAllocReserved_AlignUp(newSize ? newSize : 1, Granularity) / Granularity;
+
+    if (newCount > oldCount)
+    {
+        if (start + newCount > pregion->Units ||
+            SysAllocReserved_FindSet(pregion->pUsed, start + oldCount, start + newCount) != start + newCount)
+            return false;
+
+        for (UPInt i = start + oldCount; i < start + newCount; i++)
+        {
+            SysAllocReserved_Set(pregion->pUsed, i);
+            if (!SysAllocReserved_Test(pregion->pCommitted, i))
+            {
+                SysAllocReserved_Set(pregion->pCommitted, i);
+                Committed += Granularity;
+            }
+        }
+        pregion->UsedUnits += newCount - oldCount;
+        Used += (newCount - oldCount) * Granularity;
+    }
+    else if (newCount < oldCount)
+    {
+        freeUnits(pregion, start + newCount, oldCount - newCount);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool SysAllocReservedMMAP::Free(void* ptr, UPInt size, UPInt align)
+{
+    SF_UNUSED(align);
+    Lock::Locker lock(&RegionLock);
+
+    Region* pregion = findRegion(ptr);
+    SF_ASSERT(pregion);
+
+    UPInt start = ((UByte*)ptr - pregion->pBase) / Granularity;
+    freeUnits(pregion, start, SysAllocReserved_AlignUp(size ? size : 1, Granularity) / Granularity);
+
+    // Give the address space of an empty region back, except for the
+    // first one, which is kept for the next allocation.
+    if (pregion->UsedUnits == 0 && pregion != pRegions)
+    {
+        Region** plink = &pRegions;
+        while (*plink != pregion)
+            plink = &(*plink)->pNext;
+        *plink = pregion->pNext;
+
+        for (UPInt i = 0; i < pregion->Units; i++)
+            if (SysAllocReserved_Test(pregion->pCommitted, i))
+                Committed -= Granularity;
+        Reserved -= pregion->Size;
+        if (pregion->HugePages)
+            HugePageBytes -= pregion->Size;
+        RegionCount--;
+
+        ::munmap(pregion->pBase, pregion->Size);
+        ::munmap(pregion, pregion->MetaSize);
+    }
+    return true;
+}
+
+void SysAllocReservedMMAP::freeUnits(Region* pregion, UPInt start, UPInt count)
+{
+    for (UPInt i = start; i < start + count; i++)
+    {
+        SF_ASSERT(SysAllocReserved_Test(pregion->pUsed, i));
+        SysAllocReserved_Clear(pregion->pUsed, i);
+    }
+    pregion->UsedUnits -= count;
+    Used -= count * Granularity;
+    releaseFree(pregion, start, start + count);
+}
+
+// Releases the committed free units around [start, end). Huge page regions
+// are released in whole huge pages only: partially releasing one would
+// split it (or fail, for hugetlb), so the units stay committed until the
+// rest of the huge page is free as well.
+void SysAllocReservedMMAP::releaseFree(Region* pregion, UPInt start, UPInt end)
+{
+    UPInt step = 1;
+    if (pregion->HugePages && Granularity < HugePageSize)
+        step = HugePageSize / Granularity;
+
+    UPInt lo = start / step * step;
+    if (SysAllocReserved_FindSet(pregion->pUsed, lo, start) != start)
+        lo += step;
+    UPInt hi = Alg::Min(SysAllocReserved_AlignUp(end, step), pregion->Units);
+    if (SysAllocReserved_FindSet(pregion->pUsed, end, hi) != hi)
+        hi = end / step * step;
+
+    // Release each run of committed units in [lo, hi).
+    UPInt i = lo;
+    while (i < hi)
+    {
+        if (!SysAllocReserved_Test(pregion->pCommitted, i))
+        {
+            i++;
+            continue;
+        }
+        UPInt runEnd = i;
+        while (runEnd < hi && SysAllocReserved_Test(pregion->pCommitted, runEnd))
+            runEnd++;
+
+        if (::madvise(pregion->pBase + i * Granularity, (runEnd - i) * Granularity, MADV_DONTNEED) == 0)
+        {
+            for (UPInt j = i; j < runEnd; j++)
+                SysAllocReserved_Clear(pregion->pCommitted, j);
+            Committed -= (runEnd - i) * Granularity;
+            Released  += (runEnd - i) * Granularity;
+            ReleaseCalls++;
+        }
+        i = runEnd;
+    }
+}
+
+//------------------------------------------------------------------------
+UPInt SysAllocReservedMMAP::GetFootprint() const
+{
+    Lock::Locker lock(&RegionLock);
+    return Committed;
+}
+
+UPInt SysAllocReservedMMAP::GetUsedSpace() const
+{
+    Lock::Locker lock(&RegionLock);
+    return Used;
+}
+
+UPInt SysAllocReservedMMAP::GetBase() const
+{
+    Lock::Locker lock(&RegionLock);
+    return pRegions ? (UPInt)pRegions->pBase : 0;
+}
+
+UPInt SysAllocReservedMMAP::GetSize() const
+{
+    Lock::Locker lock(&RegionLock);
+    return pRegions ? pRegions->Size : 0;
+}
+
+void SysAllocReservedMMAP::GetStats(Stats* pstats) const
+{
+    Lock::Locker lock(&RegionLock);
+    pstats->Reserved      = Reserved;
+    pstats->Committed     = Committed;
+    pstats->Used          = Used;
+    pstats->HugePageBytes = HugePageBytes;
+    pstats->Released      = Released;
+    pstats->Regions       = RegionCount;
+    pstats->ReleaseCalls  = ReleaseCalls;
+}
+
+} // Scaleform
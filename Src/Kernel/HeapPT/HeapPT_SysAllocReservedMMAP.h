@@ -0,0 +1,146 @@
+/**************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   HeapPT_SysAllocReservedMMAP.h
+Platform    :   Unix, Linux, MacOS
+Content     :   MMAP based System Allocator that carves segments out of
+                large reserved regions backed by huge pages
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Kernel_HeapPT_SysAllocReservedMMAP_H
+#define INC_SF_Kernel_HeapPT_SysAllocReservedMMAP_H
+
+#include "../SF_SysAlloc.h"
+#include "../SF_Threads.h"
+
+namespace Scaleform {
+
+// ***** SysAllocReservedMMAP
+//
+// SysAllocMMAP maps every segment separately, so a large heap ends up in
+// many small mappings that are backed by 4K pages. SysAllocReservedMMAP
+// reserves address space in large regions up front (MAP_NORESERVE, so
+// nothing is committed until touched) and hands out segments from them,
+// lowest address first. Each region is aligned to the huge page size, so
+// on Linux the kernel can back it with transparent huge pages
+// (MADV_HUGEPAGE), or it can be mapped from the explicit hugetlb pool
+// (MAP_HUGETLB) with a fallback to transparent pages when the pool is
+// short.
+//
+// Freed and shrunk segments are returned to the system with
+// madvise(MADV_DONTNEED). Free space is released in whole huge pages
+// where possible, so a free that only covers part of a huge page keeps it
+// committed until its neighbours are freed too; GetFootprint reports the
+// committed bytes, including such pages.
+//
+// To keep an arena on one NUMA node, give the allocator the node and
+// create the arena with it:
+//
+//     SysAllocReservedMMAP::Params params;
+//     params.NumaNode = 1;
+//     static SysAllocReservedMMAP node1Alloc(params);
+//     Memory::CreateArena(1, &node1Alloc);
+//     ...
+//     MemoryHeap::HeapDesc desc;
+//     desc.Arena = 1;
+//
+// Regions are bound to the node with mbind(MPOL_PREFERRED) before they are
+// touched, so pages come from the node while it has memory. NumaNode and
+// the huge page modes are ignored on systems without them.
+//------------------------------------------------------------------------
+class SysAllocReservedMMAP : public SysAllocBase_SingletonSupport<SysAllocReservedMMAP, SysAllocPaged>
+{
+public:
+    enum
+    {
+        MinGranularity = 4*1024,
+        HugePageSize   = 2*1024*1024
+    };
+
+    enum HugePageMode
+    {
+        HugePage_None,          // Regular pages.
+        HugePage_Transparent,   // madvise(MADV_HUGEPAGE) on each region.
+        HugePage_Explicit       // MAP_HUGETLB, else as HugePage_Transparent.
+    };
+
+    struct Params
+    {
+        UPInt           ReserveSize;    // Address space per region; rounded up to HugePageSize.
+        UPInt           Granularity;    // Segment size unit; a power of two, at least MinGranularity.
+        HugePageMode    HugePages;
+        int             NumaNode;       // Preferred node, or -1 for the default policy.
+
+        Params()
+#if defined(SF_64BIT_POINTERS)
+            : ReserveSize(UPInt(1024)*1024*1024),
+#else
+            : ReserveSize(UPInt(128)*1024*1024),
+#endif
+              Granularity(64*1024), HugePages(HugePage_Transparent), NumaNode(-1)
+        { }
+    };
+
+    struct Stats
+    {
+        UPInt       Reserved;       // Address space of all regions.
+        UPInt       Committed;      // Bytes allocated or freed but not yet released.
+        UPInt       Used;           // Bytes in allocated segments.
+        UPInt       HugePageBytes;  // Reserved bytes in huge page (transparent or explicit) regions.
+        UPInt       Released;       // Total bytes returned with MADV_DONTNEED.
+        unsigned    Regions;
+        unsigned    ReleaseCalls;
+    };
+
+    SF_EXPORT SysAllocReservedMMAP(const Params& params = Params());
+    SF_EXPORT virtual ~SysAllocReservedMMAP();
+
+    virtual void    GetInfo(Info* i) const;
+    virtual void*   Alloc(UPInt size, UPInt align);
+    virtual bool    ReallocInPlace(void* oldPtr, UPInt oldSize,
+                                   UPInt newSize, UPInt align);
+    virtual bool    Free(void* ptr, UPInt size, UPInt align);
+
+    virtual UPInt   GetFootprint() const;
+    virtual UPInt   GetUsedSpace() const;
+
+    virtual UPInt   GetBase() const; // DBG
+    virtual UPInt   GetSize() const; // DBG
+
+    void            GetStats(Stats* pstats) const;
+
+private:
+    struct Region;
+
+    Region*         reserveRegion(UPInt minSize);
+    Region*         findRegion(const void* ptr) const;
+    void            freeUnits(Region* pregion, UPInt start, UPInt count);
+    void            releaseFree(Region* pregion, UPInt start, UPInt end);
+
+    mutable Lock    RegionLock;
+    Region*         pRegions;
+    Params          AllocParams;
+    UPInt           Granularity;
+    UPInt           PageSize;
+
+    UPInt           Reserved;
+    UPInt           Committed;
+    UPInt           Used;
+    UPInt           HugePageBytes;
+    UPInt           Released;
+    unsigned        RegionCount;
+    unsigned        ReleaseCalls;
+};
+
+} // Scaleform
+
+#endif
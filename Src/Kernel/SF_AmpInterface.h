@@ -22,6 +22,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "SF_RefCount.h"
 #include "SF_String.h"
 #include "SF_Log.h"
+#include "SF_Trace.h"
 
 #if defined(SF_PROFILE_GPA)
     #include <ittnotify.h>
@@ -376,17 +377,41 @@ public:
 
 
 // Some macros for frequently-used methods
+// AMP function timers also show up in the timeline trace (see SF_Trace.h).
 #ifdef SF_AMP_SERVER
-#define SF_AMP_SCOPE_TIMER_ID(ampStats, functionName, functionId)   AmpFunctionTimer _amp_timer_##functionId((ampStats), (functionName), Amp_Profile_Level_Low, (functionId))
-#define SF_AMP_SCOPE_TIMER(ampStats, functionName, profileLevel)    AmpFunctionTimer _amp_timer_((ampStats), (functionName), (profileLevel))
-#define SF_AMP_SCOPE_RENDER_TIMER_ID(functionName, functionId)      AmpFunctionTimer _amp_timer_##functionId(AmpServer::GetInstance().GetDisplayStats(), (functionName), Amp_Profile_Level_Low, (functionId))
-#define SF_AMP_SCOPE_RENDER_TIMER(functionName, profileLevel)       AmpFunctionTimer _amp_timer_(AmpServer::GetInstance().GetDisplayStats(), (functionName), (profileLevel))
+
+// AmpFunctionTimer plus the matching trace scope, so that each macro below
+// declares a single object and can be used wherever a statement can.
+class AmpScopeTimer
+{
+public:
+    AmpScopeTimer(TraceCategory category, AmpStats* ampStats, const char* functionName,
+                  AmpProfileLevel profileLevel = Amp_Profile_Level_Low,
+                  AmpNativeFunctionId functionId = Amp_Native_Function_Id_Invalid) :
+#ifdef SF_ENABLE_TRACE
+        TraceTimer(category, functionName),
+#endif
+        FunctionTimer(ampStats, functionName, profileLevel, functionId)
+    {
+        SF_UNUSED(category);
+    }
+private:
+#ifdef SF_ENABLE_TRACE
+    TraceScope          TraceTimer;
+#endif
+    AmpFunctionTimer    FunctionTimer;
+};
+
+#define SF_AMP_SCOPE_TIMER_ID(ampStats, functionName, functionId)   AmpScopeTimer _amp_timer_##functionId(TraceCat_Timer, (ampStats), (functionName), Amp_Profile_Level_Low, (functionId))
+#define SF_AMP_SCOPE_TIMER(ampStats, functionName, profileLevel)    AmpScopeTimer _amp_timer_(TraceCat_Timer, (ampStats), (functionName), (profileLevel))
+#define SF_AMP_SCOPE_RENDER_TIMER_ID(functionName, functionId)      AmpScopeTimer _amp_timer_##functionId(TraceCat_Render, AmpServer::GetInstance().GetDisplayStats(), (functionName), Amp_Profile_Level_Low, (functionId))
+#define SF_AMP_SCOPE_RENDER_TIMER(functionName, profileLevel)       AmpScopeTimer _amp_timer_(TraceCat_Render, AmpServer::GetInstance().GetDisplayStats(), (functionName), (profileLevel))
 #define SF_AMP_CODE(x) x
 #else
-#define SF_AMP_SCOPE_TIMER_ID(ampStats, functionName, functionId)
-#define SF_AMP_SCOPE_TIMER(ampStats, functionName, profileLevel)
-#define SF_AMP_SCOPE_RENDER_TIMER_ID(functionName, functionId)
-#define SF_AMP_SCOPE_RENDER_TIMER(functionName, profileLevel)
+#define SF_AMP_SCOPE_TIMER_ID(ampStats, functionName, functionId)   SF_TRACE_SCOPE(TraceCat_Timer, (functionName))
+#define SF_AMP_SCOPE_TIMER(ampStats, functionName, profileLevel)    SF_TRACE_SCOPE(TraceCat_Timer, (functionName))
+#define SF_AMP_SCOPE_RENDER_TIMER_ID(functionName, functionId)      SF_TRACE_SCOPE(TraceCat_Render, (functionName))
+#define SF_AMP_SCOPE_RENDER_TIMER(functionName, profileLevel)       SF_TRACE_SCOPE(TraceCat_Render, (functionName))
 #define SF_AMP_CODE(x)
 #endif
 
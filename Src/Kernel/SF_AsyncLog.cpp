@@ -0,0 +1,1041 @@
+/**************************************************************************
+
+Filename    :   SF_AsyncLog.cpp
+Content     :   Log that formats and writes messages on a background
+                thread
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "SF_AsyncLog.h"
+#include "SF_ArrayStaticBuff.h"
+#include "SF_Memory.h"
+#include "SF_HeapNew.h"
+#include "SF_Std.h"
+#include "SF_Trace.h"
+
+// Older MSVC has no va_copy; its va_list is a plain pointer. GCC and Clang
+// only define va_copy for C99/C++11, but always have __va_copy.
+#ifndef va_copy
+#if defined(SF_CC_MSVC)
+#define va_copy(dest, src) ((dest) = (src))
+#else
+#define va_copy(dest, src) __va_copy(dest, src)
+#endif
+#endif
+
+// Ring lookups are cached in thread-local storage. Compilers without it
+// search the ring list under a lock on every message.
+#if defined(SF_CC_MSVC)
+#define SF_ASYNCLOG_THREAD_LOCAL __declspec(thread)
+#elif defined(SF_CC_GNU) || defined(SF_CC_CLANG)
+#define SF_ASYNCLOG_THREAD_LOCAL __thread
+#endif
+
+namespace Scaleform {
+
+namespace {
+
+// ***** Packed arguments
+
+// Each argument is an 8-byte entry header followed by its value, padded to
+// 8 bytes. Integers are widened to 64 bits, floating point values are
+// stored as double and strings are copied with their terminator.
+
+enum AsyncLog_ArgType
+{
+    AsyncLog_Int,
+    AsyncLog_UInt,
+    AsyncLog_Double,
+    AsyncLog_Pointer,
+    AsyncLog_String
+};
+
+struct AsyncLog_ArgHeader
+{
+    UInt32  Type;
+    UInt32  Size;   // Bytes of value that follow.
+};
+
+// Largest packed argument block; the same size as the buffer Log formats
+// into, so strings Log would truncate are truncated here too.
+const UPInt AsyncLog_PackBufferSize = Log::MaxLogBufferMessageSize;
+
+// Longest conversion specification copied into a rebuilt format.
+const UPInt AsyncLog_MaxSpecLength  = 32;
+
+inline UPInt AsyncLog_Align8(UPInt size)
+{
+    return (size + 7) & ~UPInt(7);
+}
+
+
+// ***** Conversion specifications
+
+enum AsyncLog_Length
+{
+    AsyncLog_Len_None,
+    AsyncLog_Len_hh,
+    AsyncLog_Len_h,
+    AsyncLog_Len_l,
+    AsyncLog_Len_ll,
+    AsyncLog_Len_L,
+    AsyncLog_Len_z,     // size_t, and MSVC "I"
+    AsyncLog_Len_j,
+    AsyncLog_Len_t,
+    AsyncLog_Len_I32
+};
+
+struct AsyncLog_Spec
+{
+    const char* pFlags;     // Flag characters, right after the '%'.
+    UPInt       FlagCount;
+    int         Width;      // -1 if none; -2 if given by an argument.
+    int         Precision;  // -1 if none; -2 if given by an argument.
+    int         Length;     // AsyncLog_Length.
+    char        Conversion; // 0 for "%%".
+};
+
+int AsyncLog_ParseNumber(const char*& p)
+{
+    int value = 0;
+    while (*p >= '0' && *p <= '9' && value < 100000)
+        value = value * 10 + (*p++ - '0');
+    return value;
+}
+
+// Parses the specification at p, which points at the '%'. Returns the
+// character following it, or 0 if the packer doesn't support it.
+const char* AsyncLog_ParseSpec(const char* p, AsyncLog_Spec* pspec)
+{
+    const char* pstart = p++;
+    pspec->Width      = -1;
+    pspec->Precision  = -1;
+    pspec->Length     = AsyncLog_Len_None;
+    pspec->Conversion = 0;
+
+    if (*p == '%')
+        return p + 1;
+
+    pspec->pFlags = p;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+        p++;
+    pspec->FlagCount = (UPInt)(p - pspec->pFlags);
+
+    if (*p == '*')
+    {
+        pspec->Width = -2;
+        p++;
+    }
+    else if (*p >= '0' && *p <= '9')
+        pspec->Width = AsyncLog_ParseNumber(p);
+
+    if (*p == '.')
+    {
+        p++;
+        if (*p == '*')
+        {
+            pspec->Precision = -2;
+            p++;
+        }
+        else
+            pspec->Precision = AsyncLog_ParseNumber(p);
+    }
+
+    switch (*p)
+    {
+    case 'h':
+        pspec->Length = (p[1] == 'h') ? AsyncLog_Len_hh : AsyncLog_Len_h;
+        p += (p[1] == 'h') ? 2 : 1;
+        break;
+    case 'l':
+        pspec->Length = (p[1] == 'l') ? AsyncLog_Len_ll : AsyncLog_Len_l;
+        p += (p[1] == 'l') ? 2 : 1;
+        break;
+    case 'q': pspec->Length = AsyncLog_Len_ll; p++; break;
+    case 'L': pspec->Length = AsyncLog_Len_L;  p++; break;
+    case 'z': pspec->Length = AsyncLog_Len_z;  p++; break;
+    case 'j': pspec->Length = AsyncLog_Len_j;  p++; break;
+    case 't': pspec->Length = AsyncLog_Len_t;  p++; break;
+    case 'I':
+        if (p[1] == '6' && p[2] == '4')
+        {
+            pspec->Length = AsyncLog_Len_ll;
+            p += 3;
+        }
+        else if (p[1] == '3' && p[2] == '2')
+        {
+            pspec->Length = AsyncLog_Len_I32;
+            p += 3;
+        }
+        else
+        {
+            pspec->Length = AsyncLog_Len_z;
+            p++;
+        }
+        break;
+    default:
+        break;
+    }
+
+    switch (*p)
+    {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+    case 'p':
+        break;
+    case 'c': case 's':
+        // Wide characters and strings would need converting.
+        if (pspec->Length != AsyncLog_Len_None)
+            return 0;
+        break;
+    default:
+        // %n, %S, %C and anything unknown.
+        return 0;
+    }
+    pspec->Conversion = *p++;
+
+    if ((UPInt)(p - pstart) > AsyncLog_MaxSpecLength)
+        return 0;
+    return p;
+}
+
+inline bool AsyncLog_IsSigned(char conversion)
+{
+    return conversion == 'd' || conversion == 'i' || conversion == 'c';
+}
+
+inline bool AsyncLog_IsUnsigned(char conversion)
+{
+    return conversion == 'o' || conversion == 'u' || conversion == 'x' || conversion == 'X';
+}
+
+inline bool AsyncLog_IsFloat(char conversion)
+{
+    switch (conversion)
+    {
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        return true;
+    }
+    return false;
+}
+
+
+#ifdef SF_ENABLE_THREADS
+
+// ***** Packing
+
+class AsyncLog_Packer
+{
+public:
+    AsyncLog_Packer(UByte* pbuffer, UPInt size)
+        : pBuffer(pbuffer), pEnd(pbuffer + size), p(pbuffer) { }
+
+    bool AddInt(SInt64 value)   { return addScalar(AsyncLog_Int, &value, sizeof(value)); }
+    bool AddUInt(UInt64 value)  { return addScalar(AsyncLog_UInt, &value, sizeof(value)); }
+    bool AddDouble(double value){ return addScalar(AsyncLog_Double, &value, sizeof(value)); }
+    bool AddPointer(const void* value) { return addScalar(AsyncLog_Pointer, &value, sizeof(value)); }
+
+    // Copies the string, truncated to the space left. A non-negative
+    // precision limits the copy as it does in printf, so the string
+    // needn't be terminated within it.
+    bool AddString(const char* pstr, int precision)
+    {
+        if (!pstr)
+            pstr = "(null)";
+        if ((UPInt)(pEnd - p) < sizeof(AsyncLog_ArgHeader) + 8)
+            return false;
+        UPInt room   = (UPInt)(pEnd - p) - sizeof(AsyncLog_ArgHeader) - 1;
+        if (precision >= 0 && (UPInt)precision < room)
+            room = (UPInt)precision;
+        UPInt length = 0;
+        while (length < room && pstr[length])
+            length++;
+
+        AsyncLog_ArgHeader* phdr = (AsyncLog_ArgHeader*)p;
+        phdr->Type = AsyncLog_String;
+        phdr->Size = (UInt32)(length + 1);
+        char* pdest = (char*)(phdr + 1);
+        memcpy(pdest, pstr, length);
+        pdest[length] = 0;
+        p += AsyncLog_Align8(sizeof(AsyncLog_ArgHeader) + length + 1);
+        return true;
+    }
+
+    UPInt GetSize() const { return (UPInt)(p - pBuffer); }
+
+private:
+    bool addScalar(UInt32 type, const void* pvalue, UInt32 size)
+    {
+        if ((UPInt)(pEnd - p) < sizeof(AsyncLog_ArgHeader) + 8)
+            return false;
+        AsyncLog_ArgHeader* phdr = (AsyncLog_ArgHeader*)p;
+        phdr->Type = type;
+        phdr->Size = size;
+        memcpy(phdr + 1, pvalue, size);
+        p += sizeof(AsyncLog_ArgHeader) + 8;
+        return true;
+    }
+
+    UByte*  pBuffer;
+    UByte*  pEnd;
+    UByte*  p;
+};
+
+bool AsyncLog_PackInt(AsyncLog_Packer& packer, const AsyncLog_Spec& spec, va_list& argList)
+{
+    SInt64 value;
+    switch (spec.Length)
+    {
+    case AsyncLog_Len_hh:   value = (signed char)va_arg(argList, int);  break;
+    case AsyncLog_Len_h:    value = (short)va_arg(argList, int);        break;
+    case AsyncLog_Len_l:    value = va_arg(argList, long);              break;
+    case AsyncLog_Len_ll:
+    case AsyncLog_Len_j:    value = va_arg(argList, SInt64);            break;
+    case AsyncLog_Len_z:
+    case AsyncLog_Len_t:    value = va_arg(argList, SPInt);             break;
+    case AsyncLog_Len_I32:  value = va_arg(argList, SInt32);            break;
+    default:                value = va_arg(argList, int);               break;
+    }
+    return packer.AddInt(value);
+}
+
+bool AsyncLog_PackUInt(AsyncLog_Packer& packer, const AsyncLog_Spec& spec, va_list& argList)
+{
+    UInt64 value;
+    switch (spec.Length)
+    {
+    case AsyncLog_Len_hh:   value = (unsigned char)va_arg(argList, unsigned);   break;
+    case AsyncLog_Len_h:    value = (unsigned short)va_arg(argList, unsigned);  break;
+    case AsyncLog_Len_l:    value = va_arg(argList, unsigned long);             break;
+    case AsyncLog_Len_ll:
+    case AsyncLog_Len_j:    value = va_arg(argList, UInt64);                    break;
+    case AsyncLog_Len_z:
+    case AsyncLog_Len_t:    value = va_arg(argList, UPInt);                     break;
+    case AsyncLog_Len_I32:  value = va_arg(argList, UInt32);                    break;
+    default:                value = va_arg(argList, unsigned);                  break;
+    }
+    return packer.AddUInt(value);
+}
+
+// Packs the arguments fmt refers to. Returns false if fmt uses a
+// conversion the packer doesn't support or the arguments don't fit.
+bool AsyncLog_PackArgs(AsyncLog_Packer& packer, const char* fmt, va_list& argList)
+{
+    for (const char* p = fmt; *p; )
+    {
+        if (*p != '%')
+        {
+            p++;
+            continue;
+        }
+
+        AsyncLog_Spec spec;
+        p = AsyncLog_ParseSpec(p, &spec);
+        if (!p)
+            return false;
+        if (!spec.Conversion)
+            continue;
+
+        if (spec.Width == -2 && !packer.AddInt(va_arg(argList, int)))
+            return false;
+        int precision = spec.Precision;
+        if (precision == -2)
+        {
+            precision = va_arg(argList, int);
+            if (!packer.AddInt(precision))
+                return false;
+        }
+
+        bool ok;
+        if (spec.Conversion == 'c')
+            ok = packer.AddInt(va_arg(argList, int));
+        else if (AsyncLog_IsSigned(spec.Conversion))
+            ok = AsyncLog_PackInt(packer, spec, argList);
+        else if (AsyncLog_IsUnsigned(spec.Conversion))
+            ok = AsyncLog_PackUInt(packer, spec, argList);
+        else if (AsyncLog_IsFloat(spec.Conversion))
+        {
+            if (spec.Length == AsyncLog_Len_L)
+                ok = packer.AddDouble((double)va_arg(argList, long double));
+            else
+                ok = packer.AddDouble(va_arg(argList, double));
+        }
+        else if (spec.Conversion == 's')
+            ok = packer.AddString(va_arg(argList, const char*), precision);
+        else
+            ok = packer.AddPointer(va_arg(argList, void*));
+
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+#endif // SF_ENABLE_THREADS
+
+
+// ***** Unpacking
+
+class AsyncLog_Unpacker
+{
+public:
+    AsyncLog_Unpacker(const UByte* pargs, UPInt size)
+        : p(pargs), pEnd(pargs + size) { }
+
+    // Returns the next argument's value if it has the given type.
+    const void* Next(UInt32 type)
+    {
+        if ((UPInt)(pEnd - p) < sizeof(AsyncLog_ArgHeader))
+            return 0;
+        const AsyncLog_ArgHeader* phdr = (const AsyncLog_ArgHeader*)p;
+        if (phdr->Type != type)
+            return 0;
+        p += AsyncLog_Align8(sizeof(AsyncLog_ArgHeader) + phdr->Size);
+        return phdr + 1;
+    }
+
+private:
+    const UByte* p;
+    const UByte* pEnd;
+};
+
+inline SInt64 AsyncLog_LoadInt(const void* pvalue)
+{
+    SInt64 value;
+    memcpy(&value, pvalue, sizeof(value));
+    return value;
+}
+
+
+// ***** Thread ring cache
+
+AtomicInt<UInt32> AsyncLog_NextSerial;
+
+#if defined(SF_ENABLE_THREADS) && defined(SF_ASYNCLOG_THREAD_LOCAL)
+// The calling thread's ring in the AsyncLog with the given serial number.
+SF_ASYNCLOG_THREAD_LOCAL UInt32 AsyncLog_CachedSerial = 0;
+SF_ASYNCLOG_THREAD_LOCAL void*  AsyncLog_CachedRing   = 0;
+#endif
+
+} // namespace
+
+
+//------------------------------------------------------------------------
+UPInt AsyncLog::FormatRecord(char* buffer, UPInt bufferSize, const char* fmt,
+                             const UByte* pargs, UPInt argsSize)
+{
+    SF_ASSERT(bufferSize > 0);
+    AsyncLog_Unpacker args(pargs, argsSize);
+    UPInt             pos = 0;
+    const char*       p   = fmt;
+
+    while (*p && pos + 1 < bufferSize)
+    {
+        if (*p != '%')
+        {
+            buffer[pos++] = *p++;
+            continue;
+        }
+
+        AsyncLog_Spec spec;
+        const char*   pnext = AsyncLog_ParseSpec(p, &spec);
+        if (!pnext)
+            break;
+        if (!spec.Conversion)
+        {
+            buffer[pos++] = '%';
+            p = pnext;
+            continue;
+        }
+
+        // Rebuild the specification with explicit width and precision and
+        // a length matching the stored value.
+        const void* pwidth     = (spec.Width == -2)     ? args.Next(AsyncLog_Int) : 0;
+        const void* pprecision = (spec.Precision == -2) ? args.Next(AsyncLog_Int) : 0;
+        if ((spec.Width == -2 && !pwidth) || (spec.Precision == -2 && !pprecision))
+            break;
+
+        char  specBuffer[AsyncLog_MaxSpecLength + 32];
+        UPInt specPos = 0;
+        specBuffer[specPos++] = '%';
+        memcpy(specBuffer + specPos, spec.pFlags, spec.FlagCount);
+        specPos += spec.FlagCount;
+        int width     = pwidth ? (int)AsyncLog_LoadInt(pwidth) : spec.Width;
+        int precision = pprecision ? (int)AsyncLog_LoadInt(pprecision) : spec.Precision;
+        if (width < 0 && pwidth)
+        {
+            // A negative '*' width means left-justify.
+            specBuffer[specPos++] = '-';
+            width = -width;
+        }
+        if (width >= 0)
+        {
+            SFsprintf(specBuffer + specPos, 16, "%d", width);
+            specPos += SFstrlen(specBuffer + specPos);
+        }
+        if (precision >= 0)
+        {
+            SFsprintf(specBuffer + specPos, 16, ".%d", precision);
+            specPos += SFstrlen(specBuffer + specPos);
+        }
+
+        const void* pvalue = 0;
+        char        conversion = spec.Conversion;
+        if (conversion == 'c')
+        {
+            pvalue = args.Next(AsyncLog_Int);
+            specBuffer[specPos++] = 'c';
+        }
+        else if (AsyncLog_IsSigned(conversion) || AsyncLog_IsUnsigned(conversion))
+        {
+            pvalue = args.Next(AsyncLog_IsSigned(conversion) ? AsyncLog_Int : AsyncLog_UInt);
+            specBuffer[specPos++] = 'l';
+            specBuffer[specPos++] = 'l';
+            specBuffer[specPos++] = conversion;
+        }
+        else if (AsyncLog_IsFloat(conversion))
+        {
+            pvalue = args.Next(AsyncLog_Double);
+            specBuffer[specPos++] = conversion;
+        }
+        else
+        {
+            pvalue = args.Next(conversion == 's' ? AsyncLog_String : AsyncLog_Pointer);
+            specBuffer[specPos++] = conversion;
+        }
+        specBuffer[specPos] = 0;
+        if (!pvalue)
+            break;
+
+        char*  pdest = buffer + pos;
+        UPInt  room  = bufferSize - pos;
+        if (conversion == 'c')
+            SFsprintf(pdest, room, specBuffer, (int)AsyncLog_LoadInt(pvalue));
+        else if (AsyncLog_IsSigned(conversion))
+            SFsprintf(pdest, room, specBuffer, (long long)AsyncLog_LoadInt(pvalue));
+        else if (AsyncLog_IsUnsigned(conversion))
+            SFsprintf(pdest, room, specBuffer, (unsigned long long)(UInt64)AsyncLog_LoadInt(pvalue));
+        else if (AsyncLog_IsFloat(conversion))
+        {
+            double value;
+            memcpy(&value, pvalue, sizeof(value));
+            SFsprintf(pdest, room, specBuffer, value);
+        }
+        else if (conversion == 's')
+            SFsprintf(pdest, room, specBuffer, (const char*)pvalue);
+        else
+        {
+            void* value;
+            memcpy(&value, pvalue, sizeof(value));
+            SFsprintf(pdest, room, specBuffer, value);
+        }
+        // SFsprintf return values differ between platforms.
+        pos += SFstrlen(pdest);
+        p = pnext;
+    }
+
+    // Anything left after a mismatch is written as is, so the message
+    // is still recognizable.
+    while (*p && pos + 1 < bufferSize)
+        buffer[pos++] = *p++;
+    buffer[pos] = 0;
+    return pos;
+}
+
+
+#ifdef SF_ENABLE_THREADS
+
+// ***** Ring
+
+// Single-consumer ring of records. Head and Tail are byte positions that
+// only increase (modulo 2^32); the writer advances Head, the owning thread
+// (or whoever holds RingLock, for the shared ring) advances Tail. Records
+// are 8-byte aligned and never wrap: one that doesn't fit before the end
+// is preceded by a padding record filling the rest.
+
+struct AsyncLog::Ring
+{
+    Ring() : Owner(0), pData(0), Mask(0) { Head = 0; Tail = 0; }
+
+    ThreadId            Owner;
+    UByte*              pData;
+    UInt32              Mask;
+    AtomicInt<UInt32>   Head;
+    UByte               Pad[64];    // Keeps Head and Tail on separate cache lines.
+    AtomicInt<UInt32>   Tail;
+};
+
+namespace {
+
+struct AsyncLog_Record
+{
+    UInt32          Size;       // Including this header; PadFlag set for padding.
+    UInt32          Sequence;
+    SInt32          MessageId;
+    UInt32          ArgsSize;
+    const char*     pFormat;    // 0 if the format follows the arguments.
+};
+
+const UInt32 AsyncLog_PadFlag = 0x80000000;
+
+inline UPInt AsyncLog_RecordHeaderSize()
+{
+    return AsyncLog_Align8(sizeof(AsyncLog_Record));
+}
+
+} // namespace
+
+
+// ***** WriterThread
+
+class AsyncLog::WriterThread : public Thread
+{
+public:
+    WriterThread(AsyncLog* plog) : Thread(64 * 1024), pLog(plog) { }
+
+    virtual int Run()
+    {
+        SF_TRACE_CODE(Trace::SetThreadName("AsyncLog"));
+        pLog->writerLoop();
+        return 0;
+    }
+
+private:
+    // Not AddRef-ed; the log joins the thread in Shutdown.
+    AsyncLog*   pLog;
+};
+
+#endif // SF_ENABLE_THREADS
+
+
+// ***** AsyncLog
+
+AsyncLog::AsyncLog(Log* ptarget, const Params& params)
+    : pTarget(ptarget), LogParams(params)
+{
+    SF_ASSERT(ptarget);
+    Serial = AsyncLog_NextSerial.ExchangeAdd_NoSync(1) + 1;
+    NextSequence     = 0;
+    DroppedCount     = 0;
+    SynchronousCount = 0;
+    BlockedCount     = 0;
+    BatchCount       = 0;
+    MaxBatch         = 0;
+
+#ifdef SF_ENABLE_THREADS
+    UPInt ringSize = 1024;
+    while (ringSize < LogParams.RingSize && ringSize < 0x40000000)
+        ringSize *= 2;
+    LogParams.RingSize = ringSize;
+
+    pSharedRing   = 0;
+    WriterIdle    = false;
+    WakeRequested = false;
+    Exiting       = false;
+    ActiveProducers = 0;
+
+    pWriter = *SF_HEAP_AUTO_NEW(this) WriterThread(this);
+    if (!pWriter->Start())
+        pWriter = 0;
+#endif
+}
+
+AsyncLog::~AsyncLog()
+{
+    Shutdown();
+#ifdef SF_ENABLE_THREADS
+    for (UPInt i = 0; i < Rings.GetSize(); i++)
+    {
+        Destruct(Rings[i]);
+        SF_FREE(Rings[i]);
+    }
+#endif
+}
+
+void AsyncLog::writeSynchronous(LogMessageId messageId, const char* fmt, va_list argList)
+{
+    SynchronousCount.Increment_NoSync();
+    Lock::Locker lock(&TargetLock);
+    pTarget->LogMessageVarg(messageId, fmt, argList);
+}
+
+void AsyncLog::writeText(LogMessageId messageId, const char* ptext)
+{
+    Lock::Locker lock(&TargetLock);
+    pTarget->LogMessageById(messageId, "%s", ptext);
+}
+
+void AsyncLog::GetStats(Stats* pstats) const
+{
+    pstats->Records     = NextSequence;
+    pstats->Dropped     = DroppedCount;
+    pstats->Synchronous = SynchronousCount;
+    pstats->Blocked     = BlockedCount;
+    pstats->Batches     = BatchCount;
+    pstats->MaxBatch    = MaxBatch;
+}
+
+
+#ifndef SF_ENABLE_THREADS
+
+void AsyncLog::LogMessageVarg(LogMessageId messageId, const char* fmt, va_list argList)
+{
+    writeSynchronous(messageId, fmt, argList);
+}
+
+void AsyncLog::Flush()
+{
+}
+
+void AsyncLog::Shutdown()
+{
+}
+
+#else
+
+AsyncLog::Ring* AsyncLog::createRing()
+{
+    UPInt headerSize = (sizeof(Ring) + 63) & ~UPInt(63);
+    void* pmem = SF_HEAP_AUTO_ALLOC(this, headerSize + LogParams.RingSize);
+    if (!pmem)
+        return 0;
+    Ring* pring  = Construct<Ring>(pmem);
+    pring->Owner = GetCurrentThreadId();
+    pring->pData = (UByte*)pmem + headerSize;
+    pring->Mask  = (UInt32)(LogParams.RingSize - 1);
+    return pring;
+}
+
+// Returns the calling thread's ring, or pSharedRing once MaxRings threads
+// have their own.
+AsyncLog::Ring* AsyncLog::getThreadRing()
+{
+#ifdef SF_ASYNCLOG_THREAD_LOCAL
+    if (AsyncLog_CachedSerial == Serial)
+        return (Ring*)AsyncLog_CachedRing;
+#endif
+
+    ThreadId id    = GetCurrentThreadId();
+    Ring*    pring = 0;
+    {
+        Lock::Locker lock(&RingLock);
+        for (UPInt i = 0; i < Rings.GetSize(); i++)
+        {
+            if (Rings[i] != pSharedRing && Rings[i]->Owner == id)
+            {
+                pring = Rings[i];
+                break;
+            }
+        }
+        if (!pring && Rings.GetSize() < LogParams.MaxRings)
+        {
+            pring = createRing();
+            if (pring)
+                Rings.PushBack(pring);
+        }
+        if (!pring)
+        {
+            if (!pSharedRing)
+            {
+                pSharedRing = createRing();
+                if (!pSharedRing)
+                    return 0;
+                Rings.PushBack(pSharedRing);
+            }
+            pring = pSharedRing;
+        }
+    }
+
+#ifdef SF_ASYNCLOG_THREAD_LOCAL
+    AsyncLog_CachedSerial = Serial;
+    AsyncLog_CachedRing   = pring;
+#endif
+    return pring;
+}
+
+// Copies a record into the ring. Returns false if there isn't room; the
+// caller holds RingLock if pring is the shared ring.
+bool AsyncLog::enqueue(Ring* pring, LogMessageId messageId, const char* fmt,
+                       const UByte* pargs, UPInt argsSize)
+{
+    UPInt  formatSize = LogParams.CopyFormat ? SFstrlen(fmt) + 1 : 0;
+    UInt32 size       = (UInt32)AsyncLog_Align8(AsyncLog_RecordHeaderSize() + argsSize + formatSize);
+    UInt32 capacity   = pring->Mask + 1;
+    UInt32 tail       = pring->Tail;
+    UInt32 offset     = tail & pring->Mask;
+    UInt32 toEnd      = capacity - offset;
+    UInt32 needed     = (toEnd < size) ? toEnd + size : size;
+
+    if (tail + needed - pring->Head.Load_Acquire() > capacity)
+        return false;
+
+    if (toEnd < size)
+    {
+        ((AsyncLog_Record*)(pring->pData + offset))->Size = toEnd | AsyncLog_PadFlag;
+        tail  += toEnd;
+        offset = 0;
+    }
+
+    AsyncLog_Record* prec = (AsyncLog_Record*)(pring->pData + offset);
+    UByte*           pdest = (UByte*)prec + AsyncLog_RecordHeaderSize();
+    prec->Size      = size;
+    prec->MessageId = (int)messageId;
+    prec->ArgsSize  = (UInt32)argsSize;
+    prec->pFormat   = formatSize ? 0 : fmt;
+    memcpy(pdest, pargs, argsSize);
+    if (formatSize)
+        memcpy(pdest + argsSize, fmt, formatSize);
+
+    // The sequence is taken last so records are numbered close to the
+    // order they become visible.
+    prec->Sequence = NextSequence.ExchangeAdd_NoSync(1);
+    pring->Tail.Store_Release(tail + size);
+    return true;
+}
+
+void AsyncLog::wakeWriter()
+{
+    Mutex::Locker lock(&WriterMutex);
+    WakeRequested = true;
+    WriterWake.NotifyAll();
+}
+
+void AsyncLog::LogMessageVarg(LogMessageId messageId, const char* fmt, va_list argList)
+{
+    // Counted so that Shutdown can wait for calls that got past the
+    // Exiting check before it was set; anything they queue is then
+    // written by its last drain. Both sides use full barriers, so either
+    // the call sees Exiting or Shutdown sees the count.
+    ActiveProducers.ExchangeAdd_Sync(1);
+    if (!Exiting && pWriter)
+        logQueued(messageId, fmt, argList);
+    else
+        writeSynchronous(messageId, fmt, argList);
+    ActiveProducers.ExchangeAdd_Sync(-1);
+}
+
+void AsyncLog::logQueued(LogMessageId messageId, const char* fmt, va_list argList)
+{
+    if (messageId.GetMessageType() == LogMessage_Assert)
+    {
+        Flush();
+        writeSynchronous(messageId, fmt, argList);
+        return;
+    }
+
+    UByte           args[AsyncLog_PackBufferSize];
+    AsyncLog_Packer packer(args, sizeof(args));
+    va_list         argCopy;
+    va_copy(argCopy, argList);
+    bool            packed = AsyncLog_PackArgs(packer, fmt, argCopy);
+    va_end(argCopy);
+
+    Ring* pring = packed ? getThreadRing() : 0;
+    if (!pring || AsyncLog_RecordHeaderSize() + packer.GetSize() + SFstrlen(fmt) + 8 > pring->Mask / 2)
+    {
+        writeSynchronous(messageId, fmt, argList);
+        return;
+    }
+
+    bool blocked = false;
+    for (;;)
+    {
+        bool queued;
+        if (pring == pSharedRing)
+        {
+            Lock::Locker lock(&RingLock);
+            queued = enqueue(pring, messageId, fmt, args, packer.GetSize());
+        }
+        else
+            queued = enqueue(pring, messageId, fmt, args, packer.GetSize());
+
+        if (queued)
+        {
+            // A wakeup missed here is covered by the writer's FlushInterval
+            // timeout.
+            if (WriterIdle)
+                wakeWriter();
+            return;
+        }
+
+        if (LogParams.Policy == Overflow_Drop)
+        {
+            DroppedCount.Increment_NoSync();
+            return;
+        }
+        if (LogParams.Policy == Overflow_Synchronous || Exiting)
+        {
+            writeSynchronous(messageId, fmt, argList);
+            return;
+        }
+
+        if (!blocked)
+        {
+            BlockedCount.Increment_NoSync();
+            blocked = true;
+        }
+        wakeWriter();
+        Mutex::Locker lock(&WriterMutex);
+        // The writer signals after every batch; the timeout only covers a
+        // batch that finished between the enqueue attempt and this wait.
+        SpaceOrWritten.Wait(&WriterMutex, 1);
+    }
+}
+
+unsigned AsyncLog::drainRings()
+{
+    ArrayStaticBuffPOD<DrainCursor, 32> cursors;
+    {
+        Lock::Locker lock(&RingLock);
+        for (UPInt i = 0; i < Rings.GetSize(); i++)
+        {
+            DrainCursor c;
+            c.pRing = Rings[i];
+            c.Head  = c.pRing->Head;
+            c.Tail  = c.pRing->Tail.Load_Acquire();
+            if (c.Head != c.Tail)
+                cursors.PushBack(c);
+        }
+    }
+
+    // Only records queued before the pass started are written, so a busy
+    // producer can't keep the pass going.
+    char     text[MaxLogBufferMessageSize];
+    unsigned count = 0;
+    for (;;)
+    {
+        DrainCursor*     pnext    = 0;
+        AsyncLog_Record* pnextRec = 0;
+        for (UPInt i = 0; i < cursors.GetSize(); i++)
+        {
+            DrainCursor&     c    = cursors[i];
+            AsyncLog_Record* prec = 0;
+            while (c.Head != c.Tail)
+            {
+                prec = (AsyncLog_Record*)(c.pRing->pData + (c.Head & c.pRing->Mask));
+                if (!(prec->Size & AsyncLog_PadFlag))
+                    break;
+                c.Head += prec->Size & ~AsyncLog_PadFlag;
+                prec = 0;
+            }
+            if (!prec)
+                continue;
+            if (!pnextRec || (SInt32)(prec->Sequence - pnextRec->Sequence) < 0)
+            {
+                pnext    = &c;
+                pnextRec = prec;
+            }
+        }
+        if (!pnext)
+            break;
+
+        const UByte* pargs = (const UByte*)pnextRec + AsyncLog_RecordHeaderSize();
+        const char*  fmt   = pnextRec->pFormat ? pnextRec->pFormat
+                                               : (const char*)(pargs + pnextRec->ArgsSize);
+        FormatRecord(text, sizeof(text), fmt, pargs, pnextRec->ArgsSize);
+        writeText(LogMessageId(pnextRec->MessageId), text);
+
+        pnext->Head += pnextRec->Size;
+        pnext->pRing->Head.Store_Release(pnext->Head);
+        count++;
+    }
+
+    // Publish skipped padding as well.
+    for (UPInt i = 0; i < cursors.GetSize(); i++)
+    {
+        if (cursors[i].pRing->Head != cursors[i].Head)
+            cursors[i].pRing->Head.Store_Release(cursors[i].Head);
+    }
+    return count;
+}
+
+void AsyncLog::writerLoop()
+{
+    for (;;)
+    {
+        unsigned count = drainRings();
+
+        Mutex::Locker lock(&WriterMutex);
+        if (count)
+        {
+            BatchCount++;
+            if (count > MaxBatch)
+                MaxBatch = count;
+            SpaceOrWritten.NotifyAll();
+            continue;
+        }
+        if (Exiting)
+            break;
+
+        if (!WakeRequested)
+        {
+            WriterIdle = true;
+            WriterWake.Wait(&WriterMutex, LogParams.FlushInterval);
+            WriterIdle = false;
+        }
+        WakeRequested = false;
+    }
+}
+
+void AsyncLog::Flush()
+{
+    if (!pWriter)
+        return;
+
+    ArrayStaticBuffPOD<Ring*, 32>  rings;
+    ArrayStaticBuffPOD<UInt32, 32> tails;
+    {
+        Lock::Locker lock(&RingLock);
+        for (UPInt i = 0; i < Rings.GetSize(); i++)
+        {
+            rings.PushBack(Rings[i]);
+            tails.PushBack(Rings[i]->Tail.Load_Acquire());
+        }
+    }
+
+    wakeWriter();
+    Mutex::Locker lock(&WriterMutex);
+    for (UPInt i = 0; i < rings.GetSize(); )
+    {
+        if ((SInt32)(rings[i]->Head.Load_Acquire() - tails[i]) >= 0)
+            i++;
+        else
+            SpaceOrWritten.Wait(&WriterMutex, LogParams.FlushInterval);
+    }
+}
+
+void AsyncLog::Shutdown()
+{
+    if (!pWriter)
+        return;
+
+    Flush();
+    Exiting = true;
+    // Calls that missed Exiting finish queueing (or, if blocked on a full
+    // ring, see Exiting and write synchronously) while the writer still
+    // runs; later calls write synchronously.
+    while (ActiveProducers.ExchangeAdd_Sync(0) != 0)
+        Thread::MSleep(1);
+    {
+        Mutex::Locker lock(&WriterMutex);
+        WriterWake.NotifyAll();
+    }
+    pWriter->Wait();
+    pWriter = 0;
+
+    // Write what the writer's last pass didn't see. The rings are freed by
+    // the destructor, since threads may still hold them.
+    drainRings();
+}
+
+#endif // SF_ENABLE_THREADS
+
+} // Scaleform
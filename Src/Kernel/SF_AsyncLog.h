@@ -0,0 +1,174 @@
+/**************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   SF_AsyncLog.h
+Content     :   Log that formats and writes messages on a background
+                thread
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Kernel_AsyncLog_H
+#define INC_SF_Kernel_AsyncLog_H
+
+#include "SF_Log.h"
+#include "SF_Atomic.h"
+#include "SF_Threads.h"
+#include "SF_Array.h"
+
+namespace Scaleform {
+
+// ***** AsyncLog
+
+// AsyncLog moves message formatting and output off the logging thread.
+// Install it in place of a Log (with SetGlobalLog, Loader::SetLog, etc.)
+// and give it the Log that should do the actual writing.
+//
+// LogMessageVarg only scans the format string to find the argument types,
+// and copies the message id, the format string pointer and the packed
+// arguments (strings are copied) into a ring buffer owned by the calling
+// thread. A writer thread drains the rings in batches, formats each record
+// and passes the text to the target log as "%s", so the target adds its
+// usual prefix and newline. Records are written in the order they were
+// logged, as far as the writer can see: a record still being copied on
+// one thread may be written after a later one from another thread.
+//
+// The format string must stay valid until the record is written, which
+// holds for string literals. Set Params::CopyFormat if formats are built
+// at run time. Formats the packer doesn't handle (%n, wide strings) are
+// formatted on the calling thread instead. Assert messages flush the
+// queue and are written synchronously, since the program is likely about
+// to stop.
+//
+// Without SF_ENABLE_THREADS all messages are passed straight to the
+// target.
+
+class AsyncLog : public Log
+{
+public:
+
+    // What LogMessageVarg does when the calling thread's ring is full.
+    enum OverflowPolicy
+    {
+        // Wait for the writer to make room. Nothing is lost, but a slow
+        // target slows down the logging threads.
+        Overflow_Block,
+        // Discard the message and count it in Stats::Dropped.
+        Overflow_Drop,
+        // Format and write the message on the calling thread. Nothing is
+        // lost and no thread waits, but the message may be written ahead
+        // of earlier queued ones.
+        Overflow_Synchronous
+    };
+
+    struct Params
+    {
+        OverflowPolicy  Policy;
+        UPInt           RingSize;       // Bytes per thread ring; rounded up to a power of two.
+        unsigned        MaxRings;       // Threads past this share one locked ring.
+        unsigned        FlushInterval;  // Writer wakes at least this often (ms) while idle.
+        bool            CopyFormat;     // Copy format strings into records.
+
+        Params(OverflowPolicy policy = Overflow_Block)
+            : Policy(policy), RingSize(64 * 1024), MaxRings(32),
+              FlushInterval(50), CopyFormat(false)
+        { }
+    };
+
+    struct Stats
+    {
+        unsigned    Records;        // Messages queued.
+        unsigned    Dropped;        // Messages discarded by Overflow_Drop.
+        unsigned    Synchronous;    // Messages written on the calling thread.
+        unsigned    Blocked;        // Times a thread waited for ring space.
+        unsigned    Batches;        // Writer passes that wrote at least one record.
+        unsigned    MaxBatch;       // Most records written in one pass.
+    };
+
+    AsyncLog(Log* ptarget, const Params& params = Params());
+    virtual ~AsyncLog();
+
+    virtual void    LogMessageVarg(LogMessageId messageId, const char* fmt, va_list argList);
+
+    // Waits until every message logged before the call has been written.
+    void            Flush();
+
+    // Flushes and stops the writer thread; later messages are written
+    // synchronously. Called by the destructor. Messages logged on other
+    // threads while Shutdown runs are either written before it returns or
+    // written synchronously; none are lost.
+    void            Shutdown();
+
+    Log*            GetTarget() const           { return pTarget; }
+    void            GetStats(Stats* pstats) const;
+
+    // Formats a packed record into buffer; used by the writer. Exposed for
+    // tools that store records (such as capture files).
+    static UPInt    FormatRecord(char* buffer, UPInt bufferSize, const char* fmt,
+                                 const UByte* pargs, UPInt argsSize);
+
+private:
+    struct Ring;
+    class  WriterThread;
+    friend class WriterThread;
+
+    // A ring's read position during one drainRings pass. Declared here
+    // rather than in drainRings because C++98 doesn't allow local types
+    // as template arguments.
+    struct DrainCursor
+    {
+        Ring*   pRing;
+        UInt32  Head;
+        UInt32  Tail;
+    };
+
+    Ring*           getThreadRing();
+    Ring*           createRing();
+    bool            enqueue(Ring* pring, LogMessageId messageId, const char* fmt,
+                            const UByte* pargs, UPInt argsSize);
+    void            logQueued(LogMessageId messageId, const char* fmt, va_list argList);
+    void            writeSynchronous(LogMessageId messageId, const char* fmt, va_list argList);
+    void            writeText(LogMessageId messageId, const char* ptext);
+    // Writes the queued records; returns the number written.
+    unsigned        drainRings();
+    void            writerLoop();
+    void            wakeWriter();
+
+    Ptr<Log>        pTarget;
+    Params          LogParams;
+    UInt32          Serial;         // Tells this instance from earlier ones at the same address.
+    Lock            TargetLock;     // Serializes writes to the target.
+
+#ifdef SF_ENABLE_THREADS
+    Lock                    RingLock;       // Guards Rings and SharedRing's producer side.
+    ArrayLH<Ring*>          Rings;
+    Ring*                   pSharedRing;
+    Ptr<WriterThread>       pWriter;
+
+    Mutex                   WriterMutex;
+    WaitCondition           WriterWake;     // Signaled when records are queued while the writer is idle.
+    WaitCondition           SpaceOrWritten; // Signaled after each batch.
+    volatile bool           WriterIdle;
+    bool                    WakeRequested;  // Set by wakeWriter; keeps the writer from going idle.
+    volatile bool           Exiting;
+    AtomicInt<SInt32>       ActiveProducers; // LogMessageVarg calls in progress.
+#endif
+    AtomicInt<UInt32>       NextSequence;
+
+    AtomicInt<UInt32>       DroppedCount;
+    AtomicInt<UInt32>       SynchronousCount;
+    AtomicInt<UInt32>       BlockedCount;
+    unsigned                BatchCount;
+    unsigned                MaxBatch;
+};
+
+} // Scaleform
+
+#endif // INC_SF_Kernel_AsyncLog_H
@@ -19,6 +19,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 #include "SF_Types.h"
 #include "SF_Timer.h"
+#include "SF_Trace.h"
 
 namespace Scaleform {
 
@@ -157,6 +158,7 @@ public:
     
     void        Init()  { }
     void        Increment(UPInt, UPInt ) { }
+    void        Set(UPInt, UPInt, UPInt) { }
     MemoryStat& operator += (MemoryStat& )   { return *this; }
     MemoryStat& operator -= (MemoryStat& )   { return *this; }
 
@@ -211,6 +213,14 @@ public:
         AllocCount++;        
     }
 
+    // Sets totals computed elsewhere, such as by ThreadMemoryStats.
+    void    Set(UPInt allocated, UPInt used, UPInt allocCount)
+    {
+        Allocated = allocated;
+        Used      = used;
+        AllocCount= allocCount;
+    }
+
 
     MemoryStat& operator += (MemoryStat& other)
     {
@@ -315,7 +325,26 @@ public:
     class ScopeTimer
     {           
     public:
-        ScopeTimer(TimerStat*) { }
+        ScopeTimer(TimerStat*) { SF_TRACE_CODE(pTraceName = 0); }
+        ScopeTimer(TimerStat*, const char* traceName)
+        {
+#ifdef SF_ENABLE_TRACE
+            pTraceName = traceName;
+            if (pTraceName)
+                Trace::Record(Trace::Event_Begin, TraceCat_Timer, pTraceName);
+#else
+            SF_UNUSED(traceName);
+#endif
+        }
+#ifdef SF_ENABLE_TRACE
+        ~ScopeTimer()
+        {
+            if (pTraceName)
+                Trace::Record(Trace::Event_End, TraceCat_Timer, pTraceName);
+        }
+    private:
+        const char* pTraceName;
+#endif
     };
 
     UInt64 GetTicks() const         { return 0; }  
@@ -383,22 +412,45 @@ public:
     }
 
 
-    // Scope used for timer measurements.
+    // Scope used for timer measurements. If a trace name is given,
+    // the scope is also recorded in the timeline trace (see SF_Trace.h).
     class ScopeTimer
     {
         TimerStat*  pTimer;
         UInt64      StartTicks;
+#ifdef SF_ENABLE_TRACE
+        const char* pTraceName;
+#endif
     public:
      
         ScopeTimer(TimerStat* ptimer)
             : pTimer(ptimer)
         {
+#ifdef SF_ENABLE_TRACE
+            pTraceName = 0;
+#endif
+            StartTicks = Timer::GetProfileTicks();
+        }
+        ScopeTimer(TimerStat* ptimer, const char* traceName)
+            : pTimer(ptimer)
+        {
+#ifdef SF_ENABLE_TRACE
+            pTraceName = traceName;
+            if (pTraceName)
+                Trace::Record(Trace::Event_Begin, TraceCat_Timer, pTraceName);
+#else
+            SF_UNUSED(traceName);
+#endif
             StartTicks = Timer::GetProfileTicks();
         }
         ~ScopeTimer()
         {
             UInt64 endTicks = Timer::GetProfileTicks();
             pTimer->AddTicks(endTicks - StartTicks);
+#ifdef SF_ENABLE_TRACE
+            if (pTraceName)
+                Trace::Record(Trace::Event_End, TraceCat_Timer, pTraceName);
+#endif
         }
     };
 
@@ -0,0 +1,319 @@
+/**************************************************************************
+
+Filename    :   SF_ThreadStats.cpp
+Content     :   Lock-free per-thread memory statistics counters
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "SF_ThreadStats.h"
+#include "SF_Memory.h"
+#include "SF_Std.h"
+
+#ifdef SF_ENABLE_STATS
+
+// Thread numbers are kept in thread-local storage. Compilers without it
+// count every thread in the shared block.
+#if defined(SF_CC_MSVC)
+#define SF_THREADSTATS_THREAD_LOCAL __declspec(thread)
+#elif defined(SF_CC_GNU) || defined(SF_CC_CLANG)
+#define SF_THREADSTATS_THREAD_LOCAL __thread
+#endif
+
+// Numbers of exited threads are handed out again, which takes a callback
+// on thread exit: a fiber-local storage callback on Windows, a
+// thread-specific key destructor elsewhere.
+#if defined(SF_THREADSTATS_THREAD_LOCAL) && defined(SF_ENABLE_THREADS)
+#if defined(SF_OS_WIN32)
+#include <windows.h>
+#define SF_THREADSTATS_RECYCLE
+#elif defined(SF_OS_LINUX) || defined(SF_OS_MAC) || defined(SF_OS_ANDROID)
+#include <pthread.h>
+#define SF_THREADSTATS_RECYCLE
+#endif
+#endif
+
+namespace Scaleform {
+
+namespace {
+
+// Stat id to counter slot map, shared by all instances. Entries hold the
+// slot + 1, or 0 if the id has no slot yet; slot 0 is Stat_Default_Mem,
+// which also collects the ids that didn't get a slot.
+volatile UInt32         ThreadStats_SlotTable[Stat_MaxId];
+unsigned                ThreadStats_SlotIds[Stat_EntryCount] = { Stat_Default_Mem };
+volatile unsigned       ThreadStats_SlotCount = 1;
+Lock                    ThreadStats_SlotLock;
+
+#ifdef SF_THREADSTATS_THREAD_LOCAL
+// Thread number + 1; 0 if not numbered yet.
+SF_THREADSTATS_THREAD_LOCAL unsigned ThreadStats_ThreadIndex = 0;
+
+// Numbers handed out so far, and those of exited threads ready for reuse.
+unsigned                ThreadStats_ThreadCount = 0;
+unsigned                ThreadStats_FreeIndices[ThreadMemoryStats::MaxThreads];
+unsigned                ThreadStats_FreeCount = 0;
+Lock                    ThreadStats_IndexLock;
+#endif
+
+#ifdef SF_THREADSTATS_RECYCLE
+
+// Called on the exiting thread with its number + 1. Its block keeps the
+// counts, so the totals are unaffected; the next thread given the number
+// adds to them. Anything the thread frees from here on, such as in other
+// exit callbacks, is counted in the shared block.
+#if defined(SF_OS_WIN32)
+void WINAPI ThreadStats_OnThreadExit(void* pvalue)
+#else
+void ThreadStats_OnThreadExit(void* pvalue)
+#endif
+{
+    if (!pvalue)
+        return;
+    ThreadStats_ThreadIndex = ThreadMemoryStats::MaxThreads + 1;
+
+    Lock::Locker lock(&ThreadStats_IndexLock);
+    ThreadStats_FreeIndices[ThreadStats_FreeCount++] = (unsigned)((UPInt)pvalue - 1);
+}
+
+#if defined(SF_OS_WIN32)
+DWORD                   ThreadStats_ExitKey   = FLS_OUT_OF_INDEXES;
+inline bool ThreadStats_RegisterExit(unsigned index)
+{
+    if (ThreadStats_ExitKey == FLS_OUT_OF_INDEXES)
+        ThreadStats_ExitKey = FlsAlloc(ThreadStats_OnThreadExit);
+    return (ThreadStats_ExitKey != FLS_OUT_OF_INDEXES) &&
+           FlsSetValue(ThreadStats_ExitKey, (void*)(UPInt)(index + 1));
+}
+#else
+pthread_key_t           ThreadStats_ExitKey;
+bool                    ThreadStats_ExitKeyValid = false;
+inline bool ThreadStats_RegisterExit(unsigned index)
+{
+    if (!ThreadStats_ExitKeyValid)
+        ThreadStats_ExitKeyValid = (pthread_key_create(&ThreadStats_ExitKey, ThreadStats_OnThreadExit) == 0);
+    return ThreadStats_ExitKeyValid &&
+           (pthread_setspecific(ThreadStats_ExitKey, (void*)(UPInt)(index + 1)) == 0);
+}
+#endif
+
+#endif // SF_THREADSTATS_RECYCLE
+
+unsigned ThreadStats_AllocSlot(unsigned statId)
+{
+    Lock::Locker lock(&ThreadStats_SlotLock);
+    unsigned entry = ThreadStats_SlotTable[statId];
+    if (entry)
+        return entry - 1;
+
+    unsigned slot = 0;
+    if (ThreadStats_SlotCount < Stat_EntryCount)
+    {
+        slot = ThreadStats_SlotCount;
+        ThreadStats_SlotIds[slot] = statId;
+        AtomicOps<unsigned>::Store_Release(&ThreadStats_SlotCount, slot + 1);
+    }
+    AtomicOps<UInt32>::Store_Release(&ThreadStats_SlotTable[statId], slot + 1);
+    return slot;
+}
+
+inline unsigned ThreadStats_GetSlot(unsigned statId)
+{
+    if (statId >= Stat_MaxId || statId == Stat_Default_Mem)
+        return 0;
+    unsigned entry = AtomicOps<UInt32>::Load_Acquire(&ThreadStats_SlotTable[statId]);
+    return entry ? entry - 1 : ThreadStats_AllocSlot(statId);
+}
+
+#ifdef SF_THREADSTATS_THREAD_LOCAL
+// Numbers the calling thread, reusing the number of an exited thread if
+// there is one. Threads whose exit can't be detected keep their number.
+unsigned ThreadStats_AllocThreadIndex()
+{
+    Lock::Locker lock(&ThreadStats_IndexLock);
+    unsigned index;
+    if (ThreadStats_FreeCount)
+        index = ThreadStats_FreeIndices[--ThreadStats_FreeCount];
+    else if (ThreadStats_ThreadCount < ThreadMemoryStats::MaxThreads)
+        index = ThreadStats_ThreadCount++;
+    else
+        return ThreadMemoryStats::MaxThreads;
+
+#ifdef SF_THREADSTATS_RECYCLE
+    if (!ThreadStats_RegisterExit(index))
+    {
+        // Without the callback the number would be lost when the thread
+        // exits; give this thread the shared block instead.
+        ThreadStats_FreeIndices[ThreadStats_FreeCount++] = index;
+        return ThreadMemoryStats::MaxThreads;
+    }
+#endif
+    return index;
+}
+#endif
+
+// Returns the calling thread's block index, MaxThreads for the shared one.
+inline unsigned ThreadStats_GetThreadIndex()
+{
+#ifdef SF_THREADSTATS_THREAD_LOCAL
+    unsigned index = ThreadStats_ThreadIndex;
+    if (!index)
+    {
+        index = ThreadStats_AllocThreadIndex() + 1;
+        ThreadStats_ThreadIndex = index;
+    }
+    return index - 1;
+#else
+    return ThreadMemoryStats::MaxThreads;
+#endif
+}
+
+// Counter sums are modulo 2^N; a negative total can only be a transient
+// state seen by a concurrent reader, so it is reported as zero.
+inline UPInt ThreadStats_Clamp(UPInt value)
+{
+    return ((SPInt)value < 0) ? 0 : value;
+}
+
+} // namespace
+
+
+//------------------------------------------------------------------------
+ThreadMemoryStats::ThreadMemoryStats(MemoryHeap* pheap)
+    : pHeap(pheap)
+{
+}
+
+ThreadMemoryStats::~ThreadMemoryStats()
+{
+    Release();
+}
+
+bool ThreadMemoryStats::hasBlocks() const
+{
+    for (unsigned i = 0; i <= MaxThreads; i++)
+    {
+        if (Blocks[i].Load_Acquire())
+            return true;
+    }
+    return false;
+}
+
+ThreadMemoryStats::Block* ThreadMemoryStats::getBlock(unsigned thread)
+{
+    Block* pblock = Blocks[thread].Load_Acquire();
+    if (pblock)
+        return pblock;
+
+    // Only the shared block can be raced for; the loser frees its copy.
+    MemoryHeap* pheap = pHeap ? pHeap : Memory::GetGlobalHeap();
+    UPInt       size  = sizeof(Block) + CacheLineSize;
+    void*       pmem  = pheap->AllocSysDirect(size);
+    if (!pmem)
+        return 0;
+    memset(pmem, 0, size);
+    pblock = (Block*)(((UPInt)pmem + CacheLineSize - 1) & ~UPInt(CacheLineSize - 1));
+    pblock->pMemory = pmem;
+
+    if (!Blocks[thread].CompareAndSet_Sync(0, pblock))
+    {
+        pheap->FreeSysDirect(pmem, size);
+        pblock = Blocks[thread].Load_Acquire();
+    }
+    return pblock;
+}
+
+void ThreadMemoryStats::update(unsigned statId, UPInt alloc, UPInt use, UPInt count)
+{
+    unsigned thread = ThreadStats_GetThreadIndex();
+    Block*   pblock = getBlock(thread);
+    if (!pblock)
+        return;
+
+    Counter& c = pblock->Counters[ThreadStats_GetSlot(statId)];
+    if (thread < MaxThreads)
+    {
+        // Only this thread writes the block, so plain adds are enough;
+        // readers may see a partial update, which GetStats tolerates.
+        c.Allocated  += alloc;
+        c.Used       += use;
+        c.AllocCount += count;
+    }
+    else
+    {
+        AtomicOps<UPInt>::ExchangeAdd_NoSync(&c.Allocated,  alloc);
+        AtomicOps<UPInt>::ExchangeAdd_NoSync(&c.Used,       use);
+        AtomicOps<UPInt>::ExchangeAdd_NoSync(&c.AllocCount, count);
+    }
+}
+
+bool ThreadMemoryStats::GetStats(StatBag* pbag) const
+{
+    unsigned slotCount = AtomicOps<unsigned>::Load_Acquire(&ThreadStats_SlotCount);
+    bool     result    = true;
+
+    for (unsigned slot = 0; slot < slotCount; slot++)
+    {
+        UPInt allocated = 0, used = 0, allocCount = 0;
+        for (unsigned i = 0; i <= MaxThreads; i++)
+        {
+            const Block* pblock = Blocks[i].Load_Acquire();
+            if (pblock)
+            {
+                const Counter& c = pblock->Counters[slot];
+                allocated  += c.Allocated;
+                used       += c.Used;
+                allocCount += c.AllocCount;
+            }
+        }
+        if (!allocCount && !allocated)
+            continue;
+
+        MemoryStat stat;
+        stat.Set(ThreadStats_Clamp(allocated), ThreadStats_Clamp(used), ThreadStats_Clamp(allocCount));
+        if (!pbag->AddMemoryStat(ThreadStats_SlotIds[slot], stat))
+            result = false;
+    }
+    return result;
+}
+
+void ThreadMemoryStats::GetTotal(MemoryStat* pstat) const
+{
+    UPInt allocated = 0, used = 0, allocCount = 0;
+    for (unsigned i = 0; i <= MaxThreads; i++)
+    {
+        const Block* pblock = Blocks[i].Load_Acquire();
+        if (!pblock)
+            continue;
+        for (unsigned slot = 0; slot < Stat_EntryCount; slot++)
+        {
+            const Counter& c = pblock->Counters[slot];
+            allocated  += c.Allocated;
+            used       += c.Used;
+            allocCount += c.AllocCount;
+        }
+    }
+    pstat->Set(ThreadStats_Clamp(allocated), ThreadStats_Clamp(used), ThreadStats_Clamp(allocCount));
+}
+
+void ThreadMemoryStats::Release()
+{
+    MemoryHeap* pheap = pHeap ? pHeap : Memory::GetGlobalHeap();
+    for (unsigned i = 0; i <= MaxThreads; i++)
+    {
+        Block* pblock = Blocks[i].Exchange_NoSync(0);
+        if (pblock)
+            pheap->FreeSysDirect(pblock->pMemory, sizeof(Block) + CacheLineSize);
+    }
+}
+
+} // Scaleform
+
+#endif // SF_ENABLE_STATS
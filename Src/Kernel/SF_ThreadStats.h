@@ -0,0 +1,134 @@
+/**************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   SF_ThreadStats.h
+Content     :   Lock-free per-thread memory statistics counters
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Kernel_ThreadStats_H
+#define INC_SF_Kernel_ThreadStats_H
+
+#include "SF_Types.h"
+#include "SF_Atomic.h"
+#include "SF_Stats.h"
+
+namespace Scaleform {
+
+class MemoryHeap;
+
+// ***** ThreadMemoryStats
+
+// Per stat id memory accounting for a heap, cheap enough to leave enabled
+// in release builds. MemoryStat values kept in a StatBag must be updated
+// under the heap lock; ThreadMemoryStats instead gives every thread its own
+// block of counters, which only that thread writes, so Increment and
+// Decrement are a thread-local read and three plain adds. The blocks are
+// cache-line aligned, so threads never share a line.
+//
+// Nothing is aggregated until GetStats, which sums the blocks of all
+// threads into a StatBag. The sums are of live memory: a block freed on
+// another thread than the one that allocated it leaves a negative delta in
+// the freeing thread's block, which cancels out in the total. A concurrent
+// GetStats may see an allocation counted in one thread and not yet freed
+// in another, so totals are exact only when the heap is idle.
+//
+// Stat ids are mapped to Stat_EntryCount counter slots, shared by all
+// instances; ids beyond that are counted under Stat_Default_Mem. Threads
+// are numbered on their first update, and the numbers of exited threads
+// are reused, so MaxThreads bounds the threads alive at once rather than
+// those ever created. Threads beyond it (or all threads on compilers
+// without thread-local storage) share one block updated atomically.
+//
+// Blocks are allocated with AllocSysDirect from the heap given to the
+// constructor, so the counters never allocate through the heap they count.
+// Without SF_ENABLE_STATS the class compiles to nothing.
+
+class ThreadMemoryStats
+{
+public:
+    enum
+    {
+        MaxThreads      = 64,
+        CacheLineSize   = 64
+    };
+
+#ifndef SF_ENABLE_STATS
+
+    ThreadMemoryStats(MemoryHeap* = 0) { }
+
+    void    SetHeap(MemoryHeap*)                        { }
+    void    Increment(unsigned, UPInt, UPInt)           { }
+    void    Decrement(unsigned, UPInt, UPInt)           { }
+    bool    GetStats(StatBag*) const                    { return false; }
+    void    GetTotal(MemoryStat*) const                 { }
+    void    Release()                                   { }
+
+#else
+
+    ThreadMemoryStats(MemoryHeap* pheap = 0);
+    ~ThreadMemoryStats();
+
+    // Sets the heap blocks are allocated from. Must be called before the
+    // first update if the constructor wasn't given one.
+    void    SetHeap(MemoryHeap* pheap)                  { SF_ASSERT(!hasBlocks()); pHeap = pheap; }
+
+    // Counts an allocation of alloc requested bytes, taking use bytes of
+    // the heap, and its release.
+    void    Increment(unsigned statId, UPInt alloc, UPInt use)  { update(statId, alloc, use, 1); }
+    void    Decrement(unsigned statId, UPInt alloc, UPInt use)
+    {
+        update(statId, UPInt(0) - alloc, UPInt(0) - use, UPInt(0) - 1);
+    }
+
+    // Adds the totals of every stat id with live allocations to the bag.
+    // Returns false if the bag ran out of space.
+    bool    GetStats(StatBag* pbag) const;
+    // Sums all stat ids into one value.
+    void    GetTotal(MemoryStat* pstat) const;
+
+    // Frees all blocks, dropping the counts. No other thread may be
+    // updating the counters.
+    void    Release();
+
+private:
+    // Values are modulo 2^N, since frees on one thread subtract from
+    // allocations counted on another.
+    struct Counter
+    {
+        volatile UPInt  Allocated;
+        volatile UPInt  Used;
+        volatile UPInt  AllocCount;
+    };
+
+    // Aligned to a cache line within the AllocSysDirect memory at pMemory.
+    struct Block
+    {
+        void*   pMemory;
+        UByte   Pad[CacheLineSize - sizeof(void*)];
+        Counter Counters[Stat_EntryCount];
+    };
+
+    void            update(unsigned statId, UPInt alloc, UPInt use, UPInt count);
+    Block*          getBlock(unsigned thread);
+    bool            hasBlocks() const;
+
+    MemoryHeap*     pHeap;
+    // Indexed by thread number; the last entry is shared by the threads
+    // that have no number.
+    AtomicPtr<Block> Blocks[MaxThreads + 1];
+
+#endif // SF_ENABLE_STATS
+};
+
+} // Scaleform
+
+#endif // INC_SF_Kernel_ThreadStats_H
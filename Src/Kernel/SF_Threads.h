@@ -979,6 +979,246 @@ ThreadId GetCurrentThreadId();
 
 #endif // SF_ENABLE_THREADS
 
+
+
+// ***** AdaptiveLock
+
+// AdaptiveLock is a mutual-exclusion lock for short critical sections
+// that may be contended. An uncontended DoLock/Unlock pair is one
+// compare-and-set and one exchange, without entering the OS. A contended
+// DoLock first spins with exponential backoff, since the owner is
+// likely to release the lock soon, and only then parks the thread: on a
+// futex on Linux, with WaitOnAddress on Windows 8 and later, and by
+// sleeping for a millisecond elsewhere.
+//
+// Unlike Lock, AdaptiveLock is NOT recursive and cannot be waited on.
+// Contention is counted for profiling; the counters are only touched on
+// the slow path.
+
+class AdaptiveLock
+{
+public:
+    enum { DefaultSpinCount = 100 };
+
+    struct Stats
+    {
+        unsigned    Contended;      // DoLock calls that found the lock taken.
+        unsigned    SpinAcquires;   // Contended calls that acquired it while spinning.
+        unsigned    Parks;          // Times a thread was parked.
+    };
+
+#if !defined(SF_ENABLE_THREADS)
+
+    AdaptiveLock(unsigned = DefaultSpinCount) { }
+    void    DoLock()                { }
+    bool    TryLock()               { return true; }
+    void    Unlock()                { }
+    void    GetStats(Stats* pstats) const { pstats->Contended = pstats->SpinAcquires = pstats->Parks = 0; }
+    void    ResetStats()            { }
+
+#else
+
+    // spinCount is the number of backoff rounds before parking.
+    AdaptiveLock(unsigned spinCount = DefaultSpinCount)
+        : SpinCount(spinCount)
+    { State.Value = 0; ResetStats(); }
+    ~AdaptiveLock()
+    { SF_ASSERT(State.Value == 0); }
+
+    void    DoLock()
+    {
+        if (!State.CompareAndSet_Acquire(0, Lock_Locked))
+            lockSlow();
+    }
+    bool    TryLock()
+    {
+        return State.CompareAndSet_Acquire(0, Lock_Locked);
+    }
+    void    Unlock()
+    {
+        if (State.Exchange_Release(0) == Lock_Waiters)
+            wakeWaiter();
+    }
+
+    void    GetStats(Stats* pstats) const;
+    void    ResetStats();
+
+private:
+    enum
+    {
+        Lock_Locked     = 1,
+        Lock_Waiters    = 2     // Locked, and threads may be parked.
+    };
+
+    void    lockSlow();
+    void    wakeWaiter();
+
+    AtomicInt<SInt32>   State;
+    unsigned            SpinCount;
+    AtomicInt<UInt32>   ContendedCount;
+    AtomicInt<UInt32>   SpinAcquireCount;
+    AtomicInt<UInt32>   ParkCount;
+
+#endif
+
+public:
+    class Locker
+    {
+    public:
+        AdaptiveLock* pLock;
+        Locker(AdaptiveLock* plock)
+        { pLock = plock; pLock->DoLock(); }
+        ~Locker()
+        { pLock->Unlock(); }
+    };
+
+private:
+    AdaptiveLock(const AdaptiveLock&);
+    AdaptiveLock& operator = (const AdaptiveLock&);
+};
+
+
+
+// ***** ReadWriteLock
+
+// ReadWriteLock lets any number of readers hold the lock together, or
+// one writer alone, for structures that are looked up far more often
+// than they are changed. Shared and exclusive acquisition both take a
+// single compare-and-set when uncontended. Writers are preferred: once a
+// writer is waiting, new readers wait too, so a steady stream of
+// lookups can't starve an update.
+//
+// Contended acquisitions spin with backoff like AdaptiveLock, then park
+// the same way. The lock is not recursive, and a reader
+// can't upgrade to a writer.
+
+class ReadWriteLock
+{
+public:
+    enum { DefaultSpinCount = 100 };
+
+    struct Stats
+    {
+        unsigned    ContendedReads;     // LockShared calls that had to wait.
+        unsigned    ContendedWrites;    // LockExclusive calls that had to wait.
+        unsigned    Parks;              // Times a reader or writer was parked.
+    };
+
+#if !defined(SF_ENABLE_THREADS)
+
+    ReadWriteLock(unsigned = DefaultSpinCount) { }
+    void    LockShared()            { }
+    bool    TryLockShared()         { return true; }
+    void    UnlockShared()          { }
+    void    LockExclusive()         { }
+    bool    TryLockExclusive()      { return true; }
+    void    UnlockExclusive()       { }
+    void    GetStats(Stats* pstats) const { pstats->ContendedReads = pstats->ContendedWrites = pstats->Parks = 0; }
+    void    ResetStats()            { }
+
+#else
+
+    ReadWriteLock(unsigned spinCount = DefaultSpinCount)
+        : SpinCount(spinCount)
+    {
+        State.Value = 0;
+        WritersWaiting.Value = ReadersWaiting.Value = 0;
+        ReaderSeq.Value = WriterSeq.Value = 0;
+        ResetStats();
+    }
+    ~ReadWriteLock()
+    { SF_ASSERT(State.Value == 0); }
+
+    void    LockShared()
+    {
+        if (!TryLockShared())
+            lockSharedSlow();
+    }
+    bool    TryLockShared()
+    {
+        SInt32 s = State;
+        return !(s & State_Writer) && (WritersWaiting.Value == 0) &&
+               State.CompareAndSet_Acquire(s, s + 1);
+    }
+    void    UnlockShared()
+    {
+        SF_ASSERT((State.Value & State_ReaderMask) != 0);
+        if (State.ExchangeAdd_Sync(-1) == 1 && WritersWaiting != 0)
+            wakeWriter();
+    }
+
+    void    LockExclusive()
+    {
+        if (!TryLockExclusive())
+            lockExclusiveSlow();
+    }
+    bool    TryLockExclusive()
+    {
+        return State.CompareAndSet_Acquire(0, State_Writer);
+    }
+    void    UnlockExclusive()
+    {
+        SF_ASSERT(State.Value == State_Writer);
+        State.Exchange_Sync(0);
+        if (WritersWaiting != 0 || ReadersWaiting != 0)
+            wakeAfterWrite();
+    }
+
+    void    GetStats(Stats* pstats) const;
+    void    ResetStats();
+
+private:
+    enum
+    {
+        State_ReaderMask    = 0x3FFFFFFF,   // Number of readers holding the lock.
+        State_Writer        = 0x40000000
+    };
+
+    void    lockSharedSlow();
+    void    lockExclusiveSlow();
+    void    wakeWriter();
+    void    wakeAfterWrite();
+
+    AtomicInt<SInt32>   State;
+    AtomicInt<SInt32>   WritersWaiting;
+    AtomicInt<SInt32>   ReadersWaiting;
+    // Bumped on every wake, so a thread that saw the lock taken can park
+    // on the value it read and never miss the release.
+    AtomicInt<SInt32>   ReaderSeq;
+    AtomicInt<SInt32>   WriterSeq;
+    unsigned            SpinCount;
+    AtomicInt<UInt32>   ContendedReadCount;
+    AtomicInt<UInt32>   ContendedWriteCount;
+    AtomicInt<UInt32>   ParkCount;
+
+#endif
+
+public:
+    class ReadLocker
+    {
+    public:
+        ReadWriteLock* pLock;
+        ReadLocker(ReadWriteLock* plock)
+        { pLock = plock; pLock->LockShared(); }
+        ~ReadLocker()
+        { pLock->UnlockShared(); }
+    };
+
+    class WriteLocker
+    {
+    public:
+        ReadWriteLock* pLock;
+        WriteLocker(ReadWriteLock* plock)
+        { pLock = plock; pLock->LockExclusive(); }
+        ~WriteLocker()
+        { pLock->UnlockExclusive(); }
+    };
+
+private:
+    ReadWriteLock(const ReadWriteLock&);
+    ReadWriteLock& operator = (const ReadWriteLock&);
+};
+
 } // Scaleform
 
 #endif // INC_SF_Kernel_Threads_H
@@ -0,0 +1,290 @@
+/**************************************************************************
+
+Filename    :   SF_ThreadsLock.cpp
+Content     :   Adaptive spinning lock and reader-writer lock
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "SF_Threads.h"
+
+#ifdef SF_ENABLE_THREADS
+
+#if defined(SF_OS_LINUX)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#define SF_THREADSLOCK_FUTEX
+#elif defined(SF_OS_WIN32)
+#include <windows.h>
+#define SF_THREADSLOCK_WAITONADDRESS
+#endif
+
+#if defined(SF_CPU_X86) || defined(SF_CPU_X86_64)
+#include <emmintrin.h>
+#endif
+
+namespace Scaleform {
+
+namespace {
+
+// Backoff doubles the pause count each round up to this many pauses,
+// roughly a microsecond on current hardware.
+const unsigned ThreadsLock_MaxPause = 64;
+
+inline void ThreadsLock_Pause(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+#if defined(SF_CPU_X86) || defined(SF_CPU_X86_64)
+        _mm_pause();
+#elif defined(SF_CPU_ARM) && (defined(SF_CC_GNU) || defined(SF_CC_CLANG))
+        __asm__ __volatile__("yield");
+#endif
+    }
+}
+
+#if defined(SF_THREADSLOCK_WAITONADDRESS)
+
+// WaitOnAddress is the Windows counterpart of a futex. It is looked up at
+// run time, since it only exists from Windows 8 on; without it waiters
+// fall back to sleeping.
+struct ThreadsLock_AddressWait
+{
+    typedef BOOL (WINAPI *WaitFn)(volatile VOID* paddr, PVOID pcompare, SIZE_T size, DWORD ms);
+    typedef VOID (WINAPI *WakeFn)(PVOID paddr);
+
+    WaitFn  pWait;
+    WakeFn  pWakeSingle;
+    WakeFn  pWakeAll;
+
+    ThreadsLock_AddressWait() : pWait(0), pWakeSingle(0), pWakeAll(0)
+    {
+        HMODULE hmodule = ::GetModuleHandleA("kernelbase.dll");
+        if (!hmodule)
+            return;
+        WaitFn pwait       = (WaitFn)::GetProcAddress(hmodule, "WaitOnAddress");
+        WakeFn pwakeSingle = (WakeFn)::GetProcAddress(hmodule, "WakeByAddressSingle");
+        WakeFn pwakeAll    = (WakeFn)::GetProcAddress(hmodule, "WakeByAddressAll");
+        if (pwait && pwakeSingle && pwakeAll)
+        {
+            pWakeSingle = pwakeSingle;
+            pWakeAll    = pwakeAll;
+            pWait       = pwait;
+        }
+    }
+};
+
+// Locks used by static constructors that run before this one find the
+// functions unset and sleep; a waiter that sleeps is never lost, only
+// woken late.
+ThreadsLock_AddressWait ThreadsLock_AddressWaitFns;
+
+#endif
+
+// Blocks while *paddr == value, or until woken. Spurious returns are
+// allowed; callers re-check their condition.
+inline void ThreadsLock_Park(volatile SInt32* paddr, SInt32 value)
+{
+#if defined(SF_THREADSLOCK_FUTEX)
+    syscall(SYS_futex, (int*)paddr, FUTEX_WAIT_PRIVATE, value, (void*)0, (void*)0, 0);
+#else
+#if defined(SF_THREADSLOCK_WAITONADDRESS)
+    if (ThreadsLock_AddressWaitFns.pWait)
+    {
+        ThreadsLock_AddressWaitFns.pWait(paddr, &value, sizeof(value), INFINITE);
+        return;
+    }
+#endif
+    // Without a futex, park by sleeping; the spin phase has already
+    // handled short holds.
+    if (*paddr == value)
+        Thread::MSleep(1);
+#endif
+}
+
+inline void ThreadsLock_Wake(volatile SInt32* paddr, int count)
+{
+#if defined(SF_THREADSLOCK_FUTEX)
+    syscall(SYS_futex, (int*)paddr, FUTEX_WAKE_PRIVATE, count, (void*)0, (void*)0, 0);
+#elif defined(SF_THREADSLOCK_WAITONADDRESS)
+    if (count == 1)
+    {
+        if (ThreadsLock_AddressWaitFns.pWakeSingle)
+            ThreadsLock_AddressWaitFns.pWakeSingle((PVOID)paddr);
+    }
+    else if (ThreadsLock_AddressWaitFns.pWakeAll)
+        ThreadsLock_AddressWaitFns.pWakeAll((PVOID)paddr);
+#else
+    SF_UNUSED2(paddr, count);
+#endif
+}
+
+} // namespace
+
+
+// ***** AdaptiveLock
+
+// State is 0 when free, Lock_Locked when held, and Lock_Waiters when held
+// with threads that may be parked on it; Unlock only makes the wake call
+// in the last case.
+
+void AdaptiveLock::lockSlow()
+{
+    ContendedCount.Increment_NoSync();
+
+    unsigned pause = 1;
+    for (unsigned i = 0; i < SpinCount; i++)
+    {
+        ThreadsLock_Pause(pause);
+        if (pause < ThreadsLock_MaxPause)
+            pause *= 2;
+        if (State.Value == 0 && State.CompareAndSet_Acquire(0, Lock_Locked))
+        {
+            SpinAcquireCount.Increment_NoSync();
+            return;
+        }
+    }
+
+    // Mark the lock as having waiters before parking. A thread taking it
+    // here also keeps the mark, since others may still be parked.
+    while (State.Exchange_Acquire(Lock_Waiters) != 0)
+    {
+        ParkCount.Increment_NoSync();
+        ThreadsLock_Park(&State.Value, Lock_Waiters);
+    }
+}
+
+void AdaptiveLock::wakeWaiter()
+{
+    ThreadsLock_Wake(&State.Value, 1);
+}
+
+void AdaptiveLock::GetStats(Stats* pstats) const
+{
+    pstats->Contended    = ContendedCount;
+    pstats->SpinAcquires = SpinAcquireCount;
+    pstats->Parks        = ParkCount;
+}
+
+void AdaptiveLock::ResetStats()
+{
+    ContendedCount   = 0;
+    SpinAcquireCount = 0;
+    ParkCount        = 0;
+}
+
+
+// ***** ReadWriteLock
+
+// Waiters announce themselves in ReadersWaiting/WritersWaiting, then read
+// the sequence word they park on, then re-check State. Releasers change
+// State, then check the waiting counts and bump the sequence before
+// waking. All of these are full barriers, so either the releaser sees the
+// waiter or the waiter sees the release (or the bumped sequence).
+
+void ReadWriteLock::lockSharedSlow()
+{
+    ContendedReadCount.Increment_NoSync();
+
+    unsigned pause = 1;
+    for (unsigned i = 0; i < SpinCount; i++)
+    {
+        ThreadsLock_Pause(pause);
+        if (pause < ThreadsLock_MaxPause)
+            pause *= 2;
+        if (TryLockShared())
+            return;
+    }
+
+    ReadersWaiting.ExchangeAdd_Sync(1);
+    for (;;)
+    {
+        SInt32 seq = ReaderSeq.Load_Acquire();
+        if (TryLockShared())
+            break;
+        SInt32 s = State.Load_Acquire();
+        if ((s & State_Writer) || WritersWaiting != 0)
+        {
+            ParkCount.Increment_NoSync();
+            ThreadsLock_Park(&ReaderSeq.Value, seq);
+        }
+    }
+    ReadersWaiting.ExchangeAdd_Sync(-1);
+}
+
+void ReadWriteLock::lockExclusiveSlow()
+{
+    ContendedWriteCount.Increment_NoSync();
+
+    unsigned pause = 1;
+    for (unsigned i = 0; i < SpinCount; i++)
+    {
+        ThreadsLock_Pause(pause);
+        if (pause < ThreadsLock_MaxPause)
+            pause *= 2;
+        if (State.Value == 0 && TryLockExclusive())
+            return;
+    }
+
+    WritersWaiting.ExchangeAdd_Sync(1);
+    for (;;)
+    {
+        SInt32 seq = WriterSeq.Load_Acquire();
+        if (TryLockExclusive())
+            break;
+        if (State.Load_Acquire() != 0)
+        {
+            ParkCount.Increment_NoSync();
+            ThreadsLock_Park(&WriterSeq.Value, seq);
+        }
+    }
+    // Readers held back by this writer are woken by its UnlockExclusive.
+    WritersWaiting.ExchangeAdd_Sync(-1);
+}
+
+void ReadWriteLock::wakeWriter()
+{
+    WriterSeq.ExchangeAdd_Sync(1);
+    ThreadsLock_Wake(&WriterSeq.Value, 1);
+}
+
+void ReadWriteLock::wakeAfterWrite()
+{
+    // Hand over to the next writer if there is one; otherwise release
+    // all readers at once.
+    if (WritersWaiting != 0)
+    {
+        wakeWriter();
+    }
+    else
+    {
+        ReaderSeq.ExchangeAdd_Sync(1);
+        ThreadsLock_Wake(&ReaderSeq.Value, 0x7FFFFFFF);
+    }
+}
+
+void ReadWriteLock::GetStats(Stats* pstats) const
+{
+    pstats->ContendedReads  = ContendedReadCount;
+    pstats->ContendedWrites = ContendedWriteCount;
+    pstats->Parks           = ParkCount;
+}
+
+void ReadWriteLock::ResetStats()
+{
+    ContendedReadCount  = 0;
+    ContendedWriteCount = 0;
+    ParkCount           = 0;
+}
+
+} // Scaleform
+
+#endif // SF_ENABLE_THREADS
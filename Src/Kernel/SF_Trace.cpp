@@ -0,0 +1,387 @@
+/**************************************************************************
+
+Filename    :   SF_Trace.cpp
+Content     :   Per-thread timeline tracing with Chrome trace export
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "SF_Trace.h"
+
+#ifdef SF_ENABLE_TRACE
+
+#include "SF_Atomic.h"
+#include "SF_Threads.h"
+#include "SF_Timer.h"
+#include "SF_Memory.h"
+#include "SF_HeapNew.h"
+#include "SF_String.h"
+#include "SF_Hash.h"
+#include "SF_File.h"
+#include "SF_Std.h"
+#include <stdlib.h>
+
+// Thread-local storage keeps the per-event cost to a TLS read. Compilers
+// without it fall back to searching the buffer list by thread id.
+#if defined(SF_CC_MSVC)
+#define SF_TRACE_THREAD_LOCAL __declspec(thread)
+#elif defined(SF_CC_GNU) || defined(SF_CC_CLANG)
+#define SF_TRACE_THREAD_LOCAL __thread
+#endif
+
+namespace Scaleform {
+
+namespace {
+
+struct TraceEvent
+{
+    UInt64      Ticks;      // Raw cycle counter.
+    const char* pName;
+    UInt8       Type;
+    UInt8       Category;
+};
+
+struct TraceBuffer
+{
+    TraceBuffer*    pNext;
+    ThreadId        Id;
+    unsigned        Index;
+    const char*     pThreadName;
+    unsigned        Generation;
+    unsigned        Capacity;
+    // Written only by the owning thread; read by the trace writer.
+    volatile UInt32 Count;
+    UInt32          Dropped;
+    TraceEvent*     pEvents;
+    // Set by the owner while it is inside record; Stop and Shutdown wait
+    // for it to clear.
+    volatile UInt32 Busy;
+};
+
+const char* const TraceCategoryNames[TraceCat_Count] =
+{
+    "Timer", "Render", "Task", "Advance", "ActionScript", "User"
+};
+
+typedef Hash<String, const char*, String::HashFunctor> TraceNameHash;
+
+// Buffers are pushed at the head and never removed or freed, so the
+// pointer a thread caches in TLS stays valid across Shutdown and Start.
+// They come from the C heap rather than an SF heap, which would report
+// them as leaks when the memory system shuts down. Shutdown only frees
+// the event arrays, which the owner reallocates on its next record.
+AtomicPtr<TraceBuffer>  Trace_pBuffers;
+AtomicInt<unsigned>     Trace_ThreadCount;
+volatile unsigned       Trace_Generation     = 0;
+volatile unsigned       Trace_EventsPerThread = 64 * 1024;
+UInt64                  Trace_StartTicks     = 0;
+
+Lock                    Trace_NameLock;
+TraceNameHash*          Trace_pNames         = 0;
+
+#ifdef SF_TRACE_THREAD_LOCAL
+SF_TRACE_THREAD_LOCAL TraceBuffer* Trace_pThreadBuffer = 0;
+#endif
+
+TraceBuffer* Trace_FindBuffer(ThreadId id)
+{
+    for (TraceBuffer* p = Trace_pBuffers; p; p = p->pNext)
+    {
+        if (p->Id == id)
+            return p;
+    }
+    return 0;
+}
+
+TraceBuffer* Trace_GetThreadBuffer()
+{
+#ifdef SF_TRACE_THREAD_LOCAL
+    TraceBuffer* pbuffer = Trace_pThreadBuffer;
+    if (pbuffer)
+        return pbuffer;
+#else
+    TraceBuffer* pbuffer = Trace_FindBuffer(GetCurrentThreadId());
+    if (pbuffer)
+        return pbuffer;
+#endif
+
+    pbuffer = (TraceBuffer*)malloc(sizeof(TraceBuffer));
+    if (!pbuffer)
+        return 0;
+    memset(pbuffer, 0, sizeof(TraceBuffer));
+    pbuffer->Id         = GetCurrentThreadId();
+    pbuffer->Index      = (unsigned)Trace_ThreadCount.ExchangeAdd_Sync(1) + 1;
+    // Forces the events to be allocated by the first record.
+    pbuffer->Generation = Trace_Generation - 1;
+
+    TraceBuffer* phead;
+    do {
+        phead = Trace_pBuffers;
+        pbuffer->pNext = phead;
+    } while (!Trace_pBuffers.CompareAndSet_Sync(phead, pbuffer));
+
+#ifdef SF_TRACE_THREAD_LOCAL
+    Trace_pThreadBuffer = pbuffer;
+#endif
+    return pbuffer;
+}
+
+// Waits until no thread is inside record. Recording must already be 0:
+// an owner sets Busy with a full barrier before it checks Recording, so a
+// buffer seen idle here will not be written until recording restarts.
+void Trace_WaitForRecorders()
+{
+    for (TraceBuffer* p = Trace_pBuffers; p; p = p->pNext)
+    {
+        while (AtomicOps<UInt32>::Load_Acquire(&p->Busy))
+            Thread::MSleep(0);
+    }
+}
+
+const char* Trace_InternNameLocked(const char* pname)
+{
+    if (!pname)
+        return 0;
+    if (!Trace_pNames)
+        Trace_pNames = SF_NEW TraceNameHash;
+
+    String key(pname);
+    const char** pfound = Trace_pNames->Get(key);
+    if (pfound)
+        return *pfound;
+
+    UPInt size  = key.GetSize() + 1;
+    char* pcopy = (char*)SF_ALLOC(size, Stat_Default_Mem);
+    memcpy(pcopy, pname, size);
+    Trace_pNames->Add(key, pcopy);
+    return pcopy;
+}
+
+void Trace_WriteString(File* pfile, const char* pstr)
+{
+    pfile->Write((const UByte*)pstr, (int)SFstrlen(pstr));
+}
+
+// Writes pname as a JSON string.
+void Trace_WriteName(File* pfile, const char* pname)
+{
+    char  buf[256];
+    UPInt n = 0;
+    buf[n++] = '"';
+    for (const char* p = pname ? pname : ""; *p; p++)
+    {
+        if (n > sizeof(buf) - 8)
+        {
+            pfile->Write((const UByte*)buf, (int)n);
+            n = 0;
+        }
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\')
+        {
+            buf[n++] = '\\';
+            buf[n++] = (char)c;
+        }
+        else if (c < 0x20)
+            n += SFsprintf(buf + n, sizeof(buf) - n, "\\u%04x", c);
+        else
+            buf[n++] = (char)c;
+    }
+    buf[n++] = '"';
+    pfile->Write((const UByte*)buf, (int)n);
+}
+
+} // namespace
+
+
+// ***** Trace
+
+volatile int Trace::Recording = 0;
+
+void Trace::Start(unsigned eventsPerThread)
+{
+    Trace_EventsPerThread = Alg::Max(eventsPerThread, 16u);
+    Trace_StartTicks      = Timer::GetRawTicks();
+    // Buffers from an older generation are reset by their owner on the
+    // next record, so no other thread's buffer is touched here.
+    AtomicOps<unsigned>::Store_Release(&Trace_Generation, Trace_Generation + 1);
+    AtomicOps<int>::Store_Release(&Recording, 1);
+}
+
+void Trace::Stop()
+{
+    AtomicOps<int>::Exchange_Sync(&Recording, 0);
+    Trace_WaitForRecorders();
+}
+
+void Trace::record(EventType type, TraceCategory category, const char* pname)
+{
+    UInt64       ticks   = Timer::GetRawTicks();
+    TraceBuffer* pbuffer = Trace_GetThreadBuffer();
+    if (!pbuffer)
+        return;
+
+    // Pairs with Stop/Shutdown clearing Recording and then waiting for
+    // Busy: either they see this thread busy and wait, or it sees
+    // Recording cleared here and leaves the buffer alone.
+    AtomicOps<UInt32>::Exchange_Sync(&pbuffer->Busy, 1);
+    if (!Recording)
+    {
+        AtomicOps<UInt32>::Store_Release(&pbuffer->Busy, 0);
+        return;
+    }
+
+    if (pbuffer->Generation != Trace_Generation)
+    {
+        AtomicOps<UInt32>::Store_Release(&pbuffer->Count, 0);
+        pbuffer->Dropped = 0;
+        unsigned capacity = Trace_EventsPerThread;
+        if (!pbuffer->pEvents || pbuffer->Capacity != capacity)
+        {
+            if (pbuffer->pEvents)
+                SF_FREE(pbuffer->pEvents);
+            pbuffer->pEvents  = (TraceEvent*)SF_ALLOC(sizeof(TraceEvent) * capacity, Stat_Default_Mem);
+            pbuffer->Capacity = pbuffer->pEvents ? capacity : 0;
+        }
+        pbuffer->Generation = Trace_Generation;
+    }
+
+    UInt32 count = pbuffer->Count;
+    if (count >= pbuffer->Capacity)
+    {
+        pbuffer->Dropped++;
+        AtomicOps<UInt32>::Store_Release(&pbuffer->Busy, 0);
+        return;
+    }
+
+    TraceEvent& e = pbuffer->pEvents[count];
+    e.Ticks    = ticks;
+    e.pName    = pname;
+    e.Type     = (UInt8)type;
+    e.Category = (UInt8)category;
+    // Publishes the event to the writer.
+    AtomicOps<UInt32>::Store_Release(&pbuffer->Count, count + 1);
+    AtomicOps<UInt32>::Store_Release(&pbuffer->Busy, 0);
+}
+
+void Trace::SetThreadName(const char* pname)
+{
+    TraceBuffer* pbuffer = Trace_GetThreadBuffer();
+    if (!pbuffer)
+        return;
+    // Under the name lock, so Shutdown can't free the name in between.
+    Lock::Locker lock(&Trace_NameLock);
+    pbuffer->pThreadName = Trace_InternNameLocked(pname);
+}
+
+const char* Trace::InternName(const char* pname)
+{
+    Lock::Locker lock(&Trace_NameLock);
+    return Trace_InternNameLocked(pname);
+}
+
+bool Trace::WriteChromeTrace(File* pfile)
+{
+    if (!pfile || !pfile->IsWritable())
+        return false;
+
+    const unsigned generation = Trace_Generation;
+    const Double   mksPerTick = Double(Timer::MksPerSecond) / Double(Timer::GetRawFrequency());
+    char           buf[256];
+    bool           first = true;
+    UInt64         dropped = 0;
+
+    Trace_WriteString(pfile, "{\"traceEvents\":[\n");
+
+    for (TraceBuffer* pbuffer = Trace_pBuffers; pbuffer; pbuffer = pbuffer->pNext)
+    {
+        if (pbuffer->Generation != generation)
+            continue;
+
+        if (pbuffer->pThreadName)
+        {
+            SFsprintf(buf, sizeof(buf), "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                      first ? "" : ",\n", pbuffer->Index);
+            Trace_WriteString(pfile, buf);
+            Trace_WriteName(pfile, pbuffer->pThreadName);
+            Trace_WriteString(pfile, "}}");
+            first = false;
+        }
+
+        const UInt32 count = AtomicOps<UInt32>::Load_Acquire(&pbuffer->Count);
+        for (UInt32 i = 0; i < count; i++)
+        {
+            const TraceEvent& e = pbuffer->pEvents[i];
+            static const char phases[] = { 'B', 'E', 'i' };
+            // Events recorded just before Start may be older than it.
+            Double ts = (e.Ticks > Trace_StartTicks) ? Double(e.Ticks - Trace_StartTicks) * mksPerTick : 0.0;
+
+            SFsprintf(buf, sizeof(buf), "%s{\"ph\":\"%c\",\"cat\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,%s\"name\":",
+                      first ? "" : ",\n", phases[e.Type], TraceCategoryNames[e.Category],
+                      pbuffer->Index, ts, (e.Type == Event_Instant) ? "\"s\":\"t\"," : "");
+            Trace_WriteString(pfile, buf);
+            Trace_WriteName(pfile, e.pName);
+            Trace_WriteString(pfile, "}");
+            first = false;
+        }
+        dropped += pbuffer->Dropped;
+    }
+
+    SFsprintf(buf, sizeof(buf), "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%llu}}\n",
+              (unsigned long long)dropped);
+    Trace_WriteString(pfile, buf);
+    return pfile->GetErrorCode() == 0;
+}
+
+void Trace::GetStats(Stats* pstats)
+{
+    const unsigned generation = Trace_Generation;
+    pstats->Threads       = 0;
+    pstats->Events        = 0;
+    pstats->DroppedEvents = 0;
+    for (TraceBuffer* pbuffer = Trace_pBuffers; pbuffer; pbuffer = pbuffer->pNext)
+    {
+        if (pbuffer->Generation != generation)
+            continue;
+        pstats->Threads++;
+        pstats->Events        += AtomicOps<UInt32>::Load_Acquire(&pbuffer->Count);
+        pstats->DroppedEvents += pbuffer->Dropped;
+    }
+}
+
+void Trace::Shutdown()
+{
+    Stop();
+
+    // Older generations are never written, and their owners reset their
+    // buffers on the next record.
+    AtomicOps<unsigned>::Store_Release(&Trace_Generation, Trace_Generation + 1);
+
+    Lock::Locker lock(&Trace_NameLock);
+    for (TraceBuffer* pbuffer = Trace_pBuffers; pbuffer; pbuffer = pbuffer->pNext)
+    {
+        if (pbuffer->pEvents)
+            SF_FREE(pbuffer->pEvents);
+        pbuffer->pEvents     = 0;
+        pbuffer->Capacity    = 0;
+        pbuffer->pThreadName = 0;
+    }
+
+    if (Trace_pNames)
+    {
+        for (TraceNameHash::Iterator it = Trace_pNames->Begin(); it != Trace_pNames->End(); ++it)
+            SF_FREE((void*)it->Second);
+        delete Trace_pNames;
+        Trace_pNames = 0;
+    }
+}
+
+} // Scaleform
+
+#endif // SF_ENABLE_TRACE
@@ -0,0 +1,156 @@
+/**************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   SF_Trace.h
+Content     :   Per-thread timeline tracing with Chrome trace export
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Kernel_Trace_H
+#define INC_SF_Kernel_Trace_H
+
+#include "SF_Types.h"
+
+namespace Scaleform {
+
+class File;
+
+// ***** Trace
+
+// TimerStat and AMP report totals per frame, but not when or on which
+// thread something ran. Trace records begin/end events into per-thread
+// buffers and writes them out in the Chrome trace event format, which
+// can be opened in chrome://tracing or the Perfetto UI without an AMP
+// client.
+//
+// Tracing is compiled in only with SF_ENABLE_TRACE; otherwise the
+// SF_TRACE_ macros expand to nothing and the Trace functions are not
+// defined, so direct calls belong in SF_TRACE_CODE. When compiled in, nothing is
+// recorded until Trace::Start is called. Recording an event reads the
+// raw cycle counter and appends to a buffer owned by the calling thread,
+// without taking any locks. A thread's buffer is allocated on its first
+// event; events past the buffer size are dropped and counted.
+//
+// Event names are stored as pointers and must stay valid until the trace
+// is written: use string literals, or InternName for names built at run
+// time (e.g. ActionScript function names).
+
+enum TraceCategory
+{
+    TraceCat_Timer,         // Scoped timers (TimerStat, AMP function timers).
+    TraceCat_Render,        // Render thread and HAL.
+    TraceCat_Task,          // TaskManager tasks, loading.
+    TraceCat_Advance,       // Movie Advance.
+    TraceCat_ActionScript,  // ActionScript function calls.
+    TraceCat_User,
+    TraceCat_Count
+};
+
+class Trace
+{
+public:
+    enum EventType
+    {
+        Event_Begin,
+        Event_End,
+        Event_Instant
+    };
+
+    struct Stats
+    {
+        unsigned    Threads;
+        UInt64      Events;
+        UInt64      DroppedEvents;
+    };
+
+    // Starts recording, discarding any previously recorded events.
+    // eventsPerThread is used for buffers allocated from now on.
+    static void         Start(unsigned eventsPerThread = 64 * 1024);
+    // Stops recording and waits for threads in the middle of recording
+    // an event to finish it.
+    static void         Stop();
+    static bool         IsRecording() { return Recording != 0; }
+
+    // Records an event for the calling thread if recording.
+    static void         Record(EventType type, TraceCategory category, const char* pname)
+    {
+        if (Recording)
+            record(type, category, pname);
+    }
+
+    // Names the calling thread in the trace.
+    static void         SetThreadName(const char* pname);
+
+    // Returns a copy of pname that lives until Shutdown; the same pointer
+    // is returned for equal strings. Takes a lock, so callers should
+    // cache the result.
+    static const char*  InternName(const char* pname);
+
+    // Writes all recorded events as Chrome trace JSON. Returns false on
+    // a file error.
+    static bool         WriteChromeTrace(File* pfile);
+
+    static void         GetStats(Stats* pstats);
+
+    // Stops recording and frees the recorded events and interned names.
+    // Threads may keep calling Record; their buffers are reused when
+    // recording restarts. Must not run concurrently with Start or
+    // WriteChromeTrace.
+    static void         Shutdown();
+
+private:
+    static void         record(EventType type, TraceCategory category, const char* pname);
+
+    static volatile int Recording;
+};
+
+
+// Records a begin event on construction and the matching end event on
+// destruction.
+class TraceScope
+{
+public:
+    TraceScope(TraceCategory category, const char* pname)
+        : Category(category), pName(pname)
+    {
+        Trace::Record(Trace::Event_Begin, Category, pName);
+    }
+    ~TraceScope()
+    {
+        Trace::Record(Trace::Event_End, Category, pName);
+    }
+
+private:
+    TraceCategory   Category;
+    const char*     pName;
+};
+
+
+#define SF_TRACE_CONCAT_IMPL(a, b)          a##b
+#define SF_TRACE_CONCAT(a, b)               SF_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef SF_ENABLE_TRACE
+#define SF_TRACE_SCOPE(category, name)      Scaleform::TraceScope SF_TRACE_CONCAT(_sf_trace_scope_, __LINE__)((category), (name))
+#define SF_TRACE_BEGIN(category, name)      Scaleform::Trace::Record(Scaleform::Trace::Event_Begin, (category), (name))
+#define SF_TRACE_END(category, name)        Scaleform::Trace::Record(Scaleform::Trace::Event_End, (category), (name))
+#define SF_TRACE_INSTANT(category, name)    Scaleform::Trace::Record(Scaleform::Trace::Event_Instant, (category), (name))
+#define SF_TRACE_CODE(x) x
+#else
+#define SF_TRACE_SCOPE(category, name)
+#define SF_TRACE_BEGIN(category, name)
+#define SF_TRACE_END(category, name)
+#define SF_TRACE_INSTANT(category, name)
+#define SF_TRACE_CODE(x)
+#endif
+
+} // Scaleform
+
+#endif // INC_SF_Kernel_Trace_H
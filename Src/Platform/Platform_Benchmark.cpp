@@ -0,0 +1,721 @@
+/**************************************************************************
+
+Filename    :   Platform_Benchmark.cpp
+Content     :   Headless benchmark runner for GFx movies with frame time
+                reports and baseline comparison
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Platform_Benchmark.h"
+#include "GFx/GFx_Event.h"
+#include "GFx/GFx_MovieDef.h"
+#include "GFx/GFx_SpriteDef.h"
+#include "GFx/GFx_TimelineKeyframes.h"
+#include "GFx/GFx_MovieAdvanceScheduler.h"
+#include "Render/Render_GlyphCache.h"
+#include "Kernel/SF_SysFile.h"
+#include "Kernel/SF_Timer.h"
+#include "Kernel/SF_Random.h"
+#include "Kernel/SF_Alg.h"
+#include <math.h>
+#include <stdlib.h>
+
+namespace Scaleform { namespace Platform {
+
+using namespace Render;
+
+static const char* const Benchmark_PhaseNames[BenchmarkRunner::Phase_Count] =
+{
+    "frame", "advance", "capture", "next_capture", "display",
+    "seek_replay", "seek_keyframes", "views_serial", "views_scheduled"
+};
+
+//------------------------------------------------------------------------
+// Statistics
+
+static Double Benchmark_Percentile(const ArrayPOD<Double>& sorted, Double p)
+{
+    UPInt count = sorted.GetSize();
+    if (count == 0)
+        return 0;
+    Double pos   = p * Double(count - 1);
+    UPInt  index = (UPInt)pos;
+    if (index + 1 >= count)
+        return sorted[count - 1];
+    Double frac = pos - Double(index);
+    return sorted[index] + (sorted[index + 1] - sorted[index]) * frac;
+}
+
+// Sorts samples in place.
+static void Benchmark_ComputeStats(ArrayPOD<Double>& samples, BenchmarkRunner::PhaseStats* pstats)
+{
+    memset(pstats, 0, sizeof(BenchmarkRunner::PhaseStats));
+    UPInt count = samples.GetSize();
+    if (count == 0)
+        return;
+
+    Alg::QuickSort(samples);
+    Double sum = 0;
+    for (UPInt i = 0; i < count; i++)
+        sum += samples[i];
+
+    pstats->Count  = (unsigned)count;
+    pstats->Mean   = sum / Double(count);
+    pstats->Median = Benchmark_Percentile(samples, 0.5);
+    pstats->P95    = Benchmark_Percentile(samples, 0.95);
+    pstats->Min    = samples[0];
+    pstats->Max    = samples[count - 1];
+
+    ArrayPOD<Double> deviations;
+    deviations.Resize(count);
+    for (UPInt i = 0; i < count; i++)
+        deviations[i] = fabs(samples[i] - pstats->Median);
+    Alg::QuickSort(deviations);
+    pstats->MAD = Benchmark_Percentile(deviations, 0.5);
+}
+
+
+//------------------------------------------------------------------------
+// ***** BenchmarkRunner
+
+BenchmarkRunner::BenchmarkRunner(HAL* phal, GFx::Loader* ploader, const Config& config)
+    : pHAL(phal), pLoader(ploader), Cfg(config)
+{
+    if (!pHAL)
+    {
+        pNullHAL = *SF_NEW Null::HAL(&CommandQueue);
+        Null::HALInitParams params(ImageSize(Cfg.Width, Cfg.Height), Null::HALConfig_NoCommandLog,
+                                   GetCurrentThreadId());
+        if (pNullHAL->InitHAL(params))
+            pHAL = pNullHAL;
+        else
+            pNullHAL.Clear();
+    }
+    CommandQueue.pHAL = pHAL;
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+    if (pNullHAL)
+        pNullHAL->ShutdownHAL();
+}
+
+const char* BenchmarkRunner::GetPhaseName(PhaseType phase)
+{
+    return (phase >= 0 && phase < Phase_Count) ? Benchmark_PhaseNames[phase] : "";
+}
+
+bool BenchmarkRunner::SetInputScript(const char* ptext, unsigned* plineNumber)
+{
+    Input.Clear();
+    if (!ptext)
+        return true;
+
+    unsigned    line = 0;
+    const char* p    = ptext;
+    while (*p)
+    {
+        line++;
+        const char* pend = p;
+        while (*pend && *pend != '\n')
+            pend++;
+
+        char buf[256];
+        UPInt len = Alg::Min<UPInt>(pend - p, sizeof(buf) - 1);
+        memcpy(buf, p, len);
+        buf[len] = 0;
+        if (char* pcomment = strchr(buf, '#'))
+            *pcomment = 0;
+        p = *pend ? pend + 1 : pend;
+
+        char     type[16];
+        unsigned frame = 0;
+        int      a = 0, b = 0;
+        unsigned c = 0;
+        int      n = sscanf(buf, "%u %15s %d %d %u", &frame, type, &a, &b, &c);
+        if (n <= 0)
+            continue;   // Blank or comment.
+
+        InputEvent e;
+        e.Frame = frame;
+        e.X = e.Y = 0;
+        e.Code = 0;
+        bool ok = (n >= 2);
+        if (ok && (!SFstrcmp(type, "move") || !SFstrcmp(type, "down") || !SFstrcmp(type, "up")))
+        {
+            e.Type = !SFstrcmp(type, "move") ? InputEvent::Move :
+                     !SFstrcmp(type, "down") ? InputEvent::Down : InputEvent::Up;
+            e.X    = a;
+            e.Y    = b;
+            e.Code = (n >= 5) ? c : 0;
+            ok     = (n >= 4);
+        }
+        else if (ok && (!SFstrcmp(type, "key") || !SFstrcmp(type, "char")))
+        {
+            e.Type = !SFstrcmp(type, "key") ? InputEvent::Key : InputEvent::Char;
+            e.Code = (unsigned)a;
+            ok     = (n >= 3 && a > 0);
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            Input.Clear();
+            if (plineNumber)
+                *plineNumber = line;
+            return false;
+        }
+        Input.PushBack(e);
+    }
+
+    // Keep the script order for events of the same frame.
+    Alg::InsertionSort(Input, InputEventLess());
+    return true;
+}
+
+bool BenchmarkRunner::LoadInputScript(const char* path, unsigned* plineNumber)
+{
+    SysFile file(path, File::Open_Read | File::Open_Buffered);
+    if (!file.IsValid())
+        return false;
+
+    // GetLength returns -1 on failure.
+    int size = file.GetLength();
+    if (size < 0)
+        return false;
+    ArrayPOD<char> text;
+    text.Resize(size + 1);
+    if (size > 0 && file.Read((UByte*)text.GetDataPtr(), size) != size)
+        return false;
+    text[size] = 0;
+    return SetInputScript(text.GetDataPtr(), plineNumber);
+}
+
+void BenchmarkRunner::sendInput(GFx::Movie* pmovie, unsigned frame, UPInt* pnextEvent)
+{
+    UPInt i = *pnextEvent;
+    for (; i < Input.GetSize() && Input[i].Frame <= frame; i++)
+    {
+        const InputEvent& e = Input[i];
+        switch (e.Type)
+        {
+        case InputEvent::Move:
+            pmovie->HandleEvent(GFx::MouseEvent(GFx::Event::MouseMove, 0, float(e.X), float(e.Y)));
+            break;
+        case InputEvent::Down:
+            pmovie->HandleEvent(GFx::MouseEvent(GFx::Event::MouseDown, e.Code, float(e.X), float(e.Y)));
+            break;
+        case InputEvent::Up:
+            pmovie->HandleEvent(GFx::MouseEvent(GFx::Event::MouseUp, e.Code, float(e.X), float(e.Y)));
+            break;
+        case InputEvent::Key:
+            pmovie->HandleEvent(GFx::KeyEvent(GFx::Event::KeyDown, (Key::Code)e.Code));
+            pmovie->HandleEvent(GFx::KeyEvent(GFx::Event::KeyUp, (Key::Code)e.Code));
+            break;
+        case InputEvent::Char:
+            pmovie->HandleEvent(GFx::CharEvent(e.Code));
+            break;
+        }
+    }
+    *pnextEvent = i;
+}
+
+bool BenchmarkRunner::Run(const char* moviePath)
+{
+    if (!pHAL)
+        return false;
+
+    Ptr<GFx::MovieDef> pdef = *pLoader->CreateMovie(moviePath,
+                                  GFx::Loader::LoadAll | GFx::Loader::LoadWaitCompletion);
+    if (!pdef)
+        return false;
+
+    // Seed before the instance exists, so that the first frame's script
+    // sees the same random numbers on every run.
+    Alg::Random::SeedRandom(Cfg.RandomSeed);
+
+    Ptr<GFx::Movie> pmovie = *pdef->CreateInstance(GFx::MemoryParams(), false, 0, &CommandQueue);
+    if (!pmovie)
+        return false;
+
+    const int width  = (int)Cfg.Width;
+    const int height = (int)Cfg.Height;
+    pmovie->SetViewport(width, height, 0, 0, width, height);
+    Viewport vp(width, height, 0, 0, width, height);
+
+    GFx::MovieDisplayHandle hroot;
+    hroot = pmovie->GetDisplayHandle();
+    GlyphCache*             pglyphCache = pHAL->GetGlyphCache();
+
+    ArrayPOD<Double> samples[Phase_Count];
+    for (unsigned i = 0; i < Phase_Count; i++)
+        samples[i].Reserve(Cfg.Frames);
+
+    Result r;
+    memset(r.Phases, 0, sizeof(r.Phases));
+    r.Movie               = moviePath;
+    r.Triangles           = 0;
+    r.Primitives          = 0;
+    r.GlyphRasterizations = 0;
+
+    const Double msPerTick  = 1000.0 / Double(Timer::GetRawFrequency());
+    UPInt        nextEvent  = 0;
+    unsigned     frameCount = Cfg.WarmupFrames + Cfg.Frames;
+
+    for (unsigned frame = 0; frame < frameCount; frame++)
+    {
+        bool measure = (frame >= Cfg.WarmupFrames);
+        sendInput(pmovie, frame, &nextEvent);
+
+        HAL::Stats halStats;
+        if (measure)
+        {
+            // Drop what the warmup or the previous frame accumulated.
+            pHAL->GetStats(&halStats, true);
+            if (pglyphCache)
+                pglyphCache->ResetRasterizationCount();
+        }
+
+        UInt64 t0 = Timer::GetRawTicks();
+        pmovie->Advance(Cfg.FrameDeltaT, 0, false);
+        UInt64 t1 = Timer::GetRawTicks();
+        pmovie->Capture(false);
+        UInt64 t2 = Timer::GetRawTicks();
+        bool hasCapture = hroot.NextCapture(pHAL->GetContextNotify());
+        UInt64 t3 = Timer::GetRawTicks();
+        if (pHAL->BeginFrame())
+        {
+            if (pHAL->BeginScene())
+            {
+                pHAL->BeginDisplay(Cfg.Background, vp);
+                if (hasCapture)
+                    pHAL->Display(hroot);
+                pHAL->EndDisplay();
+                pHAL->EndScene();
+            }
+            pHAL->EndFrame();
+        }
+        UInt64 t4 = Timer::GetRawTicks();
+
+        if (!measure)
+            continue;
+
+        samples[Phase_Frame].PushBack(Double(t4 - t0) * msPerTick);
+        samples[Phase_Advance].PushBack(Double(t1 - t0) * msPerTick);
+        samples[Phase_Capture].PushBack(Double(t2 - t1) * msPerTick);
+        samples[Phase_NextCapture].PushBack(Double(t3 - t2) * msPerTick);
+        samples[Phase_Display].PushBack(Double(t4 - t3) * msPerTick);
+
+        pHAL->GetStats(&halStats, true);
+        r.Triangles  += halStats.Triangles;
+        r.Primitives += halStats.Primitives;
+        if (pglyphCache)
+            r.GlyphRasterizations += pglyphCache->GetRasterizationCount();
+    }
+
+    for (unsigned i = 0; i < Phase_Count; i++)
+        Benchmark_ComputeStats(samples[i], &r.Phases[i]);
+    Results.PushBack(r);
+    return true;
+}
+
+// Hash of what ExecuteSnapshot reads from a snapshot: its elements in
+// addition order and in depth order, with their source tags. Snapshots of
+// the same TimelineDef share tags, so equal hashes mean equal snapshots.
+static UInt32 Benchmark_HashSnapshot(const GFx::TimelineSnapshot& snapshot)
+{
+    typedef GFx::TimelineSnapshot::SnapshotElement Element;
+
+    struct Hasher
+    {
+        UInt32 H;
+        Hasher() : H(2166136261u) { }
+        void Add(UPInt v)
+        {
+            for (unsigned i = 0; i < sizeof(v); i++, v >>= 8)
+            {
+                H ^= UInt32(v & 0xFF);
+                H *= 16777619u;
+            }
+        }
+        void Add(const Element& e)
+        {
+            Add(UPInt(e.Depth));
+            Add(UPInt(e.CreateFrame));
+            Add(UPInt(e.PlaceType));
+            Add(UPInt(e.Flags));
+            Add(UPInt(e.Tags.pMainTag));
+            Add(UPInt(e.Tags.pMatrixTag));
+            Add(UPInt(e.Tags.pCxFormTag));
+            Add(UPInt(e.Tags.pFiltersTag));
+            Add(UPInt(e.Tags.pBlendModeTag));
+            Add(UPInt(e.Tags.pDepthTag));
+            Add(UPInt(e.Tags.pClipDepthTag));
+            Add(UPInt(e.Tags.pRatioTag));
+            Add(UPInt(e.Tags.pCharIdTag));
+            Add(UPInt(e.Tags.pClassNameTag));
+        }
+    } hasher;
+
+    for (const Element* p = snapshot.SnapshotList.GetFirst();
+         !snapshot.SnapshotList.IsNull(p); p = snapshot.SnapshotList.GetNext(p))
+        hasher.Add(*p);
+    hasher.Add(snapshot.SnapshotSortedArray.GetSize());
+    for (UPInt i = 0; i < snapshot.SnapshotSortedArray.GetSize(); i++)
+        hasher.Add(*snapshot.SnapshotSortedArray[i]);
+    return hasher.H;
+}
+
+bool BenchmarkRunner::RunSeeks(const char* moviePath)
+{
+    Ptr<GFx::MovieDef> pdef = *pLoader->CreateMovie(moviePath,
+                                  GFx::Loader::LoadAll | GFx::Loader::LoadWaitCompletion);
+    if (!pdef)
+        return false;
+
+    GFx::TimelineDef*       ptimeline   = static_cast<GFx::MovieDefImpl*>(pdef.GetPtr())->GetDataDef();
+    GFx::TimelineKeyframes* pkeyframes  = ptimeline->GetKeyframes();
+    MemoryHeap*             pheap       = Memory::GetGlobalHeap();
+    unsigned                frameCount  = ptimeline->GetFrameCount();
+    unsigned                step        = Alg::Max(1u, frameCount / Alg::Max(1u, Cfg.Frames));
+
+    // Snapshots are built the way a gotoAndPlay builds them, without a
+    // sprite to execute them on.
+    if (pkeyframes && frameCount)
+    {
+        GFx::TimelineSnapshot snapshot(GFx::TimelineSnapshot::Direction_Forward, pheap, 0);
+        pkeyframes->MakeSnapshot(&snapshot, ptimeline, frameCount - 1);
+    }
+
+    Result r;
+    memset(r.Phases, 0, sizeof(r.Phases));
+    r.Movie               = moviePath;
+    r.Triangles           = 0;
+    r.Primitives          = 0;
+    r.GlyphRasterizations = 0;
+
+    const Double     msPerTick = 1000.0 / Double(Timer::GetRawFrequency());
+    ArrayPOD<Double> replay, keyframes;
+    for (unsigned i = 0; i < frameCount; i += step)
+    {
+        unsigned target = frameCount - 1 - i;
+
+        GFx::TimelineSnapshot replayed(GFx::TimelineSnapshot::Direction_Forward, pheap, 0);
+        UInt64 t0 = Timer::GetRawTicks();
+        replayed.MakeSnapshot(ptimeline, 0, target);
+        UInt64 t1 = Timer::GetRawTicks();
+        replay.PushBack(Double(t1 - t0) * msPerTick);
+
+        if (pkeyframes)
+        {
+            GFx::TimelineSnapshot restored(GFx::TimelineSnapshot::Direction_Forward, pheap, 0);
+            t0 = Timer::GetRawTicks();
+            pkeyframes->MakeSnapshot(&restored, ptimeline, target);
+            t1 = Timer::GetRawTicks();
+            keyframes.PushBack(Double(t1 - t0) * msPerTick);
+
+            // The keyframe cache relies on assumptions about MakeSnapshot
+            // (see TimelineKeyframes); a timing of a wrong snapshot is
+            // worthless, so a mismatch fails the run.
+            if (Benchmark_HashSnapshot(restored) != Benchmark_HashSnapshot(replayed))
+            {
+                SF_DEBUG_WARNING2(1, "BenchmarkRunner: keyframe snapshot of %s differs from replay at frame %u",
+                                  moviePath, target);
+                return false;
+            }
+        }
+    }
+
+    Benchmark_ComputeStats(replay, &r.Phases[Phase_SeekReplay]);
+    Benchmark_ComputeStats(keyframes, &r.Phases[Phase_SeekKeyframes]);
+    Results.PushBack(r);
+    return true;
+}
+
+bool BenchmarkRunner::RunViews(const char* moviePath, unsigned viewCount)
+{
+    Ptr<GFx::MovieDef> pdef = *pLoader->CreateMovie(moviePath,
+                                  GFx::Loader::LoadAll | GFx::Loader::LoadWaitCompletion);
+    if (!pdef)
+        return false;
+
+    Result r;
+    memset(r.Phases, 0, sizeof(r.Phases));
+    r.Movie               = moviePath;
+    r.Triangles           = 0;
+    r.Primitives          = 0;
+    r.GlyphRasterizations = 0;
+
+    const Double     msPerTick  = 1000.0 / Double(Timer::GetRawFrequency());
+    const unsigned   frameCount = Cfg.WarmupFrames + Cfg.Frames;
+    const int        width      = (int)Cfg.Width;
+    const int        height     = (int)Cfg.Height;
+    const PhaseType  phases[2]  = { Phase_ViewsSerial, Phase_ViewsScheduled };
+    const unsigned   threads[2] = { 1, 0 };
+
+    for (unsigned pass = 0; pass < 2; pass++)
+    {
+        // Same content in both passes.
+        Alg::Random::SeedRandom(Cfg.RandomSeed);
+
+        Ptr<GFx::MovieAdvanceScheduler> pscheduler = *SF_NEW GFx::MovieAdvanceScheduler(threads[pass]);
+        // Groups are rebalanced once after the warmup.
+        pscheduler->SetRebalanceInterval(0);
+
+        ArrayLH<Ptr<GFx::Movie> > views;
+        for (unsigned i = 0; i < viewCount; i++)
+        {
+            Ptr<GFx::Movie> pview = *pscheduler->CreateView(pdef, "BenchmarkView", GFx::MemoryParams(),
+                                                            true, &CommandQueue);
+            if (!pview)
+                return false;
+            pview->SetViewport(width, height, 0, 0, width, height);
+            views.PushBack(pview);
+        }
+
+        ArrayPOD<Double> samples;
+        samples.Reserve(Cfg.Frames);
+        for (unsigned frame = 0; frame < frameCount; frame++)
+        {
+            if (frame == Cfg.WarmupFrames)
+                pscheduler->Rebalance();
+
+            UInt64 t0 = Timer::GetRawTicks();
+            pscheduler->Advance(Cfg.FrameDeltaT, 0);
+            UInt64 t1 = Timer::GetRawTicks();
+            if (frame >= Cfg.WarmupFrames)
+                samples.PushBack(Double(t1 - t0) * msPerTick);
+        }
+        Benchmark_ComputeStats(samples, &r.Phases[phases[pass]]);
+
+        for (UPInt i = 0; i < views.GetSize(); i++)
+            pscheduler->RemoveView(views[i]);
+    }
+
+    Results.PushBack(r);
+    return true;
+}
+
+
+//------------------------------------------------------------------------
+// ***** BenchmarkReport
+
+BenchmarkReport::BenchmarkReport()
+    : RelThreshold(0.05), ZThreshold(3.0)
+{
+}
+
+// Finds "key": in a report line and returns the text after the colon.
+static const char* Benchmark_FindField(const char* pline, const char* key)
+{
+    char pattern[64];
+    SFsprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char* p = strstr(pline, pattern);
+    return p ? p + SFstrlen(pattern) : 0;
+}
+
+static bool Benchmark_ReadNumber(const char* pline, const char* key, Double* pvalue)
+{
+    const char* p = Benchmark_FindField(pline, key);
+    if (!p)
+        return false;
+    char* pend;
+    *pvalue = strtod(p, &pend);
+    return pend != p;
+}
+
+static bool Benchmark_ReadString(const char* pline, const char* key, String* pvalue)
+{
+    const char* p = Benchmark_FindField(pline, key);
+    if (!p || *p != '"')
+        return false;
+
+    StringBuffer buf;
+    for (p++; *p && *p != '"'; p++)
+    {
+        if (*p == '\\' && p[1])
+            p++;
+        buf.AppendString(p, 1);
+    }
+    if (*p != '"')
+        return false;
+    *pvalue = buf;
+    return true;
+}
+
+bool BenchmarkReport::LoadBaseline(File* pfile)
+{
+    Baseline.Clear();
+    if (!pfile || !pfile->IsValid())
+        return false;
+
+    int size = pfile->GetLength();
+    if (size < 0)
+        return false;
+    ArrayPOD<char> text;
+    text.Resize(size + 1);
+    if (size > 0 && pfile->Read((UByte*)text.GetDataPtr(), size) != size)
+        return false;
+    text[size] = 0;
+
+    char* p = text.GetDataPtr();
+    while (*p)
+    {
+        char* pend = p;
+        while (*pend && *pend != '\n')
+            pend++;
+        char* pnext = *pend ? pend + 1 : pend;
+        *pend = 0;
+
+        BaselineEntry e;
+        String        phase;
+        Double        count = 0;
+        if (Benchmark_ReadString(p, "movie", &e.Movie) &&
+            Benchmark_ReadString(p, "phase", &phase) &&
+            Benchmark_ReadNumber(p, "count", &count) &&
+            Benchmark_ReadNumber(p, "mean", &e.Stats.Mean) &&
+            Benchmark_ReadNumber(p, "median", &e.Stats.Median) &&
+            Benchmark_ReadNumber(p, "p95", &e.Stats.P95) &&
+            Benchmark_ReadNumber(p, "min", &e.Stats.Min) &&
+            Benchmark_ReadNumber(p, "max", &e.Stats.Max) &&
+            Benchmark_ReadNumber(p, "mad", &e.Stats.MAD))
+        {
+            e.Stats.Count = (unsigned)count;
+            for (unsigned i = 0; i < BenchmarkRunner::Phase_Count; i++)
+            {
+                if (phase == Benchmark_PhaseNames[i])
+                {
+                    e.Phase = (BenchmarkRunner::PhaseType)i;
+                    Baseline.PushBack(e);
+                    break;
+                }
+            }
+        }
+        p = pnext;
+    }
+    return true;
+}
+
+bool BenchmarkReport::LoadBaseline(const char* path)
+{
+    SysFile file(path, File::Open_Read | File::Open_Buffered);
+    return LoadBaseline(&file);
+}
+
+const BenchmarkReport::BaselineEntry*
+BenchmarkReport::findBaseline(const char* movie, BenchmarkRunner::PhaseType phase) const
+{
+    for (UPInt i = 0; i < Baseline.GetSize(); i++)
+    {
+        if (Baseline[i].Phase == phase && Baseline[i].Movie == movie)
+            return &Baseline[i];
+    }
+    return 0;
+}
+
+BenchmarkReport::StatusType
+BenchmarkReport::Compare(const char* movie, BenchmarkRunner::PhaseType phase,
+                         const BenchmarkRunner::PhaseStats& stats) const
+{
+    const BaselineEntry* pbase = findBaseline(movie, phase);
+    if (!pbase || pbase->Stats.Count == 0 || stats.Count == 0)
+        return Status_NoBaseline;
+
+    const BenchmarkRunner::PhaseStats& base = pbase->Stats;
+    Double delta = stats.Median - base.Median;
+    if (fabs(delta) <= RelThreshold * base.Median)
+        return Status_Unchanged;
+
+    // Scaled MAD estimates the standard deviation of normally distributed
+    // samples. A zero spread (e.g. an unused phase) only leaves the
+    // relative test.
+    Double sigma = 1.4826 * sqrt(base.MAD * base.MAD + stats.MAD * stats.MAD);
+    if (sigma > 0 && fabs(delta) <= ZThreshold * sigma)
+        return Status_Unchanged;
+
+    return (delta > 0) ? Status_Regressed : Status_Improved;
+}
+
+static void Benchmark_WriteString(File* pfile, const char* pstr)
+{
+    pfile->Write((const UByte*)pstr, (int)SFstrlen(pstr));
+}
+
+bool BenchmarkReport::Write(File* pfile, const BenchmarkRunner& runner, unsigned* pregressions) const
+{
+    static const char* const statusNames[] = { "unchanged", "regressed", "improved" };
+
+    if (pregressions)
+        *pregressions = 0;
+    if (!pfile || !pfile->IsWritable())
+        return false;
+
+    char buf[512];
+    for (UPInt m = 0; m < runner.GetResultCount(); m++)
+    {
+        const BenchmarkRunner::Result& r = runner.GetResult(m);
+
+        // Escape the movie path for JSON; backslashes are common on Windows.
+        StringBuffer movie;
+        for (const char* p = r.Movie.ToCStr(); *p; p++)
+        {
+            if (*p == '"' || *p == '\\')
+                movie.AppendString("\\", 1);
+            movie.AppendString(p, 1);
+        }
+
+        for (unsigned i = 0; i < BenchmarkRunner::Phase_Count; i++)
+        {
+            const BenchmarkRunner::PhaseStats& s = r.Phases[i];
+            if (s.Count == 0)
+                continue;
+
+            Benchmark_WriteString(pfile, "{\"movie\":\"");
+            Benchmark_WriteString(pfile, movie.ToCStr());
+            SFsprintf(buf, sizeof(buf),
+                      "\",\"phase\":\"%s\",\"count\":%u,\"mean\":%.4f,\"median\":%.4f,"
+                      "\"p95\":%.4f,\"min\":%.4f,\"max\":%.4f,\"mad\":%.4f",
+                      Benchmark_PhaseNames[i], s.Count, s.Mean, s.Median,
+                      s.P95, s.Min, s.Max, s.MAD);
+            Benchmark_WriteString(pfile, buf);
+
+            StatusType status = Compare(r.Movie, (BenchmarkRunner::PhaseType)i, s);
+            if (status != Status_NoBaseline)
+            {
+                const BaselineEntry* pbase = findBaseline(r.Movie, (BenchmarkRunner::PhaseType)i);
+                SFsprintf(buf, sizeof(buf), ",\"baseline_median\":%.4f,\"status\":\"%s\"",
+                          pbase->Stats.Median, statusNames[status]);
+                Benchmark_WriteString(pfile, buf);
+                if (status == Status_Regressed && pregressions)
+                    (*pregressions)++;
+            }
+            if (i == BenchmarkRunner::Phase_Frame)
+            {
+                SFsprintf(buf, sizeof(buf), ",\"triangles\":%llu,\"primitives\":%llu,\"glyph_rasterizations\":%llu",
+                          (unsigned long long)r.Triangles, (unsigned long long)r.Primitives,
+                          (unsigned long long)r.GlyphRasterizations);
+                Benchmark_WriteString(pfile, buf);
+            }
+            Benchmark_WriteString(pfile, "}\n");
+        }
+    }
+    pfile->Flush();
+    return pfile->GetErrorCode() == 0;
+}
+
+bool BenchmarkReport::Write(const char* path, const BenchmarkRunner& runner, unsigned* pregressions) const
+{
+    SysFile file(path, File::Open_Write | File::Open_Truncate | File::Open_Create | File::Open_Buffered);
+    return Write(&file, runner, pregressions);
+}
+
+}} // Scaleform::Platform
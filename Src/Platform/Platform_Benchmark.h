@@ -0,0 +1,291 @@
+/**************************************************************************
+
+Filename    :   Platform_Benchmark.h
+Content     :   Headless benchmark runner for GFx movies with frame time
+                reports and baseline comparison
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Platform_Benchmark_H
+#define INC_SF_Platform_Benchmark_H
+
+#include "GFx/GFx_Player.h"
+#include "GFx/GFx_Loader.h"
+#include "Render/Render_HAL.h"
+#include "Render/Render_ThreadCommandQueue.h"
+#include "Render/Null/Null_HAL.h"
+#include "Kernel/SF_File.h"
+#include "Platform_CoreTest.h"
+
+namespace Scaleform { namespace Platform {
+
+// ***** BenchmarkRunner
+
+// Plays movies without a window or vsync and measures where the frame
+// time goes, so performance changes can be caught by a build machine
+// rather than by eye.
+//
+// Each movie is advanced with a fixed time step for a fixed number of
+// frames, with the global random generator seeded the same way on every
+// run and with input coming from a script instead of the user, so two
+// runs of the same build do the same work. Every frame is captured and
+// drawn on the calling thread. By default the runner draws through its
+// own Null::HAL, which measures the CPU side of rendering without a
+// window or GPU; an application HAL can be given instead to include the
+// device.
+//
+// The phases are timed around the calls that make up a frame; the
+// renderer's internal steps (tree cache update, tessellation, glyph
+// rasterization) are part of Phase_Display.
+//
+// Input scripts have one event per line, '#' starts a comment:
+//   <frame> move <x> <y>
+//   <frame> down <x> <y> [button]
+//   <frame> up   <x> <y> [button]
+//   <frame> key  <keycode>          (key down and up)
+//   <frame> char <unicode>
+// Events are sent before the Advance of the given frame, counting from 0.
+
+class BenchmarkRunner
+{
+public:
+    enum PhaseType
+    {
+        Phase_Frame,            // Whole frame; the sum of Advance through Display.
+        Phase_Advance,          // Movie::Advance.
+        Phase_Capture,          // Movie::Capture.
+        Phase_NextCapture,      // Taking the captured snapshot on the render side.
+        Phase_Display,          // HAL BeginFrame through EndFrame.
+        Phase_SeekReplay,       // RunSeeks: snapshot replayed from frame 0.
+        Phase_SeekKeyframes,    // RunSeeks: snapshot built through TimelineKeyframes.
+        Phase_ViewsSerial,      // RunViews: all views advanced on the calling thread.
+        Phase_ViewsScheduled,   // RunViews: all views advanced by MovieAdvanceScheduler.
+        Phase_Count
+    };
+
+    struct Config
+    {
+        float       FrameDeltaT;    // Seconds passed to Advance every frame.
+        unsigned    Frames;         // Measured frames.
+        unsigned    WarmupFrames;   // Frames played before measuring.
+        unsigned    Width, Height;
+        UInt32      RandomSeed;
+        Render::Color Background;
+
+        Config() : FrameDeltaT(1.0f / 60.0f), Frames(600), WarmupFrames(30),
+                   Width(1280), Height(720), RandomSeed(0x5EED), Background(0, 0, 0, 255) { }
+    };
+
+    // Times are in milliseconds. MAD is the median absolute deviation
+    // from the median, which is robust against the odd slow frame caused
+    // by the machine rather than the content.
+    struct PhaseStats
+    {
+        unsigned    Count;
+        Double      Mean;
+        Double      Median;
+        Double      P95;
+        Double      Min;
+        Double      Max;
+        Double      MAD;
+    };
+
+    struct Result
+    {
+        String      Movie;
+        PhaseStats  Phases[Phase_Count];
+        // Totals over the measured frames.
+        UInt64      Triangles;
+        UInt64      Primitives;
+        UInt64      GlyphRasterizations;
+    };
+
+    // With a NULL phal the runner creates and initializes a Null::HAL of
+    // the configured size. Otherwise the HAL must be initialized by the
+    // caller and is only used from the calling thread.
+    BenchmarkRunner(Render::HAL* phal, GFx::Loader* ploader, const Config& config = Config());
+    ~BenchmarkRunner();
+
+    // Sets the input script used for the movies run from now on. Returns
+    // false on a syntax error; lineNumber receives the offending line.
+    bool            SetInputScript(const char* ptext, unsigned* plineNumber = 0);
+    bool            LoadInputScript(const char* path, unsigned* plineNumber = 0);
+
+    // Plays the movie and adds its result. Returns false if it could not
+    // be loaded.
+    bool            Run(const char* moviePath);
+
+    // Times the timeline snapshots behind a backward gotoAndPlay on the
+    // movie's main timeline, for up to Config::Frames target frames spread
+    // over it, last first. Each target is built both by replaying from
+    // frame 0 and through the timeline's keyframe cache, which is filled
+    // by an unmeasured seek to the last frame first; only Phase_SeekReplay
+    // is measured if TimelineKeyframes is disabled. The two snapshots of
+    // each target are compared. Adds a result with just those phases.
+    // Returns false if the movie could not be loaded or a keyframe
+    // snapshot differs from the replayed one.
+    bool            RunSeeks(const char* moviePath);
+
+    // Times Advance of viewCount instances of the movie, each created by
+    // MovieAdvanceScheduler::CreateView in its own MemoryContext and
+    // group: once with a scheduler of one thread and once with one thread
+    // per CPU. A sample is one Advance of all views, including capture.
+    // Input scripts are not sent. Adds a result with just those phases.
+    // Returns false if the movie or a view could not be created.
+    bool            RunViews(const char* moviePath, unsigned viewCount = 64);
+
+    UPInt           GetResultCount() const      { return Results.GetSize(); }
+    const Result&   GetResult(UPInt index) const { return Results[index]; }
+
+    static const char* GetPhaseName(PhaseType phase);
+
+private:
+    struct InputEvent
+    {
+        unsigned    Frame;
+        enum TypeCode { Move, Down, Up, Key, Char } Type;
+        int         X, Y;
+        unsigned    Code;           // Mouse button, key code or character.
+    };
+
+    struct InputEventLess
+    {
+        bool operator()(const InputEvent& a, const InputEvent& b) const { return a.Frame < b.Frame; }
+    };
+
+    void            sendInput(GFx::Movie* pmovie, unsigned frame, UPInt* pnextEvent);
+
+    Render::HAL*                        pHAL;
+    GFx::Loader*                        pLoader;
+    Config                              Cfg;
+    Render::SingleThreadCommandQueue    CommandQueue;
+    Ptr<Render::Null::HAL>              pNullHAL;
+    ArrayLH_POD<InputEvent>             Input;
+    ArrayLH<Result>                     Results;
+};
+
+
+// ***** BenchmarkReport
+
+// Writes results as JSON, one phase record per line:
+//   {"movie":"a.swf","phase":"advance","count":600,"mean":1.23,"median":...,
+//    "p95":...,"min":...,"max":...,"mad":...}
+// A report written this way can be loaded back as the baseline of a later
+// run. When a baseline is given, each record also gets the baseline
+// median and a "status" of "regressed", "improved" or "unchanged".
+//
+// A phase counts as changed when its median moved by more than
+// RelThreshold of the baseline median, and by more than ZThreshold times
+// the combined spread of the two runs (MAD scaled to a standard deviation,
+// 1.4826 * MAD). The second test keeps noisy phases from being reported
+// on every run.
+
+class BenchmarkReport
+{
+public:
+    enum StatusType
+    {
+        Status_Unchanged,
+        Status_Regressed,
+        Status_Improved,
+        Status_NoBaseline
+    };
+
+    BenchmarkReport();
+
+    void            SetThresholds(Double relThreshold, Double zThreshold)
+    {
+        RelThreshold = relThreshold;
+        ZThreshold   = zThreshold;
+    }
+
+    // Loads a report written by Write as the baseline. Records that can't
+    // be parsed are skipped; returns false if the file can't be read.
+    bool            LoadBaseline(File* pfile);
+    bool            LoadBaseline(const char* path);
+
+    StatusType      Compare(const char* movie, BenchmarkRunner::PhaseType phase,
+                            const BenchmarkRunner::PhaseStats& stats) const;
+
+    // Writes all results of the runner. Returns false on a file error.
+    // pregressions receives the number of regressed phases.
+    bool            Write(File* pfile, const BenchmarkRunner& runner, unsigned* pregressions = 0) const;
+    bool            Write(const char* path, const BenchmarkRunner& runner, unsigned* pregressions = 0) const;
+
+private:
+    struct BaselineEntry
+    {
+        String                      Movie;
+        BenchmarkRunner::PhaseType  Phase;
+        BenchmarkRunner::PhaseStats Stats;
+    };
+
+    const BaselineEntry* findBaseline(const char* movie, BenchmarkRunner::PhaseType phase) const;
+
+    Double                  RelThreshold;
+    Double                  ZThreshold;
+    ArrayLH<BaselineEntry>  Baseline;
+};
+
+
+// ***** MicroBenchmark
+
+// Times a small piece of engine code in isolation, such as a counter or a
+// lock, where the difference would be lost in the noise of a movie.
+// Benchmarks are static instances that register themselves when they are
+// constructed; RunAll runs them and writes one JSON record per variant:
+//   {"benchmark":"ThreadMemoryStats","variant":"off","threads":1,"ns_per_op":21.3}
+// ns_per_op is wall time per operation of each thread, the median of
+// Repeats runs. Benchmarks of memory can also set Measurement::Footprint,
+// written as "footprint":<bytes>. The benchmarks of the kernel are in
+// Platform_MicroBenchmarks.cpp.
+
+class MicroBenchmark : public CoreTest<MicroBenchmark>
+{
+public:
+    enum
+    {
+        MaxThreads  = 16,
+        Repeats     = 5
+    };
+
+    struct Measurement
+    {
+        const char* Variant;
+        unsigned    Threads;
+        Double      NsPerOp;
+        UPInt       Footprint;  // Bytes held after the run; 0 if not measured.
+    };
+    typedef ArrayLH_POD<Measurement> MeasurementArray;
+
+    MicroBenchmark(const char* name) : CoreTest<MicroBenchmark>(name) { }
+
+    // Adds a measurement for every variant of the benchmark.
+    virtual void    Run(MeasurementArray* presults) = 0;
+
+    // Runs the benchmarks whose name starts with pfilter, or all of them.
+    // Returns false on a file error.
+    static bool     RunAll(File* pfile, const char* pfilter = 0);
+    static bool     RunAll(const char* path, const char* pfilter = 0);
+
+protected:
+    // Does iterations operations on pdata; called on every thread at once.
+    typedef void    (*LoopFn)(void* pdata, unsigned iterations);
+
+    // Times ploop on threadCount threads (started together) and adds the
+    // result. Without SF_ENABLE_THREADS only one thread is used.
+    static void     measure(MeasurementArray* presults, const char* variant,
+                            LoopFn ploop, void* pdata, unsigned threadCount, unsigned iterations);
+};
+
+}} // Scaleform::Platform
+
+#endif // INC_SF_Platform_Benchmark_H
@@ -0,0 +1,105 @@
+/**************************************************************************
+
+Filename    :   Platform_FramePipelineStats.cpp
+Content     :   Per-frame timing of the advance/render thread pipeline.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Platform_FramePipelineStats.h"
+#include "Kernel/SF_Alg.h"
+
+namespace Scaleform { namespace Platform {
+
+static inline unsigned FramePipeline_Micro(UInt64 ticks)
+{
+    return (unsigned)Alg::Min<UInt64>(ticks, 0xFFFFFFFF);
+}
+
+//------------------------------------------------------------------------
+// ***** FramePipelineStats
+
+FramePipelineStats::FramePipelineStats()
+    : LastQueueFullTicks(0), FrameStartTicks(0),
+      RenderWaitTicks(0), CaptureTicks(0), SubmitTicks(0)
+{
+    memset(&Current, 0, sizeof(Current));
+    Reset();
+}
+
+void FramePipelineStats::AddAdvanceWait(UInt64 ticks)
+{
+    Lock::Locker lock(&HistoryLock);
+    AdvanceWaitTicks += ticks;
+}
+
+FrameQueueInfo FramePipelineStats::QueueFrame(unsigned queueDepth, unsigned framesAhead,
+                                              UInt64 queueFullTicks)
+{
+    FrameQueueInfo info;
+    info.QueueTicks  = Timer::GetProfileTicks();
+    info.QueueDepth  = queueDepth;
+    info.FramesAhead = framesAhead;
+
+    Lock::Locker lock(&HistoryLock);
+    info.AdvanceWait   = FramePipeline_Micro(AdvanceWaitTicks);
+    info.QueueFullWait = FramePipeline_Micro(queueFullTicks - LastQueueFullTicks);
+    AdvanceWaitTicks   = 0;
+    LastQueueFullTicks = queueFullTicks;
+    return info;
+}
+
+void FramePipelineStats::BeginFrame(const FrameQueueInfo& info)
+{
+    FrameStartTicks = Timer::GetProfileTicks();
+
+    Current.CaptureLatency = info.QueueTicks ? FramePipeline_Micro(FrameStartTicks - info.QueueTicks) : 0;
+    Current.QueueDepth     = info.QueueDepth;
+    Current.FramesAhead    = info.FramesAhead;
+    Current.AdvanceWait    = info.AdvanceWait;
+    Current.QueueFullWait  = info.QueueFullWait;
+    Current.RenderWait     = FramePipeline_Micro(RenderWaitTicks);
+
+    RenderWaitTicks = 0;
+    CaptureTicks    = 0;
+    SubmitTicks     = 0;
+}
+
+void FramePipelineStats::EndFrame()
+{
+    Current.CaptureTime = FramePipeline_Micro(CaptureTicks);
+    Current.SubmitTime  = FramePipeline_Micro(SubmitTicks);
+    Current.FrameTime   = FramePipeline_Micro(Timer::GetProfileTicks() - FrameStartTicks);
+
+    Lock::Locker lock(&HistoryLock);
+    Current.Frame = HistoryCount;
+    History[HistoryCount % HistorySize] = Current;
+    HistoryCount++;
+}
+
+unsigned FramePipelineStats::GetHistory(FrameTiming* timings, unsigned maxCount) const
+{
+    Lock::Locker lock(&HistoryLock);
+    unsigned count = Alg::Min(Alg::Min(maxCount, HistoryCount), (unsigned)HistorySize);
+    unsigned first = HistoryCount - count;
+    for (unsigned i = 0; i < count; i++)
+        timings[i] = History[(first + i) % HistorySize];
+    return count;
+}
+
+void FramePipelineStats::Reset()
+{
+    Lock::Locker lock(&HistoryLock);
+    memset(History, 0, sizeof(History));
+    HistoryCount     = 0;
+    AdvanceWaitTicks = 0;
+}
+
+}} // Scaleform::Platform
@@ -0,0 +1,132 @@
+/**************************************************************************
+
+Filename    :   Platform_FramePipelineStats.h
+Content     :   Per-frame timing of the advance/render thread pipeline.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Platform_FramePipelineStats_H
+#define INC_SF_Platform_FramePipelineStats_H
+
+#include "Kernel/SF_Types.h"
+#include "Kernel/SF_Threads.h"
+#include "Kernel/SF_Timer.h"
+
+namespace Scaleform { namespace Platform {
+
+//------------------------------------------------------------------------
+// ***** FrameTiming
+
+// Timing of one rendered frame, as seen from both sides of the render
+// thread queue. All times are in microseconds.
+
+struct FrameTiming
+{
+    unsigned    Frame;          // Render thread frame number.
+    unsigned    CaptureLatency; // From DrawFrame to the render thread starting the frame.
+    unsigned    QueueDepth;     // Commands ahead of the frame when DrawFrame queued it.
+    unsigned    FramesAhead;    // Frames queued and not yet started, including this one.
+    unsigned    AdvanceWait;    // Advance thread time in WaitForOutstandingDrawFrame since the previous frame.
+    unsigned    QueueFullWait;  // Producer time blocked on a full command queue since the previous frame.
+    unsigned    RenderWait;     // Render thread time waiting for commands since the previous frame.
+    unsigned    CaptureTime;    // Render thread time taking display handle captures.
+    unsigned    SubmitTime;     // Render thread time in HAL EndFrame and presenting.
+    unsigned    FrameTime;      // Render thread time for the whole frame.
+};
+
+// Values DrawFrame records on the advance thread and passes along with
+// the frame.
+struct FrameQueueInfo
+{
+    UInt64      QueueTicks;
+    unsigned    QueueDepth;
+    unsigned    FramesAhead;
+    unsigned    AdvanceWait;
+    unsigned    QueueFullWait;
+
+    FrameQueueInfo()
+        : QueueTicks(0), QueueDepth(0), FramesAhead(0), AdvanceWait(0), QueueFullWait(0) { }
+};
+
+
+//------------------------------------------------------------------------
+// ***** FramePipelineStats
+
+// FramePipelineStats collects FrameTiming records for the last HistorySize
+// frames. The advance thread reports its waits and calls QueueFrame when
+// it queues a frame; the render thread brackets the frame with BeginFrame
+// and EndFrame and reports its waits, capture and submit times in
+// between. GetHistory can be called from any thread.
+
+class FramePipelineStats
+{
+public:
+    enum { HistorySize = 128 };
+
+    FramePipelineStats();
+
+    // Advance thread.
+    void        AddAdvanceWait(UInt64 ticks);
+    FrameQueueInfo QueueFrame(unsigned queueDepth, unsigned framesAhead, UInt64 queueFullTicks);
+
+    // Render thread.
+    void        AddRenderWait(UInt64 ticks)     { RenderWaitTicks += ticks; }
+    void        AddCaptureTime(UInt64 ticks)    { CaptureTicks += ticks; }
+    void        AddSubmitTime(UInt64 ticks)     { SubmitTicks += ticks; }
+    void        BeginFrame(const FrameQueueInfo& info);
+    void        EndFrame();
+
+    // Copies up to maxCount of the most recent frames into timings, oldest
+    // first; returns the number copied.
+    unsigned    GetHistory(FrameTiming* timings, unsigned maxCount) const;
+    // Clears the history; frame numbers start over.
+    void        Reset();
+
+private:
+    mutable Lock    HistoryLock;
+    FrameTiming     History[HistorySize];
+    unsigned        HistoryCount;   // Total frames recorded; the next slot is HistoryCount % HistorySize.
+
+    // Advance thread accumulators, guarded by HistoryLock.
+    UInt64          AdvanceWaitTicks;
+    UInt64          LastQueueFullTicks;
+
+    // Render thread state for the frame in progress.
+    FrameTiming     Current;
+    UInt64          FrameStartTicks;
+    UInt64          RenderWaitTicks;
+    UInt64          CaptureTicks;
+    UInt64          SubmitTicks;
+};
+
+
+// Adds the time spent in its scope to a FramePipelineStats counter.
+class FramePipelineTimer
+{
+public:
+    typedef void (FramePipelineStats::*AddFunc)(UInt64);
+
+    FramePipelineTimer(FramePipelineStats* pstats, AddFunc func)
+        : pStats(pstats), Func(func), StartTicks(Timer::GetProfileTicks()) { }
+    ~FramePipelineTimer()
+    {
+        (pStats->*Func)(Timer::GetProfileTicks() - StartTicks);
+    }
+
+private:
+    FramePipelineStats* pStats;
+    AddFunc             Func;
+    UInt64              StartTicks;
+};
+
+}} // Scaleform::Platform
+
+#endif // INC_SF_Platform_FramePipelineStats_H
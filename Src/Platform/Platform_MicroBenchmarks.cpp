@@ -0,0 +1,699 @@
+/**************************************************************************
+
+Filename    :   Platform_MicroBenchmarks.cpp
+Content     :   Benchmarks of individual kernel components
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Platform_Benchmark.h"
+#include "Kernel/SF_ThreadStats.h"
+#include "Kernel/SF_Threads.h"
+#include "Kernel/SF_SysFile.h"
+#include "Kernel/SF_Timer.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_AsyncLog.h"
+#include "Render/Soft/Soft_Rasterizer.h"
+
+#if defined(SF_OS_LINUX) || defined(SF_OS_MAC)
+#include "Kernel/HeapPT/HeapPT_SysAllocMMAP.h"
+#include "Kernel/HeapPT/HeapPT_SysAllocReservedMMAP.h"
+#define SF_MICROBENCHMARK_SYSALLOC_MMAP
+#endif
+
+namespace Scaleform { namespace Platform {
+
+// ***** MicroBenchmark
+
+namespace {
+
+#ifdef SF_ENABLE_THREADS
+struct MicroBenchmark_Worker
+{
+    void        (*pLoop)(void* pdata, unsigned iterations);
+    void*       pData;
+    unsigned    Iterations;
+    Event*      pStartEvent;
+};
+
+int MicroBenchmark_ThreadFn(Thread*, void* h)
+{
+    MicroBenchmark_Worker* pworker = (MicroBenchmark_Worker*)h;
+    pworker->pStartEvent->Wait();
+    pworker->pLoop(pworker->pData, pworker->Iterations);
+    return 0;
+}
+#endif
+
+void MicroBenchmark_WriteString(File* pfile, const char* pstr)
+{
+    pfile->Write((const UByte*)pstr, (int)SFstrlen(pstr));
+}
+
+} // namespace
+
+void MicroBenchmark::measure(MeasurementArray* presults, const char* variant,
+                             LoopFn ploop, void* pdata, unsigned threadCount, unsigned iterations)
+{
+#ifdef SF_ENABLE_THREADS
+    threadCount = Alg::Clamp<unsigned>(threadCount, 1, MaxThreads);
+#else
+    threadCount = 1;
+#endif
+
+    Double times[Repeats];
+    for (unsigned r = 0; r < Repeats; r++)
+    {
+        UInt64 start, end;
+#ifdef SF_ENABLE_THREADS
+        if (threadCount > 1)
+        {
+            // Threads are created before the clock starts and released
+            // together, so the time is of the loops running side by side.
+            Event                   startEvent;
+            MicroBenchmark_Worker   worker = { ploop, pdata, iterations, &startEvent };
+            Ptr<Thread>             threads[MaxThreads];
+            for (unsigned i = 0; i < threadCount; i++)
+            {
+                threads[i] = *SF_NEW Thread(MicroBenchmark_ThreadFn, &worker);
+                threads[i]->Start();
+            }
+            start = Timer::GetProfileTicks();
+            startEvent.SetEvent();
+            for (unsigned i = 0; i < threadCount; i++)
+                threads[i]->Wait();
+            end = Timer::GetProfileTicks();
+        }
+        else
+#endif
+        {
+            start = Timer::GetProfileTicks();
+            ploop(pdata, iterations);
+            end = Timer::GetProfileTicks();
+        }
+        times[r] = Double(end - start) * 1000.0 / iterations;
+    }
+
+    Alg::ArrayAdaptor<Double> sorted(times, Repeats);
+    Alg::InsertionSort(sorted);
+    Measurement m = { variant, threadCount, times[Repeats / 2], 0 };
+    presults->PushBack(m);
+}
+
+bool MicroBenchmark::RunAll(File* pfile, const char* pfilter)
+{
+    if (!pfile || !pfile->IsWritable())
+        return false;
+
+    char             buf[256];
+    MeasurementArray results;
+    for (MicroBenchmark* pbench = GetFirstTest(); pbench; pbench = pbench->GetNextTest())
+    {
+        if (pfilter && SFstrncmp(pbench->GetName(), pfilter, SFstrlen(pfilter)) != 0)
+            continue;
+
+        results.Clear();
+        pbench->Run(&results);
+        for (UPInt i = 0; i < results.GetSize(); i++)
+        {
+            const Measurement& m = results[i];
+            SFsprintf(buf, sizeof(buf),
+                      "{\"benchmark\":\"%s\",\"variant\":\"%s\",\"threads\":%u,\"ns_per_op\":%.2f",
+                      pbench->GetName(), m.Variant, m.Threads, m.NsPerOp);
+            MicroBenchmark_WriteString(pfile, buf);
+            if (m.Footprint)
+            {
+                SFsprintf(buf, sizeof(buf), ",\"footprint\":%llu", (unsigned long long)m.Footprint);
+                MicroBenchmark_WriteString(pfile, buf);
+            }
+            MicroBenchmark_WriteString(pfile, "}\n");
+        }
+    }
+    pfile->Flush();
+    return pfile->GetErrorCode() == 0;
+}
+
+bool MicroBenchmark::RunAll(const char* path, const char* pfilter)
+{
+    SysFile file(path, File::Open_Write | File::Open_Truncate | File::Open_Create | File::Open_Buffered);
+    return RunAll(&file, pfilter);
+}
+
+
+// ***** ThreadMemoryStats
+
+// Allocates and frees blocks of varying size from the global heap, with
+// no accounting, with ThreadMemoryStats, and with a MemoryStat updated
+// under a lock the way a StatBag is. Without SF_ENABLE_STATS the counters
+// compile to nothing and the variants measure the same loop.
+
+class ThreadStatsBenchmark : public MicroBenchmark
+{
+public:
+    ThreadStatsBenchmark() : MicroBenchmark("ThreadMemoryStats") { }
+
+    virtual void Run(MeasurementArray* presults)
+    {
+        static const unsigned threadCounts[] = { 1, 4 };
+        const unsigned        iterations     = 1000000;
+
+        for (unsigned i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+        {
+            measure(presults, "off",          loopOff,         this, threadCounts[i], iterations);
+            measure(presults, "thread_stats", loopThreadStats, this, threadCounts[i], iterations);
+            measure(presults, "locked_stat",  loopLockedStat,  this, threadCounts[i], iterations);
+        }
+        Stats.Release();
+    }
+
+private:
+    static UPInt getSize(unsigned i) { return 16 + (i & 63) * 8; }
+
+    static void loopOff(void*, unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            void* p = SF_ALLOC(getSize(i), Stat_Default_Mem);
+            SF_FREE(p);
+        }
+    }
+
+    static void loopThreadStats(void* pdata, unsigned iterations)
+    {
+        ThreadMemoryStats& stats = ((ThreadStatsBenchmark*)pdata)->Stats;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            UPInt size = getSize(i);
+            void* p    = SF_ALLOC(size, Stat_Default_Mem);
+            stats.Increment(Stat_Default_Mem, size, size);
+            stats.Decrement(Stat_Default_Mem, size, size);
+            SF_FREE(p);
+        }
+    }
+
+    static void loopLockedStat(void* pdata, unsigned iterations)
+    {
+        ThreadStatsBenchmark* pthis = (ThreadStatsBenchmark*)pdata;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            UPInt size = getSize(i);
+            void* p    = SF_ALLOC(size, Stat_Default_Mem);
+            {
+                Lock::Locker lock(&pthis->StatLock);
+                pthis->LockedStat.Increment(size, size);
+            }
+            {
+                MemoryStat freed;
+                freed.Increment(size, size);
+                Lock::Locker lock(&pthis->StatLock);
+                pthis->LockedStat -= freed;
+            }
+            SF_FREE(p);
+        }
+    }
+
+    ThreadMemoryStats   Stats;
+    Lock                StatLock;
+    MemoryStat          LockedStat;
+};
+
+static ThreadStatsBenchmark ThreadStatsBenchmarkInstance;
+
+
+// ***** AdaptiveLock and ReadWriteLock
+
+// Short critical sections under contention: counter increments under
+// Lock and AdaptiveLock, and lookups in a small table with one update
+// per 64 lookups under Lock and ReadWriteLock. The counts and the table
+// are checked afterwards, so a broken lock fails the run with an assert
+// rather than just reporting a good time.
+
+class LockBenchmark : public MicroBenchmark
+{
+public:
+    enum
+    {
+        TableSize   = 16,
+        WriteEvery  = 64
+    };
+
+    LockBenchmark() : MicroBenchmark("Lock") { }
+
+    virtual void Run(MeasurementArray* presults)
+    {
+        static const unsigned threadCounts[] = { 1, 2, 4, 8 };
+        const unsigned        iterations     = 200000;
+
+        for (unsigned i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+        {
+            reset();
+            measure(presults, "mutex_lock",    loopLock,         this, threadCounts[i], iterations);
+            measure(presults, "adaptive_lock", loopAdaptiveLock, this, threadCounts[i], iterations);
+            SF_ASSERT(Counter == CounterAdaptive);
+            measure(presults, "mutex_lookup",  loopLockLookup,   this, threadCounts[i], iterations);
+            measure(presults, "rw_lookup",     loopRWLookup,     this, threadCounts[i], iterations);
+        }
+    }
+
+private:
+    void reset()
+    {
+        Counter = CounterAdaptive = 0;
+        for (unsigned i = 0; i < TableSize; i++)
+            Table[i] = 0;
+    }
+
+    // Writers set every entry to the same value, so a reader that sees
+    // two different values has seen a partial write.
+    void write()
+    {
+        UPInt value = Table[0] + 1;
+        for (unsigned i = 0; i < TableSize; i++)
+            Table[i] = value;
+    }
+    void read() const
+    {
+        UPInt value = Table[0];
+        for (unsigned i = 1; i < TableSize; i++)
+        {
+            SF_ASSERT(Table[i] == value);
+            SF_UNUSED(value);
+        }
+    }
+
+    static void loopLock(void* pdata, unsigned iterations)
+    {
+        LockBenchmark* pthis = (LockBenchmark*)pdata;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            Lock::Locker lock(&pthis->MutexLock);
+            pthis->Counter++;
+        }
+    }
+
+    static void loopAdaptiveLock(void* pdata, unsigned iterations)
+    {
+        LockBenchmark* pthis = (LockBenchmark*)pdata;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            AdaptiveLock::Locker lock(&pthis->SpinLock);
+            pthis->CounterAdaptive++;
+        }
+    }
+
+    static void loopLockLookup(void* pdata, unsigned iterations)
+    {
+        LockBenchmark* pthis = (LockBenchmark*)pdata;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            Lock::Locker lock(&pthis->MutexLock);
+            if ((i % WriteEvery) == 0)
+                pthis->write();
+            else
+                pthis->read();
+        }
+    }
+
+    static void loopRWLookup(void* pdata, unsigned iterations)
+    {
+        LockBenchmark* pthis = (LockBenchmark*)pdata;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            if ((i % WriteEvery) == 0)
+            {
+                ReadWriteLock::WriteLocker lock(&pthis->RWLock);
+                pthis->write();
+            }
+            else
+            {
+                ReadWriteLock::ReadLocker lock(&pthis->RWLock);
+                pthis->read();
+            }
+        }
+    }
+
+    Lock            MutexLock;
+    AdaptiveLock    SpinLock;
+    ReadWriteLock   RWLock;
+    UPInt           Counter;
+    UPInt           CounterAdaptive;
+    volatile UPInt  Table[TableSize];
+};
+
+static LockBenchmark LockBenchmarkInstance;
+
+
+// ***** SoftRaster1080p
+
+// Frames of the software rasterizer that Soft::HAL draws through, on a
+// 1920x1080 surface: a clear followed by four full-screen quads, opaque
+// with a constant color and alpha-blended with vertex colors. One op is
+// one frame. The rasterizer runs its own workers, so each variant is
+// measured on one calling thread and reported with the worker count.
+
+class SoftRasterBenchmark : public MicroBenchmark
+{
+public:
+    enum
+    {
+        Width   = 1920,
+        Height  = 1080,
+        Layers  = 4
+    };
+
+    SoftRasterBenchmark() : MicroBenchmark("SoftRaster1080p"), pRaster(0), Blend(false) { }
+
+    virtual void Run(MeasurementArray* presults)
+    {
+        static const unsigned workerCounts[] = { 1, 2, 4 };
+        const unsigned        iterations     = 20;
+
+        UByte* pcolor   = (UByte*)SF_ALLOC(Width * Height * 4, Stat_Default_Mem);
+        UByte* pstencil = (UByte*)SF_ALLOC(Width * Height, Stat_Default_Mem);
+        Render::Soft::Surface surface;
+        surface.pColor       = pcolor;
+        surface.ColorPitch   = Width * 4;
+        surface.pStencil     = pstencil;
+        surface.StencilPitch = Width;
+        surface.Width        = Width;
+        surface.Height       = Height;
+
+        for (unsigned i = 0; i < sizeof(workerCounts) / sizeof(workerCounts[0]); i++)
+        {
+            Render::Soft::Rasterizer raster;
+            raster.Initialize(Memory::GetGlobalHeap(), workerCounts[i]);
+            raster.SetSurface(surface);
+            pRaster = &raster;
+
+            Blend = false;
+            measure(presults, "solid",        loopFrame, this, 1, iterations);
+            presults->Back().Threads = workerCounts[i];
+            Blend = true;
+            measure(presults, "vertex_blend", loopFrame, this, 1, iterations);
+            presults->Back().Threads = workerCounts[i];
+
+            pRaster = 0;
+            raster.Shutdown();
+        }
+
+        SF_FREE(pstencil);
+        SF_FREE(pcolor);
+    }
+
+private:
+    static void setVertex(Render::Soft::Vertex* pv, float x, float y, float shade)
+    {
+        memset(pv, 0, sizeof(Render::Soft::Vertex));
+        pv->X = x;
+        pv->Y = y;
+        pv->V[Render::Soft::Var_R] = shade;
+        pv->V[Render::Soft::Var_G] = 1.0f - shade;
+        pv->V[Render::Soft::Var_B] = 0.5f;
+        pv->V[Render::Soft::Var_A] = 0.5f;
+    }
+
+    static void loopFrame(void* pdata, unsigned iterations)
+    {
+        using namespace Render::Soft;
+        SoftRasterBenchmark* pthis  = (SoftRasterBenchmark*)pdata;
+        Rasterizer*          praster = pthis->pRaster;
+
+        DrawState state;
+        state.Flags = pthis->Blend ? (unsigned)Pixel_Vertex : (unsigned)Pixel_Solid;
+        for (unsigned c = 0; c < 4; c++)
+            state.Color[c] = 1.0f;
+        memset(state.Cxform, 0, sizeof(state.Cxform));
+        memset(state.Samplers, 0, sizeof(state.Samplers));
+        state.Clip          = Render::Rect<int>(0, 0, Width, Height);
+        state.BlendEnable   = pthis->Blend;
+        state.BlendColorOp  = state.BlendAlphaOp = Op_Add;
+        state.SourceColor   = state.SourceAlpha  = pthis->Blend ? (UByte)Factor_SrcAlpha : (UByte)Factor_One;
+        state.DestColor     = state.DestAlpha    = (UByte)Factor_InvSrcAlpha;
+        state.ColorWrite    = 1;
+        state.StencilEnable = 0;
+        state.StencilFunc   = StencilFunc_Always;
+        state.StencilPassOp = state.StencilFailOp = Stencil_Keep;
+        state.StencilRef    = 0;
+
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            praster->ClearColor(Render::Color(0, 0, 0, 255));
+            for (unsigned layer = 0; layer < Layers; layer++)
+            {
+                float    shade = float(layer) / Layers;
+                Vertex   v[4];
+                setVertex(&v[0], 0.0f,         0.0f,          shade);
+                setVertex(&v[1], float(Width), 0.0f,          shade);
+                setVertex(&v[2], float(Width), float(Height), shade);
+                setVertex(&v[3], 0.0f,         float(Height), shade);
+
+                if (praster->IsQueueFull())
+                    praster->Flush();
+                unsigned index = praster->AddDrawState(state);
+                praster->AddTriangle(index, v[0], v[1], v[2]);
+                praster->AddTriangle(index, v[0], v[2], v[3]);
+            }
+            praster->Flush();
+        }
+    }
+
+    Render::Soft::Rasterizer*   pRaster;
+    bool                        Blend;
+};
+
+static SoftRasterBenchmark SoftRasterBenchmarkInstance;
+
+
+// ***** AsyncLog
+
+// Cost to the logging thread of a short formatted message, written
+// directly to a target log and through AsyncLog with each overflow
+// policy. The target formats the message and copies it into a shared
+// buffer under a lock, standing in for a file write. The rings are kept
+// small so that the logging threads outrun the writer and the policies
+// differ; the writer's backlog is flushed outside the timed loop.
+
+class AsyncLogBenchmark : public MicroBenchmark
+{
+public:
+    AsyncLogBenchmark() : MicroBenchmark("AsyncLog"), pLog(0) { }
+
+    virtual void Run(MeasurementArray* presults)
+    {
+        static const unsigned threadCounts[] = { 1, 2, 3, 4 };
+        const unsigned        iterations     = 50000;
+
+        Ptr<Log> ptarget = *SF_NEW BufferLog;
+        for (unsigned i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+        {
+            pLog = ptarget;
+            measure(presults, "sync", loopLog, this, threadCounts[i], iterations);
+
+            measureAsync(presults, "async_block",       ptarget, AsyncLog::Overflow_Block,       threadCounts[i], iterations);
+            measureAsync(presults, "async_drop",        ptarget, AsyncLog::Overflow_Drop,        threadCounts[i], iterations);
+            measureAsync(presults, "async_synchronous", ptarget, AsyncLog::Overflow_Synchronous, threadCounts[i], iterations);
+        }
+        pLog = 0;
+    }
+
+private:
+    class BufferLog : public Log
+    {
+    public:
+        BufferLog() : Used(0) { }
+
+        virtual void LogMessageVarg(LogMessageId messageId, const char* fmt, va_list argList)
+        {
+            char text[MaxLogBufferMessageSize];
+            FormatLog(text, sizeof(text), messageId, fmt, argList);
+            UPInt length = SFstrlen(text);
+
+            Lock::Locker lock(&OutputLock);
+            if (Used + length > sizeof(Output))
+                Used = 0;
+            memcpy(Output + Used, text, length);
+            Used += length;
+        }
+
+    private:
+        Lock    OutputLock;
+        char    Output[16 * 1024];
+        UPInt   Used;
+    };
+
+    void measureAsync(MeasurementArray* presults, const char* variant, Log* ptarget,
+                      AsyncLog::OverflowPolicy policy, unsigned threadCount, unsigned iterations)
+    {
+        AsyncLog::Params params(policy);
+        params.RingSize = 4 * 1024;
+
+        Ptr<AsyncLog> plog = *SF_NEW AsyncLog(ptarget, params);
+        pLog = plog;
+        measure(presults, variant, loopLog, this, threadCount, iterations);
+        pLog = 0;
+        plog->Shutdown();
+    }
+
+    static void loopLog(void* pdata, unsigned iterations)
+    {
+        Log* plog = ((AsyncLogBenchmark*)pdata)->pLog;
+        for (unsigned i = 0; i < iterations; i++)
+            plog->LogMessageById(Log_Warning, "Frame %u: %s took %.2f ms", i, "Advance", i * 0.01);
+    }
+
+    Log*    pLog;
+};
+
+static AsyncLogBenchmark AsyncLogBenchmarkInstance;
+
+
+#ifdef SF_MICROBENCHMARK_SYSALLOC_MMAP
+
+// ***** SysAllocMMAP and SysAllocReservedMMAP
+
+// Heap segments from SysAllocMMAP (a mapping per segment) and from
+// SysAllocReservedMMAP (segments carved from huge page regions), with
+// sizes of 64K to 1M. alloc_touch allocates a segment and writes every
+// page of it, freeing the segment that held its slot before; random_read
+// reads single bytes at random places in a live set of segments, which is
+// where huge pages save TLB misses. Footprint is the committed bytes of
+// the live set: GetStats().Committed for the reserved allocator, and the
+// segment sizes for SysAllocMMAP, which maps exactly what it is asked for.
+
+class SysAllocMMAPBenchmark : public MicroBenchmark
+{
+public:
+    enum
+    {
+        Segments        = 128,
+        SegmentUnit     = 64 * 1024,
+        TouchStep       = 4 * 1024,
+        Align           = SysAllocMMAP::MinGranularity
+    };
+
+    SysAllocMMAPBenchmark()
+        : MicroBenchmark("SysAllocMMAP"), pAlloc(0), pReserved(0), LiveBytes(0), LiveFootprint(0), ReadSum(0)
+    {
+        for (unsigned i = 0; i < Segments; i++)
+            pSegments[i] = 0;
+    }
+
+    virtual void Run(MeasurementArray* presults)
+    {
+        {
+            SysAllocMMAP alloc;
+            runAllocator(presults, &alloc, 0, "mmap_alloc_touch", "mmap_random_read");
+        }
+        {
+            SysAllocReservedMMAP alloc;
+            runAllocator(presults, &alloc, &alloc, "reserved_alloc_touch", "reserved_random_read");
+        }
+    }
+
+private:
+    static UPInt getSize(unsigned i) { return SegmentUnit * (1 + (i * 7) % 16); }
+
+    void runAllocator(MeasurementArray* presults, SysAllocPaged* palloc, SysAllocReservedMMAP* preserved,
+                      const char* allocVariant, const char* readVariant)
+    {
+        pAlloc    = palloc;
+        pReserved = preserved;
+
+        // alloc_touch frees its segments at the end of each run, after
+        // taking the footprint of the full live set.
+        measure(presults, allocVariant, loopAllocTouch, this, 1, Segments * 2);
+        presults->Back().Footprint = LiveFootprint;
+
+        for (unsigned i = 0; i < Segments; i++)
+            allocSegment(i, i);
+        LiveFootprint = getFootprint();
+        measure(presults, readVariant, loopRandomRead, this, 1, 1000000);
+        presults->Back().Footprint = LiveFootprint;
+        freeSegments();
+
+        pAlloc    = 0;
+        pReserved = 0;
+    }
+
+    UPInt getFootprint() const
+    {
+        if (!pReserved)
+            return LiveBytes;
+        SysAllocReservedMMAP::Stats stats;
+        pReserved->GetStats(&stats);
+        return stats.Committed;
+    }
+
+    void allocSegment(unsigned slot, unsigned i)
+    {
+        if (pSegments[slot])
+        {
+            pAlloc->Free(pSegments[slot], SegmentSizes[slot], Align);
+            LiveBytes -= SegmentSizes[slot];
+        }
+        UPInt  size = getSize(i);
+        UByte* p    = (UByte*)pAlloc->Alloc(size, Align);
+        SF_ASSERT(p);
+        for (UPInt offset = 0; offset < size; offset += TouchStep)
+            p[offset] = (UByte)i;
+        pSegments[slot]    = p;
+        SegmentSizes[slot] = size;
+        LiveBytes += size;
+    }
+
+    void freeSegments()
+    {
+        for (unsigned i = 0; i < Segments; i++)
+        {
+            if (pSegments[i])
+                pAlloc->Free(pSegments[i], SegmentSizes[i], Align);
+            pSegments[i] = 0;
+        }
+        LiveBytes = 0;
+    }
+
+    static void loopAllocTouch(void* pdata, unsigned iterations)
+    {
+        SysAllocMMAPBenchmark* pthis = (SysAllocMMAPBenchmark*)pdata;
+        for (unsigned i = 0; i < iterations; i++)
+            pthis->allocSegment(i % Segments, i);
+        pthis->LiveFootprint = pthis->getFootprint();
+        pthis->freeSegments();
+    }
+
+    static void loopRandomRead(void* pdata, unsigned iterations)
+    {
+        SysAllocMMAPBenchmark* pthis = (SysAllocMMAPBenchmark*)pdata;
+        UInt32 seed = 12345;
+        UPInt  sum  = 0;
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            unsigned slot = (seed >> 8) % Segments;
+            seed = seed * 1664525 + 1013904223;
+            sum += pthis->pSegments[slot][(seed >> 4) % pthis->SegmentSizes[slot]];
+        }
+        pthis->ReadSum = sum;
+    }
+
+    SysAllocPaged*          pAlloc;
+    SysAllocReservedMMAP*   pReserved;
+    UByte*                  pSegments[Segments];
+    UPInt                   SegmentSizes[Segments];
+    UPInt                   LiveBytes;
+    UPInt                   LiveFootprint;
+    volatile UPInt          ReadSum;    // Keeps the reads from being optimized out.
+};
+
+static SysAllocMMAPBenchmark SysAllocMMAPBenchmarkInstance;
+
+#endif // SF_MICROBENCHMARK_SYSALLOC_MMAP
+
+}} // Scaleform::Platform
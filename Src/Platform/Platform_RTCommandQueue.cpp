@@ -14,6 +14,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 **************************************************************************/
 
 #include "Platform_RTCommandQueue.h"
+#include "Kernel/SF_Timer.h"
 
 namespace Scaleform { namespace Platform {
 
@@ -97,7 +98,7 @@ void CircularDataQueue::PopDataEnd(UPInt size)
 // ***** RTCommandQueue
 
 RTCommandQueue::RTCommandQueue(ThreadingType type)
-: TType(type), Queue(64*1024),
+: TType(type), Queue(64*1024), QueueDepth(0), ProducerWaitTicks(0),
   ProcessingStopped(false), ConsumerSleeping(false)
 {
     if (type == AutoDetectThreading)
@@ -115,7 +116,7 @@ RTCommandQueue::~RTCommandQueue()
     // ExitThread / StoppProcessing call but after before exit.
     //  - perhaps apply an exiting state earlier, directly on exit call?
 
-    Lock::Locker lock(&QueueLock);
+    AdaptiveLock::Locker lock(&QueueLock);
     freeNotifiers();
 }
 
@@ -148,6 +149,7 @@ bool RTCommandQueue::pushCommand(CommandConstructor* cmd, RTNotifier** pnotifier
     bool success = true;
     bool wakeConsumer;     
     RTNotifier* notifier = 0;
+    UInt64      waitTicks = 0;
 
     if (IsProcessingStopped())
         return false;
@@ -155,12 +157,13 @@ bool RTCommandQueue::pushCommand(CommandConstructor* cmd, RTNotifier** pnotifier
     while(1)
     {        
         { // Lock scope
-            Lock::Locker lock(&QueueLock);
+            AdaptiveLock::Locker lock(&QueueLock);
 
             if (notifier)
             {
                 freeNotifier_NTS(notifier);
                 notifier = 0;
+                ProducerWaitTicks += Timer::GetProfileTicks() - waitTicks;
             }
             
             wakeConsumer     = ConsumerSleeping;
@@ -170,6 +173,7 @@ bool RTCommandQueue::pushCommand(CommandConstructor* cmd, RTNotifier** pnotifier
             if  (data)
             {
                 RTCommand* result = cmd->Construct(data);
+                QueueDepth++;
                 if (result->NeedsWait())
                 {
                     SF_ASSERT(pnotifier);
@@ -180,6 +184,7 @@ bool RTCommandQueue::pushCommand(CommandConstructor* cmd, RTNotifier** pnotifier
             {
                 notifier = allocNotifier_NTS();
                 BlockedProducers.PushBack(notifier);
+                waitTicks = Timer::GetProfileTicks();
             }
         }
 
@@ -206,13 +211,14 @@ bool RTCommandQueue::PopCommand(RTCommandBuffer* buffer, unsigned delay)
     
     do {
         { // Lock scope
-            Lock::Locker lock(&QueueLock);
+            AdaptiveLock::Locker lock(&QueueLock);
             UByte* data = Queue.PopDataBegin();
             if (data)
             {
                 // Copy into buffer.
                 buffer->SetCommand(data);
                 Queue.PopDataEnd(buffer->GetSize());
+                QueueDepth--;
                 notifier = buffer->GetNotifier();
                 repeat = false;
                 // ConsumerSleeping could be 'true' here if timeout PopCommand was used,
@@ -248,6 +254,11 @@ bool RTCommandQueue::PopCommand(RTCommandBuffer* buffer, unsigned delay)
     return success;
 }
 
+UInt64 RTCommandQueue::GetProducerWaitTicks()
+{
+    AdaptiveLock::Locker lock(&QueueLock);
+    return ProducerWaitTicks;
+}
 
 
 }} // Scaleform::Platform
@@ -531,6 +531,13 @@ public:
     void    StopQueueProcessing() { ProcessingStopped = true; }
     bool    IsProcessingStopped() const { return ProcessingStopped; }
 
+    // Number of commands waiting to be executed. Read without the queue
+    // lock, so only approximate while other threads push or pop.
+    unsigned GetQueueDepth() const { return QueueDepth; }
+    // Total time, in microseconds, producers have spent blocked on a full
+    // queue.
+    UInt64  GetProducerWaitTicks();
+
 protected:
 
     // Notifier management; notifiers are allocated for each producer thread
@@ -538,15 +545,19 @@ protected:
     RTNotifier* allocNotifier_NTS();
     void        freeNotifier_NTS(RTNotifier* notifier) { FreeNotifiers.PushBack(notifier); }
     void        freeNotifier(RTNotifier* notifier)
-    { Lock::Locker l(&QueueLock); freeNotifier_NTS(notifier); }    
+    { AdaptiveLock::Locker l(&QueueLock); freeNotifier_NTS(notifier); }    
     void        freeNotifiers();
 
     bool    pushCommand(CommandConstructor* cmd, RTNotifier** pnotifier = 0);
 
     ThreadingType     TType;
     ThreadId          RenderThreadId;
-    Lock              QueueLock;
+    // Held only around queue and notifier list updates; producers and the
+    // consumer block on events outside of it.
+    AdaptiveLock      QueueLock;
     CircularDataQueue Queue;
+    volatile unsigned QueueDepth;
+    UInt64            ProducerWaitTicks;
     // Once processing is stopped, no more push calls are allowed.
     volatile bool     ProcessingStopped;
     bool              ConsumerSleeping;
@@ -15,6 +15,8 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 #include "Platform_RenderHALThread.h"
 #include "Render/Render_MeshCache.h"
+#include "Kernel/SF_Trace.h"
+#include "Kernel/SF_Alg.h"
 
 namespace Scaleform { namespace Platform {
 
@@ -38,6 +40,8 @@ RenderHALThread::RenderHALThread(RTCommandQueue::ThreadingType threadingType)
   Frames(0),
   BGColor(0),
   DrawFrameEnqueued(false),
+  PipelineDepth(1),
+  FramesPending(0),
   RTBlocked(false), RTResume(false), RTBlockedFlag(false),
   CursorState(true),
   WatchDogTrigger(WatchDog_Signaled),
@@ -67,10 +71,13 @@ RenderHALThread::~RenderHALThread()
 int RenderHALThread::Run()
 {
     RTCommandBuffer cmd;
+    SF_TRACE_CODE(Trace::SetThreadName("Render"));
 
     do {
+        UInt64 waitStart = Timer::GetProfileTicks();
         if (PopCommand(&cmd))
         {
+            PipelineStats.AddRenderWait(Timer::GetProfileTicks() - waitStart);
             cmd.Execute(*this);
             if (cmd.NeedsWait())
                 cmd.GetNotifier()->Notify();
@@ -214,7 +221,13 @@ void RenderHALThread::UpdateConfiguration()
 
 void RenderHALThread::DrawFrame()
 {
-    PushCall(&RenderHALThread::drawFrame);
+    unsigned framesAhead;
+    {
+        Mutex::Locker lock(&PacingMutex);
+        framesAhead = ++FramesPending;
+    }
+    PushCall(&RenderHALThread::drawQueuedFrame,
+             PipelineStats.QueueFrame(GetQueueDepth(), framesAhead, GetProducerWaitTicks()));
     DrawFrameEnqueued = true;
 }
 
@@ -228,9 +241,38 @@ void RenderHALThread::WaitForOutstandingDrawFrame()
 {
     if (DrawFrameEnqueued && !IsSingleThreaded())
     {
-        DrawFrameDone.Wait();
-        DrawFrameEnqueued = false;
+        FramePipelineTimer timer(&PipelineStats, &FramePipelineStats::AddAdvanceWait);
+        if (PipelineDepth <= 1)
+        {
+            DrawFrameDone.Wait();
+            DrawFrameEnqueued = false;
+        }
+        else
+        {
+            Mutex::Locker lock(&PacingMutex);
+            while (FramesPending >= PipelineDepth && !IsProcessingStopped())
+                FrameStarted.Wait(&PacingMutex);
+            DrawFrameEnqueued = (FramesPending != 0);
+        }
+    }
+}
+
+void RenderHALThread::SetPipelineDepth(unsigned frames)
+{
+    Mutex::Locker lock(&PacingMutex);
+    PipelineDepth = Alg::Max(frames, 1u);
+}
+
+void RenderHALThread::drawQueuedFrame(const FrameQueueInfo& info)
+{
+    {
+        Mutex::Locker lock(&PacingMutex);
+        FramesPending--;
+        FrameStarted.NotifyAll();
     }
+    PipelineStats.BeginFrame(info);
+    drawFrame();
+    PipelineStats.EndFrame();
 }
 
 bool RenderHALThread::adjustViewConfig(Platform::ViewConfig* config)
@@ -289,6 +331,10 @@ void RenderHALThread::exitThread()
 {   // Just in case.
     destroyGraphics();
     StopQueueProcessing();
+
+    // Release an advance thread waiting for frames that won't be drawn.
+    Mutex::Locker lock(&PacingMutex);
+    FrameStarted.NotifyAll();
 }
 
 void RenderHALThread::updateCursor(const Point<int> mousePos, SystemCursorState state)
@@ -348,6 +394,7 @@ void RenderHALThread::PushThreadCommand(Render::ThreadCommand* command)
 }
 void RenderHALThread::executeThreadCommand(const Ptr<Render::ThreadCommand>& command)
 {
+    SF_TRACE_SCOPE(TraceCat_Render, "RenderHALThread::executeThreadCommand");
     command->Execute();
 }
 
@@ -407,13 +454,13 @@ void RenderHALThread::StartThread()
 
 void RenderHALThread::GetRenderStats( Render::HAL::Stats* pstats )
 {
-    Lock::Locker lock(&RenderStatsLock);
+    AdaptiveLock::Locker lock(&RenderStatsLock);
     *pstats = RenderStats;
 }
 
 void RenderHALThread::GetMeshCacheStats( Render::MeshCache::Stats* pstats )
 {
-    Lock::Locker lock(&RenderStatsLock);
+    AdaptiveLock::Locker lock(&RenderStatsLock);
     *pstats = MeshCacheStats;
 }
 
@@ -20,6 +20,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Render/Render_ThreadCommandQueue.h"
 #include "Render/Render_Profiler.h"
 #include "Platform_RTCommandQueue.h"
+#include "Platform_FramePipelineStats.h"
 #include "Platform.h"
 
 #ifdef SF_OS_ANDROID
@@ -114,6 +115,21 @@ public:
     void    DrawFrame();
     void    CaptureFrameWithoutDraw();
     void    WaitForOutstandingDrawFrame();
+
+    // Sets how many frames DrawFrame may queue ahead of the render thread.
+    // With the default of 1, WaitForOutstandingDrawFrame returns once the
+    // previous frame has started rendering, so advance of the next frame
+    // overlaps rendering of the current one. Larger values let the advance
+    // thread run further ahead, absorbing render frame time spikes at the
+    // cost of latency. Call from the advance thread.
+    void        SetPipelineDepth(unsigned frames);
+    unsigned    GetPipelineDepth() const { return PipelineDepth; }
+
+    // Copies timings of up to maxCount recently rendered frames, oldest
+    // first; returns the number copied. Can be called from any thread.
+    unsigned    GetFrameTimings(FrameTiming* timings, unsigned maxCount) const
+    { return PipelineStats.GetHistory(timings, maxCount); }
+    void        ResetFrameTimings() { PipelineStats.Reset(); }
     
     void    ToggleWireframe();
 	void	SetWireframe(bool wireframe);
@@ -155,6 +171,7 @@ protected:
     virtual void destroyGraphics();
     void         blockForGraphicsInit();
     void         exitThread();
+    void         drawQueuedFrame(const FrameQueueInfo& info);
     void         setBackgroundColor(Render::Color bgColor) { BGColor = bgColor; }
     void         setStereoParams(Render::StereoParams sparams);
     void         setProfileMode(Render::ProfilerModes mode);
@@ -199,7 +216,7 @@ protected:
     bool                    Wireframe;
 	
     // Real-time render stats, not synchronized.
-    Lock                    RenderStatsLock;
+    AdaptiveLock            RenderStatsLock;
     Render::HAL::Stats      RenderStats;
     Render::MeshCache::Stats MeshCacheStats;
     unsigned                GlyphRasterCount;
@@ -213,6 +230,14 @@ protected:
     Event                   DrawFrameDone;
     bool                    DrawFrameEnqueued;
 
+    // Frame pipelining; FramesPending counts frames queued by DrawFrame
+    // that the render thread hasn't started.
+    FramePipelineStats      PipelineStats;
+    unsigned                PipelineDepth;
+    unsigned                FramesPending;
+    Mutex                   PacingMutex;
+    WaitCondition           FrameStarted;
+
     // These events are used for blocking/resuming render thread
     // during main-thread graphics configuration.
     Event                   RTBlocked, RTResume;
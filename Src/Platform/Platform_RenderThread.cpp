@@ -262,7 +262,10 @@ void RenderThread::drawFrame()
             drawFrame((DisplayWindow*)Windows[j]);
         }
 
-        pRenderer->EndFrame();
+        {
+            FramePipelineTimer timer(&PipelineStats, &FramePipelineStats::AddSubmitTime);
+            pRenderer->EndFrame();
+        }
 
         Frames++;
     }
@@ -282,6 +285,7 @@ void RenderThread::drawFrame(DisplayWindow* pDispWin)
         drawFrameMono(pDispWin, false);
         if (pDispWin->VConfig.StereoFormat == Stereo_Standard)
         {
+            FramePipelineTimer timer(&PipelineStats, &FramePipelineStats::AddSubmitTime);
             pDevice->PresentFrame(Render::StereoLeft);
             PresentMode |= Render::StereoRight;
         }
@@ -298,6 +302,7 @@ void RenderThread::drawFrame(DisplayWindow* pDispWin)
     }
 
     // Present the back buffer contents to the display.
+    FramePipelineTimer timer(&PipelineStats, &FramePipelineStats::AddSubmitTime);
     pDevice->PresentFrame(PresentMode);
 }
 
@@ -358,7 +363,7 @@ void RenderThread::drawFrameMono(DisplayWindow* pDispWin, bool capture)
 	{
 		bool resetStats = true;
 		SF_AMP_CODE(resetStats = !AmpServer::GetInstance().IsValidConnection());
-		Lock::Locker lock(&RenderStatsLock);
+		AdaptiveLock::Locker lock(&RenderStatsLock);
 		pHal->GetStats(&RenderStats, resetStats);
         pHal->GetMeshCache().GetStats(&MeshCacheStats);
         GlyphRasterCount = pHal->GetGlyphCache()->GetRasterizationCount();
@@ -406,7 +411,12 @@ void RenderThread::drawFrameMono(DisplayWindow* pDispWin, bool capture)
 void RenderThread::drawDisplayHandle(DisplayHandleDesc& desc, const Render::Viewport& vp, bool capture)
 {
     SF_AMP_SCOPE_RENDER_TIMER("RenderThread::drawDisplayHandle", Amp_Profile_Level_Low);
-    bool captureHasData = capture || desc.hRoot.NextCapture(pRenderer->GetContextNotify());
+    bool captureHasData = capture;
+    if (!captureHasData)
+    {
+        FramePipelineTimer timer(&PipelineStats, &FramePipelineStats::AddCaptureTime);
+        captureHasData = desc.hRoot.NextCapture(pRenderer->GetContextNotify());
+    }
     
     if (captureHasData && (desc.hRoot.GetRenderEntry() != 0))
     {
@@ -538,13 +548,13 @@ void RenderThread::createCursorPrimitives()
 
 unsigned RenderThread::GetGlyphRasterizationCount()
 {
-    Lock::Locker lock(&RenderStatsLock);
+    AdaptiveLock::Locker lock(&RenderStatsLock);
     return GlyphRasterCount;
 }
 
 void RenderThread::ResetRasterizationCount()
 {
-    Lock::Locker lock(&RenderStatsLock);
+    AdaptiveLock::Locker lock(&RenderStatsLock);
     ResetGlyphRasterCount = true;
 }
 
@@ -138,7 +138,9 @@ void RenderHALThread::DestroyGraphics()
 void RenderHALThread::DrawFrame_RenderThread()
 {
     runCommands();
+    PipelineStats.BeginFrame(FrameQueueInfo());
     drawFrame();
+    PipelineStats.EndFrame();
 }
 
 void RenderHALThread::CaptureFrameWithoutDraw()
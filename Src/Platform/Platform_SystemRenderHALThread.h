@@ -18,6 +18,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 #include "Render/Render_ThreadCommandQueue.h"
 #include "Platform_RTCommandQueue.h"
+#include "Platform_FramePipelineStats.h"
 #include "Platform.h"
 
 
@@ -116,6 +117,12 @@ public:
     void    DrawFrame_RenderThread();
     void    WaitForOutstandingDrawFrame();
 
+    // Frames are driven by the system, so only render thread timings are
+    // recorded; latency and advance-side fields are zero.
+    unsigned GetFrameTimings(FrameTiming* timings, unsigned maxCount) const
+    { return PipelineStats.GetHistory(timings, maxCount); }
+    void     ResetFrameTimings() { PipelineStats.Reset(); }
+
     void    ToggleWireframe()
     {
         Wireframe = !Wireframe;
@@ -239,6 +246,7 @@ protected:
 
     Event                   DrawFrameDone;
     bool                    DrawFrameEnqueued;
+    FramePipelineStats      PipelineStats;
 
     // These events are used for blocking/resuming render thread
     // during maind-thread graphics configuration.
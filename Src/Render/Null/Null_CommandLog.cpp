@@ -0,0 +1,171 @@
+/**************************************************************************
+
+Filename    :   Null_CommandLog.cpp
+Content     :   Compact log of the commands issued by the Null HAL
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render/Null/Null_CommandLog.h"
+#include "Kernel/SF_File.h"
+#include "Kernel/SF_Std.h"
+#include "Kernel/SF_Debug.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+static const char* CommandLog_OpNames[Cmd_Count] =
+{
+    "RenderTarget",
+    "Viewport",
+    "BlendMode",
+    "BlendEnable",
+    "DepthStencil",
+    "RasterMode",
+    "Shader",
+    "Uniforms",
+    "Texture",
+    "VertexArray",
+    "Draw",
+    "DrawIndexed",
+    "DrawInstanced",
+};
+
+CommandLog::CommandLog(UPInt maxCommands)
+  : MaxCommands(maxCommands)
+{
+    memset(&LogStats, 0, sizeof(LogStats));
+}
+
+void CommandLog::Add(CommandOp op, unsigned arg16, UInt32 arg0, UInt32 arg1, UInt32 arg2)
+{
+    LogStats.Commands++;
+    if (Commands.GetSize() >= MaxCommands)
+    {
+        LogStats.DroppedCommands++;
+        return;
+    }
+
+    Command cmd;
+    cmd.Op    = (UByte)op;
+    cmd.Pad   = 0;
+    cmd.Arg16 = (UInt16)arg16;
+    cmd.Arg0  = arg0;
+    cmd.Arg1  = arg1;
+    cmd.Arg2  = arg2;
+    Commands.PushBack(cmd);
+}
+
+void CommandLog::AddUniforms(unsigned var, const float* pdata, unsigned count, unsigned batchCount)
+{
+    LogStats.UniformFloats += count;
+    if (Commands.GetSize() >= MaxCommands)
+    {
+        LogStats.Commands++;
+        LogStats.DroppedCommands++;
+        return;
+    }
+
+    UPInt offset = Uniforms.GetSize();
+    Uniforms.Resize(offset + count);
+    if (count)
+        memcpy(Uniforms.GetDataPtr() + offset, pdata, count * sizeof(float));
+    Add(Cmd_Uniforms, batchCount, (UInt32)offset, count, var);
+}
+
+void CommandLog::Clear()
+{
+    Commands.Clear();
+    Uniforms.Clear();
+    memset(&LogStats, 0, sizeof(LogStats));
+}
+
+static inline UInt64 CommandLog_Hash(UInt64 hash, UInt32 value)
+{
+    // FNV-1a, one byte at a time so the result doesn't depend on endianness.
+    for (unsigned i = 0; i < 4; i++)
+    {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+UInt64 CommandLog::ComputeHash(bool includeUniforms) const
+{
+    UInt64 hash = 14695981039346656037ULL;
+
+    for (UPInt i = 0; i < Commands.GetSize(); i++)
+    {
+        const Command& cmd = Commands[i];
+        hash = CommandLog_Hash(hash, cmd.Op | (UInt32(cmd.Arg16) << 16));
+
+        // The pool offset of uniform records depends on which records were
+        // kept, so only the values themselves are hashed.
+        if (cmd.Op == Cmd_Uniforms)
+        {
+            hash = CommandLog_Hash(hash, cmd.Arg1);
+            hash = CommandLog_Hash(hash, cmd.Arg2);
+            if (includeUniforms)
+            {
+                const float* pdata = GetUniforms(cmd);
+                for (UInt32 j = 0; j < cmd.Arg1; j++)
+                {
+                    UInt32 bits;
+                    memcpy(&bits, pdata + j, sizeof(bits));
+                    hash = CommandLog_Hash(hash, bits);
+                }
+            }
+            continue;
+        }
+
+        hash = CommandLog_Hash(hash, cmd.Arg0);
+        hash = CommandLog_Hash(hash, cmd.Arg1);
+        hash = CommandLog_Hash(hash, cmd.Arg2);
+    }
+    return hash;
+}
+
+bool CommandLog::Write(File* pfile) const
+{
+    if (!pfile || !pfile->IsWritable())
+        return false;
+
+    char buf[256];
+    for (UPInt i = 0; i < Commands.GetSize(); i++)
+    {
+        const Command& cmd = Commands[i];
+        int n = (int)SFsprintf(buf, sizeof(buf), "%-13s %5u %08x %08x %08x",
+                               GetOpName((CommandOp)cmd.Op), (unsigned)cmd.Arg16,
+                               (unsigned)cmd.Arg0, (unsigned)cmd.Arg1, (unsigned)cmd.Arg2);
+        pfile->Write((const UByte*)buf, n);
+
+        if (cmd.Op == Cmd_Uniforms)
+        {
+            const float* pdata = GetUniforms(cmd);
+            for (UInt32 j = 0; j < cmd.Arg1; j++)
+            {
+                n = (int)SFsprintf(buf, sizeof(buf), " %g", pdata[j]);
+                pfile->Write((const UByte*)buf, n);
+            }
+        }
+        pfile->Write((const UByte*)"\n", 1);
+    }
+
+    SF_DEBUG_WARNING1(LogStats.DroppedCommands != 0,
+                      "CommandLog::Write - %u commands were dropped", (unsigned)LogStats.DroppedCommands);
+    return pfile->GetErrorCode() == 0;
+}
+
+const char* CommandLog::GetOpName(CommandOp op)
+{
+    return ((unsigned)op < Cmd_Count) ? CommandLog_OpNames[op] : "Unknown";
+}
+
+}}} // Scaleform::Render::Null
@@ -0,0 +1,123 @@
+/**************************************************************************
+
+Filename    :   Null_CommandLog.h
+Content     :   Compact log of the commands issued by the Null HAL
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Null_CommandLog_H
+#define INC_SF_Render_Null_CommandLog_H
+
+#include "Kernel/SF_Types.h"
+#include "Kernel/SF_Array.h"
+
+namespace Scaleform {
+
+class File;
+
+namespace Render { namespace Null {
+
+// CommandLog records the state changes and draw calls that Null::HAL would
+// have sent to a GPU, as fixed size records plus a pool of uniform values.
+// Records never hold pointers; textures and render targets are identified
+// by serial numbers assigned in creation order, so two runs doing the same
+// work produce identical logs and hashes.
+
+enum CommandOp
+{
+    Cmd_RenderTarget,   // Arg0 = target serial, Arg1 = width|height<<16, Arg2 = clear color, Arg16 = 1 if cleared.
+    Cmd_Viewport,       // Arg0 = x|y<<16, Arg1 = width|height<<16.
+    Cmd_BlendMode,      // Arg16 = BlendMode, Arg0 = sourceAc | forceAc<<1.
+    Cmd_BlendEnable,    // Arg16 = enabled.
+    Cmd_DepthStencil,   // Arg16 = DepthStencilMode, Arg0 = stencil reference.
+    Cmd_RasterMode,     // Arg16 = RasterModeType.
+    Cmd_Shader,         // Arg16 = ShaderType, Arg0 = shader combo index.
+    Cmd_Uniforms,       // Arg0 = offset in the uniform pool, Arg1 = float count, Arg2 = Uniform::UniformType, Arg16 = batch count.
+    Cmd_Texture,        // Arg16 = stage, Arg0 = texture serial, Arg1 = width|height<<16, Arg2 = wrap|sample<<8.
+    Cmd_VertexArray,    // Arg16 = stride, Arg0 = vertex count, Arg1 = index count.
+    Cmd_Draw,           // Arg0 = vertex count, Arg1 = mesh count.
+    Cmd_DrawIndexed,    // Arg0 = index count, Arg1 = vertex count, Arg2 = mesh count.
+    Cmd_DrawInstanced,  // Arg0 = index count, Arg1 = vertex count, Arg2 = instance count.
+    Cmd_Count
+};
+
+struct Command
+{
+    UByte   Op;
+    UByte   Pad;
+    UInt16  Arg16;
+    UInt32  Arg0;
+    UInt32  Arg1;
+    UInt32  Arg2;
+};
+
+class CommandLog
+{
+public:
+    struct Stats
+    {
+        UInt64  Commands;
+        UInt64  DrawCalls;
+        UInt64  Triangles;
+        UInt64  UniformFloats;
+        UInt64  DroppedCommands;    // Not stored because the log was full or disabled.
+    };
+
+    // maxCommands limits the records kept between Clear calls; counters keep
+    // running after the limit is reached. 0 keeps counters only.
+    CommandLog(UPInt maxCommands = 1024 * 1024);
+
+    void            SetMaxCommands(UPInt maxCommands) { MaxCommands = maxCommands; }
+    UPInt           GetMaxCommands() const            { return MaxCommands; }
+
+    void            Add(CommandOp op, unsigned arg16 = 0, UInt32 arg0 = 0, UInt32 arg1 = 0, UInt32 arg2 = 0);
+    // Adds a Cmd_Uniforms record for uniform variable var, copying count
+    // floats into the pool.
+    void            AddUniforms(unsigned var, const float* pdata, unsigned count, unsigned batchCount);
+    // Counts a draw; called with the Cmd_Draw* records.
+    void            AddDraw(unsigned triangles)
+    {
+        LogStats.DrawCalls++;
+        LogStats.Triangles += triangles;
+    }
+
+    // Discards the records and resets the counters.
+    void            Clear();
+
+    UPInt           GetCommandCount() const             { return Commands.GetSize(); }
+    const Command&  GetCommand(UPInt index) const       { return Commands[index]; }
+    const float*    GetUniforms(const Command& cmd) const
+    {
+        SF_ASSERT(cmd.Op == Cmd_Uniforms);
+        return Uniforms.GetDataPtr() + cmd.Arg0;
+    }
+    const Stats&    GetStats() const                    { return LogStats; }
+
+    // FNV-1a hash of the stored records, for comparing frames between
+    // builds. Uniform values may differ in the last bits between compilers,
+    // so they can be left out.
+    UInt64          ComputeHash(bool includeUniforms = true) const;
+
+    // Writes the records as text, one per line, for diffing.
+    bool            Write(File* pfile) const;
+
+    static const char* GetOpName(CommandOp op);
+
+private:
+    UPInt                       MaxCommands;
+    ArrayLH_POD<Command>        Commands;
+    ArrayLH_POD<float>          Uniforms;
+    Stats                       LogStats;
+};
+
+}}} // Scaleform::Render::Null
+
+#endif // INC_SF_Render_Null_CommandLog_H
@@ -0,0 +1,363 @@
+/**************************************************************************
+
+Filename    :   Null_HAL.cpp
+Content     :   Null Renderer HAL, which records commands instead of
+                drawing them.
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Kernel/SF_Debug.h"
+#include "Kernel/SF_HeapNew.h"
+
+#include "Render/Render_TextureCacheGeneric.h"
+#include "Render/Render_BufferGeneric.h"
+#include "Render/Null/Null_HAL.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+
+// ***** RenderHAL_Null
+
+HAL::HAL(ThreadCommandQueue* commandQueue) :
+    Render::ShaderHAL<ShaderManager, ShaderInterface>(commandQueue),
+    RSync(),
+    Cache(Memory::GetGlobalHeap(), MeshCacheParams::PC_Defaults, &RSync),
+    DefaultBufferSize(1280, 720),
+    pCurrentFormat(0),
+    pCurrentVertices(0),
+    pCurrentIndices(0)
+{
+}
+
+HAL::~HAL()
+{
+    ShutdownHAL();
+}
+
+RenderTarget* HAL::CreateRenderTarget(Render::Texture* texture, bool needsStencil)
+{
+    Null::Texture* pt = (Null::Texture*)texture;
+    if ( !pt || pt->TextureCount != 1 )
+        return 0;
+
+    RenderTarget* prt = pRenderBufferManager->CreateRenderTarget(
+        texture->GetSize(), RBuffer_Texture, texture->GetFormat(), texture);
+    if ( !prt )
+        return 0;
+    ++AccumulatedStats.RTChanges;
+
+    Ptr<DepthStencilBuffer> pdsb;
+    if ( needsStencil )
+        pdsb = *pRenderBufferManager->CreateDepthStencilBuffer(texture->GetSize(), false);
+
+    RenderTargetData::UpdateData(prt, this, pt->Serial, pdsb);
+    return prt;
+}
+
+RenderTarget* HAL::CreateTempRenderTarget(const ImageSize& size, bool needsStencil)
+{
+    RenderTarget* prt = pRenderBufferManager->CreateTempRenderTarget(size);
+    if ( !prt )
+        return 0;
+    Null::Texture* pt = (Null::Texture*)prt->GetTexture();
+    if ( !pt )
+        return 0;
+
+    RenderTargetData* phd = (RenderTargetData*)prt->GetRenderTargetData();
+    if ( phd && (!needsStencil || phd->pDepthStencilBuffer != 0 ))
+        return prt;
+    ++AccumulatedStats.RTChanges;
+
+    Ptr<DepthStencilBuffer> pdsb = 0;
+    if ( needsStencil )
+        pdsb = *pRenderBufferManager->CreateDepthStencilBuffer(size, true);
+
+    RenderTargetData::UpdateData(prt, this, pt->Serial, pdsb);
+    return prt;
+}
+
+// *** RenderHAL_Null Implementation
+
+bool HAL::InitHAL(const Render::HALInitParams& paramsIn)
+{
+    const Null::HALInitParams& params = reinterpret_cast<const Null::HALInitParams&>(paramsIn);
+
+    DefaultBufferSize = params.DefaultBufferSize;
+    Log.Clear();
+    Log.SetMaxCommands((params.ConfigFlags & HALConfig_NoCommandLog) ? 0 : params.MaxCommands);
+
+    RSync.SetContext(this);
+
+    pTextureManager = params.GetTextureManager();
+    if (!pTextureManager)
+    {
+        pTextureManager =
+            *SF_HEAP_AUTO_NEW(this) TextureManager(params.RenderThreadId, pRTCommandQueue);
+    }
+    pTextureManager->Initialize(this);
+
+    pRenderBufferManager = params.pRenderBufferManager;
+    if (!pRenderBufferManager)
+    {
+        pRenderBufferManager = *SF_HEAP_AUTO_NEW(this) RenderBufferManagerGeneric(RBGenericImpl::DSSM_None);
+        if ( !pRenderBufferManager || !pRenderBufferManager->Initialize(pTextureManager))
+        {
+            ShutdownHAL();
+            return false;
+        }
+    }
+
+    if (!SManager.Initialize(this) ||
+        !Cache.Initialize(this))
+        return false;
+
+    // Render targets are stored top-down, like the default buffer, so the
+    // base MatrixState needs no compensation.
+    pMatrixFactory = SF_HEAP_NEW(pHeap) Render::MatrixStateFactory(pHeap);
+
+    // Call the base-initialization.
+    return BaseHAL::InitHAL(params);
+}
+
+// Returns back to original mode (cleanup)
+bool HAL::ShutdownHAL()
+{
+    if (!(HALState & HS_Initialized))
+        return true;
+
+    if (!BaseHAL::ShutdownHAL())
+        return false;
+
+    destroyDefaultRenderBuffer();
+    pRenderBufferManager.Clear();
+    pTextureManager->Reset();
+    pTextureManager.Clear();
+    Cache.Reset();
+    SManager.Reset();
+    RSync.SetContext(0);
+
+    return true;
+}
+
+bool HAL::BeginScene()
+{
+    if ( !BaseHAL::BeginScene())
+        return false;
+
+    if (!(ConfigFlags & HALConfig_AccumulateCommandLog))
+        Log.Clear();
+
+    pCurrentFormat   = 0;
+    pCurrentVertices = 0;
+    pCurrentIndices  = 0;
+    return true;
+}
+
+void   HAL::MapVertexFormat(PrimitiveFillType fill, const VertexFormat* sourceFormat,
+                            const VertexFormat** single,
+                            const VertexFormat** batch, const VertexFormat** instanced, unsigned)
+{
+    SManager.MapVertexFormat(fill, sourceFormat, single, batch, instanced, MVF_Align | MVF_HasInstancing);
+}
+
+void HAL::SetDefaultBufferSize(const ImageSize& size)
+{
+    DefaultBufferSize = size;
+
+    // Replace the default target, unless a frame is rendering to it.
+    if ((HALState & HS_Initialized) && !(HALState & HS_InFrame))
+        createDefaultRenderBuffer();
+}
+
+// Updates the viewport matrix based on provided viewport and view rectangle.
+void HAL::updateViewport()
+{
+    if (HALState & HS_ViewValid)
+    {
+        int dx = ViewRect.x1 - VP.Left,
+            dy = ViewRect.y1 - VP.Top;
+
+        calcHWViewMatrix(VP.Flags, &Matrices->View2D, ViewRect, dx, dy);
+        Matrices->SetUserMatrix(Matrices->User);
+        Matrices->ViewRect    = ViewRect;
+        Matrices->UVPOChanged = 1;
+
+        if ( HALState & HS_InRenderTarget )
+        {
+            Log.Add(Cmd_Viewport, 0, (VP.Left & 0xFFFF) | (VP.Top << 16),
+                    (VP.Width & 0xFFFF) | (VP.Height << 16));
+        }
+        else
+        {
+            Log.Add(Cmd_Viewport, 0, (ViewRect.x1 & 0xFFFF) | (ViewRect.y1 << 16),
+                    (ViewRect.Width() & 0xFFFF) | (ViewRect.Height() << 16));
+        }
+    }
+    else
+    {
+        Log.Add(Cmd_Viewport);
+    }
+
+    ShaderData.BeginScene();
+}
+
+bool HAL::createDefaultRenderBuffer()
+{
+    Ptr<RenderTarget> ptarget = *SF_HEAP_AUTO_NEW(this) RenderTarget(0, RBuffer_Default, DefaultBufferSize );
+    Ptr<DepthStencilBuffer> pdsb = *SF_HEAP_AUTO_NEW(this) DepthStencilBuffer(0, DefaultBufferSize);
+    RenderTargetData::UpdateData(ptarget, this, 0, pdsb);
+
+    SetRenderTarget(ptarget);
+    return true;
+}
+
+void HAL::setRenderTargetImpl(Render::RenderTargetData* phdinput, unsigned flags, const Color &clearColor)
+{
+    SF_DEBUG_ASSERT(phdinput != 0, "Unexpected NULL RenderTargetData.");
+    RenderTargetData* phd = reinterpret_cast<RenderTargetData*>(phdinput);
+
+    const ImageSize& size = phd->GetBufferSize();
+    Log.Add(Cmd_RenderTarget, (flags & PRT_NoClear) ? 0 : 1, phd->Serial,
+            (size.Width & 0xFFFF) | (size.Height << 16), clearColor.ToColor32());
+}
+
+bool HAL::checkDepthStencilBufferCaps()
+{
+    // Stencil is never actually stored, so every target supports it.
+    RenderTargetEntry& rte = RenderTargetStack.Back();
+    if (!rte.StencilChecked)
+    {
+        rte.StencilAvailable     = true;
+        rte.MultiBitStencil      = true;
+        rte.DepthBufferAvailable = true;
+        rte.StencilChecked       = 1;
+    }
+    return true;
+}
+
+void HAL::applyDepthStencilMode(DepthStencilMode mode, unsigned stencilRef)
+{
+    Log.Add(Cmd_DepthStencil, mode, stencilRef);
+    CurrentDepthStencilState = mode;
+}
+
+void HAL::applyRasterModeImpl(RasterModeType mode)
+{
+    Log.Add(Cmd_RasterMode, mode);
+}
+
+void HAL::applyBlendModeImpl(BlendMode mode, bool sourceAc, bool forceAc)
+{
+    Log.Add(Cmd_BlendMode, mode, (sourceAc ? 1 : 0) | (forceAc ? 2 : 0));
+}
+
+void HAL::applyBlendModeEnableImpl(bool enabled)
+{
+    Log.Add(Cmd_BlendEnable, enabled ? 1 : 0);
+}
+
+UPInt HAL::setVertexArray(PrimitiveBatch* pbatch, Render::MeshCacheItem* pmesh)
+{
+    BaseHAL::setVertexArray(pbatch, pmesh);
+    return setVertexArray(pbatch->pFormat, pmesh, 0);
+}
+
+UPInt HAL::setVertexArray(const ComplexMesh::FillRecord& fr, unsigned formatIndex, Render::MeshCacheItem* pmesh)
+{
+    BaseHAL::setVertexArray(fr, formatIndex, pmesh);
+    return setVertexArray(fr.pFormats[formatIndex], pmesh, fr.VertexByteOffset);
+}
+
+UPInt HAL::setVertexArray(const VertexFormat* pformat, Render::MeshCacheItem* pmeshBase, UPInt vboffset)
+{
+    SimpleMeshCacheItem* pmesh = reinterpret_cast<SimpleMeshCacheItem*>(pmeshBase);
+    UByte* pbase = ((MeshBuffer*)pmesh->GetBuffer())->GetBufferBase();
+
+    pCurrentFormat   = pformat;
+    pCurrentVertices = pbase + pmesh->GetVertexOffset() + vboffset;
+    pCurrentIndices  = (const IndexType*)(pbase + pmesh->GetIndexOffset());
+
+    Log.Add(Cmd_VertexArray, pformat->Size, pmesh->VertexCount, pmesh->IndexCount);
+
+    // Indices are read relative to pCurrentIndices.
+    return 0;
+}
+
+void HAL::setBatchUnitSquareVertexStream()
+{
+    pCurrentFormat   = &VertexXY16iAlpha::Format;
+    pCurrentVertices = (const UByte*)Cache.GetMaskEraseBatchVertices();
+    pCurrentIndices  = 0;
+
+    Log.Add(Cmd_VertexArray, sizeof(VertexXY16iAlpha), 6 * SF_RENDER_MAX_BATCHES, 0);
+}
+
+void HAL::drawPrimitive(unsigned indexCount, unsigned meshCount)
+{
+    Log.Add(Cmd_Draw, 0, indexCount, meshCount);
+    Log.AddDraw(indexCount / 3);
+
+    SF_UNUSED(meshCount);
+#if !defined(SF_BUILD_SHIPPING)
+    AccumulatedStats.Meshes += meshCount;
+    AccumulatedStats.Triangles += indexCount / 3;
+    AccumulatedStats.Primitives++;
+#endif
+}
+
+void HAL::drawIndexedPrimitive(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset )
+{
+    Log.Add(Cmd_DrawIndexed, 0, indexCount, vertexCount, meshCount);
+    Log.AddDraw(indexCount / 3);
+
+    SF_UNUSED3(meshCount, indexPtr, vertexOffset);
+#if !defined(SF_BUILD_SHIPPING)
+    AccumulatedStats.Meshes += meshCount;
+    AccumulatedStats.Triangles += indexCount / 3;
+    AccumulatedStats.Primitives++;
+#endif
+}
+
+void HAL::drawIndexedInstanced(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset )
+{
+    Log.Add(Cmd_DrawInstanced, 0, indexCount, vertexCount, meshCount);
+    Log.AddDraw((indexCount / 3) * meshCount);
+
+    SF_UNUSED2(indexPtr, vertexOffset);
+#if !defined(SF_BUILD_SHIPPING)
+    AccumulatedStats.Meshes += meshCount;
+    AccumulatedStats.Triangles += (indexCount / 3) * meshCount;
+    AccumulatedStats.Primitives++;
+#endif
+}
+
+
+//--------------------------------------------------------------------
+
+void RenderTargetData::UpdateData( RenderBuffer* buffer, HAL* phal, UInt32 serial, DepthStencilBuffer* pdsb )
+{
+    if ( !buffer )
+        return;
+
+    RenderTargetData* poldHD = (Null::RenderTargetData*)buffer->GetRenderTargetData();
+    if ( !poldHD )
+    {
+        poldHD = SF_NEW RenderTargetData(buffer, phal, serial, pdsb);
+        buffer->SetRenderTargetData(poldHD);
+    }
+    else
+    {
+        poldHD->Serial = serial;
+        poldHD->pDepthStencilBuffer = pdsb;
+    }
+}
+
+}}} // Scaleform::Render::Null
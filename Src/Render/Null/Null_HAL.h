@@ -0,0 +1,182 @@
+/**************************************************************************
+
+Filename    :   Null_HAL.h
+Content     :   Null Renderer HAL, which records commands instead of
+                drawing them.
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Null_HAL_H
+#define INC_SF_Render_Null_HAL_H
+
+#include "Render/Render_HAL.h"
+#include "Render/Render_Profiler.h"
+#include "Render/Null/Null_Shader.h"
+#include "Render/Null/Null_MeshCache.h"
+#include "Render/Null/Null_Texture.h"
+#include "Render/Null/Null_Sync.h"
+#include "Render/Null/Null_CommandLog.h"
+#include "Render/Render_ShaderHAL.h"    // Must be included after platform specific shader includes.
+
+namespace Scaleform { namespace Render { namespace Null {
+
+// The Null HAL runs the whole renderer front end - tessellation, batching,
+// mesh and texture caching, shader and uniform selection - but sends the
+// result to a CommandLog instead of a GPU. It needs no window or device, so
+// it can be used for headless tests and to measure the CPU cost of rendering.
+
+// HALConfigFlags enumeration defines system-specific HAL configuration
+// flags passed into InitHAL though HALInitParams.
+enum HALConfigFlags
+{
+    // Only count commands, without storing them. Use for benchmarks,
+    // where the log would only cost memory.
+    HALConfig_NoCommandLog          = 0x00000001,
+
+    // Keep the log across frames; by default BeginScene clears it.
+    HALConfig_AccumulateCommandLog  = 0x00000002,
+};
+
+// Null::HALInitParams provides Null-specific rendering initialization
+// parameters for HAL::InitHAL.
+
+struct HALInitParams : public Render::HALInitParams
+{
+    ImageSize   DefaultBufferSize;  // Size of the default render target.
+    UPInt       MaxCommands;        // Records kept in the command log between clears.
+
+    HALInitParams(const ImageSize& bufferSize = ImageSize(1280, 720),
+                  UInt32 halConfigFlags = 0,
+                  ThreadId renderThreadId = ThreadId()) :
+        Render::HALInitParams(0, halConfigFlags, renderThreadId),
+        DefaultBufferSize(bufferSize),
+        MaxCommands(1024 * 1024)
+    { }
+
+    // Null::TextureManager accessors for correct type.
+    void            SetTextureManager(TextureManager* manager) { pTextureManager = manager; }
+    TextureManager* GetTextureManager() const       { return (TextureManager*) pTextureManager.GetPtr(); }
+};
+
+class HAL : public Render::ShaderHAL<ShaderManager, ShaderInterface>
+{
+    typedef Render::ShaderHAL<ShaderManager, ShaderInterface> BaseHAL;
+
+    friend class Null::MeshCache;
+    friend class Null::Texture;
+    friend class Null::MappedTexture;
+public:
+
+    HAL(ThreadCommandQueue* commandQueue);
+    virtual ~HAL();
+
+    virtual RenderTarget*           CreateRenderTarget(Render::Texture* texture, bool needsStencil);
+    virtual RenderTarget*           CreateTempRenderTarget(const ImageSize& size, bool needsStencil);
+
+    virtual bool                    InitHAL(const Render::HALInitParams& params);
+    virtual bool                    ShutdownHAL();
+
+    virtual bool                    BeginScene();
+
+    virtual bool                    IsRasterModeSupported(RasterModeType) const { return true; }
+    virtual float                   GetViewportScaling() const      { return 1.0f; }
+
+    virtual Render::RenderSync*     GetRenderSync()                 { return (Render::RenderSync*)&RSync; }
+    virtual Render::TextureManager* GetTextureManager()             { return pTextureManager.GetPtr(); }
+    virtual class MeshCache&        GetMeshCache()                  { return Cache; }
+
+    virtual void                    MapVertexFormat(PrimitiveFillType fill, const VertexFormat* sourceFormat,
+                                                    const VertexFormat** single,
+                                                    const VertexFormat** batch, const VertexFormat** instanced,
+                                                    unsigned meshType = MeshCacheItem::Mesh_Regular);
+
+    // Commands recorded since the last BeginScene (or since InitHAL, with
+    // HALConfig_AccumulateCommandLog).
+    CommandLog&                     GetCommandLog()                 { return Log; }
+    const CommandLog&               GetCommandLog() const           { return Log; }
+
+    // Changes the size of the default render target. Must be called
+    // outside of BeginFrame/EndFrame.
+    void                            SetDefaultBufferSize(const ImageSize& size);
+    const ImageSize&                GetDefaultBufferSize() const    { return DefaultBufferSize; }
+
+protected:
+
+    virtual void        updateViewport();
+    virtual bool        createDefaultRenderBuffer();
+    virtual void        setRenderTargetImpl(Render::RenderTargetData* data, unsigned flags, const Color &clearColor);
+
+    virtual bool        checkDepthStencilBufferCaps();
+    virtual void        applyDepthStencilMode(DepthStencilMode mode, unsigned stencilRef);
+    virtual void        applyRasterModeImpl(RasterModeType mode);
+    virtual void        applyBlendModeImpl(BlendMode mode, bool sourceAc = false, bool forceAc = false);
+    virtual void        applyBlendModeEnableImpl(bool enabled);
+
+    virtual void        setBatchUnitSquareVertexStream();
+    virtual UPInt       setVertexArray(PrimitiveBatch* pbatch, Render::MeshCacheItem* pmesh);
+    virtual UPInt       setVertexArray(const ComplexMesh::FillRecord& fr, unsigned formatIndex, Render::MeshCacheItem* pmesh);
+    UPInt               setVertexArray(const VertexFormat* pformat, Render::MeshCacheItem* pmesh, UPInt vboffset);
+    virtual void        drawPrimitive(unsigned indexCount, unsigned meshCount);
+    virtual void        drawIndexedPrimitive(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset );
+    virtual void        drawIndexedInstanced(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset );
+
+    // Called before the contents of a texture are written or released.
+    // HALs that read textures back after the draw call (such as Soft::HAL)
+    // use it to finish pending drawing first.
+    virtual void        beginTextureUpdate(Null::Texture*) { }
+
+    Null::RenderSync            RSync;
+    Null::MeshCache             Cache;
+    Ptr<Null::TextureManager>   pTextureManager;
+    CommandLog                  Log;
+    ImageSize                   DefaultBufferSize;
+
+    // Vertex stream set by the last setVertexArray; the draw functions
+    // index into these, relative to the start of the mesh.
+    const VertexFormat*         pCurrentFormat;
+    const UByte*                pCurrentVertices;
+    const IndexType*            pCurrentIndices;
+};
+
+// Use this HAL if you want to use profile modes.
+class ProfilerHAL : public Render::ProfilerHAL<HAL>
+{
+public:
+    ProfilerHAL(ThreadCommandQueue* commandQueue) : Render::ProfilerHAL<HAL>(commandQueue)
+    {
+    }
+};
+
+//--------------------------------------------------------------------
+// RenderTargetData, used for both RenderTargets and DepthStencilSurface implementations.
+class RenderTargetData : public Render::RenderTargetData
+{
+public:
+    friend class HAL;
+
+    HAL*                    pHAL;
+    UInt32                  Serial;     // Serial of the target texture; 0 for the default buffer.
+
+    static void UpdateData( RenderBuffer* buffer, HAL* phal, UInt32 serial, DepthStencilBuffer* pdsb);
+
+    HAL*                GetHAL() const          { return pHAL; }
+    RenderBuffer*       GetBuffer() const       { return pBuffer; }
+    const ImageSize&    GetBufferSize() const   { return pBuffer->GetBufferSize(); }
+
+private:
+    RenderTargetData( RenderBuffer* buffer, HAL* hal, UInt32 serial, DepthStencilBuffer* pdsb ) :
+       Render::RenderTargetData(buffer, pdsb), pHAL(hal), Serial(serial)
+    { }
+};
+
+}}} // Scaleform::Render::Null
+
+#endif
@@ -0,0 +1,140 @@
+/**************************************************************************
+
+Filename    :   Null_MeshCache.cpp
+Content     :   Null HAL mesh cache implementation
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render/Null/Null_HAL.h"
+#include "Render/Null/Null_MeshCache.h"
+#include "Kernel/SF_Debug.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_HeapNew.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+
+MeshCache::MeshCache(MemoryHeap* pheap, const MeshCacheParams& params, Render::RenderSync* psync)
+  : SimpleMeshCache(pheap, params, psync),
+    pHal(0)
+{
+    fillMaskEraseVertexBuffer<VertexXY16iAlpha>(MaskEraseBatchVertices, SF_RENDER_MAX_BATCHES);
+}
+
+MeshCache::~MeshCache()
+{
+    Reset();
+}
+
+bool    MeshCache::Initialize(HAL* phal)
+{
+    pHal = phal;
+    adjustMeshCacheParams(&Params);
+
+    if (!StagingBuffer.Initialize(pHeap, Params.StagingBufferSize))
+        return false;
+
+    if (!allocateReserve())
+    {
+        Reset();
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::Reset()
+{
+    if (pHal)
+    {
+        releaseAllBuffers();
+        pHal = 0;
+    }
+    StagingBuffer.Reset();
+}
+
+bool MeshCache::SetParams(const MeshCacheParams& argParams)
+{
+    MeshCacheParams params(argParams);
+    adjustMeshCacheParams(&params);
+
+    if (pHal)
+    {
+        CacheList.EvictAll();
+
+        if (Params.StagingBufferSize != params.StagingBufferSize)
+        {
+            if (!StagingBuffer.Initialize(pHeap, params.StagingBufferSize))
+            {
+                if (!StagingBuffer.Initialize(pHeap, Params.StagingBufferSize))
+                {
+                    SF_DEBUG_ERROR(1, "MeshCache::SetParams - couldn't restore StagingBuffer after fail");
+                }
+                return false;
+            }
+        }
+
+        if ((Params.MemReserve != params.MemReserve) ||
+            (Params.MemGranularity != params.MemGranularity))
+        {
+            releaseAllBuffers();
+
+            // Allocate new reserve. If not possible, restore previous one and fail.
+            MeshCacheParams oldParams(Params);
+            Params = params;
+            if (!allocateReserve())
+            {
+                Params = oldParams;
+                if (!allocateReserve())
+                {
+                    SF_DEBUG_ERROR(1, "MeshCache::SetParams - couldn't restore Reserve after fail");
+                }
+                return false;
+            }
+        }
+    }
+    Params = params;
+    return true;
+}
+
+void MeshCache::adjustMeshCacheParams(MeshCacheParams* p)
+{
+    if (p->MaxBatchInstances > SF_RENDER_MAX_BATCHES)
+        p->MaxBatchInstances = SF_RENDER_MAX_BATCHES;
+
+    UPInt maxStagingItemSize = p->MaxVerticesSizeInBatch +
+                               sizeof(UInt16) * p->MaxIndicesInBatch;
+    if (maxStagingItemSize * 2 > p->StagingBufferSize)
+        p->StagingBufferSize = maxStagingItemSize * 2;
+}
+
+SimpleMeshBuffer* MeshCache::createHWBuffer(UPInt size, AllocType atype, unsigned arena)
+{
+    UByte* pdata = (UByte*)SF_HEAP_MEMALIGN(pHeap, size, BufferAlignment, StatRender_MeshCacheMgmt_Mem);
+    if (!pdata)
+        return 0;
+
+    MeshBuffer* pbuffer = SF_HEAP_NEW(pHeap) MeshBuffer(size, atype, arena);
+    if (!pbuffer)
+    {
+        SF_FREE_ALIGN(pdata);
+        return 0;
+    }
+    pbuffer->pData = pdata;
+    return pbuffer;
+}
+
+void MeshCache::destroyHWBuffer(SimpleMeshBuffer* pbuffer)
+{
+    SF_FREE_ALIGN(pbuffer->pData);
+    delete pbuffer;
+}
+
+}}} // Scaleform::Render::Null
@@ -0,0 +1,75 @@
+/**************************************************************************
+
+Filename    :   Null_MeshCache.h
+Content     :   Null HAL mesh cache, kept in system memory
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Null_MeshCache_H
+#define INC_SF_Render_Null_MeshCache_H
+
+#include "Render/Render_SimpleMeshCache.h"
+#include "Render/Render_Vertex.h"
+#include "Kernel/SF_Debug.h"
+#include "Kernel/SF_HeapNew.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+class HAL;
+
+// MeshBuffer memory is ordinary heap memory. Vertices and indices stay in
+// it after upload, so the HAL can read back what it was asked to draw.
+
+class MeshBuffer : public SimpleMeshBuffer
+{
+    friend class MeshCache;
+public:
+    MeshBuffer(UPInt size, AllocType type, unsigned arena)
+        : SimpleMeshBuffer(size, type, arena)
+    { }
+
+    UByte*  GetBufferBase() const { return (UByte*)pData; }
+};
+
+
+class MeshCache : public SimpleMeshCache
+{
+    friend class HAL;
+public:
+
+    MeshCache(MemoryHeap* pheap, const MeshCacheParams& params, Render::RenderSync* psync);
+    ~MeshCache();
+
+    // Initializes MeshCache for operation, including allocation of the reserve
+    // buffer. Typically called from InitHAL.
+    bool            Initialize(HAL* phal);
+    void            Reset();
+
+    // *** MeshCacheConfig Interface
+    virtual bool    SetParams(const MeshCacheParams& params);
+
+    // The mask erase vertices, one quad of 6 vertices per batch instance.
+    const VertexXY16iAlpha* GetMaskEraseBatchVertices() const { return MaskEraseBatchVertices; }
+
+protected:
+
+    virtual SimpleMeshBuffer*   createHWBuffer(UPInt size, AllocType atype, unsigned arena);
+    virtual void                destroyHWBuffer(SimpleMeshBuffer* pbuffer);
+
+    void                        adjustMeshCacheParams(MeshCacheParams* p);
+
+    HAL*                pHal;
+    VertexXY16iAlpha    MaskEraseBatchVertices[6 * SF_RENDER_MAX_BATCHES];
+};
+
+}}} // Scaleform::Render::Null
+
+#endif // INC_SF_Render_Null_MeshCache_H
@@ -0,0 +1,177 @@
+/**************************************************************************
+
+Filename    :   Null_Shader.cpp
+Content     :   Shader bookkeeping for the Null HAL
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render/Null/Null_Shader.h"
+#include "Render/Null/Null_HAL.h"
+#include "Kernel/SF_Debug.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+const UniformVar* ShaderPair::GetUniformVariable(unsigned var) const
+{
+    if (pVDesc->Uniforms[var].Location >= 0)
+        return &pVDesc->Uniforms[var];
+    else if (pFDesc->Uniforms[var].Location >= 0)
+        return &pFDesc->Uniforms[var];
+    else
+        return 0;
+}
+
+// *** ShaderInterface
+
+ShaderInterface::ShaderInterface(Render::HAL* phal)
+{
+    pHal = reinterpret_cast<HAL*>(phal);
+}
+
+bool ShaderInterface::SetStaticShader(ShaderDesc::ShaderType shader, const VertexFormat*)
+{
+    const VertexShaderDesc* pvdesc = VertexShaderDesc::GetDesc(shader, ShaderDesc::ShaderVersion_GLES30);
+    const FragShaderDesc*   pfdesc = FragShaderDesc::GetDesc(shader, ShaderDesc::ShaderVersion_GLES30);
+
+    // Redundancy checking (don't set the same shader twice in a row).
+    if (CurShader.pVDesc == pvdesc && CurShader.pFDesc == pfdesc && pvdesc)
+        return true;
+
+    if (!pvdesc || !pfdesc)
+    {
+        CurShader.pVDesc = 0;
+        CurShader.pFDesc = 0;
+        CurShader.Type   = ShaderDesc::ST_None;
+        SF_DEBUG_ASSERT1(0, "Shader does not exist (type=%d)", shader);
+        return false;
+    }
+
+    CurShader.pVDesc     = pvdesc;
+    CurShader.pFDesc     = pfdesc;
+    CurShader.Type       = shader;
+    CurShader.ComboIndex = FragShaderDesc::GetShaderComboIndex(shader, ShaderDesc::ShaderVersion_GLES30);
+    pHal->GetCommandLog().Add(Cmd_Shader, shader, CurShader.ComboIndex);
+    return true;
+}
+
+void ShaderInterface::SetTexture(const Shader& sd, unsigned var, Render::Texture* ptex, ImageFillMode fm, unsigned index)
+{
+    Null::Texture* ptexture = (Null::Texture*)ptex;
+    ptexture->ApplyTexture(sd->pFDesc->Uniforms[var].Location + index, fm);
+
+    // Only the fill texture stages are tracked; filter and gradient
+    // samplers are not read back.
+    if (var != Uniform::SU_tex)
+        return;
+    for (unsigned plane = 0; plane < ptexture->GetTextureStageCount(); plane++)
+    {
+        if (index + plane >= MaxTextureBindings)
+            break;
+        TextureBinding& binding = Bindings[index + plane];
+        binding.pTexture = ptexture;
+        binding.Plane    = plane;
+        binding.FillMode = fm;
+    }
+}
+
+const float* ShaderInterface::GetUniformData(unsigned var, unsigned batch) const
+{
+    if (!CurShader)
+        return 0;
+
+    // Same layout as ShaderInterfaceBase::SetUniform.
+    const VertexShaderDesc* pvdesc = CurShader.pVDesc;
+    const FragShaderDesc*   pfdesc = CurShader.pFDesc;
+    if (pvdesc->BatchUniforms[var].Offset >= 0)
+    {
+        const UniformVar& array = pvdesc->Uniforms[pvdesc->BatchUniforms[var].Array];
+        return UniformData + array.ShadowOffset +
+               array.ElementSize * (batch * array.BatchSize + pvdesc->BatchUniforms[var].Offset);
+    }
+    if (pfdesc->BatchUniforms[var].Offset >= 0)
+    {
+        const UniformVar& array = pfdesc->Uniforms[pfdesc->BatchUniforms[var].Array];
+        return UniformData + array.ShadowOffset +
+               array.ElementSize * (batch * array.BatchSize + pfdesc->BatchUniforms[var].Offset);
+    }
+    if (pvdesc->Uniforms[var].Size)
+        return UniformData + pvdesc->Uniforms[var].ShadowOffset;
+    if (pfdesc->Uniforms[var].Size)
+        return UniformData + pfdesc->Uniforms[var].ShadowOffset;
+    return 0;
+}
+
+void ShaderInterface::Finish(unsigned batchCount)
+{
+    ShaderInterfaceBase<Uniform,ShaderPair>::Finish(batchCount);
+
+    if (!CurShader)
+        return;
+
+    for (int var = 0; var < Uniform::SU_Count; var++)
+    {
+        if (UniformSet[var])
+        {
+            const UniformVar* uniformPtr = CurShader.GetUniformVariable(var);
+            if (!uniformPtr || uniformPtr->IsSampler)
+                continue;
+            const UniformVar& uniformDef = *uniformPtr;
+
+            unsigned size;
+            if (uniformDef.BatchSize > 0)
+                size = batchCount * uniformDef.BatchSize;
+            else if (uniformDef.ElementSize)
+                size = uniformDef.Size / uniformDef.ElementSize;
+            else
+                continue;
+
+            pHal->GetCommandLog().AddUniforms(var, UniformData + uniformDef.ShadowOffset,
+                                              size * uniformDef.ElementSize, batchCount);
+        }
+    }
+
+    memset(UniformSet, 0, Uniform::SU_Count);
+}
+
+void ShaderInterface::BeginScene()
+{
+    CurShader.pVDesc = 0;
+    CurShader.pFDesc = 0;
+    CurShader.Type   = ShaderDesc::ST_None;
+    for (unsigned i = 0; i < MaxTextureBindings; i++)
+        Bindings[i] = TextureBinding();
+}
+
+// *** ShaderManager
+
+ShaderManager::ShaderManager(ProfileViews* prof) :
+    StaticShaderManagerType(prof),
+    pHal(0)
+{
+}
+
+bool ShaderManager::Initialize(HAL* phal)
+{
+    pHal = phal;
+    return true;
+}
+
+void ShaderManager::Reset()
+{
+    pHal = 0;
+}
+
+unsigned ShaderManager::SetupFilter(const Filter* filter, unsigned fillFlags, unsigned* passes) const
+{
+    return StaticShaderManagerType::GetFilterPasses(filter, fillFlags, passes);
+}
+
+}}} // Scaleform::Render::Null
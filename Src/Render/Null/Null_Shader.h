@@ -0,0 +1,132 @@
+/**************************************************************************
+
+Filename    :   Null_Shader.h
+Content     :   Shader bookkeeping for the Null HAL
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Null_Shader_H
+#define INC_SF_Render_Null_Shader_H
+
+// The Null HAL has no shaders of its own; it uses the GLES shader
+// descriptors for the uniform layout, so recorded uniform data matches what
+// the GL HAL would upload. The descriptor header is plain data and doesn't
+// need the GL API.
+#include "Render/GL/GLES_ShaderDescs.h"
+#include "Render/Render_Shader.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+using GL::Uniform;
+using GL::UniformVar;
+using GL::BatchVar;
+using GL::ShaderDesc;
+using GL::VertexShaderDesc;
+using GL::FragShaderDesc;
+using GL::UniqueShaderCombinations;
+
+class HAL;
+class Texture;
+
+struct ShaderPair
+{
+    typedef ShaderDesc::ShaderType ShaderType;
+
+    const VertexShaderDesc* pVDesc;
+    const FragShaderDesc*   pFDesc;
+    unsigned                ComboIndex;
+    ShaderType              Type;
+
+    ShaderPair() : pVDesc(0), pFDesc(0), ComboIndex(0), Type(ShaderDesc::ST_None) {}
+
+    operator bool() const { return pVDesc && pFDesc; }
+    const ShaderPair* operator->() const { return this; }
+
+    // Returns the uniform definition for the given variable, or NULL if the
+    // shader doesn't use it.
+    const UniformVar* GetUniformVariable(unsigned var) const;
+};
+
+class ShaderInterface : public ShaderInterfaceBase<Uniform,ShaderPair>
+{
+public:
+    typedef ShaderPair Shader;
+
+    // Texture plane bound to a sampler stage by SetTexture.
+    struct TextureBinding
+    {
+        Null::Texture*  pTexture;
+        unsigned        Plane;
+        ImageFillMode   FillMode;
+
+        TextureBinding() : pTexture(0), Plane(0) { }
+    };
+    enum { MaxTextureBindings = 4 };
+
+    ShaderInterface(Render::HAL* phal);
+
+    const Shader&       GetCurrentShaders() const { return CurShader; }
+    bool                SetStaticShader(ShaderDesc::ShaderType shader, const VertexFormat* pvf);
+
+    void                SetTexture(const Shader& sp, unsigned stage, Render::Texture* ptexture, ImageFillMode fm, unsigned index = 0);
+
+    // Records the uniforms set since the last Finish.
+    void                Finish(unsigned batchCount = 0);
+
+    // Called on BeginScene (resets redundancy checks)
+    void                BeginScene();
+
+    // Returns the current value of a uniform for the given batch index, or
+    // NULL if the current shader doesn't use it. Values stay valid until the
+    // next primitive sets them.
+    const float*        GetUniformData(unsigned var, unsigned batch = 0) const;
+
+    // Returns the texture plane last bound to the given sampler stage.
+    const TextureBinding& GetTextureBinding(unsigned stage) const { return Bindings[stage]; }
+
+protected:
+    HAL*                pHal;
+    ShaderPair          CurShader;
+    TextureBinding      Bindings[MaxTextureBindings];
+};
+
+typedef StaticShaderManager<ShaderDesc, VertexShaderDesc, Uniform, ShaderInterface, Texture> StaticShaderManagerType;
+class ShaderManager : public StaticShaderManagerType, public Unassignable
+{
+public:
+    typedef StaticShaderManager<ShaderDesc, VertexShaderDesc, Uniform, ShaderInterface, Texture> Base;
+    typedef Uniform UniformType;
+
+    ShaderManager(ProfileViews* prof);
+
+    bool    Initialize(HAL* phal);
+    void    Reset();
+
+    // Uses the GLES 3.0 descriptors: they have no uniform count limits and
+    // support instancing.
+    virtual ShaderDesc::ShaderVersion GetShaderVersion() const { return ShaderDesc::ShaderVersion_GLES30; }
+
+    unsigned SetupFilter(const Filter* filter, unsigned fillFlags, unsigned* passes) const;
+
+    bool    HasInstancingSupport() const { return true; }
+
+    // Render targets are stored top-down, so no flipping is needed.
+    static unsigned GetDrawableImageFlags() { return 0; }
+
+    HAL*    GetHAL() const { return pHal; }
+
+protected:
+    HAL*    pHal;
+};
+
+}}} // Scaleform::Render::Null
+
+#endif // INC_SF_Render_Null_Shader_H
@@ -0,0 +1,44 @@
+/**********************************************************************
+
+Filename    :   Null_Sync.h
+Content     :   Fences for the Null HAL, which complete immediately
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+***********************************************************************/
+
+#ifndef INC_SF_Render_Null_Sync_H
+#define INC_SF_Render_Null_Sync_H
+
+#include "Render/Render_Sync.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+// Nothing is executed asynchronously by the Null HAL, so a fence has
+// passed as soon as it is inserted. Handles are still unique, so fence
+// ordering works as on other platforms.
+class RenderSync : public Render::RenderSync
+{
+public:
+    RenderSync() : NextFence(1) { }
+
+    virtual void    KickOffFences(FenceType) { }
+
+protected:
+
+    virtual UInt64  SetFence()                                        { return NextFence++; }
+    virtual bool    IsPending(FenceType, UInt64, const FenceFrame&)  { return false; }
+    virtual bool    WaitFence(FenceType, UInt64, const FenceFrame&)  { return true; }
+
+    UInt64  NextFence;
+};
+
+}}} // Scaleform::Render::Null
+
+#endif // INC_SF_Render_Null_Sync_H
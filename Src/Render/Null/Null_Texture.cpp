@@ -0,0 +1,376 @@
+/**************************************************************************
+
+Filename    :   Null_Texture.cpp
+Content     :   Null HAL Texture and TextureManager implementation
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Null_Texture.h"
+#include "Render/Render_TextureUtil.h"
+#include "Kernel/SF_Debug.h"
+#include "Render/Null/Null_HAL.h"
+
+namespace Scaleform { namespace Render { namespace Null {
+
+
+extern const TextureFormat::Mapping TextureFormatMapping[];
+
+Texture::Texture(TextureManagerLocks* pmanagerLocks, const TextureFormat* pformat,
+                 unsigned mipLevels, const ImageSize& size, unsigned use,
+                 ImageBase* pimage, UInt32 serial) :
+    Render::Texture(pmanagerLocks, size, (UByte)mipLevels, (UInt16)use, pimage, pformat),
+    Serial(serial)
+{
+    TextureCount = (UByte) pformat->GetPlaneCount();
+}
+
+Texture::~Texture()
+{
+    SF_DEBUG_ASSERT(pImage == 0, "pImage must be null, since ImageLost had to be called externally.");
+    Mutex::Locker  lock(&pManagerLocks->TextureMutex);
+
+    if ((State == State_Valid) || (State == State_Lost))
+    {
+        SF_DEBUG_ASSERT(pManagerLocks->pManager, "pManagerLocks->pManager should still be valid for these states.");
+        RemoveNode();
+        pNext = pPrev = 0;
+        ReleaseHWTextures();
+    }
+}
+
+bool Texture::Initialize()
+{
+    ImageFormat     format  = GetImageFormat();
+    TextureManager* pmanager= GetManager();
+
+    // Mipmaps are always generated in software, so they end up in the
+    // backing image like any other level.
+    if (Use & ImageUse_GenMipmaps)
+    {
+        SF_ASSERT(MipLevels == 1);
+        if (!(pmanager->GetTextureUseCaps(format) & ImageUse_GenMipmaps))
+        {
+            TextureFlags |= TF_SWMipGen;
+            unsigned allocMipLevels = 31;
+            for (unsigned itex = 0; itex < TextureCount; itex++)
+                allocMipLevels = Alg::Min(allocMipLevels, ImageSize_MipLevelCount(GetTextureSize(itex)));
+            MipLevels = (UByte)allocMipLevels;
+        }
+    }
+
+    pBackingImage = *RawImage::Create(GetConvFormat(), MipLevels, ImgSize, 0);
+    if (!pBackingImage)
+    {
+        SF_DEBUG_ERROR(1, "CreateTexture failed - couldn't allocate texture storage");
+        State = State_InitFailed;
+        return false;
+    }
+
+    // Upload image content to texture, if any.
+    if (pImage && !Render::Texture::Update())
+    {
+        SF_DEBUG_ERROR(1, "CreateTexture failed - couldn't initialize texture contents");
+
+        ReleaseHWTextures();
+        State = State_InitFailed;
+        return false;
+    }
+
+    State = State_Valid;
+    return Render::Texture::Initialize();
+}
+
+void Texture::uploadImage(ImageData* psource)
+{
+    if (GetHAL())
+        GetHAL()->beginTextureUpdate(this);
+
+    ImageData backingData;
+    pBackingImage->GetImageData(&backingData);
+    ImageFormat format = GetConvFormat();
+
+    for (unsigned itex = 0; itex < TextureCount; itex++)
+    {
+        for (unsigned level = 0; level < MipLevels; level++)
+        {
+            ImagePlane splane, dplane;
+            psource->GetPlane(level * TextureCount + itex, &splane);
+            backingData.GetMipLevelPlane(level, itex, &dplane);
+            ConvertImagePlane(dplane, splane, format, itex, &Image::CopyScanlineDefault, 0);
+        }
+    }
+}
+
+void Texture::ReleaseHWTextures(bool)
+{
+    if (GetManager() && GetHAL())
+        GetHAL()->beginTextureUpdate(this);
+    Render::Texture::ReleaseHWTextures();
+    pBackingImage.Clear();
+}
+
+void Texture::ApplyTexture(unsigned stage, const ImageFillMode& fillMode)
+{
+    Render::Texture::ApplyTexture(stage, fillMode);
+
+    HAL* phal = GetHAL();
+    if (phal)
+    {
+        phal->GetCommandLog().Add(Cmd_Texture, stage, Serial,
+                                  ImgSize.Width | (ImgSize.Height << 16),
+                                  fillMode.GetWrapMode() | (fillMode.GetSampleMode() << 8));
+    }
+}
+
+bool    Texture::Update(const UpdateDesc* updates, unsigned count, unsigned mipLevel)
+{
+    if (!pBackingImage)
+        return false;
+
+    const TextureFormat::Mapping* pmapping = GetTextureFormatMapping();
+    bool inUnmap = pMap != 0;
+
+    if (!GetManager()->mapTexture(this, mipLevel, 1))
+    {
+        SF_DEBUG_WARNING(1, "Texture::Update failed - couldn't map texture");
+        return false;
+    }
+
+    ImageFormat format = GetImageFormat();
+    ImagePlane  dplane;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const UpdateDesc &desc = updates[i];
+        ImagePlane        splane(desc.SourcePlane);
+
+        pMap->Data.GetPlane(desc.PlaneIndex, &dplane);
+        dplane.pData += desc.DestRect.y1 * dplane.Pitch +
+            desc.DestRect.x1 * pmapping->BytesPerPixel;
+
+        splane.SetSize(desc.DestRect.GetSize());
+        dplane.SetSize(desc.DestRect.GetSize());
+        ConvertImagePlane(dplane, splane, format, desc.PlaneIndex,
+            pmapping->CopyFunc, 0);
+    }
+
+    if (!inUnmap)
+        GetManager()->unmapTexture(this);
+    return true;
+}
+
+#ifdef SF_AMP_SERVER
+bool Texture::Copy(ImageData* pdata)
+{
+    Image::CopyScanlineFunc puncopyFunc = pFormat->GetScanlineUncopyFn();
+    if (!GetManager() || !pBackingImage || pFormat->GetImageFormat() != pdata->Format || !puncopyFunc)
+        return false;
+
+    ImageData backingData;
+    pBackingImage->GetImageData(&backingData);
+    SF_ASSERT(pdata->GetPlaneCount() <= backingData.GetPlaneCount());
+
+    for (unsigned ip = 0; ip < pdata->GetPlaneCount(); ip++)
+    {
+        ImagePlane splane, dplane;
+        pdata->GetPlane(ip, &dplane);
+        backingData.GetPlane(ip, &splane);
+        ConvertImagePlane(dplane, splane, GetFormat(), ip, puncopyFunc, 0);
+    }
+    return true;
+}
+#endif // SF_AMP_SERVER
+
+void Texture::computeUpdateConvertRescaleFlags( bool rescale, bool swMipGen, ImageFormat inputFormat,
+                                                ImageRescaleType &rescaleType, ImageFormat &rescaleBuffFromat, bool &convert )
+{
+    SF_UNUSED2(rescale, inputFormat);
+    const TextureFormat::Mapping* pmapping = GetTextureFormatMapping();
+    rescaleBuffFromat = pmapping->ConvFormat;
+    rescaleType = ResizeNone;
+
+    // Textures are never padded to a power of two, so only the software
+    // mipmap generation needs the data in a directly usable format.
+    if (swMipGen && pmapping->Format != pmapping->ConvFormat)
+        convert = true;
+}
+
+// ***** DepthStencilSurface
+
+DepthStencilSurface::DepthStencilSurface(TextureManagerLocks* pmanagerLocks, const ImageSize& size) :
+    Render::DepthStencilSurface(pmanagerLocks, size)
+{
+}
+
+bool DepthStencilSurface::Initialize()
+{
+    State = Texture::State_Valid;
+    return true;
+}
+
+// ***** MappedTexture
+
+bool MappedTexture::Map(Render::Texture* ptexture, unsigned mipLevel, unsigned levelCount)
+{
+    SF_ASSERT(!IsMapped());
+    SF_ASSERT((mipLevel + levelCount) <= ptexture->MipLevels);
+
+    Texture* nullTexture = reinterpret_cast<Texture*>(ptexture);
+    if (!nullTexture->pBackingImage)
+        return false;
+    if (nullTexture->GetHAL())
+        nullTexture->GetHAL()->beginTextureUpdate(nullTexture);
+
+    // Initialize Data as efficiently as possible.
+    ImageFormat format = nullTexture->GetConvFormat();
+    if (levelCount <= PlaneReserveSize)
+        Data.Initialize(format, levelCount, Planes, ptexture->GetPlaneCount(), true);
+    else if (!Data.Initialize(format, levelCount, true))
+        return false;
+
+    pTexture      = ptexture;
+    StartMipLevel = mipLevel;
+    LevelCount    = levelCount;
+
+    unsigned textureCount = ptexture->TextureCount;
+    ImageData BackingData;
+    nullTexture->pBackingImage->GetImageData(&BackingData);
+
+    for (unsigned itex = 0; itex < textureCount; itex++)
+    {
+        ImagePlane plane;
+        for (unsigned level = 0; level < levelCount; level++)
+        {
+            BackingData.GetMipLevelPlane(level + StartMipLevel, itex, &plane);
+            Data.SetPlane(level * textureCount + itex, plane);
+        }
+    }
+
+    pTexture->pMap = this;
+    return true;
+}
+
+// ***** TextureManager
+
+TextureManager::TextureManager(ThreadId renderThreadId, ThreadCommandQueue* commandQueue, TextureCache* texCache) :
+    Render::TextureManager(renderThreadId, commandQueue, texCache),
+    pHal(0),
+    NextSerial(1)
+{
+}
+
+TextureManager::~TextureManager()
+{
+    Mutex::Locker lock(&pLocks->TextureMutex);
+
+    // InitTextureQueue MUST be empty, or there was a thread
+    // service problem.
+    SF_ASSERT(TextureInitQueue.IsEmpty());
+    processTextureKillList();
+
+    // Notify all textures
+    while (!Textures.IsEmpty())
+        Textures.GetFirst()->LoseManager();
+
+    pLocks->pManager = 0;
+}
+
+// Color formats are widened to R8G8B8A8, so every color texture can be
+// read the same way.
+const TextureFormat::Mapping TextureFormatMapping[] =
+{
+    // Standard formats.
+    { Image_R8G8B8A8,   Image_R8G8B8A8,     4, &Image::CopyScanlineDefault,            &Image::CopyScanlineDefault },
+    { Image_B8G8R8A8,   Image_R8G8B8A8,     4, &Image_CopyScanline32_SwapBR,           &Image_CopyScanline32_SwapBR },
+    { Image_R8G8B8,     Image_R8G8B8A8,     4, &Image_CopyScanline24_Extend_RGB_RGBA,  &Image_CopyScanline32_Retract_RGBA_RGB },
+    { Image_B8G8R8,     Image_R8G8B8A8,     4, &Image_CopyScanline24_Extend_RGB_BGRA,  &Image_CopyScanline32_Retract_BGRA_RGB },
+    { Image_A8,         Image_A8,           1, &Image::CopyScanlineDefault,            &Image::CopyScanlineDefault },
+
+    // Video formats.
+    { Image_Y8_U2_V2,   Image_Y8_U2_V2,     1, &Image::CopyScanlineDefault,            &Image::CopyScanlineDefault },
+    { Image_Y8_U2_V2_A8,Image_Y8_U2_V2_A8,  1, &Image::CopyScanlineDefault,            &Image::CopyScanlineDefault },
+
+    { Image_None, Image_None, 0, 0, 0 }
+};
+
+void TextureManager::Initialize(HAL* phal)
+{
+    RenderThreadId = GetCurrentThreadId();
+    pHal = phal;
+    initTextureFormats();
+}
+
+void TextureManager::initTextureFormats()
+{
+    if (pHal == 0 || TextureFormats.GetSize() != 0)
+        return;
+
+    for (const TextureFormat::Mapping* pmapping = TextureFormatMapping; pmapping->Format != Image_None; pmapping++)
+    {
+        TextureFormat* tf = SF_HEAP_AUTO_NEW(this) TextureFormat(pmapping);
+        TextureFormats.PushBack(tf);
+    }
+}
+
+void    TextureManager::processInitTextures()
+{
+    // TextureMutex lock expected externally.
+    if (!TextureInitQueue.IsEmpty())
+    {
+        do {
+            Render::Texture* ptexture = TextureInitQueue.GetFirst();
+            ptexture->RemoveNode();
+            ptexture->pPrev = ptexture->pNext = 0;
+            if (ptexture->Initialize())
+                Textures.PushBack(ptexture);
+
+        } while (!TextureInitQueue.IsEmpty());
+        pLocks->TextureInitWC.NotifyAll();
+    }
+}
+
+Render::Texture* TextureManager::CreateTexture(ImageFormat format, unsigned mipLevels,
+                                               const ImageSize& size, unsigned use,
+                                               ImageBase* pimage, Render::MemoryManager* allocManager)
+{
+    SF_UNUSED(allocManager);
+
+    TextureFormat* ptformat = (TextureFormat*)precreateTexture(format, use, pimage);
+    if ( !ptformat )
+        return 0;
+
+    Render::Texture* ptexture =
+        SF_HEAP_AUTO_NEW(this) Texture(pLocks, ptformat, mipLevels, size, use, pimage, NextSerial++);
+
+    return postCreateTexture(ptexture, use);
+}
+
+Render::DepthStencilSurface* TextureManager::CreateDepthStencilSurface(const ImageSize& size, MemoryManager* manager)
+{
+    SF_UNUSED(manager);
+    DepthStencilSurface* pdss = SF_HEAP_AUTO_NEW(this) DepthStencilSurface(pLocks, size);
+    return postCreateDepthStencilSurface(pdss);
+}
+
+unsigned TextureManager::GetTextureUseCaps(ImageFormat format)
+{
+    // GenMipmaps is left out on purpose: the base Update then builds the
+    // mip levels in software, so they are stored like the top level.
+    unsigned use = ImageUse_Update | ImageUse_NoDataLoss | ImageUse_PartialUpdate |
+                   ImageUse_MapRenderThread;
+
+    const Render::TextureFormat* ptformat = getTextureFormat(format);
+    if (!ptformat)
+        return 0;
+    return use;
+}
+
+}}} // Scaleform::Render::Null
@@ -0,0 +1,174 @@
+/**************************************************************************
+
+Filename    :   Null_Texture.h
+Content     :   Null HAL Texture and TextureManager, kept in system memory
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Null_Texture_H
+#define INC_SF_Render_Null_Texture_H
+
+#include "Kernel/SF_List.h"
+#include "Kernel/SF_Threads.h"
+#include "Render/Render_Image.h"
+#include "Render/Render_MemoryManager.h"
+#include "Kernel/SF_HeapNew.h"
+
+namespace Scaleform { namespace Render {
+
+class ThreadCommandQueue;
+
+namespace Null {
+
+
+// TextureFormat describes format of the texture and its caps.
+// Textures are stored in ConvFormat; the Null HAL keeps only a few of
+// them (R8G8B8A8 and single channel planes), so texture contents can be
+// read back directly.
+
+struct TextureFormat : public Render::TextureFormat
+{
+    struct Mapping
+    {
+        ImageFormat              Format, ConvFormat;
+        UByte                    BytesPerPixel;
+        Image::CopyScanlineFunc  CopyFunc;
+        Image::CopyScanlineFunc  UncopyFunc;
+    };
+    const Mapping*  pMapping;
+
+    TextureFormat(const TextureFormat::Mapping* pmapping = 0) : pMapping(pmapping) { }
+
+    virtual ImageFormat             GetImageFormat() const      { return pMapping->Format; }
+    virtual Image::CopyScanlineFunc GetScanlineCopyFn() const   { return pMapping->CopyFunc; }
+    virtual Image::CopyScanlineFunc GetScanlineUncopyFn() const { return pMapping->UncopyFunc; }
+};
+
+class MappedTexture;
+class TextureManager;
+class HAL;
+
+
+// Null Texture class implementation. The texture data lives in
+// pBackingImage, which always holds all planes and mip levels in
+// the ConvFormat of the texture format.
+
+class Texture : public Render::Texture
+{
+public:
+    Ptr<RawImage>           pBackingImage;
+    UInt32                  Serial;         // Creation order within the manager; identifies the texture in command logs.
+
+    Texture(TextureManagerLocks* pmanagerLocks, const TextureFormat* pformat, unsigned mipLevels,
+            const ImageSize& size, unsigned use, ImageBase* pimage, UInt32 serial);
+    ~Texture();
+
+    TextureManager*         GetManager() const     { return (TextureManager*)pManagerLocks->pManager; }
+    inline  HAL*            GetHAL() const;
+    virtual bool            IsValid() const        { return pBackingImage != 0; }
+
+    virtual bool            Initialize();
+    virtual void            ReleaseHWTextures(bool staging = true);
+    virtual void            ApplyTexture(unsigned stage, const ImageFillMode& fillMode);
+
+    // *** Interface implementation
+
+    virtual Image*                  GetImage() const                        { SF_ASSERT(!pImage || (pImage->GetImageType() != Image::Type_ImageBase)); return (Image*)pImage; }
+    virtual ImageFormat             GetFormat() const                       { return GetImageFormat(); }
+    virtual ImageSize               GetTextureSize(unsigned plane =0) const { return ImageData::GetFormatPlaneSize(GetConvFormat(), ImgSize, plane); }
+    const TextureFormat*            GetTextureFormat() const                { return reinterpret_cast<const TextureFormat*>(pFormat); }
+    const TextureFormat::Mapping*   GetTextureFormatMapping() const         { return pFormat ? reinterpret_cast<const TextureFormat*>(pFormat)->pMapping : 0; }
+    // Format of the data in pBackingImage.
+    ImageFormat                     GetConvFormat() const                   { return GetTextureFormatMapping()->ConvFormat; }
+
+    virtual bool            Update(const UpdateDesc* updates, unsigned count = 1, unsigned mipLevel = 0);
+
+    // Copies the image data from the backing image.
+    SF_AMP_CODE( virtual bool Copy(ImageData* pdata); )
+
+protected:
+    virtual void            computeUpdateConvertRescaleFlags( bool rescale, bool swMipGen, ImageFormat inputFormat,
+                                                              ImageRescaleType &rescaleType, ImageFormat &rescaleBuffFromat, bool &convert );
+    virtual void            uploadImage(ImageData* psource);
+};
+
+// Null DepthStencilSurface implementation. Stencil is not stored; the
+// HAL only records the stencil state.
+class DepthStencilSurface : public Render::DepthStencilSurface
+{
+public:
+    DepthStencilSurface(TextureManagerLocks* pmanagerLocks, const ImageSize& size);
+
+    bool                    Initialize();
+};
+
+// *** MappedTexture
+class MappedTexture : public MappedTextureBase
+{
+    friend class Texture;
+
+public:
+    MappedTexture() : MappedTextureBase() { }
+
+    virtual bool Map(Render::Texture* ptexture, unsigned mipLevel, unsigned levelCount);
+};
+
+
+// Null Texture Manager.
+// This class is responsible for creating textures and keeping track of them
+// in the list.
+
+class TextureManager : public Render::TextureManager
+{
+    friend class Texture;
+    friend class DepthStencilSurface;
+public:
+    TextureManager(ThreadId renderThreadId, ThreadCommandQueue* commandQueue, TextureCache* texCache = 0);
+    ~TextureManager();
+
+    void            Initialize(HAL* phal);
+
+    // *** TextureManager
+    virtual Render::Texture* CreateTexture(ImageFormat format, unsigned mipLevels,
+                                           const ImageSize& size, unsigned use,
+                                           ImageBase* pimage = 0,
+                                           Render::MemoryManager* manager = 0);
+
+    virtual Render::DepthStencilSurface* CreateDepthStencilSurface(const ImageSize& size,
+                                                           MemoryManager* manager = 0);
+
+    virtual bool    IsDrawableImageFormat(ImageFormat format) const { return (format == Image_B8G8R8A8) || (format == Image_R8G8B8A8); }
+
+    unsigned        GetTextureUseCaps(ImageFormat format);
+
+protected:
+    MappedTexture       MappedTexture0;
+
+    HAL*                pHal;
+    UInt32              NextSerial;
+
+    HAL* GetHAL() const { return pHal; }
+
+    void                         initTextureFormats();
+    virtual MappedTextureBase&   getDefaultMappedTexture() { return MappedTexture0; }
+    virtual MappedTextureBase*   createMappedTexture()     { return SF_HEAP_AUTO_NEW(this) MappedTexture; }
+
+    virtual void    processInitTextures();
+};
+
+Null::HAL* Texture::GetHAL() const
+{
+    return ((Null::TextureManager*)pManagerLocks->pManager)->pHal;
+}
+
+}}} // Scaleform::Render::Null
+
+#endif // INC_SF_Render_Null_Texture_H
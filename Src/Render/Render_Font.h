@@ -344,6 +344,19 @@ public:
         return (UpperCaseTop <= 0) ? 0 : UpperCaseTop; 
     }
 
+    // Outline hashes of GlyphRasterStore::GetOutlineHash, cached for the lifetime of
+    // the font so store lookups don't walk the glyph shape every time. Thread-safe.
+    bool GetCachedOutlineHash(UInt32 key, UInt32* phash) const
+    {
+        Lock::Locker lock(&OutlineHashLock);
+        return OutlineHashes.Get(key, phash);
+    }
+    void SetCachedOutlineHash(UInt32 key, UInt32 hash) const
+    {
+        Lock::Locker lock(&OutlineHashLock);
+        OutlineHashes.Set(key, hash);
+    }
+
 protected:
     UInt16 calcTopBound(UInt16 code);
     void   calcLowerUpperTop(GlyphCache* log);
@@ -370,6 +383,10 @@ protected:
     unsigned Flags;   // Described by FontFlags enum.  
     SInt16   LowerCaseTop, UpperCaseTop;
     FontCacheHandleRef  hRef;
+
+private:
+    mutable Lock        OutlineHashLock;
+    mutable HashLH<UInt32, UInt32, FixedSizeHash<UInt32>, StatRender_Font_Mem> OutlineHashes;
 };
 
 
@@ -30,6 +30,8 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Render_GlyphFitter.h"
 #include "Render_Rasterizer.h"
 #include "Render_Stroker.h"
+#include "Render_GlyphRasterStore.h"
+#include "Render_GlyphDistField.h"
 
 namespace Scaleform { namespace Render {
 
@@ -271,6 +273,27 @@ public:
 
     float                   GetMaxRasterScale() const   { return Param.MaxRasterScale; }
 
+    // Optional store of pre-rasterized glyphs (filled by GlyphCacheWarmup or
+    // loaded from disk). It is consulted before the font's own raster and the
+    // Rasterizer, and receives newly rasterized glyphs so it can be saved.
+    void                    SetRasterStore(GlyphRasterStore* store) { pRasterStore = store; }
+    GlyphRasterStore*       GetRasterStore() const      { return pRasterStore; }
+
+    // Distance field glyphs, shared by all sizes above Param.DistFieldMinSize.
+    // Created on demand when Param.UseDistanceFields is set.
+    DistFieldGlyphCache*    GetDistFieldCache()
+    {
+        if (!pDistFieldCache && Param.UseDistanceFields)
+        {
+            DistFieldParams dfp(Param.DistFieldMultiChannel ? DistFieldParams::Field_MSDF : DistFieldParams::Field_SDF,
+                                Param.DistFieldBaseSize, Param.DistFieldSpread);
+            pDistFieldCache = *SF_HEAP_NEW(pHeap) DistFieldGlyphCache(pHeap, dfp);
+        }
+        return pDistFieldCache;
+    }
+    bool                    UseDistanceField(float screenSize) const
+    { return Param.UseDistanceFields && screenSize >= Param.DistFieldMinSize; }
+
     float GetScaleU() const { return ScaleU; }
     float GetScaleV() const { return ScaleV; }
 
@@ -360,6 +383,15 @@ private:
 
     GlyphNode* allocateGlyph(TextMeshProvider* tm, const GlyphParam& gp, unsigned w, unsigned h);
     GlyphNode* getPrerasterizedGlyph(GlyphRunData& data, TextMeshProvider* tm, const GlyphParam& gp);
+
+    // Fetches a raster from the raster store, falling back to Font::GetGlyphRaster.
+    // autoFit is whether the glyph would go through addShapeAutoFit.
+    bool getStoredGlyphRaster(Font* font, unsigned glyphIndex, unsigned hintedSize, bool autoFit, GlyphRaster* raster)
+    {
+        if (pRasterStore && pRasterStore->GetRaster(font, glyphIndex, hintedSize, autoFit, raster))
+            return true;
+        return font->GetGlyphRaster(glyphIndex, hintedSize, raster);
+    }
     void partialUpdateTextures();
     void copyImageData(ImagePlane* pl, const UByte* data, unsigned pitch, 
                        unsigned dstX, unsigned dstY, unsigned w, unsigned h);
@@ -412,6 +444,8 @@ private:
     List<TextMeshProvider>                      TextInPin;
     EvictNotifier                               Notifier;
     Ptr<FontCacheHandleManager>                 pFontHandleManager;
+    Ptr<GlyphRasterStore>                       pRasterStore;
+    Ptr<DistFieldGlyphCache>                    pDistFieldCache;
     RQCacheInterface*                           pRQCaches;
     Log*                                        pLog;
 
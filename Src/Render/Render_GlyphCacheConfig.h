@@ -48,6 +48,15 @@ struct GlyphCacheParams
     // during a single frame of rendering.
     bool     FenceWaitOnFullCache;
 
+    // Distance field glyphs: when enabled, glyphs larger than DistFieldMinSize
+    // pixels are drawn from one DistFieldBaseSize field per glyph (see
+    // GlyphDistFieldGenerator) instead of a raster per size.
+    bool     UseDistanceFields;
+    bool     DistFieldMultiChannel;
+    unsigned DistFieldBaseSize;
+    float    DistFieldSpread;
+    float    DistFieldMinSize;
+
     // Configures dynamic GlyphCache rendering.
     // Pass NumTextures == 0 to disable dynamic cache.
     GlyphCacheParams(unsigned numTextures = 1,
@@ -70,7 +79,12 @@ struct GlyphCacheParams
         ShadowQuality(1.0f),
         UseAutoFit(true),
         UseVectorOnFullCache(true),
-        FenceWaitOnFullCache(true)
+        FenceWaitOnFullCache(true),
+        UseDistanceFields(false),
+        DistFieldMultiChannel(true),
+        DistFieldBaseSize(32),
+        DistFieldSpread(4.0f),
+        DistFieldMinSize(48.0f)
     {}
 
 };
@@ -0,0 +1,577 @@
+/**************************************************************************
+
+Filename    :   Render_GlyphDistField.cpp
+Content     :   Signed distance field (SDF/MSDF) glyph generation
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render_GlyphDistField.h"
+#include "Render_GlyphRasterStore.h"
+#include "Render_Rasterizer.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_Alg.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace Scaleform { namespace Render {
+
+static inline float DistField_Median(float a, float b, float c)
+{
+    return Alg::Max(Alg::Min(a, b), Alg::Min(Alg::Max(a, b), c));
+}
+
+//------------------------------------------------------------------------
+float DistFieldGlyph::GetDistance(unsigned x, unsigned y) const
+{
+    const UByte* p = &Data[(y * Width + x) * Channels];
+    float v = (Channels >= 3) ? DistField_Median(p[0], p[1], p[2]) : float(p[0]);
+    return (v / 255.0f - 0.5f) * 2.0f * Spread;
+}
+
+float DistFieldGlyph::SampleDistance(float x, float y) const
+{
+    x = Alg::Clamp(x - 0.5f, 0.0f, float(Width  - 1));
+    y = Alg::Clamp(y - 0.5f, 0.0f, float(Height - 1));
+    unsigned x0 = unsigned(x), y0 = unsigned(y);
+    unsigned x1 = Alg::Min(x0 + 1, Width - 1), y1 = Alg::Min(y0 + 1, Height - 1);
+    float    fx = x - x0, fy = y - y0;
+
+    // Channels are interpolated before the median, like the texture unit does.
+    float ch[3];
+    unsigned n = Alg::Min(Channels, 3u);
+    for (unsigned c = 0; c < n; ++c)
+    {
+        float v00 = Data[(y0 * Width + x0) * Channels + c];
+        float v10 = Data[(y0 * Width + x1) * Channels + c];
+        float v01 = Data[(y1 * Width + x0) * Channels + c];
+        float v11 = Data[(y1 * Width + x1) * Channels + c];
+        ch[c] = Alg::Lerp(Alg::Lerp(v00, v10, fx), Alg::Lerp(v01, v11, fx), fy);
+    }
+    float v = (n >= 3) ? DistField_Median(ch[0], ch[1], ch[2]) : ch[0];
+    return (v / 255.0f - 0.5f) * 2.0f * Spread;
+}
+
+
+//------------------------------------------------------------------------
+GlyphDistFieldGenerator::GlyphDistFieldGenerator(MemoryHeap* heap) :
+    pHeap(heap ? heap : Memory::GetGlobalHeap()),
+    LastX(0), LastY(0), StartX(0), StartY(0), EdgeIndex(0), Orientation(1.0f)
+{
+}
+
+void GlyphDistFieldGenerator::addSegment(float x, float y, float tx1, float ty1, float tx2, float ty2)
+{
+    Segment s = { LastX, LastY, x, y, tx1, ty1, tx2, ty2, EdgeIndex, Color_White };
+    Segments.PushBack(s);
+    LastX = x;
+    LastY = y;
+}
+
+void GlyphDistFieldGenerator::addEdgeLine(float x, float y)
+{
+    if (x == LastX && y == LastY)
+        return;
+    addSegment(x, y, x - LastX, y - LastY, x - LastX, y - LastY);
+    EdgeIndex++;
+}
+
+// Curves are flattened into segments that all carry the same edge index,
+// so corner detection and coloring see the curve as one edge. Each segment
+// records the curve's derivative at its ends; at a degenerate end (control
+// point on the end point) the derivative vanishes and the corner test
+// falls back to the segment itself.
+void GlyphDistFieldGenerator::addEdgeQuad(float cx, float cy, float x, float y)
+{
+    float    len   = sqrtf((cx - LastX) * (cx - LastX) + (cy - LastY) * (cy - LastY)) +
+                     sqrtf((x - cx) * (x - cx) + (y - cy) * (y - cy));
+    unsigned steps = Alg::Clamp(unsigned(len * 0.5f) + 2, 2u, 32u);
+    float    x0 = LastX, y0 = LastY;
+    float    tx = cx - x0, ty = cy - y0;
+
+    for (unsigned i = 1; i <= steps; ++i)
+    {
+        float t  = float(i) / float(steps);
+        float t1 = 1.0f - t;
+        float px = t1 * t1 * x0 + 2.0f * t1 * t * cx + t * t * x;
+        float py = t1 * t1 * y0 + 2.0f * t1 * t * cy + t * t * y;
+        float nx = t1 * (cx - x0) + t * (x - cx);
+        float ny = t1 * (cy - y0) + t * (y - cy);
+        addSegment(px, py, tx, ty, nx, ny);
+        tx = nx;
+        ty = ny;
+    }
+    EdgeIndex++;
+}
+
+void GlyphDistFieldGenerator::addEdgeCubic(float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+    float    len   = sqrtf((c1x - LastX) * (c1x - LastX) + (c1y - LastY) * (c1y - LastY)) +
+                     sqrtf((c2x - c1x) * (c2x - c1x) + (c2y - c1y) * (c2y - c1y)) +
+                     sqrtf((x - c2x) * (x - c2x) + (y - c2y) * (y - c2y));
+    unsigned steps = Alg::Clamp(unsigned(len * 0.5f) + 3, 3u, 48u);
+    float    x0 = LastX, y0 = LastY;
+    float    tx = c1x - x0, ty = c1y - y0;
+
+    for (unsigned i = 1; i <= steps; ++i)
+    {
+        float t  = float(i) / float(steps);
+        float t1 = 1.0f - t;
+        float px = t1 * t1 * t1 * x0 + 3.0f * t1 * t1 * t * c1x + 3.0f * t1 * t * t * c2x + t * t * t * x;
+        float py = t1 * t1 * t1 * y0 + 3.0f * t1 * t1 * t * c1y + 3.0f * t1 * t * t * c2y + t * t * t * y;
+        float nx = t1 * t1 * (c1x - x0) + 2.0f * t1 * t * (c2x - c1x) + t * t * (x - c2x);
+        float ny = t1 * t1 * (c1y - y0) + 2.0f * t1 * t * (c2y - c1y) + t * t * (y - c2y);
+        addSegment(px, py, tx, ty, nx, ny);
+        tx = nx;
+        ty = ny;
+    }
+    EdgeIndex++;
+}
+
+void GlyphDistFieldGenerator::closeContour()
+{
+    if (LastX != StartX || LastY != StartY)
+        addEdgeLine(StartX, StartY);
+
+    unsigned start = Contours.GetSize() ? Contours.Back().Start + Contours.Back().Count : 0;
+    Contour  c;
+    c.Start     = start;
+    c.Count     = unsigned(Segments.GetSize()) - start;
+    c.EdgeCount = EdgeIndex;
+    if (c.Count)
+        Contours.PushBack(c);
+    EdgeIndex = 0;
+}
+
+// Marks corners at edge junctions and colors the runs between corners.
+// Contours without corners stay white (all channels), which degenerates
+// to a plain SDF for them - correct, since they have no corners to keep.
+void GlyphDistFieldGenerator::colorEdges()
+{
+    float cornerSin = sinf(Params.CornerAngle);
+
+    for (UPInt ci = 0; ci < Contours.GetSize(); ++ci)
+    {
+        const Contour& c = Contours[ci];
+        Segment* segs = &Segments[c.Start];
+
+        // Corners are recorded by the edge that starts at them.
+        ArrayLH_POD<unsigned, StatRender_Font_Mem> corners;
+        for (unsigned i = 0; i < c.Count; ++i)
+        {
+            const Segment& prev = segs[(i + c.Count - 1) % c.Count];
+            const Segment& cur  = segs[i];
+            if (prev.Edge == cur.Edge && c.EdgeCount > 1)
+                continue;
+
+            // Compare the edges' own tangents at the junction; the chords of
+            // flattened curves turn by up to a step angle even where the
+            // curves join smoothly.
+            float ax = prev.tx2, ay = prev.ty2;
+            float bx = cur.tx1,  by = cur.ty1;
+            float la = sqrtf(ax * ax + ay * ay), lb = sqrtf(bx * bx + by * by);
+            if (la == 0)
+            {
+                ax = prev.x2 - prev.x1; ay = prev.y2 - prev.y1;
+                la = sqrtf(ax * ax + ay * ay);
+            }
+            if (lb == 0)
+            {
+                bx = cur.x2 - cur.x1; by = cur.y2 - cur.y1;
+                lb = sqrtf(bx * bx + by * by);
+            }
+            if (la == 0 || lb == 0)
+                continue;
+            float dot   = (ax * bx + ay * by) / (la * lb);
+            float cross = (ax * by - ay * bx) / (la * lb);
+            if (dot <= 0 || fabsf(cross) > cornerSin)
+                corners.PushBack(i);
+        }
+
+        if (corners.GetSize() == 0)
+            continue;
+
+        // Colors cycle through channel pairs. With a single corner the
+        // contour is split in three so the corner still sees two colors.
+        static const unsigned cycle[2] = { Color_Cyan, Color_Magenta };
+        if (corners.GetSize() == 1)
+        {
+            static const unsigned three[3] = { Color_Magenta, Color_Yellow, Color_Cyan };
+            for (unsigned i = 0; i < c.Count; ++i)
+            {
+                unsigned rel = (i + c.Count - corners[0]) % c.Count;
+                segs[i].Color = three[Alg::Min(rel * 3 / c.Count, 2u)];
+            }
+            continue;
+        }
+
+        unsigned nc = unsigned(corners.GetSize());
+        for (unsigned k = 0; k < nc; ++k)
+        {
+            // The last run must differ from both neighbors when the count is odd.
+            unsigned color = (k == nc - 1 && (nc & 1)) ? unsigned(Color_Yellow) : cycle[k & 1];
+            unsigned from  = corners[k];
+            unsigned to    = corners[(k + 1) % nc];
+            for (unsigned i = from; i != to; i = (i + 1) % c.Count)
+                segs[i].Color = color;
+        }
+    }
+}
+
+// Non-zero winding test, matching the fill rule used for glyphs.
+bool GlyphDistFieldGenerator::isInside(float x, float y) const
+{
+    int winding = 0;
+    for (UPInt i = 0; i < Segments.GetSize(); ++i)
+    {
+        const Segment& s = Segments[i];
+        if (s.y1 <= y)
+        {
+            if (s.y2 > y && (s.x2 - s.x1) * (y - s.y1) - (x - s.x1) * (s.y2 - s.y1) > 0)
+                winding++;
+        }
+        else if (s.y2 <= y && (s.x2 - s.x1) * (y - s.y1) - (x - s.x1) * (s.y2 - s.y1) < 0)
+            winding--;
+    }
+    return winding != 0;
+}
+
+// Distance to the nearest segment whose color overlaps channelMask. For the
+// full mask the sign comes from the winding test; for single channels it
+// comes from the side of the nearest segment, which is what lets the median
+// of three channels reconstruct sharp corners.
+float GlyphDistFieldGenerator::signedDistance(float x, float y, unsigned channelMask, bool inside) const
+{
+    float bestDist  = 1e30f;
+    float bestOrtho = 0;
+    float bestSide  = 0;
+
+    for (UPInt i = 0; i < Segments.GetSize(); ++i)
+    {
+        const Segment& s = Segments[i];
+        if (!(s.Color & channelMask))
+            continue;
+
+        float dx = s.x2 - s.x1, dy = s.y2 - s.y1;
+        float len2 = dx * dx + dy * dy;
+        float t = (len2 > 0) ? ((x - s.x1) * dx + (y - s.y1) * dy) / len2 : 0.0f;
+        t = Alg::Clamp(t, 0.0f, 1.0f);
+        float px = x - (s.x1 + t * dx), py = y - (s.y1 + t * dy);
+        float dist = sqrtf(px * px + py * py);
+        float cross = dx * py - dy * px;
+        float ortho = (dist > 0 && len2 > 0) ? fabsf(cross) / (dist * sqrtf(len2)) : 1.0f;
+
+        // At shared endpoints prefer the segment the point is more orthogonal to.
+        if (dist < bestDist - 1e-4f || (dist < bestDist + 1e-4f && ortho > bestOrtho))
+        {
+            bestDist  = dist;
+            bestOrtho = ortho;
+            bestSide  = cross * Orientation;
+        }
+    }
+
+    if (channelMask == Color_White)
+        return inside ? bestDist : -bestDist;
+    return (bestSide >= 0) ? bestDist : -bestDist;
+}
+
+bool GlyphDistFieldGenerator::Generate(const ShapeDataInterface* shape, float shapeScale,
+                                       DistFieldGlyph* glyph)
+{
+    Segments.Clear();
+    Contours.Clear();
+    EdgeIndex = 0;
+
+    float         coord[Edge_MaxCoord];
+    unsigned      styles[3];
+    ShapePosInfo  pos(shape->GetStartingPos());
+    ShapePathType pathType;
+    while ((pathType = shape->ReadPathInfo(&pos, coord, styles)) != Shape_EndShape)
+    {
+        StartX = LastX = coord[0] * shapeScale;
+        StartY = LastY = coord[1] * shapeScale;
+
+        PathEdgeType edgeType;
+        while ((edgeType = shape->ReadEdge(&pos, coord)) != Edge_EndPath)
+        {
+            if (edgeType == Edge_LineTo)
+                addEdgeLine(coord[0] * shapeScale, coord[1] * shapeScale);
+            else if (edgeType == Edge_QuadTo)
+                addEdgeQuad(coord[0] * shapeScale, coord[1] * shapeScale,
+                            coord[2] * shapeScale, coord[3] * shapeScale);
+            else if (edgeType == Edge_CubicTo)
+                addEdgeCubic(coord[0] * shapeScale, coord[1] * shapeScale,
+                             coord[2] * shapeScale, coord[3] * shapeScale,
+                             coord[4] * shapeScale, coord[5] * shapeScale);
+        }
+        closeContour();
+    }
+
+    if (Segments.GetSize() == 0)
+        return false;
+
+    // Bounds and orientation; the sum of contour areas has the sign of
+    // the outer contours, since holes wind the other way.
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    float area = 0;
+    for (UPInt i = 0; i < Segments.GetSize(); ++i)
+    {
+        const Segment& s = Segments[i];
+        minX = Alg::Min(minX, Alg::Min(s.x1, s.x2));
+        minY = Alg::Min(minY, Alg::Min(s.y1, s.y2));
+        maxX = Alg::Max(maxX, Alg::Max(s.x1, s.x2));
+        maxY = Alg::Max(maxY, Alg::Max(s.y1, s.y2));
+        area += s.x1 * s.y2 - s.x2 * s.y1;
+    }
+    Orientation = (area >= 0) ? 1.0f : -1.0f;
+
+    bool msdf = (Params.Type == DistFieldParams::Field_MSDF);
+    if (msdf)
+        colorEdges();
+
+    int pad  = int(ceilf(Params.Spread)) + 1;
+    int left = int(floorf(minX)) - pad;
+    int top  = int(floorf(minY)) - pad;
+
+    glyph->Width    = unsigned(int(ceilf(maxX)) + pad - left);
+    glyph->Height   = unsigned(int(ceilf(maxY)) + pad - top);
+    glyph->Channels = msdf ? 3 : 1;
+    glyph->OriginX  = -left;
+    glyph->OriginY  = -top;
+    glyph->BaseSize = Params.BaseSize;
+    glyph->Spread   = Params.Spread;
+    glyph->Data.Resize(glyph->Width * glyph->Height * glyph->Channels);
+
+    float  toValue = 255.0f / (2.0f * Params.Spread);
+    UByte* dst     = glyph->Data.GetDataPtr();
+
+    for (unsigned y = 0; y < glyph->Height; ++y)
+    {
+        float py = float(top) + y + 0.5f;
+        for (unsigned x = 0; x < glyph->Width; ++x)
+        {
+            float px     = float(left) + x + 0.5f;
+            bool  inside = isInside(px, py);
+            float sdf    = signedDistance(px, py, Color_White, inside);
+
+            if (!msdf)
+            {
+                *dst++ = UByte(Alg::Clamp(sdf * toValue + 127.5f, 0.0f, 255.0f));
+                continue;
+            }
+
+            float r = signedDistance(px, py, Color_Red,   inside);
+            float g = signedDistance(px, py, Color_Green, inside);
+            float b = signedDistance(px, py, Color_Blue,  inside);
+
+            // Error correction: fall back to the true distance where the
+            // median would put the texel on the wrong side of the outline.
+            if ((DistField_Median(r, g, b) > 0) != inside)
+                r = g = b = sdf;
+
+            dst[0] = UByte(Alg::Clamp(r * toValue + 127.5f, 0.0f, 255.0f));
+            dst[1] = UByte(Alg::Clamp(g * toValue + 127.5f, 0.0f, 255.0f));
+            dst[2] = UByte(Alg::Clamp(b * toValue + 127.5f, 0.0f, 255.0f));
+            dst += 3;
+        }
+    }
+    return true;
+}
+
+bool GlyphDistFieldGenerator::GenerateGlyph(Font* font, unsigned glyphIndex, DistFieldGlyph* glyph)
+{
+    const ShapeDataInterface* shape = font->GetPermanentGlyphShape(glyphIndex);
+    GlyphShape tmpShape;
+    if (!shape)
+    {
+        // Unhinted outline: request it at the nominal size.
+        if (!font->GetTemporaryGlyphShape(glyphIndex, 0, &tmpShape))
+            return false;
+        shape = &tmpShape;
+    }
+    return Generate(shape, float(Params.BaseSize) / font->GetNominalGlyphHeight(), glyph);
+}
+
+//------------------------------------------------------------------------
+unsigned GlyphDistFieldGenerator::GetRenderWidth(const DistFieldGlyph& glyph, float size)
+{
+    return unsigned(ceilf(glyph.Width * size / float(glyph.BaseSize)));
+}
+
+unsigned GlyphDistFieldGenerator::GetRenderHeight(const DistFieldGlyph& glyph, float size)
+{
+    return unsigned(ceilf(glyph.Height * size / float(glyph.BaseSize)));
+}
+
+// Mirrors the distance field pixel shader: sample, take the median,
+// convert to screen pixels and map a one pixel band around the outline
+// to coverage.
+void GlyphDistFieldGenerator::RenderCoverage(const DistFieldGlyph& glyph, float size,
+                                             UByte* dst, unsigned dstPitch,
+                                             int* originX, int* originY)
+{
+    float    scale = size / float(glyph.BaseSize);
+    unsigned w = GetRenderWidth(glyph, size);
+    unsigned h = GetRenderHeight(glyph, size);
+
+    for (unsigned y = 0; y < h; ++y)
+    {
+        UByte* row = dst + y * dstPitch;
+        for (unsigned x = 0; x < w; ++x)
+        {
+            float d = glyph.SampleDistance((x + 0.5f) / scale, (y + 0.5f) / scale) * scale;
+            row[x] = UByte(Alg::Clamp(d + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    if (originX) *originX = int(floorf(glyph.OriginX * scale + 0.5f));
+    if (originY) *originY = int(floorf(glyph.OriginY * scale + 0.5f));
+}
+
+float GlyphDistFieldGenerator::CompareCoverage(const UByte* a, const UByte* b,
+                                               unsigned width, unsigned height, unsigned pitch)
+{
+    if (!width || !height)
+        return 0;
+    double sum = 0;
+    for (unsigned y = 0; y < height; ++y)
+        for (unsigned x = 0; x < width; ++x)
+            sum += abs(int(a[y * pitch + x]) - int(b[y * pitch + x]));
+    return float(sum / (double(width) * height));
+}
+
+
+// The raster is the reference: rendered at the field's base size from the
+// same unhinted outline, so the only differences are the field's.
+float GlyphDistFieldGenerator::MeasureCoverageError(Font* font, unsigned glyphIndex,
+                                                    const DistFieldGlyph& glyph, MemoryHeap* heap)
+{
+    if (!heap)
+        heap = Memory::GetGlobalHeap();
+
+    Rasterizer       ras(heap);
+    ToleranceParams  tol;
+    Ptr<GlyphRaster> raster = *SF_HEAP_NEW(heap) GlyphRaster;
+    if (!GlyphCacheWarmup::RasterizeGlyph(ras, tol, font, glyphIndex, glyph.BaseSize, raster))
+        return -1.0f;
+
+    // Render the field and crop it to the raster, aligning the glyph origins.
+    unsigned fw = GetRenderWidth(glyph, float(glyph.BaseSize));
+    unsigned fh = GetRenderHeight(glyph, float(glyph.BaseSize));
+    int      fox, foy;
+    ArrayLH_POD<UByte, StatRender_Font_Mem> field, cropped;
+    field.Resize(fw * fh);
+    RenderCoverage(glyph, float(glyph.BaseSize), field.GetDataPtr(), fw, &fox, &foy);
+
+    unsigned w = raster->Width, h = raster->Height;
+    cropped.Resize(w * h);
+    memset(cropped.GetDataPtr(), 0, cropped.GetSize());
+    int dx = fox - raster->OriginX;
+    int dy = foy - raster->OriginY;
+    for (unsigned y = 0; y < h; ++y)
+    {
+        int sy = int(y) + dy;
+        if (sy < 0 || sy >= int(fh))
+            continue;
+        for (unsigned x = 0; x < w; ++x)
+        {
+            int sx = int(x) + dx;
+            if (sx >= 0 && sx < int(fw))
+                cropped[y * w + x] = field[sy * fw + sx];
+        }
+    }
+    return CompareCoverage(raster->Raster.GetDataPtr(), cropped.GetDataPtr(), w, h, w);
+}
+
+
+//------------------------------------------------------------------------
+DistFieldGlyphCache::DistFieldGlyphCache(MemoryHeap* heap, const DistFieldParams& params) :
+    pHeap(heap ? heap : Memory::GetGlobalHeap()), Params(params), Bytes(0)
+{
+}
+
+// Generators keep scratch state, so each call uses its own; their cost is
+// negligible next to the field itself.
+Ptr<DistFieldGlyph> DistFieldGlyphCache::generate(Font* font, unsigned glyphIndex) const
+{
+    GlyphDistFieldGenerator generator(pHeap);
+    generator.SetParams(Params);
+
+    Ptr<DistFieldGlyph> glyph = *SF_HEAP_NEW(pHeap) DistFieldGlyph;
+    if (!generator.GenerateGlyph(font, glyphIndex, glyph))
+        return Ptr<DistFieldGlyph>();
+
+#ifdef SF_BUILD_DEBUG
+    float error = GlyphDistFieldGenerator::MeasureCoverageError(font, glyphIndex, *glyph, pHeap);
+    SF_DEBUG_ASSERT1(error <= float(MaxCoverageError),
+                     "DistFieldGlyphCache - field differs from the rasterized glyph (error %.1f)", error);
+    SF_UNUSED(error);
+#endif
+    return glyph;
+}
+
+Ptr<DistFieldGlyph> DistFieldGlyphCache::GetGlyph(Font* font, unsigned glyphIndex)
+{
+    // Fields are size independent; hash the outline the generator reads.
+    Key key(font, glyphIndex, GlyphRasterStore::GetOutlineHash(font, glyphIndex, 0));
+    {
+        Lock::Locker lock(&CacheLock);
+        Ptr<DistFieldGlyph>* pglyph = Glyphs.Get(key);
+        if (pglyph)
+            return *pglyph;
+    }
+
+    Ptr<DistFieldGlyph> glyph = generate(font, glyphIndex);
+
+    // Another thread may have generated the same glyph meanwhile; keep the
+    // first one so callers share it. Empty glyphs are cached as null so
+    // they aren't regenerated.
+    Lock::Locker lock(&CacheLock);
+    Ptr<DistFieldGlyph>* pglyph = Glyphs.Get(key);
+    if (pglyph)
+        return *pglyph;
+    if (glyph)
+        Bytes += glyph->Data.GetSize();
+    Glyphs.Set(key, glyph);
+    return glyph;
+}
+
+void DistFieldGlyphCache::Prefetch(Font* font, const wchar_t* chars)
+{
+    if (!font || !chars)
+        return;
+    for (; *chars; ++chars)
+    {
+        int glyphIndex = font->GetGlyphIndex(UInt16(*chars));
+        if (glyphIndex >= 0)
+            GetGlyph(font, unsigned(glyphIndex));
+    }
+}
+
+void DistFieldGlyphCache::Clear()
+{
+    Lock::Locker lock(&CacheLock);
+    Glyphs.Clear();
+    Bytes = 0;
+}
+
+unsigned DistFieldGlyphCache::GetGlyphCount() const
+{
+    Lock::Locker lock(&CacheLock);
+    return unsigned(Glyphs.GetSize());
+}
+
+UPInt DistFieldGlyphCache::GetBytes() const
+{
+    Lock::Locker lock(&CacheLock);
+    return Bytes;
+}
+
+}} // Scaleform::Render
@@ -0,0 +1,257 @@
+/**************************************************************************
+
+PublicHeader:   Render
+Filename    :   Render_GlyphDistField.h
+Content     :   Signed distance field (SDF/MSDF) glyph generation
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_GlyphDistField_H
+#define INC_SF_Render_GlyphDistField_H
+
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Hash.h"
+#include "Kernel/SF_String.h"
+#include "Kernel/SF_Atomic.h"
+#include "Render_Font.h"
+
+namespace Scaleform { namespace Render {
+
+//------------------------------------------------------------------------
+// ***** DistFieldParams
+
+// Distance field glyphs are generated once, at BaseSize pixels per nominal
+// glyph height, and scaled to any screen size at render time. Spread is the
+// distance in base-size pixels that maps to the full 0..255 value range;
+// it bounds both the usable outline/shadow width and the maximum
+// magnification before edges soften.
+struct DistFieldParams
+{
+    enum FieldType
+    {
+        Field_SDF,      // Single channel true distance; rounds sharp corners.
+        Field_MSDF      // Three channel median distance; keeps corners sharp.
+    };
+
+    FieldType   Type;
+    unsigned    BaseSize;
+    float       Spread;
+    float       CornerAngle;    // Edge junctions sharper than this (radians) are MSDF corners.
+
+    DistFieldParams(FieldType type = Field_MSDF, unsigned baseSize = 32, float spread = 4.0f)
+        : Type(type), BaseSize(baseSize), Spread(spread), CornerAngle(0.25f)
+    {}
+};
+
+
+//------------------------------------------------------------------------
+// ***** DistFieldGlyph
+
+// Generated field. Data is Width * Height * Channels bytes, row-major, with
+// 128 on the outline and larger values inside. Origin follows the
+// GlyphRaster convention: pixel (OriginX, OriginY) holds the glyph origin.
+class DistFieldGlyph : public RefCountBase<DistFieldGlyph, StatRender_Font_Mem>
+{
+public:
+    DistFieldGlyph() : Width(0), Height(0), Channels(1), OriginX(0), OriginY(0),
+                       BaseSize(0), Spread(0) {}
+
+    ArrayLH_POD<UByte, StatRender_Font_Mem> Data;
+    unsigned    Width, Height;
+    unsigned    Channels;       // 1 for SDF, 3 for MSDF.
+    int         OriginX, OriginY;
+    unsigned    BaseSize;
+    float       Spread;
+
+    // Signed distance in base-size pixels at a field texel (median for MSDF).
+    float       GetDistance(unsigned x, unsigned y) const;
+    // Bilinear field sample at (x, y) in field pixel coordinates.
+    float       SampleDistance(float x, float y) const;
+};
+
+
+//------------------------------------------------------------------------
+// ***** GlyphDistFieldGenerator
+
+// Builds distance fields from glyph outlines (any ShapeDataInterface:
+// Font::GetPermanentGlyphShape, a GlyphShape filled by
+// GetTemporaryGlyphShape, or a GFx compact font path).
+//
+// Curves are flattened at base size, so the generation cost is
+// O(width * height * segments). MSDF edges are colored per
+// Chlumsky's scheme: each run of edges between corners gets a channel
+// pair, and consecutive runs never share all of their channels. Corners
+// are found from the tangents of the original edges, not of the flattened
+// segments, so smooth curve joins aren't mistaken for corners. Texels
+// where the median disagrees with the true inside/outside test are
+// replaced by the single-channel distance to avoid sparkle artifacts.
+//
+// Not thread-safe; use one generator per thread.
+class GlyphDistFieldGenerator
+{
+public:
+    GlyphDistFieldGenerator(MemoryHeap* heap = 0);
+
+    void        SetParams(const DistFieldParams& params) { Params = params; }
+    const DistFieldParams& GetParams() const             { return Params; }
+
+    // Generates the field for the outline; shapeScale converts outline units
+    // to base-size pixels (BaseSize / Font::GetNominalGlyphHeight() for glyphs).
+    // Returns false for an empty outline.
+    bool        Generate(const ShapeDataInterface* shape, float shapeScale, DistFieldGlyph* glyph);
+
+    // Convenience: fetches the outline from the font.
+    bool        GenerateGlyph(Font* font, unsigned glyphIndex, DistFieldGlyph* glyph);
+
+    // CPU reference renderer, used to validate field quality against
+    // Rasterizer coverage. Writes A8 coverage for the glyph rendered at
+    // 'size' pixels per nominal height into dst; returns the origin through
+    // originX/originY like GlyphRaster. dst must be at least
+    // GetRenderWidth(glyph, size) x GetRenderHeight(glyph, size).
+    static unsigned GetRenderWidth (const DistFieldGlyph& glyph, float size);
+    static unsigned GetRenderHeight(const DistFieldGlyph& glyph, float size);
+    static void     RenderCoverage(const DistFieldGlyph& glyph, float size,
+                                   UByte* dst, unsigned dstPitch,
+                                   int* originX = 0, int* originY = 0);
+
+    // Mean absolute coverage difference (0..255) of two A8 images of equal size.
+    static float    CompareCoverage(const UByte* a, const UByte* b,
+                                    unsigned width, unsigned height, unsigned pitch);
+
+    // Compares the field rendered at its base size with the Rasterizer
+    // coverage of the same outline, over the rasterized glyph's bounds.
+    // Returns the CompareCoverage error, or -1 if the glyph can't be rasterized.
+    static float    MeasureCoverageError(Font* font, unsigned glyphIndex, const DistFieldGlyph& glyph,
+                                         MemoryHeap* heap = 0);
+
+private:
+    enum EdgeColor
+    {
+        Color_Red    = 1,
+        Color_Green  = 2,
+        Color_Blue   = 4,
+        Color_Yellow = Color_Red | Color_Green,
+        Color_Cyan   = Color_Green | Color_Blue,
+        Color_Magenta= Color_Red | Color_Blue,
+        Color_White  = 7
+    };
+
+    struct Segment
+    {
+        float       x1, y1, x2, y2;
+        float       tx1, ty1;   // Tangent of the source edge at (x1, y1), unnormalized.
+        float       tx2, ty2;   // Tangent of the source edge at (x2, y2).
+        unsigned    Edge;       // Index of the source edge in its contour.
+        unsigned    Color;
+    };
+
+    struct Contour
+    {
+        unsigned    Start, Count;   // Range in Segments.
+        unsigned    EdgeCount;
+    };
+
+    void        addSegment(float x, float y, float tx1, float ty1, float tx2, float ty2);
+    void        addEdgeLine(float x, float y);
+    void        addEdgeQuad(float cx, float cy, float x, float y);
+    void        addEdgeCubic(float c1x, float c1y, float c2x, float c2y, float x, float y);
+    void        closeContour();
+    void        colorEdges();
+    bool        isInside(float x, float y) const;
+    float       signedDistance(float x, float y, unsigned channelMask, bool inside) const;
+
+    MemoryHeap*         pHeap;
+    DistFieldParams     Params;
+    ArrayLH_POD<Segment, StatRender_Font_Mem> Segments;
+    ArrayLH_POD<Contour, StatRender_Font_Mem> Contours;
+    float               LastX, LastY, StartX, StartY;
+    unsigned            EdgeIndex;
+    float               Orientation;    // +1 if positive cross products point inside.
+};
+
+
+//------------------------------------------------------------------------
+// ***** DistFieldGlyphCache
+
+// Caches one field per (font, glyph) regardless of the sizes it's drawn
+// at. Glyphs are keyed by font name, style and the glyph's outline hash
+// (GlyphRasterStore::GetOutlineHash), so equally named fonts with different
+// outlines don't share fields. Thread-safe; fields are generated on first
+// request, outside the cache lock, so a miss on one thread doesn't stall
+// lookups on others. Prefetch generates them ahead of time, typically on a
+// loading thread. Debug builds check every new field against the
+// rasterized glyph (MaxCoverageError).
+class DistFieldGlyphCache : public RefCountBase<DistFieldGlyphCache, StatRender_Font_Mem>
+{
+public:
+    // Largest acceptable GlyphDistFieldGenerator::MeasureCoverageError; the
+    // one pixel edge band alone accounts for a few units on small glyphs.
+    enum { MaxCoverageError = 16 };
+
+    DistFieldGlyphCache(MemoryHeap* heap = 0, const DistFieldParams& params = DistFieldParams());
+
+    const DistFieldParams& GetParams() const { return Params; }
+
+    // Returns the cached field, generating it on a miss; null for empty
+    // glyphs. The returned reference keeps the field alive across Clear.
+    Ptr<DistFieldGlyph> GetGlyph(Font* font, unsigned glyphIndex);
+
+    // Generates the fields of the characters' glyphs that aren't cached yet.
+    void        Prefetch(Font* font, const wchar_t* chars);
+
+    // Drops the cache's references; fields still held by callers stay valid.
+    void        Clear();
+    unsigned    GetGlyphCount() const;
+    UPInt       GetBytes() const;
+
+private:
+    Ptr<DistFieldGlyph> generate(Font* font, unsigned glyphIndex) const;
+
+    struct Key
+    {
+        String      FontName;
+        unsigned    StyleFlags;
+        unsigned    GlyphIndex;
+        UInt32      OutlineHash;
+
+        Key() : StyleFlags(0), GlyphIndex(0), OutlineHash(0) {}
+        Key(Font* font, unsigned glyphIndex, UInt32 outlineHash)
+            : FontName(font->GetName()), StyleFlags(font->GetFontStyleFlags()),
+              GlyphIndex(glyphIndex), OutlineHash(outlineHash) {}
+
+        bool operator == (const Key& other) const
+        {
+            return GlyphIndex == other.GlyphIndex && OutlineHash == other.OutlineHash &&
+                   StyleFlags == other.StyleFlags && FontName == other.FontName;
+        }
+
+        struct HashFunctor
+        {
+            UPInt operator()(const Key& key) const
+            {
+                return String::BernsteinHashFunction(key.FontName.ToCStr(), key.FontName.GetSize()) ^
+                       key.OutlineHash ^ (key.GlyphIndex * 31) ^ (key.StyleFlags << 28);
+            }
+        };
+    };
+
+    typedef HashLH<Key, Ptr<DistFieldGlyph>, Key::HashFunctor, StatRender_Font_Mem> GlyphHashType;
+
+    MemoryHeap*             pHeap;
+    DistFieldParams         Params;
+    mutable Lock            CacheLock;
+    GlyphHashType           Glyphs;
+    UPInt                   Bytes;
+};
+
+}} // Scaleform::Render
+
+#endif // INC_SF_Render_GlyphDistField_H
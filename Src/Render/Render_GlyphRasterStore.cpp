@@ -0,0 +1,625 @@
+/**************************************************************************
+
+Filename    :   Render_GlyphRasterStore.cpp
+Content     :   Persistent pre-rasterized glyph store and glyph cache
+                warm-up
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render_GlyphRasterStore.h"
+#include "Render_Rasterizer.h"
+#include "Render_GlyphFitter.h"
+#include "Render_TessCurves.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_UTF8Util.h"
+#include "Kernel/SF_Alg.h"
+#include <string.h>
+
+namespace Scaleform { namespace Render {
+
+//------------------------------------------------------------------------
+GlyphRasterStore::GlyphRasterStore(MemoryHeap* heap) :
+    pHeap(heap ? heap : Memory::GetGlobalHeap()),
+    CompressedBytes(0), UncompressedBytes(0), Hits(0), Misses(0)
+{
+}
+
+GlyphRasterStore::~GlyphRasterStore()
+{
+}
+
+// Runs are encoded as a control byte followed by data. Control values
+// 0..127 mean "copy the next N+1 literal bytes", values 128..255 mean
+// "repeat the next byte N-125 times" (3..130 repeats).
+void GlyphRasterStore::CompressA8(const UByte* src, UPInt size,
+                                  ArrayLH_POD<UByte, StatRender_Font_Mem>* dst)
+{
+    dst->Clear();
+    UPInt i = 0;
+    while (i < size)
+    {
+        UPInt run = 1;
+        while (i + run < size && run < 130 && src[i + run] == src[i])
+            run++;
+
+        if (run >= 3)
+        {
+            dst->PushBack(UByte(run + 125));
+            dst->PushBack(src[i]);
+            i += run;
+            continue;
+        }
+
+        // Collect literals until a run of 3 starts or 128 literals accumulate.
+        UPInt start = i;
+        UPInt count = 0;
+        while (i < size && count < 128)
+        {
+            if (i + 2 < size && src[i] == src[i + 1] && src[i] == src[i + 2])
+                break;
+            i++;
+            count++;
+        }
+        dst->PushBack(UByte(count - 1));
+        UPInt pos = dst->GetSize();
+        dst->Resize(pos + count);
+        memcpy(&(*dst)[pos], src + start, count);
+    }
+}
+
+bool GlyphRasterStore::DecompressA8(const UByte* src, UPInt srcSize, UByte* dst, UPInt dstSize)
+{
+    UPInt si = 0, di = 0;
+    while (si < srcSize)
+    {
+        unsigned ctrl = src[si++];
+        if (ctrl >= 128)
+        {
+            UPInt run = ctrl - 125;
+            if (si >= srcSize || di + run > dstSize)
+                return false;
+            memset(dst + di, src[si++], run);
+            di += run;
+        }
+        else
+        {
+            UPInt count = ctrl + 1;
+            if (si + count > srcSize || di + count > dstSize)
+                return false;
+            memcpy(dst + di, src + si, count);
+            si += count;
+            di += count;
+        }
+    }
+    return di == dstSize;
+}
+
+//------------------------------------------------------------------------
+void GlyphRasterStore::AddRaster(const char* fontName, unsigned fontFlags, UInt32 outlineHash,
+                                 unsigned glyphIndex, unsigned hintedSize,
+                                 const GlyphRaster& raster)
+{
+    if (raster.Width == 0 || raster.Height == 0 ||
+        raster.Width > 0xFFFF || raster.Height > 0xFFFF ||
+        raster.Raster.GetSize() < UPInt(raster.Width) * raster.Height)
+        return;
+
+    Entry e;
+    e.Width   = UInt16(raster.Width);
+    e.Height  = UInt16(raster.Height);
+    e.OriginX = SInt16(raster.OriginX);
+    e.OriginY = SInt16(raster.OriginY);
+    CompressA8(&raster.Raster[0], UPInt(raster.Width) * raster.Height, &e.Data);
+
+    Key key(fontName, fontFlags, outlineHash, glyphIndex, hintedSize);
+
+    ReadWriteLock::WriteLocker lock(&StoreLock);
+    Entry* existing = Entries.Get(key);
+    if (existing)
+    {
+        CompressedBytes   -= existing->Data.GetSize();
+        UncompressedBytes -= UPInt(existing->Width) * existing->Height;
+    }
+    CompressedBytes   += e.Data.GetSize();
+    UncompressedBytes += UPInt(e.Width) * e.Height;
+    Entries.Set(key, e);
+}
+
+bool GlyphRasterStore::GetRaster(const char* fontName, unsigned fontFlags, UInt32 outlineHash,
+                                 unsigned glyphIndex, unsigned hintedSize,
+                                 GlyphRaster* raster) const
+{
+    Key key(fontName, fontFlags, outlineHash, glyphIndex, hintedSize);
+
+    ReadWriteLock::ReadLocker lock(&StoreLock);
+    const Entry* e = Entries.Get(key);
+    if (!e)
+    {
+        Misses.Increment_NoSync();
+        return false;
+    }
+    raster->Width      = e->Width;
+    raster->Height     = e->Height;
+    raster->OriginX    = e->OriginX;
+    raster->OriginY    = e->OriginY;
+    raster->HintedSize = hintedSize;
+    raster->Raster.Resize(UPInt(e->Width) * e->Height);
+    if (!DecompressA8(e->Data.GetDataPtr(), e->Data.GetSize(),
+                      raster->Raster.GetDataPtr(), raster->Raster.GetSize()))
+    {
+        Misses.Increment_NoSync();
+        return false;
+    }
+    Hits.Increment_NoSync();
+    return true;
+}
+
+bool GlyphRasterStore::HasRaster(const char* fontName, unsigned fontFlags, UInt32 outlineHash,
+                                 unsigned glyphIndex, unsigned hintedSize) const
+{
+    Key key(fontName, fontFlags, outlineHash, glyphIndex, hintedSize);
+    ReadWriteLock::ReadLocker lock(&StoreLock);
+    return Entries.Get(key) != 0;
+}
+
+void GlyphRasterStore::Clear()
+{
+    ReadWriteLock::WriteLocker lock(&StoreLock);
+    Entries.Clear();
+    CompressedBytes = UncompressedBytes = 0;
+    Hits = Misses = 0;
+}
+
+void GlyphRasterStore::GetStats(Stats* pstats) const
+{
+    ReadWriteLock::ReadLocker lock(&StoreLock);
+    pstats->GlyphCount        = (unsigned)Entries.GetSize();
+    pstats->CompressedBytes   = CompressedBytes;
+    pstats->UncompressedBytes = UncompressedBytes;
+    pstats->Hits              = Hits;
+    pstats->Misses            = Misses;
+}
+
+//------------------------------------------------------------------------
+namespace {
+
+// FNV-1a over 32-bit words.
+inline UInt32 GlyphRasterStore_Hash(UInt32 hash, UInt32 v)
+{
+    for (unsigned i = 0; i < 4; ++i, v >>= 8)
+        hash = (hash ^ (v & 0xFF)) * 16777619u;
+    return hash;
+}
+
+inline UInt32 GlyphRasterStore_HashFloat(UInt32 hash, float f)
+{
+    union { float F; UInt32 U; } u;
+    u.F = f;
+    return GlyphRasterStore_Hash(hash, u.U);
+}
+
+} // namespace
+
+UInt32 GlyphRasterStore::GetOutlineHash(Font* font, unsigned glyphIndex, unsigned hintedSize)
+{
+    // A permanent shape is the same at every size, so one cached hash serves
+    // all of them; temporary shapes are produced per hinted size.
+    const ShapeDataInterface* shape = font->GetPermanentGlyphShape(glyphIndex);
+    unsigned keySize   = shape ? 0 : hintedSize;
+    bool     cacheable = (glyphIndex <= 0xFFFF && keySize <= 0xFFFF);
+    UInt32   key       = UInt32(glyphIndex | (keySize << 16));
+    UInt32   hash;
+
+    if (cacheable && font->GetCachedOutlineHash(key, &hash))
+        return hash;
+    hash = computeOutlineHash(font, shape, glyphIndex, hintedSize);
+    if (cacheable)
+        font->SetCachedOutlineHash(key, hash);
+    return hash;
+}
+
+UInt32 GlyphRasterStore::computeOutlineHash(Font* font, const ShapeDataInterface* shape,
+                                            unsigned glyphIndex, unsigned hintedSize)
+{
+    UInt32 hash = 2166136261u;
+    hash = GlyphRasterStore_HashFloat(hash, font->GetNominalGlyphHeight());
+    hash = GlyphRasterStore_HashFloat(hash, font->GetAscent());
+    hash = GlyphRasterStore_HashFloat(hash, font->GetDescent());
+    hash = GlyphRasterStore_HashFloat(hash, font->GetLeading());
+
+    GlyphShape tmpShape;
+    if (!shape)
+    {
+        if (!font->GetTemporaryGlyphShape(glyphIndex, hintedSize, &tmpShape))
+            return hash;
+        shape = &tmpShape;
+    }
+
+    float coord[Edge_MaxCoord];
+    unsigned styles[3];
+    ShapePosInfo  pos(shape->GetStartingPos());
+    ShapePathType pathType;
+    while ((pathType = shape->ReadPathInfo(&pos, coord, styles)) != Shape_EndShape)
+    {
+        hash = GlyphRasterStore_HashFloat(hash, coord[0]);
+        hash = GlyphRasterStore_HashFloat(hash, coord[1]);
+
+        PathEdgeType edgeType;
+        while ((edgeType = shape->ReadEdge(&pos, coord)) != Edge_EndPath)
+        {
+            unsigned count = (edgeType == Edge_LineTo) ? 2 : (edgeType == Edge_QuadTo) ? 4 : 6;
+            hash = GlyphRasterStore_Hash(hash, (UInt32)edgeType);
+            for (unsigned i = 0; i < count; ++i)
+                hash = GlyphRasterStore_HashFloat(hash, coord[i]);
+        }
+        hash = GlyphRasterStore_Hash(hash, 0xFFFFFFFFu);
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------
+// File layout (little-endian):
+//   UInt32 signature, UInt32 version, UInt32 count, then per entry:
+//   UInt16 nameLen, name bytes, UInt16 styleFlags, UInt16 hintedSize,
+//   UInt32 glyphIndex, UInt32 outlineHash, UInt16 width, UInt16 height, SInt16 originX,
+//   SInt16 originY, UInt32 dataSize, data bytes.
+bool GlyphRasterStore::Save(File* file) const
+{
+    if (!file || !file->IsWritable())
+        return false;
+
+    ReadWriteLock::ReadLocker lock(&StoreLock);
+    file->WriteUInt32(FileSignature);
+    file->WriteUInt32(FileVersion);
+    file->WriteUInt32((UInt32)Entries.GetSize());
+
+    for (EntryHashType::ConstIterator it = Entries.Begin(); it != Entries.End(); ++it)
+    {
+        const Key&   key = it->First;
+        const Entry& e   = it->Second;
+        UInt16 nameLen = (UInt16)Alg::Min(key.FontName.GetSize(), UPInt(0xFFFF));
+
+        file->WriteUInt16(nameLen);
+        file->Write((const UByte*)key.FontName.ToCStr(), nameLen);
+        file->WriteUInt16(key.StyleFlags);
+        file->WriteUInt16(key.HintedSize);
+        file->WriteUInt32(key.GlyphIndex);
+        file->WriteUInt32(key.OutlineHash);
+        file->WriteUInt16(e.Width);
+        file->WriteUInt16(e.Height);
+        file->WriteSInt16(e.OriginX);
+        file->WriteSInt16(e.OriginY);
+        file->WriteUInt32((UInt32)e.Data.GetSize());
+        if (file->Write(e.Data.GetDataPtr(), (int)e.Data.GetSize()) != (int)e.Data.GetSize())
+            return false;
+    }
+    return true;
+}
+
+bool GlyphRasterStore::Load(File* file)
+{
+    if (!file || !file->IsValid())
+        return false;
+    if (file->ReadUInt32() != FileSignature || file->ReadUInt32() != FileVersion)
+        return false;
+
+    UInt32 count = file->ReadUInt32();
+    ArrayLH_POD<char, StatRender_Font_Mem> name;
+
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        UInt16 nameLen = file->ReadUInt16();
+        name.Resize(nameLen + 1);
+        if (file->Read((UByte*)name.GetDataPtr(), nameLen) != nameLen)
+            return false;
+        name[nameLen] = 0;
+
+        Key key;
+        key.FontName   = name.GetDataPtr();
+        key.StyleFlags = file->ReadUInt16();
+        key.HintedSize = file->ReadUInt16();
+        key.GlyphIndex  = file->ReadUInt32();
+        key.OutlineHash = file->ReadUInt32();
+
+        Entry e;
+        e.Width   = file->ReadUInt16();
+        e.Height  = file->ReadUInt16();
+        e.OriginX = file->ReadSInt16();
+        e.OriginY = file->ReadSInt16();
+
+        UInt32 dataSize = file->ReadUInt32();
+        // A run-length stream can't expand by more than 1/128 over the raw data.
+        UPInt  maxSize  = UPInt(e.Width) * e.Height;
+        if (dataSize == 0 || dataSize > maxSize + maxSize / 128 + 1)
+            return false;
+        e.Data.Resize(dataSize);
+        if (file->Read(e.Data.GetDataPtr(), (int)dataSize) != (int)dataSize)
+            return false;
+
+        ReadWriteLock::WriteLocker lock(&StoreLock);
+        Entry* existing = Entries.Get(key);
+        if (existing)
+        {
+            CompressedBytes   -= existing->Data.GetSize();
+            UncompressedBytes -= UPInt(existing->Width) * existing->Height;
+        }
+        CompressedBytes   += e.Data.GetSize();
+        UncompressedBytes += maxSize;
+        Entries.Set(key, e);
+    }
+    return true;
+}
+
+
+//------------------------------------------------------------------------
+GlyphCacheWarmup::GlyphCacheWarmup(GlyphRasterStore* store, MemoryHeap* heap) :
+    pHeap(heap ? heap : Memory::GetGlobalHeap()), pStore(store),
+    Done(0), CancelRequested(0), RasterizedCount(0), SkippedCount(0)
+{
+}
+
+GlyphCacheWarmup::~GlyphCacheWarmup()
+{
+    Cancel();
+    Wait();
+}
+
+void GlyphCacheWarmup::AddRequest(Font* font, float size, const wchar_t* chars, bool autoFit)
+{
+    if (!font || !chars)
+        return;
+    Request& req   = Requests.PushDefault();
+    req.pFont      = font;
+    req.HintedSize = (unsigned)(size + 0.5f);
+    req.AutoFit    = autoFit;
+    for (; *chars; ++chars)
+        req.Chars.PushBack(UInt16(*chars));
+}
+
+void GlyphCacheWarmup::AddRequest(Font* font, float size, const char* utf8Chars, bool autoFit)
+{
+    if (!font || !utf8Chars)
+        return;
+    Request& req   = Requests.PushDefault();
+    req.pFont      = font;
+    req.HintedSize = (unsigned)(size + 0.5f);
+    req.AutoFit    = autoFit;
+    UInt32 ch;
+    while ((ch = UTF8Util::DecodeNextChar(&utf8Chars)) != 0)
+        req.Chars.PushBack(UInt16(ch));
+}
+
+namespace {
+
+// GlyphCache::addShapeAutoFit: the outline is flattened into the fitter in
+// font units, fitted to heightInPixels with the font's lower and upper case
+// tops as alignment zones, and the snapped contours are fed to the
+// rasterizer. GlyphFitter keeps vertices Y-up, hence the flip back.
+void GlyphCacheWarmup_AddShapeAutoFit(Rasterizer& ras, GlyphFitter& fitter, const ToleranceParams& tol,
+                                      const ShapeDataInterface* shape, Font* font, unsigned hintedSize)
+{
+    float    nomHeight = font->GetNominalGlyphHeight();
+    float    coord[Edge_MaxCoord];
+    unsigned styles[3];
+
+    fitter.Clear();
+    fitter.SetNominalFontHeight(int(nomHeight));
+
+    ShapePosInfo  pos(shape->GetStartingPos());
+    ShapePathType pathType;
+    while ((pathType = shape->ReadPathInfo(&pos, coord, styles)) != Shape_EndShape)
+    {
+        fitter.MoveTo(coord[0], coord[1]);
+
+        PathEdgeType edgeType;
+        while ((edgeType = shape->ReadEdge(&pos, coord)) != Edge_EndPath)
+        {
+            if (edgeType == Edge_LineTo)
+                fitter.LineTo(coord[0], coord[1]);
+            else if (edgeType == Edge_QuadTo)
+                TessellateQuadCurve(&fitter, tol, coord[0], coord[1], coord[2], coord[3]);
+            else if (edgeType == Edge_CubicTo)
+                TessellateCubicCurve(&fitter, tol, coord[0], coord[1], coord[2], coord[3], coord[4], coord[5]);
+        }
+        fitter.ClosePath();
+    }
+
+    // Font's case tops are computed lazily from the glyph shapes; there is
+    // no cache to log to from here.
+    fitter.FitGlyph(int(hintedSize), 0, font->GetLowerCaseTop(0), font->GetUpperCaseTop(0));
+
+    float scale = float(hintedSize) / nomHeight;
+    for (unsigned i = 0; i < fitter.GetNumContours(); ++i)
+    {
+        const GlyphFitter::ContourType& c = fitter.GetContour(i);
+        if (c.NumVertices <= 2)
+            continue;
+
+        GlyphFitter::VertexType v = fitter.GetVertex(c, 0);
+        fitter.SnapVertex(v);
+        ras.MoveTo(v.x * scale, -v.y * scale);
+        for (unsigned j = 1; j < c.NumVertices; ++j)
+        {
+            v = fitter.GetVertex(c, j);
+            fitter.SnapVertex(v);
+            ras.LineTo(v.x * scale, -v.y * scale);
+        }
+        ras.ClosePath();
+    }
+}
+
+} // namespace
+
+// Walks the glyph outline in font units, scaled to hintedSize pixels per
+// nominal glyph height. Glyph shapes are Y-down with the baseline at 0,
+// so OriginY is the distance from the top row to the baseline, matching
+// what font providers return from GetGlyphRaster.
+bool GlyphCacheWarmup::RasterizeGlyph(Rasterizer& ras, const ToleranceParams& tol,
+                                      Font* font, unsigned glyphIndex, unsigned hintedSize,
+                                      GlyphRaster* raster, GlyphFitter* fitter)
+{
+    const ShapeDataInterface* shape = font->GetPermanentGlyphShape(glyphIndex);
+    GlyphShape tmpShape;
+    if (!shape)
+    {
+        if (!font->GetTemporaryGlyphShape(glyphIndex, hintedSize, &tmpShape))
+            return false;
+        shape = &tmpShape;
+    }
+
+    ras.Clear();
+    if (fitter)
+    {
+        GlyphCacheWarmup_AddShapeAutoFit(ras, *fitter, tol, shape, font, hintedSize);
+    }
+    else
+    {
+        float scale = float(hintedSize) / font->GetNominalGlyphHeight();
+        float coord[Edge_MaxCoord];
+        unsigned styles[3];
+
+        ShapePosInfo  pos(shape->GetStartingPos());
+        ShapePathType pathType;
+        while ((pathType = shape->ReadPathInfo(&pos, coord, styles)) != Shape_EndShape)
+        {
+            ras.MoveTo(coord[0] * scale, coord[1] * scale);
+
+            PathEdgeType edgeType;
+            while ((edgeType = shape->ReadEdge(&pos, coord)) != Edge_EndPath)
+            {
+                if (edgeType == Edge_LineTo)
+                {
+                    ras.LineTo(coord[0] * scale, coord[1] * scale);
+                }
+                else if (edgeType == Edge_QuadTo)
+                {
+                    TessellateQuadCurve(&ras, tol, coord[0] * scale, coord[1] * scale,
+                                                   coord[2] * scale, coord[3] * scale);
+                }
+                else if (edgeType == Edge_CubicTo)
+                {
+                    TessellateCubicCurve(&ras, tol, coord[0] * scale, coord[1] * scale,
+                                                    coord[2] * scale, coord[3] * scale,
+                                                    coord[4] * scale, coord[5] * scale);
+                }
+            }
+            ras.ClosePath();
+        }
+    }
+
+    if (!ras.SortCells())
+        return false;
+
+    raster->Width      = unsigned(ras.GetMaxX() - ras.GetMinX() + 1);
+    raster->Height     = unsigned(ras.GetNumScanlines());
+    raster->OriginX    = -ras.GetMinX();
+    raster->OriginY    = -ras.GetMinY();
+    raster->HintedSize = hintedSize;
+    raster->Raster.Resize(raster->Width * raster->Height);
+    memset(raster->Raster.GetDataPtr(), 0, raster->Raster.GetSize());
+    for (unsigned i = 0; i < raster->Height; ++i)
+        ras.SweepScanline(i, &raster->Raster[i * raster->Width]);
+    return true;
+}
+
+void GlyphCacheWarmup::Run()
+{
+    Rasterizer      ras(pHeap);
+    GlyphFitter     fitter(pHeap);
+    ToleranceParams tol;
+    Ptr<GlyphRaster> raster = *SF_HEAP_NEW(pHeap) GlyphRaster;
+
+    for (UPInt r = 0; r < Requests.GetSize() && !CancelRequested; ++r)
+    {
+        Request& req = Requests[r];
+        Font*    font = req.pFont;
+
+        for (UPInt c = 0; c < req.Chars.GetSize() && !CancelRequested; ++c)
+        {
+            int glyphIndex = font->GetGlyphIndex(req.Chars[c]);
+            if (glyphIndex < 0)
+            {
+                SkippedCount++;
+                continue;
+            }
+            unsigned keyFlags    = GlyphRasterStore::GetKeyFlags(font, req.AutoFit);
+            UInt32   outlineHash = GlyphRasterStore::GetOutlineHash(font, glyphIndex, req.HintedSize);
+            if (pStore->HasRaster(font->GetName(), keyFlags, outlineHash,
+                                  glyphIndex, req.HintedSize))
+            {
+                SkippedCount++;
+                continue;
+            }
+
+            // Fonts that supply their own rasters (e.g. hinted system fonts)
+            // are stored as they are, so the cache sees identical pixels.
+            bool ok = font->GetGlyphRaster(glyphIndex, req.HintedSize, raster);
+            if (!ok)
+                ok = RasterizeGlyph(ras, tol, font, glyphIndex, req.HintedSize, raster,
+                                    req.AutoFit ? &fitter : 0);
+            if (ok)
+            {
+                pStore->AddRaster(font->GetName(), keyFlags, outlineHash,
+                                  glyphIndex, req.HintedSize, *raster);
+                RasterizedCount++;
+            }
+            else
+                SkippedCount++;
+        }
+    }
+
+#ifdef SF_ENABLE_THREADS
+    Mutex::Locker lock(&DoneMutex);
+    Done = 1;
+    DoneCond.NotifyAll();
+#else
+    Done = 1;
+#endif
+}
+
+int GlyphCacheWarmup::threadFunc(Thread*, void* h)
+{
+    ((GlyphCacheWarmup*)h)->Run();
+    return 0;
+}
+
+bool GlyphCacheWarmup::StartAsync()
+{
+#ifdef SF_ENABLE_THREADS
+    if (pThread)
+        return false;
+    pThread = *SF_HEAP_NEW(pHeap) Thread(threadFunc, this);
+    if (pThread && pThread->Start())
+        return true;
+    pThread = 0;
+#endif
+    Run();
+    return true;
+}
+
+void GlyphCacheWarmup::Wait()
+{
+#ifdef SF_ENABLE_THREADS
+    if (pThread)
+    {
+        {
+            Mutex::Locker lock(&DoneMutex);
+            while (!Done)
+                DoneCond.Wait(&DoneMutex);
+        }
+        // Run has returned; join so the thread is gone before pThread is released.
+        pThread->Wait();
+        pThread = 0;
+    }
+#endif
+}
+
+}} // Scaleform::Render
@@ -0,0 +1,259 @@
+/**************************************************************************
+
+PublicHeader:   Render
+Filename    :   Render_GlyphRasterStore.h
+Content     :   Persistent pre-rasterized glyph store and glyph cache
+                warm-up
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_GlyphRasterStore_H
+#define INC_SF_Render_GlyphRasterStore_H
+
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Hash.h"
+#include "Kernel/SF_String.h"
+#include "Kernel/SF_Threads.h"
+#include "Kernel/SF_File.h"
+#include "Render_Font.h"
+#include "Render_ToleranceParams.h"
+
+namespace Scaleform { namespace Render {
+
+class Rasterizer;
+class GlyphFitter;
+
+//------------------------------------------------------------------------
+// ***** GlyphRasterStore
+
+// GlyphRasterStore keeps A8 glyph rasters keyed by font name, style flags,
+// a hash of the glyph outline, hinted pixel size and glyph index. Embedded
+// fonts often share a name while having different outlines (subsets,
+// different versions of a face), so the name alone doesn't identify the
+// glyph; the outline hash keeps such fonts apart, in memory and in saved
+// files. Rasters are stored run-length compressed, since glyph coverage
+// is mostly 0x00 and 0xFF runs.
+//
+// The store is filled either by GlyphCacheWarmup (on a worker thread) or
+// by Load() from a file saved in a previous run. GlyphCache consults the
+// store installed with GlyphCache::SetRasterStore before it rasterizes a
+// glyph, so a hit only costs a decompression and a texture copy.
+//
+// Rasters produced through GlyphFitter (auto-fit) differ from unfitted
+// ones of the same glyph and size, so the fitting mode is part of the key.
+//
+// All public functions are thread-safe.
+class GlyphRasterStore : public RefCountBase<GlyphRasterStore, StatRender_Font_Mem>
+{
+public:
+    enum
+    {
+        FileSignature = 0x53524647, // 'GFRS'
+        FileVersion   = 3,
+
+        // Added to fontFlags for rasters fitted to the pixel grid with GlyphFitter.
+        RasterFlag_AutoFit = 0x8000
+    };
+
+    struct Stats
+    {
+        unsigned    GlyphCount;
+        UPInt       CompressedBytes;
+        UPInt       UncompressedBytes;
+        unsigned    Hits;
+        unsigned    Misses;
+    };
+
+    GlyphRasterStore(MemoryHeap* heap = 0);
+    ~GlyphRasterStore();
+
+    // Adds (or replaces) a raster. fontFlags are masked to Font::FF_Style_Mask
+    // and RasterFlag_AutoFit; outlineHash is GetOutlineHash of the glyph.
+    void        AddRaster(const char* fontName, unsigned fontFlags, UInt32 outlineHash,
+                          unsigned glyphIndex, unsigned hintedSize,
+                          const GlyphRaster& raster);
+
+    // Decompresses a stored raster; returns false on a miss.
+    bool        GetRaster(const char* fontName, unsigned fontFlags, UInt32 outlineHash,
+                          unsigned glyphIndex, unsigned hintedSize,
+                          GlyphRaster* raster) const;
+
+    bool        HasRaster(const char* fontName, unsigned fontFlags, UInt32 outlineHash,
+                          unsigned glyphIndex, unsigned hintedSize) const;
+
+    // Convenience overloads keyed by the font object and fitting mode.
+    void        AddRaster(Font* font, unsigned glyphIndex, unsigned hintedSize, bool autoFit,
+                          const GlyphRaster& raster)
+    {
+        AddRaster(font->GetName(), GetKeyFlags(font, autoFit), GetOutlineHash(font, glyphIndex, hintedSize),
+                  glyphIndex, hintedSize, raster);
+    }
+    bool        GetRaster(Font* font, unsigned glyphIndex, unsigned hintedSize, bool autoFit,
+                          GlyphRaster* raster) const
+    {
+        return GetRaster(font->GetName(), GetKeyFlags(font, autoFit), GetOutlineHash(font, glyphIndex, hintedSize),
+                         glyphIndex, hintedSize, raster);
+    }
+
+    static unsigned GetKeyFlags(Font* font, bool autoFit)
+    {
+        return font->GetFontFlags() | (autoFit ? RasterFlag_AutoFit : 0);
+    }
+
+    // Hashes the glyph outline (path and edge coordinates) together with the
+    // font's nominal height and metrics, so equally named fonts with different
+    // glyphs hash differently. Glyphs without an outline (raster-only fonts)
+    // hash the metrics only; such fonts come from font providers, where the
+    // name identifies the face. The hash is stable across runs. It is cached
+    // in the font (Font::GetCachedOutlineHash), so only the first call per
+    // glyph walks the shape.
+    static UInt32 GetOutlineHash(Font* font, unsigned glyphIndex, unsigned hintedSize);
+
+    void        Clear();
+    void        GetStats(Stats* pstats) const;
+
+    // Serialization. Load merges into the current contents; returns false on
+    // signature/version mismatch or truncated data (partial data is kept).
+    bool        Save(File* file) const;
+    bool        Load(File* file);
+
+    // Run-length codec used for stored rasters; exposed for tools.
+    static void CompressA8(const UByte* src, UPInt size, ArrayLH_POD<UByte, StatRender_Font_Mem>* dst);
+    static bool DecompressA8(const UByte* src, UPInt srcSize, UByte* dst, UPInt dstSize);
+
+private:
+    static UInt32 computeOutlineHash(Font* font, const ShapeDataInterface* shape,
+                                     unsigned glyphIndex, unsigned hintedSize);
+
+    struct Key
+    {
+        String      FontName;
+        UInt16      StyleFlags;
+        UInt16      HintedSize;
+        UInt32      GlyphIndex;
+        UInt32      OutlineHash;
+
+        Key() : StyleFlags(0), HintedSize(0), GlyphIndex(0), OutlineHash(0) {}
+        Key(const char* name, unsigned flags, UInt32 outlineHash, unsigned glyphIndex, unsigned hintedSize)
+            : FontName(name), StyleFlags(UInt16(flags & (Font::FF_Style_Mask | RasterFlag_AutoFit))),
+              HintedSize(UInt16(hintedSize)), GlyphIndex(glyphIndex), OutlineHash(outlineHash) {}
+
+        bool operator == (const Key& other) const
+        {
+            return GlyphIndex == other.GlyphIndex && HintedSize == other.HintedSize &&
+                   OutlineHash == other.OutlineHash && StyleFlags == other.StyleFlags &&
+                   FontName == other.FontName;
+        }
+
+        struct HashFunctor
+        {
+            UPInt operator()(const Key& key) const
+            {
+                return String::BernsteinHashFunction(key.FontName.ToCStr(), key.FontName.GetSize()) ^
+                       key.OutlineHash ^ (key.GlyphIndex * 31) ^ (key.HintedSize << 20) ^ (key.StyleFlags << 28);
+            }
+        };
+    };
+
+    struct Entry
+    {
+        UInt16  Width, Height;
+        SInt16  OriginX, OriginY;
+        ArrayLH_POD<UByte, StatRender_Font_Mem> Data;
+    };
+
+    typedef HashLH<Key, Entry, Key::HashFunctor, StatRender_Font_Mem> EntryHashType;
+
+    MemoryHeap*         pHeap;
+    // Lookups far outnumber additions once the store is warm, so readers
+    // share the lock.
+    mutable ReadWriteLock StoreLock;
+    EntryHashType       Entries;
+    UPInt               CompressedBytes;
+    UPInt               UncompressedBytes;
+    mutable AtomicInt<unsigned> Hits;
+    mutable AtomicInt<unsigned> Misses;
+};
+
+
+//------------------------------------------------------------------------
+// ***** GlyphCacheWarmup
+
+// GlyphCacheWarmup rasterizes a list of (font, size, characters) requests
+// into a GlyphRasterStore ahead of time, without touching the GlyphCache
+// or any render thread state. Run it with StartAsync on a worker thread
+// during loading; the glyphs then reach the cache texture on first use
+// without invoking the Rasterizer.
+//
+// Sizes should be the snapped sizes the cache will request, that is
+// GlyphCache::SnapFontSizeToRamp of the expected screen size. autoFit
+// should match what the cache will do for the text, that is
+// GlyphCacheParams::UseAutoFit and GlyphParam::IsAutoFit; fitted glyphs
+// go through GlyphFitter exactly as GlyphCache::addShapeAutoFit does.
+class GlyphCacheWarmup : public RefCountBase<GlyphCacheWarmup, StatRender_Font_Mem>
+{
+public:
+    GlyphCacheWarmup(GlyphRasterStore* store, MemoryHeap* heap = 0);
+    ~GlyphCacheWarmup();
+
+    // Queues a request. Must be called before Run/StartAsync.
+    void        AddRequest(Font* font, float size, const wchar_t* chars, bool autoFit = true);
+    void        AddRequest(Font* font, float size, const char* utf8Chars, bool autoFit = true);
+
+    // Rasterizes all queued requests on the calling thread.
+    void        Run();
+
+    // Rasterizes on a newly created thread (synchronously if threads are disabled).
+    bool        StartAsync();
+    // Blocks until StartAsync work is done.
+    void        Wait();
+    bool        IsDone() const      { return Done != 0; }
+    void        Cancel()            { CancelRequested = 1; }
+
+    unsigned    GetRasterizedCount() const  { return RasterizedCount; }
+    unsigned    GetSkippedCount() const     { return SkippedCount; }
+
+    // Rasterizes a single glyph outline into raster, using the same
+    // coordinate conventions as GlyphCache. With a fitter, the outline is
+    // snapped to the pixel grid first, as for GlyphParam::AutoFit text.
+    // Returns false for empty glyphs.
+    static bool RasterizeGlyph(Rasterizer& ras, const ToleranceParams& tol,
+                               Font* font, unsigned glyphIndex, unsigned hintedSize,
+                               GlyphRaster* raster, GlyphFitter* fitter = 0);
+
+private:
+    struct Request
+    {
+        Ptr<Font>           pFont;
+        unsigned            HintedSize;
+        bool                AutoFit;
+        ArrayLH<UInt16, StatRender_Font_Mem> Chars;
+    };
+
+    static int  threadFunc(Thread* pthread, void* h);
+
+    MemoryHeap*                 pHeap;
+    Ptr<GlyphRasterStore>       pStore;
+    ArrayLH<Request, StatRender_Font_Mem> Requests;
+    Ptr<Thread>                 pThread;
+#ifdef SF_ENABLE_THREADS
+    Mutex                       DoneMutex;
+    WaitCondition               DoneCond;   // Signaled by Run when it sets Done.
+#endif
+    volatile unsigned           Done;
+    volatile unsigned           CancelRequested;
+    unsigned                    RasterizedCount;
+    unsigned                    SkippedCount;
+};
+
+}} // Scaleform::Render
+
+#endif // INC_SF_Render_GlyphRasterStore_H
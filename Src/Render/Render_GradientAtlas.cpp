@@ -0,0 +1,351 @@
+/**************************************************************************
+
+Filename    :   Render_GradientAtlas.cpp
+Content     :   Shared texture atlas for gradient ramps
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render_GradientAtlas.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_Alg.h"
+#include <math.h>
+
+namespace Scaleform { namespace Render {
+
+//------------------------------------------------------------------------
+GradientAtlasImage::GradientAtlasImage(GradientAtlas* atlas, unsigned page, unsigned row) :
+    pAtlas(atlas), Page(page), Row(row)
+{
+    SF_AMP_CODE(ImageId = ImageBase::GetNextImageId();)
+}
+
+GradientAtlasImage::~GradientAtlasImage()
+{
+    if (pAtlas)
+        pAtlas->onImageDestroyed(this);
+}
+
+ImageSize GradientAtlasImage::GetSize() const
+{
+    return pAtlas ? pAtlas->GetPageSize() : ImageSize(0, 0);
+}
+
+ImageRect GradientAtlasImage::GetRect() const
+{
+    if (!pAtlas)
+        return ImageRect(0, 0, 0, 0);
+    return ImageRect(0, Row, ImageSize(pAtlas->GetParams().RowWidth, 1));
+}
+
+Texture* GradientAtlasImage::GetTexture(TextureManager*)
+{
+    return pAtlas ? pAtlas->GetPageTexture(Page) : 0;
+}
+
+// The gradient matrix maps the shape into ramp space along U only; whatever
+// V it generates is replaced with the center of our row, so linear filtering
+// never picks up the neighbouring ramps.
+void GradientAtlasImage::collapseToRow(Matrix2F* mat) const
+{
+    if (!pAtlas)
+        return;
+    mat->Shy() = 0;
+    mat->Sy()  = 0;
+    mat->Ty()  = ((float)Row + 0.5f) / (float)pAtlas->GetParams().RowsPerPage;
+}
+
+void GradientAtlasImage::GetUVGenMatrix(Matrix2F* mat, TextureManager* manager)
+{
+    Image::GetUVGenMatrix(mat, manager);
+    collapseToRow(mat);
+}
+
+void GradientAtlasImage::GetUVNormMatrix(Matrix2F* mat, TextureManager* manager)
+{
+    Image::GetUVNormMatrix(mat, manager);
+    collapseToRow(mat);
+}
+
+
+//------------------------------------------------------------------------
+GradientAtlas::GradientAtlas(MemoryHeap* heap, TextureManager* texMan,
+                             const GradientAtlasParams& params) :
+    pHeap(heap), pTexMan(texMan), Params(params), FrameId(1)
+{
+    Params.RowWidth    = Alg::Clamp(Params.RowWidth,    16u, 1024u);
+    Params.RowsPerPage = Alg::Clamp(Params.RowsPerPage, 1u,  1024u);
+    Params.MorphSteps  = Alg::Max(Params.MorphSteps, 2u);
+    RowPixels.Resize(Params.RowWidth);
+}
+
+GradientAtlas::~GradientAtlas()
+{
+    Clear();
+}
+
+void GradientAtlas::Clear()
+{
+    for (UPInt i = 0; i < Rows.GetSize(); ++i)
+    {
+        // Outstanding images keep working as 'null texture' fills until
+        // their owners release them.
+        if (Rows[i].pImage)
+            Rows[i].pImage->pAtlas = 0;
+    }
+    Rows.Clear();
+    Pages.Clear();
+    RowHash.Clear();
+}
+
+bool GradientAtlas::allocPage()
+{
+    if (!pTexMan || Pages.GetSize() >= Params.MaxPages)
+        return false;
+
+    Ptr<Texture> tex = *pTexMan->CreateTexture(Image_R8G8B8A8, 1, GetPageSize(),
+                                               ImageUse_Update | ImageUse_PartialUpdate, 0);
+    if (!tex)
+        return false;
+
+    PageEntry page;
+    page.pTexture  = tex;
+    page.LastFrame = 0;
+    Pages.PushBack(page);
+    Rows.Resize(Pages.GetSize() * Params.RowsPerPage);
+    return true;
+}
+
+int GradientAtlas::findFreeRow()
+{
+    // Prefer a never-used row; otherwise the least recently used row
+    // that no live fill references.
+    int      lruRow   = -1;
+    UInt32   lruFrame = 0;
+    for (UPInt i = 0; i < Rows.GetSize(); ++i)
+    {
+        const RowEntry& row = Rows[i];
+        if (!row.Used)
+            return (int)i;
+        if (!row.pImage && (lruRow < 0 || row.LastFrame < lruFrame))
+        {
+            lruRow   = (int)i;
+            lruFrame = row.LastFrame;
+        }
+    }
+    return lruRow;
+}
+
+void GradientAtlas::touchRow(RowEntry& row)
+{
+    row.LastFrame = FrameId;
+}
+
+bool GradientAtlas::uploadRow(unsigned rowIndex, const GradientData* data, float morphRatio)
+{
+    Texture* tex = Pages[rowIndex / Params.RowsPerPage].pTexture;
+    GenerateRamp(data, morphRatio, RowPixels.GetDataPtr(), Params.RowWidth);
+
+    Texture::UpdateDesc upd;
+    upd.SourcePlane.SetData(ImageSize(Params.RowWidth, 1), Params.RowWidth * 4,
+                            Params.RowWidth * 4, (UByte*)RowPixels.GetDataPtr());
+    upd.DestRect   = ImageRect(0, rowIndex % Params.RowsPerPage, ImageSize(Params.RowWidth, 1));
+    upd.PlaneIndex = 0;
+    return tex->Update(&upd, 1, 0);
+}
+
+Image* GradientAtlas::Acquire(const GradientData* data, float morphRatio)
+{
+    if (!data || data->GetGradientType() != GradientLinear || data->GetRecordCount() == 0)
+    {
+        Counters.Rejected++;
+        return 0;
+    }
+
+    unsigned morphStep = 0;
+    if (data->GetMorphTo())
+        morphStep = (unsigned)(Alg::Clamp(morphRatio, 0.0f, 1.0f) * (Params.MorphSteps - 1) + 0.5f);
+
+    RowKey   key(const_cast<GradientData*>(data), morphStep);
+    unsigned rowIndex;
+
+    if (RowHash.Get(key, &rowIndex))
+    {
+        Counters.Hits++;
+    }
+    else
+    {
+        int freeRow = findFreeRow();
+        if (freeRow < 0 && allocPage())
+            freeRow = findFreeRow();
+        if (freeRow < 0)
+        {
+            Counters.Rejected++;
+            return 0;
+        }
+        rowIndex = (unsigned)freeRow;
+
+        // Upload the quantized ratio, since that's what the key shares.
+        float quantRatio = data->GetMorphTo() ? (float)morphStep / (float)(Params.MorphSteps - 1) : 0.0f;
+        if (!uploadRow(rowIndex, data, quantRatio))
+        {
+            Counters.Rejected++;
+            return 0;
+        }
+
+        RowEntry& row = Rows[rowIndex];
+        if (row.Used)
+        {
+            RowHash.Remove(row.Key);
+            Counters.Evictions++;
+        }
+        // A reused row counts as a new ramp even if its previous
+        // ramp was referenced earlier in this frame.
+        row.Key       = key;
+        row.Used      = true;
+        row.LastFrame = 0;
+        RowHash.Set(key, rowIndex);
+        Counters.Misses++;
+    }
+
+    RowEntry& row = Rows[rowIndex];
+    touchRow(row);
+
+    if (row.pImage)
+    {
+        row.pImage->AddRef();
+        return row.pImage;
+    }
+    row.pImage = SF_HEAP_NEW(pHeap) GradientAtlasImage(this, rowIndex / Params.RowsPerPage,
+                                                      rowIndex % Params.RowsPerPage);
+    return row.pImage;
+}
+
+void GradientAtlas::onImageDestroyed(GradientAtlasImage* image)
+{
+    unsigned rowIndex = image->Page * Params.RowsPerPage + image->Row;
+    if (rowIndex < Rows.GetSize() && Rows[rowIndex].pImage == image)
+        Rows[rowIndex].pImage = 0;
+}
+
+void GradientAtlas::NoteDraw(const Texture* ptexture)
+{
+    if (!ptexture)
+        return;
+    for (UPInt i = 0; i < Pages.GetSize(); ++i)
+    {
+        PageEntry& page = Pages[i];
+        if (page.pTexture.GetPtr() != ptexture)
+            continue;
+        Counters.DrawsThisFrame++;
+        if (page.LastFrame != FrameId)
+            Counters.PagesThisFrame++;
+        page.LastFrame = FrameId;
+        return;
+    }
+}
+
+void GradientAtlas::EndFrame()
+{
+    FrameId++;
+}
+
+void GradientAtlas::GetStats(Stats* pstats, bool clearCounters)
+{
+    unsigned used = 0;
+    for (UPInt i = 0; i < Rows.GetSize(); ++i)
+        if (Rows[i].Used)
+            used++;
+
+    *pstats             = Counters;
+    pstats->Pages       = (unsigned)Pages.GetSize();
+    pstats->RowsUsed    = used;
+    pstats->RowCapacity = (unsigned)Rows.GetSize();
+
+    if (clearCounters)
+        Counters.Clear();
+}
+
+
+//------------------------------------------------------------------------
+static inline float GradientAtlas_ToLinear(UByte c)
+{
+    float f = c / 255.0f;
+    return f * f;
+}
+static inline UByte GradientAtlas_FromLinear(float f)
+{
+    return (UByte)(sqrtf(Alg::Clamp(f, 0.0f, 1.0f)) * 255.0f + 0.5f);
+}
+
+void GradientAtlas::GenerateRamp(const GradientData* data, float morphRatio,
+                                 UInt32* pixels, unsigned width)
+{
+    enum { MaxRecords = 256 };
+    GradientRecord  recs[MaxRecords];
+    unsigned        count = Alg::Min((unsigned)data->GetRecordCount(), (unsigned)MaxRecords);
+    const GradientData* morphTo = data->GetMorphTo();
+    unsigned i;
+
+    if (morphTo && morphTo->GetRecordCount() == data->GetRecordCount())
+    {
+        for (i = 0; i < count; ++i)
+            recs[i] = data->At(i).LerpTo(morphTo->At(i), morphRatio);
+    }
+    else
+    {
+        for (i = 0; i < count; ++i)
+            recs[i] = data->At(i);
+    }
+
+    bool     linearRGB = data->IsLinearRGB();
+    UByte*   pdest     = (UByte*)pixels;
+    unsigned rec       = 0;
+
+    for (unsigned x = 0; x < width; ++x)
+    {
+        float ratio = (width > 1) ? (255.0f * x) / (float)(width - 1) : 0.0f;
+        while (rec + 1 < count && ratio > (float)recs[rec + 1].Ratio)
+            rec++;
+
+        Color c;
+        if (ratio <= (float)recs[0].Ratio || rec + 1 >= count)
+        {
+            c = (ratio <= (float)recs[0].Ratio) ? recs[0].ColorV : recs[count - 1].ColorV;
+        }
+        else
+        {
+            const GradientRecord& r0 = recs[rec];
+            const GradientRecord& r1 = recs[rec + 1];
+            float span = (float)r1.Ratio - (float)r0.Ratio;
+            float t    = (span > 0) ? (ratio - (float)r0.Ratio) / span : 0.0f;
+
+            if (linearRGB)
+            {
+                c.SetRGBA(GradientAtlas_FromLinear(Alg::Lerp(GradientAtlas_ToLinear(r0.ColorV.GetRed()),   GradientAtlas_ToLinear(r1.ColorV.GetRed()),   t)),
+                          GradientAtlas_FromLinear(Alg::Lerp(GradientAtlas_ToLinear(r0.ColorV.GetGreen()), GradientAtlas_ToLinear(r1.ColorV.GetGreen()), t)),
+                          GradientAtlas_FromLinear(Alg::Lerp(GradientAtlas_ToLinear(r0.ColorV.GetBlue()),  GradientAtlas_ToLinear(r1.ColorV.GetBlue()),  t)),
+                          (UByte)Alg::Lerp((float)r0.ColorV.GetAlpha(), (float)r1.ColorV.GetAlpha(), t));
+            }
+            else
+            {
+                c = Color::Blend(r0.ColorV, r1.ColorV, t);
+            }
+        }
+
+        pdest[0] = c.GetRed();
+        pdest[1] = c.GetGreen();
+        pdest[2] = c.GetBlue();
+        pdest[3] = c.GetAlpha();
+        pdest += 4;
+    }
+}
+
+}} // Scaleform::Render
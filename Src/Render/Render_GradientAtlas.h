@@ -0,0 +1,228 @@
+/**************************************************************************
+
+PublicHeader:   Render
+Filename    :   Render_GradientAtlas.h
+Content     :   Shared texture atlas for gradient ramps
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_GradientAtlas_H
+#define INC_SF_Render_GradientAtlas_H
+
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Hash.h"
+#include "Render_Image.h"
+#include "Render_Gradients.h"
+
+namespace Scaleform { namespace Render {
+
+class GradientAtlas;
+
+//------------------------------------------------------------------------
+// ***** GradientAtlasParams
+
+// GradientAtlas packs gradient ramps as single-pixel rows of a few shared
+// RGBA textures ("pages"). Fills that reference ramps in the same page
+// end up with the same Texture pointer and therefore the same PrimitiveFill,
+// which lets the batcher merge shapes that would otherwise be broken up
+// by a texture change per gradient.
+struct GradientAtlasParams
+{
+    unsigned RowWidth;      // Width of every ramp row; ramps are resampled to it.
+    unsigned RowsPerPage;   // Height of a page texture, in ramp rows.
+    unsigned MaxPages;      // Pages allocated on demand, up to this limit.
+
+    // Morph ratios are quantized to this many steps before lookup, so
+    // morph shapes that differ only by sub-step ratio share a ramp row.
+    unsigned MorphSteps;
+
+    GradientAtlasParams(unsigned rowWidth = 256, unsigned rowsPerPage = 256,
+                        unsigned maxPages = 2, unsigned morphSteps = 256)
+        : RowWidth(rowWidth), RowsPerPage(rowsPerPage),
+          MaxPages(maxPages), MorphSteps(morphSteps)
+    {}
+};
+
+
+//------------------------------------------------------------------------
+// GradientAtlasImage is the Image handed out for a ramp stored in the atlas.
+// It reports the page texture, and its UV matrices collapse the V axis onto
+// the center of its row, so the gradient matrix only needs to drive U.
+// Only Linear gradients are atlased; radial shaders compute U from the
+// length of the texture coordinate and can't be confined to a row.
+class GradientAtlasImage : public Image
+{
+    friend class GradientAtlas;
+public:
+    GradientAtlasImage(GradientAtlas* atlas, unsigned page, unsigned row);
+    virtual ~GradientAtlasImage();
+
+    virtual ImageFormat     GetFormat() const       { return Image_R8G8B8A8; }
+    virtual ImageSize       GetSize() const;
+    virtual ImageRect       GetRect() const;
+    virtual unsigned        GetUse() const          { return 0; }
+    virtual unsigned        GetMipmapCount() const  { return 1; }
+
+    virtual Texture*        GetTexture(TextureManager* pmanager);
+    virtual void            GetUVGenMatrix(Matrix2F* mat, TextureManager* manager);
+    virtual void            GetUVNormMatrix(Matrix2F* mat, TextureManager* manager);
+
+    unsigned                GetPage() const { return Page; }
+    unsigned                GetRow() const  { return Row; }
+
+    virtual Image*  GetAsImage() { return this; }
+    SF_AMP_CODE(
+        virtual UPInt   GetBytes(int* memRegion) const { if (memRegion) *memRegion = 0; return 0; }
+        virtual UInt32  GetImageId() const { return ImageId; }
+        virtual UInt32  GetBaseImageId() const { return 0; }
+    )
+
+private:
+    void                    collapseToRow(Matrix2F* mat) const;
+
+    GradientAtlas*          pAtlas;     // Cleared by the atlas on destruction.
+    unsigned                Page;
+    unsigned                Row;
+    SF_AMP_CODE(UInt32 ImageId;)
+};
+
+
+//------------------------------------------------------------------------
+// ***** GradientAtlas
+
+// Render-thread only, owned by PrimitiveFillManager. Rows are reference
+// counted by the GradientAtlasImage objects that use them; unreferenced
+// rows stay resident (so re-appearing gradients are free) and are reused
+// in least-recently-used order when the atlas runs out of space.
+class GradientAtlas : public RefCountBase<GradientAtlas, StatRender_TreeCache_Mem>
+{
+    friend class GradientAtlasImage;
+public:
+
+    // Occupancy and batching counters. The per-frame counters are fed by
+    // NoteDraw from the HAL, so they describe what was bound, not which
+    // fills happened to be created during the frame.
+    struct Stats
+    {
+        unsigned Pages;             // Page textures allocated.
+        unsigned RowsUsed;          // Rows holding a ramp (referenced or cached).
+        unsigned RowCapacity;       // Pages * RowsPerPage.
+        unsigned DrawsThisFrame;    // Fill binds that sampled a page since last EndFrame.
+        unsigned PagesThisFrame;    // Distinct pages bound since last EndFrame.
+        unsigned Hits;              // Acquire calls satisfied by an existing row.
+        unsigned Misses;            // Acquire calls that rasterized a new row.
+        unsigned Evictions;         // Cached rows overwritten by a new ramp.
+        unsigned Rejected;          // Ramps left to a standalone GradientImage.
+
+        Stats() { Clear(); }
+        void Clear()
+        {
+            Pages = RowsUsed = RowCapacity = DrawsThisFrame = PagesThisFrame = 0;
+            Hits = Misses = Evictions = Rejected = 0;
+        }
+    };
+
+    GradientAtlas(MemoryHeap* heap, TextureManager* texMan,
+                  const GradientAtlasParams& params = GradientAtlasParams());
+    ~GradientAtlas();
+
+    const GradientAtlasParams& GetParams() const { return Params; }
+
+    // Returns an image for the ramp, sharing an existing row when an equal
+    // gradient (after morph quantization) is already resident. Returns 0 when
+    // the gradient can't be atlased (non-linear type, or all rows referenced);
+    // the caller should then fall back to a standalone GradientImage.
+    Image*          Acquire(const GradientData* data, float morphRatio);
+
+    // Called by the HAL for every texture of a fill it binds; textures that
+    // aren't atlas pages are ignored.
+    void            NoteDraw(const Texture* ptexture);
+
+    // Marks frame boundary for LRU ordering and per-frame statistics.
+    void            EndFrame();
+
+    // Releases page textures and forgets all cached rows; referenced
+    // GradientAtlasImages will report a null texture until re-acquired.
+    void            Clear();
+
+    void            GetStats(Stats* pstats, bool clearCounters = true);
+
+    Texture*        GetPageTexture(unsigned page) const
+    { return (page < Pages.GetSize()) ? Pages[page].pTexture.GetPtr() : 0; }
+    ImageSize       GetPageSize() const { return ImageSize(Params.RowWidth, Params.RowsPerPage); }
+
+    // Generates a ramp of 'width' RGBA pixels for the data, interpolating
+    // towards the morph target; shared with the CPU reference path.
+    static void     GenerateRamp(const GradientData* data, float morphRatio,
+                                 UInt32* pixels, unsigned width);
+
+private:
+    struct RowKey
+    {
+        Ptr<GradientData>   pData;
+        unsigned            MorphStep;
+
+        RowKey() : MorphStep(0) {}
+        RowKey(GradientData* data, unsigned step) : pData(data), MorphStep(step) {}
+
+        bool operator == (const RowKey& other) const
+        {
+            if (MorphStep != other.MorphStep || !(*pData == *other.pData))
+                return false;
+            const GradientData* m1 = pData->GetMorphTo();
+            const GradientData* m2 = other.pData->GetMorphTo();
+            return (m1 == m2) || (m1 && m2 && (*m1 == *m2));
+        }
+
+        struct HashFunctor
+        {
+            UPInt operator()(const RowKey& key) const
+            { return key.pData->GetHashValue(0) ^ (key.MorphStep * 0x9E3779B1u); }
+        };
+    };
+
+    struct RowEntry
+    {
+        RowKey              Key;
+        GradientAtlasImage* pImage;     // Shared image while referenced; no ref held.
+        UInt32              LastFrame;  // 0 until first referenced.
+        bool                Used;
+        RowEntry() : pImage(0), LastFrame(0), Used(false) {}
+    };
+
+    struct PageEntry
+    {
+        Ptr<Texture>        pTexture;
+        UInt32              LastFrame;  // Frame of the last NoteDraw; 0 until first bound.
+    };
+
+    typedef HashLH<RowKey, unsigned, RowKey::HashFunctor, StatRender_TreeCache_Mem> RowHashType;
+
+    bool            allocPage();
+    int             findFreeRow();
+    bool            uploadRow(unsigned rowIndex, const GradientData* data, float morphRatio);
+    void            touchRow(RowEntry& row);
+    void            onImageDestroyed(GradientAtlasImage* image);
+
+    MemoryHeap*                 pHeap;
+    TextureManager*             pTexMan;
+    GradientAtlasParams         Params;
+    ArrayLH<PageEntry, StatRender_TreeCache_Mem> Pages;
+    ArrayLH<RowEntry,  StatRender_TreeCache_Mem> Rows;      // Page-major, RowsPerPage per page.
+    ArrayLH<UInt32,    StatRender_TreeCache_Mem> RowPixels; // Scratch for one ramp.
+    RowHashType                 RowHash;
+    UInt32                      FrameId;    // Starts at 1, so 0 marks untouched rows and pages.
+    Stats                       Counters;
+};
+
+}} // Scaleform::Render
+
+#endif // INC_SF_Render_GradientAtlas_H
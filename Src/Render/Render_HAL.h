@@ -96,6 +96,11 @@ enum HALConfigFlagsType
     // in GL where shaders cannot be compiled offline. However, this may have performance implications
     // when referencing initializing shaders during playback.
     HALConfig_DynamicShaderInit         = 0x04000000,
+
+    // Packs linear gradient ramps into a shared GradientAtlas instead of creating a texture per
+    // gradient. Gradient-heavy content then shares fills between shapes, reducing texture binds
+    // and batch breaks. Radial and focal gradients are not affected.
+    HALConfig_GradientAtlas             = 0x02000000,
 };
 
 // Parameter to Display, specifying which pass to render.
@@ -252,9 +257,22 @@ public:
         unsigned RTChanges;     // Number of render target changes performed (between HAL::BeginScene/EndScene).
         unsigned Filters;       // Number of filters rendered, does not include cached filter rendering.
 
-        Stats() : Primitives(0), Meshes(0), Triangles(0), Masks(0), RTChanges(0), Filters(0) { }
-
-        void Clear() { Primitives = Meshes = Triangles = Masks = RTChanges = Filters = 0; }
+        // Gradient atlas (HALConfig_GradientAtlas) counters, taken when fills are bound for drawing.
+        // GradientAtlasDraws is the number of fill binds that sampled an atlas page; GradientAtlasPages
+        // is the number of distinct pages bound, summed over frames.
+        unsigned GradientAtlasDraws;
+        unsigned GradientAtlasPages;
+        unsigned GradientAtlasRows;     // Atlas rows currently holding a ramp.
+        unsigned GradientAtlasCapacity; // Total atlas rows allocated.
+
+        Stats() : Primitives(0), Meshes(0), Triangles(0), Masks(0), RTChanges(0), Filters(0),
+                  GradientAtlasDraws(0), GradientAtlasPages(0), GradientAtlasRows(0), GradientAtlasCapacity(0) { }
+
+        void Clear()
+        {
+            Primitives = Meshes = Triangles = Masks = RTChanges = Filters = 0;
+            GradientAtlasDraws = GradientAtlasPages = GradientAtlasRows = GradientAtlasCapacity = 0;
+        }
     };
 
     // *** Public API
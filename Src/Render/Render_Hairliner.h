@@ -132,6 +132,16 @@ public:
 
     void Tessellate();
 
+    // Fast path for simple hairlines: when no two non-adjacent segments come
+    // within the line width of each other and there are no sharp joins, the
+    // line ribbons are emitted directly, without the scanbeam sweep, and the
+    // function returns true. Otherwise it leaves the output empty and returns
+    // false, and the caller should run Tessellate(). Tessellate() itself
+    // doesn't try the fast path: its definition is not part of this source
+    // tree, so TessellateSimple is only reached by callers that invoke it
+    // directly.
+    bool TessellateSimple();
+
     // Acquire mesh interface
     //----------------------------
     virtual void        Transform(const Matrix2F& m);
@@ -203,6 +213,19 @@ private:
     void generateTriangles(CoordType width);
     void generateContourAA(unsigned edge);
 
+    // Fast path (Render_HairlinerSimple.cpp)
+    struct SimpleSegType
+    {
+        CoordType x1, y1, x2, y2;
+        CoordType minX, maxX;
+        unsigned  path, index;  // Path and position of the start vertex in it.
+    };
+    static bool cmpSimpleSegs(const SimpleSegType& a, const SimpleSegType& b);
+    bool     isSimpleInput(ArrayPaged<SrcVertexType, 4, 16>& verts,
+                           ArrayPaged<PathType, 4, 4>& paths,
+                           ArrayPaged<unsigned, 4, 4>& closed);
+    unsigned addSimpleVertex(CoordType x, CoordType y, unsigned alpha);
+
     //-------------------------------------------------------------------
     LinearHeap*                             pHeap;
     CoordType                               Epsilon;
@@ -0,0 +1,293 @@
+/**************************************************************************
+
+Filename    :   Render_HairlinerSimple.cpp
+Content     :   Hairliner fast path for simple, non-overlapping paths
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render_Hairliner.h"
+
+#ifdef SF_RENDER_ENABLE_HAIRLINER
+
+#include "Kernel/SF_Alg.h"
+#include <math.h>
+
+namespace Scaleform { namespace Render {
+
+//-----------------------------------------------------------------------
+// Most hairline content (wireframes, outlines of UI shapes, chart grids)
+// consists of paths that never cross or touch. For those, the graph built
+// by the scanbeam sweep is just the input polylines, so the ribbons can
+// be emitted directly: per vertex, a center vertex (alpha 1) and two
+// fringe vertices (alpha 0) offset along the mitered normal.
+//
+// The test is conservative. Any two non-consecutive segments closer than
+// the line width, a join sharper than 120 degrees, or a pair-test count
+// that suggests a dense, heavily overlapping scene sends the input to the
+// sweep.
+//-----------------------------------------------------------------------
+
+bool Hairliner::cmpSimpleSegs(const SimpleSegType& a, const SimpleSegType& b)
+{
+    return a.minX < b.minX;
+}
+
+static inline CoordType Hairliner_PointSegDist2(CoordType px, CoordType py,
+                                                CoordType x1, CoordType y1,
+                                                CoordType x2, CoordType y2)
+{
+    CoordType dx = x2 - x1, dy = y2 - y1;
+    CoordType len2 = dx * dx + dy * dy;
+    CoordType t = (len2 > 0) ? ((px - x1) * dx + (py - y1) * dy) / len2 : 0;
+    t = Alg::Clamp(t, CoordType(0), CoordType(1));
+    dx = px - (x1 + t * dx);
+    dy = py - (y1 + t * dy);
+    return dx * dx + dy * dy;
+}
+
+static inline bool Hairliner_SegsCross(const CoordType* a, const CoordType* b)
+{
+    CoordType d1 = Math2D::CrossProduct(a[0], a[1], a[2], a[3], b[0], b[1]);
+    CoordType d2 = Math2D::CrossProduct(a[0], a[1], a[2], a[3], b[2], b[3]);
+    CoordType d3 = Math2D::CrossProduct(b[0], b[1], b[2], b[3], a[0], a[1]);
+    CoordType d4 = Math2D::CrossProduct(b[0], b[1], b[2], b[3], a[2], a[3]);
+    return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0));
+}
+
+unsigned Hairliner::addSimpleVertex(CoordType x, CoordType y, unsigned alpha)
+{
+    OutVertexType v = { x, y, alpha };
+    OutVertices.PushBack(v);
+    return unsigned(OutVertices.GetSize() - 1);
+}
+
+// Collects deduplicated vertices per path (closed paths lose their
+// repeated last vertex), and checks the joins and segment separation.
+bool Hairliner::isSimpleInput(ArrayPaged<SrcVertexType, 4, 16>& verts,
+                              ArrayPaged<PathType, 4, 4>& paths,
+                              ArrayPaged<unsigned, 4, 4>& closed)
+{
+    const CoordType eps2 = Epsilon * Epsilon;
+    unsigned i, j;
+
+    for (i = 0; i < Paths.GetSize(); ++i)
+    {
+        const PathType& src = Paths[i];
+        PathType p;
+        p.start = unsigned(verts.GetSize());
+        for (j = src.start; j < src.end; ++j)
+        {
+            const SrcVertexType& v = SrcVertices[j];
+            if (verts.GetSize() > p.start)
+            {
+                const SrcVertexType& l = verts.Back();
+                if ((v.x - l.x) * (v.x - l.x) + (v.y - l.y) * (v.y - l.y) <= eps2)
+                    continue;
+            }
+            verts.PushBack(v);
+        }
+        p.end = unsigned(verts.GetSize());
+
+        unsigned isClosed = 0;
+        if (p.end - p.start >= 3)
+        {
+            const SrcVertexType& f = verts[p.start];
+            const SrcVertexType& l = verts[p.end - 1];
+            if ((f.x - l.x) * (f.x - l.x) + (f.y - l.y) * (f.y - l.y) <= eps2)
+            {
+                verts.PopBack();
+                p.end--;
+                isClosed = 1;
+            }
+        }
+        if (p.end - p.start < 2)
+        {
+            while (verts.GetSize() > p.start)
+                verts.PopBack();
+            continue;
+        }
+        paths.PushBack(p);
+        closed.PushBack(isClosed);
+    }
+
+    if (paths.GetSize() == 0)
+        return false;
+
+    // Joins and segment list.
+    ArrayPaged<SimpleSegType, 4, 16> segs(pHeap);
+
+    for (i = 0; i < paths.GetSize(); ++i)
+    {
+        const PathType& p = paths[i];
+        unsigned n    = p.end - p.start;
+        unsigned nseg = closed[i] ? n : n - 1;
+
+        for (j = 0; j < nseg; ++j)
+        {
+            const SrcVertexType& v1 = verts[p.start + j];
+            const SrcVertexType& v2 = verts[p.start + (j + 1) % n];
+            SimpleSegType s;
+            s.x1 = v1.x; s.y1 = v1.y; s.x2 = v2.x; s.y2 = v2.y;
+            s.minX  = Alg::Min(v1.x, v2.x) - Width;
+            s.maxX  = Alg::Max(v1.x, v2.x) + Width;
+            s.path  = i;
+            s.index = j;
+            segs.PushBack(s);
+
+            if (j + 1 < nseg || closed[i])
+            {
+                const SrcVertexType& v3 = verts[p.start + (j + 2) % n];
+                CoordType ax = v2.x - v1.x, ay = v2.y - v1.y;
+                CoordType bx = v3.x - v2.x, by = v3.y - v2.y;
+                CoordType dot = ax * bx + ay * by;
+                if (dot < 0 && dot * dot > 0.25f * (ax * ax + ay * ay) * (bx * bx + by * by))
+                    return false;
+            }
+        }
+    }
+
+    // Sweep-and-prune on X; pairs are tested for actual separation.
+    Alg::QuickSort(segs, cmpSimpleSegs);
+
+    UPInt budget = segs.GetSize() * 64 + 1024;
+    CoordType minDist2 = Width * Width;
+    for (i = 0; i < segs.GetSize(); ++i)
+    {
+        const SimpleSegType& a = segs[i];
+        CoordType aMinY = Alg::Min(a.y1, a.y2) - Width;
+        CoordType aMaxY = Alg::Max(a.y1, a.y2) + Width;
+
+        for (j = i + 1; j < segs.GetSize() && segs[j].minX <= a.maxX; ++j)
+        {
+            if (--budget == 0)
+                return false;
+
+            const SimpleSegType& b = segs[j];
+            if (Alg::Max(b.y1, b.y2) < aMinY || Alg::Min(b.y1, b.y2) > aMaxY)
+                continue;
+
+            if (a.path == b.path)
+            {
+                const PathType& p = paths[a.path];
+                unsigned nseg = closed[a.path] ? p.end - p.start : p.end - p.start - 1;
+                unsigned d = (a.index > b.index) ? a.index - b.index : b.index - a.index;
+                if (d == 1 || (closed[a.path] && d == nseg - 1))
+                    continue;
+            }
+
+            CoordType ca[4] = { a.x1, a.y1, a.x2, a.y2 };
+            CoordType cb[4] = { b.x1, b.y1, b.x2, b.y2 };
+            if (Hairliner_SegsCross(ca, cb) ||
+                Hairliner_PointSegDist2(a.x1, a.y1, b.x1, b.y1, b.x2, b.y2) < minDist2 ||
+                Hairliner_PointSegDist2(a.x2, a.y2, b.x1, b.y1, b.x2, b.y2) < minDist2 ||
+                Hairliner_PointSegDist2(b.x1, b.y1, a.x1, a.y1, a.x2, a.y2) < minDist2 ||
+                Hairliner_PointSegDist2(b.x2, b.y2, a.x1, a.y1, a.x2, a.y2) < minDist2)
+                return false;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------
+bool Hairliner::TessellateSimple()
+{
+    OutVertices.Clear();
+    Triangles.Clear();
+
+    ArrayPaged<SrcVertexType, 4, 16> verts(pHeap);
+    ArrayPaged<PathType, 4, 4>       paths(pHeap);
+    ArrayPaged<unsigned, 4, 4>       closed(pHeap);
+
+    if (!isSimpleInput(verts, paths, closed))
+        return false;
+
+    CoordType hw = Width * 0.5f;
+
+    for (unsigned i = 0; i < paths.GetSize(); ++i)
+    {
+        const PathType& p = paths[i];
+        unsigned n     = p.end - p.start;
+        bool     isClosed = closed[i] != 0;
+        unsigned first = unsigned(OutVertices.GetSize());
+
+        // Three vertices per source vertex: left fringe, center, right fringe.
+        for (unsigned j = 0; j < n; ++j)
+        {
+            const SrcVertexType& v = verts[p.start + j];
+            bool hasPrev = isClosed || j > 0;
+            bool hasNext = isClosed || j + 1 < n;
+            const SrcVertexType& vp = verts[p.start + (hasPrev ? (j + n - 1) % n : j)];
+            const SrcVertexType& vn = verts[p.start + (hasNext ? (j + 1) % n : j)];
+
+            CoordType nx = 0, ny = 0;
+            if (hasPrev)
+            {
+                CoordType dx = v.x - vp.x, dy = v.y - vp.y;
+                CoordType l  = sqrtf(dx * dx + dy * dy);
+                nx -= dy / l; ny += dx / l;
+            }
+            if (hasNext)
+            {
+                CoordType dx = vn.x - v.x, dy = vn.y - v.y;
+                CoordType l  = sqrtf(dx * dx + dy * dy);
+                nx -= dy / l; ny += dx / l;
+            }
+
+            // Miter: scale the bisector so its projection on either
+            // normal equals the half-width. Joins are limited to 120
+            // degrees by isSimpleInput, so the miter is at most 2x.
+            CoordType nl2 = nx * nx + ny * ny;
+            CoordType k   = (hasPrev && hasNext) ? 2 * hw / nl2 : hw / sqrtf(nl2);
+            nx *= k; ny *= k;
+
+            addSimpleVertex(v.x + nx, v.y + ny, 0);
+            addSimpleVertex(v.x,      v.y,      1);
+            addSimpleVertex(v.x - nx, v.y - ny, 0);
+        }
+
+        unsigned nseg = isClosed ? n : n - 1;
+        for (unsigned j = 0; j < nseg; ++j)
+        {
+            unsigned a = first + j * 3;
+            unsigned b = first + ((j + 1) % n) * 3;
+            TriangleType t;
+            t.v1 = a;     t.v2 = a + 1; t.v3 = b + 1; Triangles.PushBack(t);
+            t.v1 = a;     t.v2 = b + 1; t.v3 = b;     Triangles.PushBack(t);
+            t.v1 = a + 1; t.v2 = a + 2; t.v3 = b + 2; Triangles.PushBack(t);
+            t.v1 = a + 1; t.v2 = b + 2; t.v3 = b + 1; Triangles.PushBack(t);
+        }
+
+        if (!isClosed)
+        {
+            // Fade the open ends out over half the width.
+            for (unsigned e = 0; e < 2; ++e)
+            {
+                unsigned j  = e ? n - 1 : 0;
+                unsigned jn = e ? n - 2 : 1;
+                const SrcVertexType& v  = verts[p.start + j];
+                const SrcVertexType& vn = verts[p.start + jn];
+                CoordType dx = v.x - vn.x, dy = v.y - vn.y;
+                CoordType l  = sqrtf(dx * dx + dy * dy);
+                unsigned c   = first + j * 3;
+                unsigned tip = addSimpleVertex(v.x + dx / l * hw, v.y + dy / l * hw, 0);
+                TriangleType t;
+                t.v1 = c;     t.v2 = c + 1; t.v3 = tip; Triangles.PushBack(t);
+                t.v1 = c + 1; t.v2 = c + 2; t.v3 = tip; Triangles.PushBack(t);
+            }
+        }
+    }
+
+    return true;
+}
+
+}} // Scaleform::Render
+
+#endif // SF_RENDER_ENABLE_HAIRLINER
@@ -139,6 +139,22 @@ struct MeshCacheParams
         MaxVerticesSizeInBatch(src.MaxVerticesSizeInBatch),
         MaxIndicesInBatch(src.MaxIndicesInBatch)
     { }
+
+    MeshCacheParams& operator = (const MeshCacheParams& src)
+    {
+        MemReserve                  = src.MemReserve;
+        MemLimit                    = src.MemLimit;
+        MemGranularity              = src.MemGranularity;
+        LRUTailSize                 = src.LRUTailSize;
+        StagingBufferSize           = src.StagingBufferSize;
+        VBLockEvictSizeLimit        = src.VBLockEvictSizeLimit;
+        MaxBatchInstances           = src.MaxBatchInstances;
+        InstancingThreshold         = src.InstancingThreshold;
+        NoBatchVerticesSizeThreshold = src.NoBatchVerticesSizeThreshold;
+        MaxVerticesSizeInBatch      = src.MaxVerticesSizeInBatch;
+        MaxIndicesInBatch           = src.MaxIndicesInBatch;
+        return *this;
+    }
 };
 
 
@@ -30,6 +30,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Render/Render_Containers.h"
 #include "Render/Render_Image.h" // For PrimitiveFill
 #include "Render/Render_Gradients.h"
+#include "Render/Render_GradientAtlas.h"
 #include "Render/Render_Vertex.h"
 #include "Render/Render_Types2D.h"
 #include "Render/Render_Math2D.h"
@@ -697,7 +698,24 @@ public:
     }
 
     PrimitiveFill* CreateFill(const PrimitiveFillData& initdata);
-    PrimitiveFill* CreateFill(const FillData& initdata, Ptr<Image>* gradientImg, TextureManager* mng, float morphRatio);
+
+    // Creates a fill for shape data. When a gradient atlas is installed, gradients
+    // it accepts are served as rows of its shared page textures (gradientImg then
+    // receives the row image), so their fills compare equal and batch together.
+    PrimitiveFill* CreateFill(const FillData& initdata, Ptr<Image>* gradientImg, TextureManager* mng, float morphRatio)
+    {
+        if (pGradientAtlas && initdata.Type == Fill_Gradient)
+        {
+            if (Image* img = pGradientAtlas->Acquire(initdata.pGradient, morphRatio))
+            {
+                *gradientImg = *img;
+                PrimitiveFillData data(initdata.PrimFill, initdata.pVFormat, img->GetTexture(mng),
+                                       ImageFillMode(Wrap_Clamp, Sample_Linear));
+                return CreateFill(data);
+            }
+        }
+        return createFill(initdata, gradientImg, mng, morphRatio);
+    }
 
     // Creates a complex merged fill built out of one or more regular fills.
     PrimitiveFill* CreateMergedFill(unsigned mergeFlags, const VertexFormat* vformat,
@@ -707,15 +725,23 @@ public:
 
     UPInt   GetNumGradients() const { return Gradients.GetSize(); }
 
+    // Optional shared atlas for gradient ramps, installed by ShaderHAL when
+    // HALConfig_GradientAtlas is set; see CreateFill.
+    void            SetGradientAtlas(GradientAtlas* atlas) { pGradientAtlas = atlas; }
+    GradientAtlas*  GetGradientAtlas() const               { return pGradientAtlas; }
+
 private:
+    // CreateFill(const FillData&, ...) without the atlas; every gradient gets its own GradientImage.
+    PrimitiveFill* createFill(const FillData& initdata, Ptr<Image>* gradientImg, TextureManager* mng, float morphRatio);
     void    removeFill(PrimitiveFill* fill);
     void    removeGradient(GradientImage* img);
     // Creates and/or registers a gradient image; caller must store reference.
     Image*  createGradientImage(GradientData* data, float morphRatio);
 
-    MemoryHeap*     pHeap;      // The heap in which PrimitiveFills are allocated. Generally this is the HAL's heap.
-    FillHashSet     FillSet;
-    GradientHashSet Gradients;
+    MemoryHeap*         pHeap;      // The heap in which PrimitiveFills are allocated. Generally this is the HAL's heap.
+    FillHashSet         FillSet;
+    GradientHashSet     Gradients;
+    Ptr<GradientAtlas>  pGradientAtlas;
 };
 
 // Must match SetUserUniforms
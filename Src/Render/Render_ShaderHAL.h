@@ -90,6 +90,17 @@ protected:
     virtual void drawCachedFilter(FilterPrimitive* primitive);
     virtual void drawBlendPrimitive(BlendPrimitive* prim, Render::Texture* blendSource, Render::Texture* blendDest, Render::Texture* blendAlpha);
 
+    // Reports the textures of a fill being bound to the gradient atlas, so its
+    // per-frame counters describe draws rather than fill creation.
+    void noteGradientAtlasDraw(const PrimitiveFill* pfill)
+    {
+        GradientAtlas* atlas = FillManager.GetGradientAtlas();
+        if (!atlas || !pfill)
+            return;
+        for (unsigned i = 0; i < pfill->GetTextureCount(); i++)
+            atlas->NoteDraw(pfill->GetTexture(i));
+    }
+
     // *** Profiler
     virtual void profilerDrawCacheablePrimArea(const CacheablePrimitive* prim);
     virtual void profilerApplyUniform(ProfilerUniform uniform, unsigned components, float* values);
@@ -125,12 +136,21 @@ inline bool ShaderHAL<ShaderManagerType, ShaderInterfaceType>::InitHAL(const HAL
         const_cast<const VertexFormat**>(&MappedXY16iAlphaSolid[PrimitiveBatch::DP_Instanced]),
         MeshCacheItem::Mesh_Regular);
 
-    return HAL::InitHAL(params);
+    if (!HAL::InitHAL(params))
+        return false;
+
+    if (ConfigFlags & HALConfig_GradientAtlas)
+    {
+        Ptr<GradientAtlas> atlas = *SF_HEAP_AUTO_NEW(this) GradientAtlas(pHeap, GetTextureManager());
+        FillManager.SetGradientAtlas(atlas);
+    }
+    return true;
 }
 
 template<class ShaderManagerType, class ShaderInterfaceType>
 inline bool ShaderHAL<ShaderManagerType, ShaderInterfaceType>::ShutdownHAL()
 {
+    FillManager.SetGradientAtlas(0);
     if (!Render::HAL::ShutdownHAL())
         return false;
 
@@ -165,6 +185,17 @@ inline bool ShaderHAL<ShaderManagerType, ShaderInterfaceType>::EndScene()
         return false;
 
     SManager.EndScene();
+
+    if (GradientAtlas* atlas = FillManager.GetGradientAtlas())
+    {
+        GradientAtlas::Stats gstats;
+        atlas->GetStats(&gstats);
+        AccumulatedStats.GradientAtlasDraws   += gstats.DrawsThisFrame;
+        AccumulatedStats.GradientAtlasPages   += gstats.PagesThisFrame;
+        AccumulatedStats.GradientAtlasRows     = gstats.RowsUsed;
+        AccumulatedStats.GradientAtlasCapacity = gstats.RowCapacity;
+        atlas->EndFrame();
+    }
     return true;
 }
 
@@ -869,6 +900,7 @@ inline void ShaderHAL<ShaderManagerType, ShaderInterfaceType>::DrawProcessedPrim
             const typename ShaderManagerType::Shader& pShader =
                 SManager.SetPrimitiveFill(pprimitive->pFill, fillFlags, pbatch->Type, pbatch->pFormat, 
                 batchMeshCount, Matrices, &pprimitive->Meshes[meshIndex], &ShaderData);
+            noteGradientAtlasDraw(pprimitive->pFill);
 
             GetProfiler().SetBatch(this, pprimitive, bidx);
 
@@ -976,6 +1008,7 @@ inline void ShaderHAL<ShaderManagerType, ShaderInterfaceType>::DrawProcessedComp
         // Apply fill.
         PrimitiveFillType fillType = Profiler.GetFillType(fr.pFill->GetType());
         const typename ShaderManagerType::Shader& pso = SManager.SetFill(fr.pFill, fillFlags, batchType, fr.pFormats[formatIndex], &ShaderData);
+        noteGradientAtlasDraw(fr.pFill);
 
         GetProfiler().SetBatch(this, complexMesh, fillIndex);
 
@@ -0,0 +1,531 @@
+/**************************************************************************
+
+Filename    :   Render_StrokerBatch.cpp
+Content     :   Batched polyline-to-stroke converter with SoA/SIMD
+                segment setup
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render_StrokerBatch.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_Alg.h"
+#include <math.h>
+#include <string.h>
+
+namespace Scaleform { namespace Render {
+
+//-----------------------------------------------------------------------
+StrokerBatch::StrokerBatch(MemoryHeap* heap) :
+    pHeap(heap ? heap : Memory::GetGlobalHeap()),
+    pStreams(0), StreamCapacity(0), VertexCount(0), pOut(0),
+    Width(0.5f),
+    LineJoin(RoundJoin),
+    StartLineCap(RoundCap),
+    EndLineCap(RoundCap),
+    MiterLimit(3.0f),
+    CurveTolerance(1.0f),
+    IntersectionEpsilon(1e-3f)
+{
+}
+
+StrokerBatch::~StrokerBatch()
+{
+    if (pStreams)
+        SF_HEAP_FREE(pHeap, pStreams);
+}
+
+void StrokerBatch::SetToleranceParam(const ToleranceParams& param)
+{
+    CurveTolerance      = param.CurveTolerance;
+    IntersectionEpsilon = param.IntersectionEpsilon;
+}
+
+void StrokerBatch::Clear()
+{
+    VertexCount = 0;
+    Paths.Clear();
+    OutXY.Clear();
+    ContourEnds.Clear();
+    pOut = 0;
+}
+
+//-----------------------------------------------------------------------
+bool StrokerBatch::growStreams(UPInt size)
+{
+    if (size <= StreamCapacity)
+        return true;
+
+    UPInt newCap = Alg::Max(StreamCapacity * 2, UPInt(64));
+    while (newCap < size)
+        newCap *= 2;
+    newCap = (newCap + 3) & ~UPInt(3);
+
+    CoordType* streams = (CoordType*)SF_HEAP_MEMALIGN(pHeap, newCap * S_Count * sizeof(CoordType),
+                                                      16, StatRender_Mem);
+    if (!streams)
+        return false;
+    if (pStreams)
+    {
+        // Only the input streams carry data between calls.
+        memcpy(streams + S_X * newCap, stream(S_X), VertexCount * sizeof(CoordType));
+        memcpy(streams + S_Y * newCap, stream(S_Y), VertexCount * sizeof(CoordType));
+        SF_HEAP_FREE(pHeap, pStreams);
+    }
+    pStreams       = streams;
+    StreamCapacity = newCap;
+    return true;
+}
+
+bool StrokerBatch::Reserve(unsigned numPaths, unsigned numVertices)
+{
+    Paths.Reserve(numPaths);
+    return growStreams(VertexCount + numVertices + 4);
+}
+
+SF_INLINE void StrokerBatch::pushVertex(CoordType x, CoordType y)
+{
+    CoordType* xs = stream(S_X);
+    CoordType* ys = stream(S_Y);
+    if (Paths.GetSize() && VertexCount > Paths.Back().Start &&
+        xs[VertexCount - 1] == x && ys[VertexCount - 1] == y)
+        return;
+    xs[VertexCount] = x;
+    ys[VertexCount] = y;
+    VertexCount++;
+}
+
+void StrokerBatch::finishPath(unsigned start, bool closed)
+{
+    PathRange& p = Paths.Back();
+    p.Count  = unsigned(VertexCount - start);
+    p.Closed = closed;
+
+    if (closed && p.Count > 1)
+    {
+        // Like StrokePath::ClosePath, drop a last vertex that repeats the first.
+        const CoordType* xs = stream(S_X);
+        const CoordType* ys = stream(S_Y);
+        if (xs[VertexCount - 1] == xs[start] && ys[VertexCount - 1] == ys[start])
+        {
+            VertexCount--;
+            p.Count--;
+        }
+    }
+    if (p.Count < 2 || (closed && p.Count < 3))
+    {
+        // Degenerate: a single point is not stroked, and a closed path
+        // with two vertices is stroked as an open one.
+        if (p.Count == 2)
+            p.Closed = false;
+        else
+        {
+            VertexCount = start;
+            Paths.PopBack();
+        }
+    }
+}
+
+bool StrokerBatch::AddPolyline(const CoordType* xy, unsigned count, bool closed)
+{
+    if (!count)
+        return true;
+    if (!growStreams(VertexCount + count + 4))
+        return false;
+    PathRange p = { unsigned(VertexCount), 0, closed };
+    Paths.PushBack(p);
+    for (unsigned i = 0; i < count; ++i)
+        pushVertex(xy[2*i], xy[2*i + 1]);
+    finishPath(p.Start, closed);
+    return true;
+}
+
+bool StrokerBatch::AddPolyline(const CoordType* x, const CoordType* y, unsigned count, bool closed)
+{
+    if (!count)
+        return true;
+    if (!growStreams(VertexCount + count + 4))
+        return false;
+    PathRange p = { unsigned(VertexCount), 0, closed };
+    Paths.PushBack(p);
+    for (unsigned i = 0; i < count; ++i)
+        pushVertex(x[i], y[i]);
+    finishPath(p.Start, closed);
+    return true;
+}
+
+//-----------------------------------------------------------------------
+// Segment i starts at vertex i. For open paths the last vertex has no
+// segment; it gets a copy of the previous one so the SIMD pass can run
+// over the whole stream without special cases.
+void StrokerBatch::calcSegments()
+{
+    const CoordType* xs  = stream(S_X);
+    const CoordType* ys  = stream(S_Y);
+    CoordType*       dxs = stream(S_DX);
+    CoordType*       dys = stream(S_DY);
+    CoordType*       nxs = stream(S_NX);
+    CoordType*       nys = stream(S_NY);
+    CoordType*       lns = stream(S_Len);
+
+    for (UPInt pi = 0; pi < Paths.GetSize(); ++pi)
+    {
+        const PathRange& p   = Paths[pi];
+        unsigned         end = p.Start + p.Count - 1;
+        for (unsigned i = p.Start; i < end; ++i)
+        {
+            dxs[i] = xs[i + 1] - xs[i];
+            dys[i] = ys[i + 1] - ys[i];
+        }
+        if (p.Closed)
+        {
+            dxs[end] = xs[p.Start] - xs[end];
+            dys[end] = ys[p.Start] - ys[end];
+        }
+        else
+        {
+            dxs[end] = dxs[end - 1];
+            dys[end] = dys[end - 1];
+        }
+    }
+
+    UPInt padded = (VertexCount + 3) & ~UPInt(3);
+    for (UPInt i = VertexCount; i < padded; ++i)
+        dxs[i] = dys[i] = 1.0f;
+
+#if defined(SF_ENABLE_SIMD)
+    using namespace SIMD;
+    static SF_SIMD_ALIGN(const float half[4])  = { 0.5f, 0.5f, 0.5f, 0.5f };
+    static SF_SIMD_ALIGN(const float three[4]) = { 3.0f, 3.0f, 3.0f, 3.0f };
+    static SF_SIMD_ALIGN(const float tiny[4]) = { 1e-20f, 1e-20f, 1e-20f, 1e-20f };
+    SF_SIMD_ALIGN(float width[4])        = { Width, Width, Width, Width };
+
+    Vector4f vHalf  = IS::LoadAligned(half);
+    Vector4f vThree = IS::LoadAligned(three);
+    Vector4f vTiny  = IS::LoadAligned(tiny);
+    Vector4f vWidth = IS::LoadAligned(width);
+    Vector4f vZero  = IS::Subtract(vHalf, vHalf);
+
+    for (UPInt i = 0; i < padded; i += 4)
+    {
+        Vector4f dx   = IS::LoadAligned(dxs + i);
+        Vector4f dy   = IS::LoadAligned(dys + i);
+        Vector4f len2 = IS::Max(IS::MultiplyAdd(dx, dx, IS::Multiply(dy, dy)), vTiny);
+
+        // rsqrt estimate + one Newton-Raphson step: r = r * 0.5 * (3 - len2 * r * r)
+        Vector4f r    = IS::ReciprocalSqrt(len2);
+        r = IS::Multiply(IS::Multiply(r, vHalf),
+                         IS::Subtract(vThree, IS::Multiply(len2, IS::Multiply(r, r))));
+
+        Vector4f s    = IS::Multiply(r, vWidth);
+        IS::StoreAligned(lns + i, IS::Multiply(len2, r));
+        IS::StoreAligned(nxs + i, IS::Subtract(vZero, IS::Multiply(dy, s)));
+        IS::StoreAligned(nys + i, IS::Multiply(dx, s));
+    }
+#else
+    for (UPInt i = 0; i < padded; ++i)
+    {
+        CoordType len = sqrtf(dxs[i] * dxs[i] + dys[i] * dys[i]);
+        CoordType s   = (len > 0) ? Width / len : 0;
+        lns[i] =  len;
+        nxs[i] = -dys[i] * s;
+        nys[i] =  dxs[i] * s;
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------
+static inline unsigned StrokerBatch_ArcSteps(CoordType width, CoordType tolerance, CoordType* pda)
+{
+    CoordType w  = Alg::Max(width, CoordType(1e-3f));
+    CoordType da = acosf(w / (w + Alg::Max(tolerance, CoordType(0.01f)) * 0.25f)) * 2;
+    da = Alg::Max(da, CoordType(0.05f));
+    if (pda) *pda = da;
+    return unsigned(3.14159265f / da) + 2;
+}
+
+unsigned StrokerBatch::estimateOutlineSize() const
+{
+    unsigned arc     = StrokerBatch_ArcSteps(Width, CurveTolerance, 0);
+    unsigned perJoin = (LineJoin == RoundJoin) ? arc + 2 : 3;
+    unsigned perCap  = Alg::Max(StartLineCap == RoundCap ? arc + 2 : 2u,
+                                EndLineCap   == RoundCap ? arc + 2 : 2u);
+    return unsigned(VertexCount) * 2 * perJoin + unsigned(Paths.GetSize()) * 2 * perCap;
+}
+
+void StrokerBatch::ensureOut(UPInt extra)
+{
+    UPInt used = pOut - OutXY.GetDataPtr();
+    if (used + extra * 2 <= OutXY.GetSize())
+        return;
+    OutXY.Resize(Alg::Max(OutXY.GetSize() * 2, used + extra * 2));
+    pOut = OutXY.GetDataPtr() + used;
+}
+
+void StrokerBatch::closeContour()
+{
+    ContourEnds.PushBack(unsigned((pOut - OutXY.GetDataPtr()) / 2));
+}
+
+// Clockwise arc around (x,y) from offset (dx1,dy1) to offset (dx2,dy2).
+// With offsets on the left of the direction of travel, clockwise is the
+// outer side of a right turn and the forward side of a cap.
+void StrokerBatch::emitArc(CoordType x, CoordType y,
+                           CoordType dx1, CoordType dy1,
+                           CoordType dx2, CoordType dy2)
+{
+    CoordType da;
+    StrokerBatch_ArcSteps(Width, CurveTolerance, &da);
+
+    CoordType a1 = atan2f(dy1, dx1);
+    CoordType a2 = atan2f(dy2, dx2);
+    if (a2 > a1)
+        a2 -= 2 * 3.14159265f;
+
+    unsigned n = unsigned((a1 - a2) / da);
+    ensureOut(n + 2);
+    emit(x + dx1, y + dy1);
+    if (n)
+    {
+        da = (a1 - a2) / (n + 1);
+        CoordType a = a1 - da;
+        for (unsigned i = 0; i < n; ++i, a -= da)
+            emit(x + cosf(a) * Width, y + sinf(a) * Width);
+    }
+    emit(x + dx2, y + dy2);
+}
+
+void StrokerBatch::emitCap(unsigned v, unsigned seg, bool start, LineCapType cap)
+{
+    const CoordType x  = stream(S_X)[v];
+    const CoordType y  = stream(S_Y)[v];
+    // Offsets are taken relative to the direction leaving the path end.
+    CoordType s  = start ? -1.0f : 1.0f;
+    CoordType nx = stream(S_NX)[seg] * s;
+    CoordType ny = stream(S_NY)[seg] * s;
+
+    if (cap == RoundCap)
+    {
+        emitArc(x, y, nx, ny, -nx, -ny);
+        return;
+    }
+
+    ensureOut(2);
+    if (cap == SquareCap)
+    {
+        // Extend by the half-width along the outgoing direction (-n rotated).
+        CoordType ex = ny, ey = -nx;
+        emit(x + nx + ex, y + ny + ey);
+        emit(x - nx + ex, y - ny + ey);
+    }
+    else
+    {
+        emit(x + nx, y + ny);
+        emit(x - nx, y - ny);
+    }
+}
+
+// Join at vertex v between incoming segment segA and outgoing segB, on the
+// left of the direction of travel. side = -1 walks the path backwards,
+// which flips directions and normals together.
+void StrokerBatch::emitJoin(unsigned v, unsigned segA, unsigned segB, CoordType side)
+{
+    const CoordType* dxs = stream(S_DX);
+    const CoordType* dys = stream(S_DY);
+    const CoordType* lns = stream(S_Len);
+
+    CoordType x   = stream(S_X)[v];
+    CoordType y   = stream(S_Y)[v];
+    CoordType nax = stream(S_NX)[segA] * side, nay = stream(S_NY)[segA] * side;
+    CoordType nbx = stream(S_NX)[segB] * side, nby = stream(S_NY)[segB] * side;
+    CoordType la  = lns[segA], lb = lns[segB];
+    CoordType dax = dxs[segA] * side / la, day = dys[segA] * side / la;
+    CoordType dbx = dxs[segB] * side / lb, dby = dys[segB] * side / lb;
+
+    CoordType cross = dax * dby - day * dbx;
+    CoordType dot   = dax * dbx + day * dby;
+
+    ensureOut(3);
+    if (fabsf(cross) < IntersectionEpsilon && dot > 0)
+    {
+        emit(x + nax, y + nay);
+        return;
+    }
+
+    CoordType w2    = Width * Width;
+    CoordType denom = w2 + nax * nbx + nay * nby;
+
+    if (cross > 0)
+    {
+        // Left turn: our side is the inner one. Use the offset-line
+        // intersection when it lies within both segments, otherwise
+        // go through the vertex; non-zero filling covers the overlap.
+        if (denom > w2 * 0.01f)
+        {
+            CoordType k  = w2 / denom;
+            CoordType mx = (nax + nbx) * k, my = (nay + nby) * k;
+            CoordType ml = mx * mx + my * my;
+            CoordType lim = Alg::Min(la, lb);
+            if (ml <= lim * lim + w2)
+            {
+                emit(x + mx, y + my);
+                return;
+            }
+        }
+        emit(x + nax, y + nay);
+        emit(x, y);
+        emit(x + nbx, y + nby);
+        return;
+    }
+
+    // Right turn: outer side.
+    switch (LineJoin)
+    {
+    case RoundJoin:
+        emitArc(x, y, nax, nay, nbx, nby);
+        return;
+
+    case BevelJoin:
+        emit(x + nax, y + nay);
+        emit(x + nbx, y + nby);
+        return;
+
+    case MiterJoin:
+    case MiterBevelJoin:
+        {
+            CoordType lim = MiterLimit * Width;
+            if (denom > w2 * 1e-4f)
+            {
+                CoordType k  = w2 / denom;
+                CoordType mx = (nax + nbx) * k, my = (nay + nby) * k;
+                if (mx * mx + my * my <= lim * lim)
+                {
+                    emit(x + mx, y + my);
+                    return;
+                }
+            }
+            if (LineJoin == MiterBevelJoin)
+            {
+                emit(x + nax, y + nay);
+                emit(x + nbx, y + nby);
+                return;
+            }
+
+            // Cut the miter at the limit, perpendicular to its bisector.
+            CoordType ux = nax + nbx, uy = nay + nby;
+            CoordType ul = sqrtf(ux * ux + uy * uy);
+            if (ul < 1e-6f)
+            {
+                ux = dax - dbx; uy = day - dby;
+                ul = sqrtf(ux * ux + uy * uy);
+            }
+            ux /= ul; uy /= ul;
+            CoordType proj = nax * ux + nay * uy;           // W*cos(theta/2)
+            CoordType sinh = dax * ux + day * uy;           // sin(theta/2)
+            CoordType t    = (sinh > 1e-6f) ? (lim - proj) / sinh : 0;
+            emit(x + nax + dax * t, y + nay + day * t);
+            emit(x + nbx - dbx * t, y + nby - dby * t);
+        }
+        return;
+    }
+}
+
+void StrokerBatch::emitSide(const PathRange& p, CoordType side)
+{
+    unsigned first = p.Start;
+    unsigned last  = p.Start + p.Count - 1;
+
+    if (p.Closed)
+    {
+        if (side > 0)
+        {
+            for (unsigned v = first; v <= last; ++v)
+                emitJoin(v, (v == first) ? last : v - 1, v, side);
+        }
+        else
+        {
+            for (unsigned v = last + 1; v-- > first; )
+                emitJoin(v, v, (v == first) ? last : v - 1, side);
+        }
+        return;
+    }
+
+    // Open paths: interior joins only; caps are emitted by the caller.
+    if (side > 0)
+    {
+        for (unsigned v = first + 1; v < last; ++v)
+            emitJoin(v, v - 1, v, side);
+    }
+    else
+    {
+        for (unsigned v = last - 1; v > first; --v)
+            emitJoin(v, v, v - 1, side);
+    }
+}
+
+//-----------------------------------------------------------------------
+unsigned StrokerBatch::GenerateOutlines()
+{
+    OutXY.Clear();
+    ContourEnds.Clear();
+    if (!VertexCount)
+        return 0;
+
+    calcSegments();
+
+    OutXY.Resize(UPInt(estimateOutlineSize()) * 2 + 16);
+    ContourEnds.Reserve(Paths.GetSize() * 2);
+    pOut = OutXY.GetDataPtr();
+
+    for (UPInt pi = 0; pi < Paths.GetSize(); ++pi)
+    {
+        const PathRange& p = Paths[pi];
+        if (p.Closed)
+        {
+            emitSide(p, 1.0f);
+            closeContour();
+            emitSide(p, -1.0f);
+            closeContour();
+        }
+        else
+        {
+            // Left side forward, end cap, right side backward, start cap;
+            // each cap starts and ends on the offsets of its end segment.
+            unsigned last = p.Start + p.Count - 1;
+            emitSide(p, 1.0f);
+            emitCap(last, last - 1, false, EndLineCap);
+            emitSide(p, -1.0f);
+            emitCap(p.Start, p.Start, true, StartLineCap);
+            closeContour();
+        }
+    }
+
+    OutXY.Resize(pOut - OutXY.GetDataPtr());
+    pOut = 0;
+    return (unsigned)ContourEnds.GetSize();
+}
+
+void StrokerBatch::GenerateStroke(TessBase* tess)
+{
+    GenerateOutlines();
+
+    const CoordType* v = OutXY.GetDataPtr();
+    unsigned         start = 0;
+    for (UPInt c = 0; c < ContourEnds.GetSize(); ++c)
+    {
+        unsigned end = ContourEnds[c];
+        for (unsigned i = start; i < end; ++i)
+            tess->AddVertex(v[2*i], v[2*i + 1]);
+        tess->ClosePath();
+        start = end;
+    }
+}
+
+}} // Scaleform::Render
@@ -0,0 +1,157 @@
+/**************************************************************************
+
+PublicHeader:   Render
+Filename    :   Render_StrokerBatch.h
+Content     :   Batched polyline-to-stroke converter with SoA/SIMD
+                segment setup
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_StrokerBatch_H
+#define INC_SF_Render_StrokerBatch_H
+
+#include "Kernel/SF_Types.h"
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_SIMD.h"
+#include "Render_Stroker.h"
+
+namespace Scaleform { namespace Render {
+
+//-----------------------------------------------------------------------
+// StrokerBatch produces the same stroke outlines as Stroker, but for many
+// polylines at once. Typical inputs are chart series and debug overlays:
+// thousands of straight polylines with identical stroke style.
+//
+// Work is split into two passes over all queued paths:
+//  1. Segment setup. Vertex data is kept in structure-of-arrays form
+//     (X, Y, then DX, DY, NX, NY, Len) in 16-byte aligned streams, and the
+//     normal/length computation runs four segments per iteration using
+//     SIMD::IS (reciprocal square root refined by one Newton step).
+//  2. Join and cap emission. Outline vertices are written into an output
+//     buffer that's reserved up front from a worst-case vertex estimate,
+//     so no per-vertex growth happens in the inner loop.
+//
+// The result is either replayed into a TessBase (same contract as
+// Stroker::GenerateStroke: AddVertex/ClosePath per contour, FinalizePath
+// is left to the caller) or read back directly from GetOutline*.
+//
+// Input vertices are expected to be flattened already; curves should go
+// through TessellateQuadCurve/TessellateCubicCurve first, as with Stroker.
+//
+// StrokerBatch is a standalone component: the shape mesh generator, which
+// would feed it runs of same-style solid strokes, is not part of this
+// source tree, so nothing in the renderer calls it yet.
+//-----------------------------------------------------------------------
+class StrokerBatch : public StrokerTypes
+{
+public:
+    typedef Scaleform::Render::CoordType CoordType;
+
+    StrokerBatch(MemoryHeap* heap = 0);
+    ~StrokerBatch();
+
+    // Setup
+    //---------------------
+    void    SetToleranceParam(const ToleranceParams& param);
+    void    SetWidth(CoordType v)           { Width = v/2;  }
+    void    SetLineJoin(LineJoinType v)     { LineJoin = v; }
+    void    SetLineCap(LineCapType v)       { StartLineCap = EndLineCap = v; }
+    void    SetStartLineCap(LineCapType v)  { StartLineCap = v; }
+    void    SetEndLineCap(LineCapType v)    { EndLineCap = v; }
+    void    SetMiterLimit(CoordType v)      { MiterLimit = v; }
+
+    // Input
+    //---------------------
+    void    Clear();
+    // Returns false if the vertex streams couldn't be allocated.
+    bool    Reserve(unsigned numPaths, unsigned numVertices);
+
+    // Adds a polyline from interleaved (x,y) pairs or separate X/Y streams.
+    // Coinciding consecutive vertices are filtered, like StrokePath does.
+    // Returns false, leaving the batch unchanged, if the vertex streams
+    // couldn't be grown.
+    bool    AddPolyline(const CoordType* xy, unsigned count, bool closed);
+    bool    AddPolyline(const CoordType* x, const CoordType* y, unsigned count, bool closed);
+
+    unsigned GetPathCount() const   { return (unsigned)Paths.GetSize(); }
+
+    // Output
+    //---------------------
+    // Builds outlines for all queued paths. Returns the number of contours.
+    unsigned GenerateOutlines();
+
+    // GenerateOutlines + replay into the tessellator.
+    void    GenerateStroke(TessBase* tess);
+
+    unsigned         GetOutlineContourCount() const { return (unsigned)ContourEnds.GetSize(); }
+    // Contour i spans vertices [GetOutlineContourStart(i), ContourEnds[i]).
+    unsigned         GetOutlineContourStart(unsigned i) const { return i ? ContourEnds[i - 1] : 0; }
+    unsigned         GetOutlineContourEnd(unsigned i) const   { return ContourEnds[i]; }
+    const CoordType* GetOutlineVertices() const     { return OutXY.GetDataPtr(); } // Interleaved x,y.
+
+private:
+    struct PathRange
+    {
+        unsigned Start, Count;
+        bool     Closed;
+    };
+
+    // One aligned block holding all SoA streams; each stream is padded
+    // to a multiple of four floats so SIMD loops need no tail handling.
+    enum StreamId { S_X, S_Y, S_DX, S_DY, S_NX, S_NY, S_Len, S_Count };
+
+    CoordType*  stream(StreamId s) { return pStreams + s * StreamCapacity; }
+    bool        growStreams(UPInt size);
+    void        pushVertex(CoordType x, CoordType y);
+    void        finishPath(unsigned start, bool closed);
+
+    void        calcSegments();
+    unsigned    estimateOutlineSize() const;
+
+    SF_INLINE void emit(CoordType x, CoordType y)
+    {
+        CoordType* p = pOut;
+        p[0] = x; p[1] = y;
+        pOut = p + 2;
+    }
+    void        ensureOut(UPInt extra);
+    void        emitArc(CoordType x, CoordType y, CoordType dx1, CoordType dy1,
+                        CoordType dx2, CoordType dy2);
+    void        emitCap(unsigned v, unsigned seg, bool start, LineCapType cap);
+    void        emitJoin(unsigned v, unsigned segA, unsigned segB, CoordType side);
+    void        emitSide(const PathRange& p, CoordType side);
+    void        closeContour();
+
+    MemoryHeap*     pHeap;
+    CoordType*      pStreams;
+    UPInt           StreamCapacity;
+    UPInt           VertexCount;
+
+    ArrayLH_POD<PathRange, StatRender_Mem>  Paths;
+    ArrayLH_POD<CoordType, StatRender_Mem>  OutXY;
+    ArrayLH_POD<unsigned,  StatRender_Mem>  ContourEnds;
+    CoordType*      pOut;
+
+    CoordType       Width;
+    LineJoinType    LineJoin;
+    LineCapType     StartLineCap;
+    LineCapType     EndLineCap;
+    CoordType       MiterLimit;
+    CoordType       CurveTolerance;
+    CoordType       IntersectionEpsilon;
+
+    StrokerBatch(const StrokerBatch&);
+    void operator = (const StrokerBatch&);
+};
+
+}} // Scaleform::Render
+
+#endif // INC_SF_Render_StrokerBatch_H
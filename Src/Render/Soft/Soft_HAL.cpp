@@ -0,0 +1,815 @@
+/**************************************************************************
+
+Filename    :   Soft_HAL.cpp
+Content     :   Software Renderer HAL, which draws into system memory
+                without a GPU.
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Kernel/SF_Debug.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_Trace.h"
+
+#include "Render/Soft/Soft_HAL.h"
+
+namespace Scaleform { namespace Render { namespace Soft {
+
+using Null::ShaderDesc;
+using Null::Uniform;
+using Null::ShaderPair;
+using Null::ShaderInterface;
+
+// Vertex attribute offsets of the current vertex format; -1 if absent.
+struct VertexLayout
+{
+    unsigned    Stride;
+    int         Pos;
+    bool        PosFloat;
+    int         Color;
+    bool        ColorARGB;
+    int         Factor;         // VET_T0Weight8
+    int         FactorAlpha;    // VET_FactorAlpha8
+    int         TexCoord;
+    int         Batch;          // VET_Instance8
+};
+
+static int Soft_ElementOffset(const VertexFormat* pformat, unsigned attr, unsigned mask)
+{
+    const VertexElement* pelement = pformat->GetElement(attr, mask);
+    return pelement ? (int)pelement->Offset : -1;
+}
+
+static void Soft_GetVertexLayout(const VertexFormat* pformat, VertexLayout* playout)
+{
+    playout->Stride      = pformat->Size;
+    playout->PosFloat    = false;
+    playout->ColorARGB   = false;
+    playout->Color       = playout->Factor = playout->FactorAlpha = -1;
+    playout->TexCoord    = playout->Batch = -1;
+
+    // The unit square stream stores the batch index in all four alpha
+    // bytes, which carry no factors.
+    if (pformat == &VertexXY16iAlpha::Format)
+    {
+        playout->Stride = sizeof(VertexXY16iAlpha);
+        playout->Pos    = 0;
+        playout->Batch  = 4;
+        return;
+    }
+
+    const unsigned usageIndex = VET_Usage_Mask | VET_Index_Mask;
+    const VertexElement* ppos = pformat->GetElement(VET_Pos, VET_Usage_Mask);
+    playout->Pos      = ppos ? (int)ppos->Offset : -1;
+    playout->PosFloat = ppos && (ppos->Attribute & VET_CompType_Mask) == VET_F32;
+
+    const VertexElement* pcolor = pformat->GetElement(VET_Color, usageIndex);
+    if (pcolor)
+    {
+        playout->Color     = (int)pcolor->Offset;
+        playout->ColorARGB = (pcolor->Attribute & VET_CompType_Mask) == VET_U32;
+    }
+    playout->Factor      = Soft_ElementOffset(pformat, VET_T0Weight8 & ~VET_Components_Mask,    usageIndex | VET_CompType_Mask);
+    playout->FactorAlpha = Soft_ElementOffset(pformat, VET_FactorAlpha8 & ~VET_Components_Mask, usageIndex | VET_CompType_Mask);
+    playout->TexCoord    = Soft_ElementOffset(pformat, VET_TexCoord, VET_Usage_Mask);
+    playout->Batch       = Soft_ElementOffset(pformat, VET_Instance | VET_U8, VET_Usage_Mask | VET_CompType_Mask);
+}
+
+// Pixel pipeline and vertex inputs of a GLES 3.0 shader type.
+struct ShaderSetup
+{
+    unsigned    Flags;          // PixelFlags
+    unsigned    SamplerCount;
+    bool        Position3d;
+    bool        TexCoordAttr;   // tc0 from the vertex (text shaders), rather than texgen.
+    bool        SecondTexGen;   // tc1 from texgen rows 2 and 3.
+    bool        VertexCxform;   // Vertex color transformed by cxmul/cxadd (text shaders).
+};
+
+// Returns false for shaders the rasterizer can't run (filters, blend modes,
+// DrawableImage and video).
+static bool Soft_DecodeShader(ShaderDesc::ShaderType type, ShaderSetup* psetup)
+{
+    psetup->Flags        = 0;
+    psetup->SamplerCount = 0;
+    psetup->TexCoordAttr = false;
+    psetup->SecondTexGen = false;
+    psetup->VertexCxform = false;
+
+    unsigned bits;
+    if (type >= ShaderDesc::ST_start_base && type <= ShaderDesc::ST_end_base)
+    {
+        bits = type - ShaderDesc::ST_start_base;
+        if (bits & ShaderDesc::ST_base_ATexTG)
+        {
+            psetup->Flags = Pixel_ATex;
+            psetup->SamplerCount = 2;
+        }
+        else if (bits & ShaderDesc::ST_base_Vertex)
+            psetup->Flags = Pixel_Vertex;
+        else if (bits & ShaderDesc::ST_base_TexTGTexTG)
+        {
+            psetup->Flags = Pixel_TexTex;
+            psetup->SamplerCount = 2;
+            psetup->SecondTexGen = true;
+        }
+        else if (bits & ShaderDesc::ST_base_ATexTGATexTG)
+        {
+            psetup->Flags = Pixel_ATexATex;
+            psetup->SamplerCount = 4;
+            psetup->SecondTexGen = true;
+        }
+        else if (bits & ShaderDesc::ST_base_TexTGVertex)
+        {
+            psetup->Flags = Pixel_TexVertex;
+            psetup->SamplerCount = 1;
+        }
+        else if (bits & ShaderDesc::ST_base_ATexTGVertex)
+        {
+            psetup->Flags = Pixel_ATexVertex;
+            psetup->SamplerCount = 2;
+        }
+        else
+        {
+            psetup->Flags = Pixel_Tex;
+            psetup->SamplerCount = 1;
+        }
+
+        if (bits & ShaderDesc::ST_base_CxformAc)
+            psetup->Flags |= Pixel_CxformAc;
+        else if (bits & ShaderDesc::ST_base_Cxform)
+            psetup->Flags |= Pixel_Cxform;
+        if (bits & ShaderDesc::ST_base_EAlpha)
+            psetup->Flags |= Pixel_EAlpha;
+        if (bits & ShaderDesc::ST_base_Mul)
+            psetup->Flags |= Pixel_Mul;
+        if (bits & ShaderDesc::ST_base_Inv)
+            psetup->Flags |= Pixel_Inv;
+        psetup->Position3d = (bits & ShaderDesc::ST_base_Position3d) != 0;
+        return true;
+    }
+
+    if (type >= ShaderDesc::ST_start_base_text && type <= ShaderDesc::ST_end_base_text)
+    {
+        bits = type - ShaderDesc::ST_start_base_text;
+        if (bits & ShaderDesc::ST_base_text_Text)
+        {
+            psetup->Flags = Pixel_Text;
+            psetup->SamplerCount = 1;
+            psetup->TexCoordAttr = true;
+            psetup->VertexCxform = true;
+        }
+        else if (bits & ShaderDesc::ST_base_text_TexUV)
+        {
+            psetup->Flags = Pixel_Tex;
+            psetup->SamplerCount = 1;
+            psetup->TexCoordAttr = true;
+        }
+        else if (bits & ShaderDesc::ST_base_text_ATexUV)
+        {
+            psetup->Flags = Pixel_ATex;
+            psetup->SamplerCount = 2;
+            psetup->TexCoordAttr = true;
+        }
+        else
+            psetup->Flags = Pixel_Solid;
+
+        if ((bits & ShaderDesc::ST_base_text_Cxform) && !psetup->VertexCxform)
+            psetup->Flags |= Pixel_Cxform;
+        if (bits & ShaderDesc::ST_base_text_Mul)
+            psetup->Flags |= Pixel_Mul;
+        if (bits & ShaderDesc::ST_base_text_Inv)
+            psetup->Flags |= Pixel_Inv;
+        psetup->Position3d = (bits & ShaderDesc::ST_base_text_Position3d) != 0;
+        return true;
+    }
+    return false;
+}
+
+template<class T>
+static inline T Soft_Read(const UByte* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+static inline float Soft_Dot(const float* prow, float x, float y)
+{
+    return prow[0] * x + prow[1] * y + prow[3];
+}
+
+
+// ***** HAL
+
+HAL::HAL(ThreadCommandQueue* commandQueue) :
+    Null::HAL(commandQueue),
+    pTargetTexture(0),
+    BaseState()
+{
+    BaseState.ColorWrite  = 1;
+    BaseState.StencilFunc = StencilFunc_Always;
+    BaseState.SourceColor = BaseState.SourceAlpha = Factor_One;
+}
+
+HAL::~HAL()
+{
+    ShutdownHAL();
+}
+
+bool HAL::InitHAL(const Render::HALInitParams& paramsIn)
+{
+    const Soft::HALInitParams& params = reinterpret_cast<const Soft::HALInitParams&>(paramsIn);
+
+    Raster.Initialize(Memory::GetHeapByAddress(this), params.ThreadCount);
+    if (!BaseHAL::InitHAL(params))
+    {
+        Raster.Shutdown();
+        return false;
+    }
+    return true;
+}
+
+bool HAL::ShutdownHAL()
+{
+    if (!(HALState & HS_Initialized))
+        return true;
+
+    Raster.Shutdown();
+    if (!BaseHAL::ShutdownHAL())
+        return false;
+
+    freeStencilBuffers(false);
+    pFrameBuffer.Clear();
+    pTargetTexture = 0;
+    return true;
+}
+
+bool HAL::EndScene()
+{
+    if (!BaseHAL::EndScene())
+        return false;
+
+    // The frame is complete; temporary targets may be reused at other
+    // addresses by the next scene.
+    Flush();
+    freeStencilBuffers(true);
+    return true;
+}
+
+void HAL::Flush()
+{
+    Raster.Flush();
+}
+
+UPInt HAL::CountDifferentPixels(const ImageData& image0, const ImageData& image1, unsigned tolerance)
+{
+    bool rgba0 = image0.Format == Image_R8G8B8A8 || image0.Format == Image_B8G8R8A8;
+    if (!rgba0 || image0.Format != image1.Format || image0.GetSize() != image1.GetSize())
+        return ~UPInt(0);
+
+    ImagePlane plane0, plane1;
+    image0.GetPlane(0, &plane0);
+    image1.GetPlane(0, &plane1);
+
+    UPInt count = 0;
+    for (unsigned y = 0; y < plane0.Height; y++)
+    {
+        const UByte* p0 = plane0.pData + y * plane0.Pitch;
+        const UByte* p1 = plane1.pData + y * plane1.Pitch;
+        for (unsigned x = 0; x < plane0.Width * 4; x += 4)
+        {
+            for (unsigned c = 0; c < 4; c++)
+            {
+                if ((unsigned)Alg::Abs(int(p0[x + c]) - int(p1[x + c])) > tolerance)
+                {
+                    count++;
+                    break;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// Updates the viewport matrix based on provided viewport and view rectangle.
+void HAL::updateViewport()
+{
+    BaseHAL::updateViewport();
+
+    if (HALState & HS_ViewValid)
+    {
+        if (HALState & HS_InRenderTarget)
+        {
+            ViewportRect.SetRect(VP.Left, VP.Top, VP.Left + VP.Width, VP.Top + VP.Height);
+            ClipRect = ViewportRect;
+        }
+        else
+        {
+            ViewportRect = ViewRect;
+            ClipRect     = ViewRect;
+            // Vertices are clipped to the viewport on the GPU too, so the
+            // scissor only narrows it.
+            if (VP.Flags & Viewport::View_UseScissorRect)
+            {
+                ClipRect.SetRect(Alg::Max(ClipRect.x1, VP.ScissorLeft),
+                                 Alg::Max(ClipRect.y1, VP.ScissorTop),
+                                 Alg::Min(ClipRect.x2, VP.ScissorLeft + VP.ScissorWidth),
+                                 Alg::Min(ClipRect.y2, VP.ScissorTop + VP.ScissorHeight));
+            }
+        }
+    }
+    else
+    {
+        ViewportRect.SetRect(0, 0, 0, 0);
+        ClipRect.SetRect(0, 0, 0, 0);
+    }
+    BaseState.Clip = ClipRect;
+}
+
+bool HAL::createDefaultRenderBuffer()
+{
+    Flush();
+    if (!pFrameBuffer || pFrameBuffer->GetSize() != DefaultBufferSize)
+    {
+        // Nothing may draw to the old buffer until the new target is set.
+        Raster.SetSurface(Surface());
+        pFrameBuffer = *RawImage::Create(Image_R8G8B8A8, 1, DefaultBufferSize, 0);
+        if (!pFrameBuffer)
+            return false;
+
+        ImageData  data;
+        ImagePlane plane;
+        pFrameBuffer->GetImageData(&data);
+        data.GetPlane(0, &plane);
+        memset(plane.pData, 0, plane.Pitch * plane.Height);
+    }
+
+    // The old default target's stencil is keyed by its RenderTargetData.
+    freeStencilBuffers(false);
+    return BaseHAL::createDefaultRenderBuffer();
+}
+
+void HAL::setRenderTargetImpl(Render::RenderTargetData* phdinput, unsigned flags, const Color &clearColor)
+{
+    BaseHAL::setRenderTargetImpl(phdinput, flags, clearColor);
+
+    // Queued triangles may use the stencil buffer released below.
+    Raster.Flush();
+
+    Null::RenderTargetData* phd = reinterpret_cast<Null::RenderTargetData*>(phdinput);
+    Surface    surface;
+    ImageData  data;
+    ImagePlane plane;
+
+    pTargetTexture = 0;
+    if (phd->GetBuffer()->GetType() == RBuffer_Default)
+    {
+        if (pFrameBuffer && pFrameBuffer->GetImageData(&data))
+        {
+            data.GetPlane(0, &plane);
+            surface.pColor = plane.pData;
+        }
+    }
+    else
+    {
+        Null::Texture* ptexture = (Null::Texture*)((RenderTarget*)phd->GetBuffer())->GetTexture();
+        if (ptexture && ptexture->pBackingImage && ptexture->GetConvFormat() == Image_R8G8B8A8 &&
+            ptexture->pBackingImage->GetImageData(&data))
+        {
+            data.GetMipLevelPlane(0, 0, &plane);
+            surface.pColor = plane.pData;
+            pTargetTexture = ptexture;
+        }
+        else
+        {
+            SF_DEBUG_WARNING(1, "Soft::HAL - render target texture is not R8G8B8A8; drawing to it is skipped");
+        }
+    }
+
+    if (surface.pColor)
+    {
+        surface.ColorPitch = plane.Pitch;
+        surface.Width      = plane.Width;
+        surface.Height     = plane.Height;
+
+        // Find (or create) the stencil of this target, so masks survive
+        // nested render targets.
+        UPInt i;
+        for (i = 0; i < StencilBuffers.GetSize(); i++)
+        {
+            if (StencilBuffers[i].pData == phdinput)
+                break;
+        }
+        if (i < StencilBuffers.GetSize() && (StencilBuffers[i].Width != plane.Width || StencilBuffers[i].Height != plane.Height))
+        {
+            SF_FREE(StencilBuffers[i].pStencil);
+            StencilBuffers.RemoveAt(i);
+            i = StencilBuffers.GetSize();
+        }
+        if (i == StencilBuffers.GetSize())
+        {
+            StencilBuffer sb;
+            sb.pData    = phdinput;
+            sb.Default  = phd->GetBuffer()->GetType() == RBuffer_Default;
+            sb.Width    = plane.Width;
+            sb.Height   = plane.Height;
+            sb.pStencil = (UByte*)SF_HEAP_AUTO_ALLOC_ID(this, plane.Width * plane.Height, StatRender_RenderPipeline_Mem);
+            if (sb.pStencil)
+            {
+                memset(sb.pStencil, 0, plane.Width * plane.Height);
+                StencilBuffers.PushBack(sb);
+            }
+        }
+        if (i < StencilBuffers.GetSize())
+        {
+            surface.pStencil     = StencilBuffers[i].pStencil;
+            surface.StencilPitch = plane.Width;
+        }
+    }
+
+    Raster.SetSurface(surface);
+
+    // Clear, if not specifically excluded
+    if (!(flags & PRT_NoClear))
+        Raster.ClearColor(clearColor);
+}
+
+void HAL::freeStencilBuffers(bool keepDefault)
+{
+    for (UPInt i = StencilBuffers.GetSize(); i > 0; i--)
+    {
+        StencilBuffer& sb = StencilBuffers[i - 1];
+        if (keepDefault && sb.Default)
+            continue;
+        // The rasterizer must not be left pointing at freed memory.
+        if (Raster.GetSurface().pStencil == sb.pStencil)
+        {
+            Surface surface = Raster.GetSurface();
+            surface.pStencil = 0;
+            Raster.SetSurface(surface);
+        }
+        SF_FREE(sb.pStencil);
+        StencilBuffers.RemoveAt(i - 1);
+    }
+}
+
+bool HAL::checkDepthStencilBufferCaps()
+{
+    // Every target gets an 8-bit stencil; there is no depth buffer.
+    RenderTargetEntry& rte = RenderTargetStack.Back();
+    if (!rte.StencilChecked)
+    {
+        rte.StencilAvailable     = true;
+        rte.MultiBitStencil      = true;
+        rte.DepthBufferAvailable = false;
+        rte.StencilChecked       = 1;
+    }
+    return true;
+}
+
+void HAL::applyDepthStencilMode(DepthStencilMode mode, unsigned stencilRef)
+{
+    static const UByte StencilFunctions[DepthStencilFunction_Count] =
+    {
+        StencilFunc_Never,          // Ignore
+        StencilFunc_Never,          // Never
+        StencilFunc_Less,           // Less
+        StencilFunc_Equal,          // Equal
+        StencilFunc_LessEqual,      // LessEqual
+        StencilFunc_Greater,        // Greater
+        StencilFunc_NotEqual,       // NotEqual
+        StencilFunc_GreaterEqual,   // GreaterEqual
+        StencilFunc_Always,         // Always
+    };
+    static const UByte StencilOps[StencilOp_Count] =
+    {
+        Stencil_Keep,       // Ignore
+        Stencil_Keep,       // Keep
+        Stencil_Replace,    // Replace
+        Stencil_Increment,  // Increment
+    };
+
+    BaseHAL::applyDepthStencilMode(mode, stencilRef);
+
+    // Ignored values keep their current setting, as they do on the GPU.
+    const HALDepthStencilDescriptor& desc = DepthStencilModeTable[mode];
+    if (desc.ColorWriteEnable != EnableIgnore_Ignore)
+        BaseState.ColorWrite = (desc.ColorWriteEnable == EnableIgnore_On);
+    if (desc.StencilEnable != EnableIgnore_Ignore)
+        BaseState.StencilEnable = (desc.StencilEnable == EnableIgnore_On);
+    if (BaseState.StencilEnable)
+    {
+        BaseState.StencilFunc = StencilFunctions[desc.StencilFunction];
+        BaseState.StencilRef  = (UByte)stencilRef;
+        if (desc.StencilPassOp != StencilOp_Ignore)
+            BaseState.StencilPassOp = StencilOps[desc.StencilPassOp];
+        if (desc.StencilFailOp != StencilOp_Ignore)
+            BaseState.StencilFailOp = StencilOps[desc.StencilFailOp];
+    }
+}
+
+void HAL::applyBlendModeImpl(BlendMode mode, bool sourceAc, bool forceAc)
+{
+    static const UByte BlendOps[BlendOp_Count] =
+    {
+        Op_Add,             // BlendOp_ADD
+        Op_Max,             // BlendOp_MAX
+        Op_Min,             // BlendOp_MIN
+        Op_RevSubtract,     // BlendOp_REVSUBTRACT
+    };
+    static const UByte BlendFactors[BlendFactor_Count] =
+    {
+        Factor_Zero,        // BlendFactor_ZERO
+        Factor_One,         // BlendFactor_ONE
+        Factor_SrcAlpha,    // BlendFactor_SRCALPHA
+        Factor_InvSrcAlpha, // BlendFactor_INVSRCALPHA
+        Factor_DestColor,   // BlendFactor_DESTCOLOR
+        Factor_InvDestColor,// BlendFactor_INVDESTCOLOR
+    };
+
+    BaseHAL::applyBlendModeImpl(mode, sourceAc, forceAc);
+
+    const HALBlendModeDescriptor& desc = BlendModeTable[mode];
+    UByte sourceColor = BlendFactors[desc.SourceColor];
+    if (sourceAc && sourceColor == Factor_SrcAlpha)
+        sourceColor = Factor_One;
+
+    BaseState.BlendColorOp = BlendOps[desc.Operator];
+    BaseState.SourceColor  = sourceColor;
+    BaseState.DestColor    = BlendFactors[desc.DestColor];
+    if ((VP.Flags & Viewport::View_AlphaComposite) || forceAc)
+    {
+        BaseState.BlendAlphaOp = BlendOps[desc.AlphaOperator];
+        BaseState.SourceAlpha  = BlendFactors[desc.SourceAlpha];
+        BaseState.DestAlpha    = BlendFactors[desc.DestAlpha];
+    }
+    else
+    {
+        BaseState.BlendAlphaOp = BaseState.BlendColorOp;
+        BaseState.SourceAlpha  = BaseState.SourceColor;
+        BaseState.DestAlpha    = BaseState.DestColor;
+    }
+}
+
+void HAL::applyBlendModeEnableImpl(bool enabled)
+{
+    BaseHAL::applyBlendModeEnableImpl(enabled);
+    BaseState.BlendEnable = enabled;
+}
+
+void HAL::drawPrimitive(unsigned indexCount, unsigned meshCount)
+{
+    BaseHAL::drawPrimitive(indexCount, meshCount);
+    submitDraw(0, indexCount, indexCount, 0);
+}
+
+void HAL::drawIndexedPrimitive(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset )
+{
+    BaseHAL::drawIndexedPrimitive(indexCount, vertexCount, meshCount, indexPtr, vertexOffset);
+    if (pCurrentIndices)
+        submitDraw(pCurrentIndices + indexPtr, indexCount, vertexCount, 0);
+}
+
+void HAL::drawIndexedInstanced(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset )
+{
+    BaseHAL::drawIndexedInstanced(indexCount, vertexCount, meshCount, indexPtr, vertexOffset);
+    if (pCurrentIndices)
+        submitDraw(pCurrentIndices + indexPtr, indexCount, vertexCount, meshCount);
+}
+
+void HAL::beginTextureUpdate(Null::Texture* ptexture)
+{
+    // Queued triangles read textures (and the target) at Flush time.
+    if (!Raster.IsQueueEmpty() && (ptexture == pTargetTexture || Raster.References(ptexture)))
+        Raster.Flush();
+}
+
+bool HAL::setupDrawState(unsigned batch, unsigned flags, DrawState* pstate)
+{
+    *pstate = BaseState;
+    if (!pstate->ColorWrite && !pstate->StencilEnable)
+        return false;
+    pstate->Flags = flags;
+
+    const float* pcxmul = ShaderData.GetUniformData(Uniform::SU_cxmul, batch);
+    const float* pcxadd = ShaderData.GetUniformData(Uniform::SU_cxadd, batch);
+    if ((flags & Pixel_SourceMask) == Pixel_Solid && pcxmul)
+        memcpy(pstate->Color, pcxmul, sizeof(pstate->Color));
+    if ((flags & (Pixel_Cxform | Pixel_CxformAc)) && pcxmul && pcxadd)
+    {
+        memcpy(pstate->Cxform[0], pcxmul, sizeof(pstate->Cxform[0]));
+        memcpy(pstate->Cxform[1], pcxadd, sizeof(pstate->Cxform[1]));
+    }
+
+    for (unsigned i = 0; i < ShaderInterface::MaxTextureBindings; i++)
+    {
+        const ShaderInterface::TextureBinding& binding = ShaderData.GetTextureBinding(i);
+        Sampler&   sampler = pstate->Samplers[i];
+        ImageData  data;
+        ImagePlane plane;
+
+        memset(&sampler, 0, sizeof(sampler));
+        if (!binding.pTexture || !binding.pTexture->pBackingImage ||
+            !binding.pTexture->pBackingImage->GetImageData(&data))
+            continue;
+
+        data.GetMipLevelPlane(0, binding.Plane, &plane);
+        ImageFormat format = binding.pTexture->GetConvFormat();
+        sampler.pSource       = binding.pTexture;
+        sampler.pData         = plane.pData;
+        sampler.Pitch         = plane.Pitch;
+        sampler.Width         = plane.Width;
+        sampler.Height        = plane.Height;
+        sampler.BytesPerPixel = (format == Image_R8G8B8A8) ? 4 : 1;
+        sampler.AlphaPlane    = (format == Image_A8);
+        sampler.Clamp         = (binding.FillMode.GetWrapMode() == Wrap_Clamp);
+        sampler.Linear        = (binding.FillMode.GetSampleMode() == Sample_Linear);
+        if (!sampler.Width || !sampler.Height)
+            sampler.pData = 0;
+    }
+    return true;
+}
+
+void HAL::submitDraw(const IndexType* pindices, unsigned indexCount, unsigned vertexCount, unsigned instanceCount)
+{
+    const ShaderPair& shader = ShaderData.GetCurrentShaders();
+    if (!Raster.HasSurface() || !(HALState & HS_ViewValid) || !shader || !pCurrentFormat || !pCurrentVertices)
+        return;
+
+    ShaderSetup setup;
+    if (!Soft_DecodeShader(shader.Type, &setup))
+    {
+        SF_DEBUG_WARNONCE1(1, "Soft::HAL - shader type %d is not supported; its draws are skipped", (int)shader.Type);
+        return;
+    }
+    SF_TRACE_SCOPE(TraceCat_Render, "Soft::HAL::submitDraw");
+
+    VertexLayout layout;
+    Soft_GetVertexLayout(pCurrentFormat, &layout);
+    if (layout.Pos < 0)
+        return;
+
+    // Per-batch uniforms, and DrawStates created on first use. States are
+    // dropped by Flush, so the cache is reset whenever the queue fills.
+    const unsigned maxBatches = SF_RENDER_MAX_BATCHES;
+    int          states[SF_RENDER_MAX_BATCHES];
+    const float* pmvp[SF_RENDER_MAX_BATCHES];
+    const float* ptexgen[SF_RENDER_MAX_BATCHES];
+    const float* pcxmul[SF_RENDER_MAX_BATCHES];
+    const float* pcxadd[SF_RENDER_MAX_BATCHES];
+    bool         fetched[SF_RENDER_MAX_BATCHES];
+    for (unsigned b = 0; b < maxBatches; b++)
+    {
+        states[b]  = -1;
+        fetched[b] = false;
+    }
+
+    const float vpx = (float)ViewportRect.x1, vpw = (float)ViewportRect.Width();
+    const float vpy = (float)ViewportRect.y1, vph = (float)ViewportRect.Height();
+    const float k   = 1.0f / 255.0f;
+
+    unsigned passCount = instanceCount ? instanceCount : 1;
+    for (unsigned pass = 0; pass < passCount; pass++)
+    {
+        // Transform the vertices used by this draw (or instance).
+        Vertices.Resize(vertexCount);
+        VertexBatches.Resize(vertexCount);
+        for (unsigned i = 0; i < vertexCount; i++)
+        {
+            const UByte* pv    = pCurrentVertices + i * layout.Stride;
+            unsigned     batch = instanceCount ? pass : (layout.Batch >= 0 ? pv[layout.Batch] : 0);
+            Vertex&      v     = Vertices[i];
+
+            if (batch >= maxBatches)
+                batch = maxBatches - 1;
+            VertexBatches[i] = (UByte)batch;
+            if (!fetched[batch])
+            {
+                pmvp[batch]    = ShaderData.GetUniformData(Uniform::SU_mvp, batch);
+                ptexgen[batch] = ShaderData.GetUniformData(Uniform::SU_texgen, batch);
+                pcxmul[batch]  = ShaderData.GetUniformData(Uniform::SU_cxmul, batch);
+                pcxadd[batch]  = ShaderData.GetUniformData(Uniform::SU_cxadd, batch);
+                fetched[batch] = true;
+            }
+
+            float x, y;
+            if (layout.PosFloat)
+            {
+                x = Soft_Read<float>(pv + layout.Pos);
+                y = Soft_Read<float>(pv + layout.Pos + 4);
+            }
+            else
+            {
+                x = (float)Soft_Read<SInt16>(pv + layout.Pos);
+                y = (float)Soft_Read<SInt16>(pv + layout.Pos + 2);
+            }
+
+            const float* pm = pmvp[batch];
+            float nx = 0.0f, ny = 0.0f;
+            if (pm && setup.Position3d)
+            {
+                float w = Soft_Dot(pm + 12, x, y);
+                // Behind the eye; the triangles using it are dropped below.
+                if (w <= 1e-6f)
+                    VertexBatches[i] = 0xFF;
+                else
+                {
+                    nx = Soft_Dot(pm, x, y) / w;
+                    ny = Soft_Dot(pm + 4, x, y) / w;
+                }
+            }
+            else if (pm)
+            {
+                nx = Soft_Dot(pm, x, y);
+                ny = Soft_Dot(pm + 4, x, y);
+            }
+            v.X = vpx + (nx + 1.0f) * 0.5f * vpw;
+            v.Y = vpy + (1.0f - ny) * 0.5f * vph;
+
+            memset(v.V, 0, sizeof(v.V));
+            if (layout.Color >= 0)
+            {
+                const UByte* pc = pv + layout.Color;
+                if (layout.ColorARGB)
+                {
+                    UInt32 argb = Soft_Read<UInt32>(pc);
+                    v.V[Var_R] = ((argb >> 16) & 0xFF) * k;
+                    v.V[Var_G] = ((argb >> 8) & 0xFF) * k;
+                    v.V[Var_B] = (argb & 0xFF) * k;
+                    v.V[Var_A] = (argb >> 24) * k;
+                }
+                else
+                {
+                    for (unsigned c = 0; c < 4; c++)
+                        v.V[Var_R + c] = pc[c] * k;
+                }
+                if (setup.VertexCxform && pcxmul[batch] && pcxadd[batch])
+                {
+                    for (unsigned c = 0; c < 4; c++)
+                        v.V[Var_R + c] = v.V[Var_R + c] * pcxmul[batch][c] + pcxadd[batch][c];
+                }
+            }
+            v.V[Var_Factor]      = (layout.Factor >= 0) ? pv[layout.Factor] * k : 0.0f;
+            v.V[Var_FactorAlpha] = (layout.FactorAlpha >= 0) ? pv[layout.FactorAlpha] * k : 1.0f;
+
+            if (setup.TexCoordAttr)
+            {
+                if (layout.TexCoord >= 0)
+                {
+                    v.V[Var_U0] = Soft_Read<float>(pv + layout.TexCoord);
+                    v.V[Var_V0] = Soft_Read<float>(pv + layout.TexCoord + 4);
+                }
+            }
+            else if (ptexgen[batch] && setup.SamplerCount)
+            {
+                const float* pt = ptexgen[batch];
+                v.V[Var_U0] = Soft_Dot(pt, x, y);
+                v.V[Var_V0] = Soft_Dot(pt + 4, x, y);
+                if (setup.SecondTexGen)
+                {
+                    v.V[Var_U1] = Soft_Dot(pt + 8, x, y);
+                    v.V[Var_V1] = Soft_Dot(pt + 12, x, y);
+                }
+            }
+        }
+
+        // Queue the triangles.
+        for (unsigned i = 0; i + 2 < indexCount; i += 3)
+        {
+            unsigned i0 = pindices ? pindices[i]     : i,
+                     i1 = pindices ? pindices[i + 1] : i + 1,
+                     i2 = pindices ? pindices[i + 2] : i + 2;
+            if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+                continue;
+            unsigned batch = VertexBatches[i0];
+            if (batch >= maxBatches || VertexBatches[i1] >= maxBatches || VertexBatches[i2] >= maxBatches)
+                continue;
+
+            if (Raster.IsQueueFull())
+            {
+                Raster.Flush();
+                for (unsigned b = 0; b < maxBatches; b++)
+                    states[b] = -1;
+            }
+            if (states[batch] < 0)
+            {
+                DrawState state;
+                if (!setupDrawState(batch, setup.Flags, &state))
+                    return;
+                states[batch] = (int)Raster.AddDrawState(state);
+            }
+            Raster.AddTriangle((unsigned)states[batch], Vertices[i0], Vertices[i1], Vertices[i2]);
+        }
+    }
+}
+
+}}} // Scaleform::Render::Soft
@@ -0,0 +1,147 @@
+/**************************************************************************
+
+Filename    :   Soft_HAL.h
+Content     :   Software Renderer HAL, which draws into system memory
+                without a GPU.
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Soft_HAL_H
+#define INC_SF_Render_Soft_HAL_H
+
+#include "Render/Null/Null_HAL.h"
+#include "Render/Soft/Soft_Rasterizer.h"
+
+namespace Scaleform { namespace Render { namespace Soft {
+
+// The Soft HAL draws into memory, for thumbnails and image comparison tests
+// on machines without a GPU. It is built on Null::HAL, so the front end
+// (tessellation, batching, caches and shader selection) is the same one the
+// GPU HALs run; each draw is then decoded from the GLES 3.0 shader type and
+// uniforms and handed to a Soft::Rasterizer.
+//
+// Supported: solid, gradient, image and text fills, color transforms
+// (including the alpha-composite form), blend modes expressible as blend
+// states, edge anti-aliasing, render targets, and masks through an 8-bit
+// stencil buffer. Scale9 grids and gradients need no special handling, as
+// they reach the HAL as ordinary textured meshes.
+//
+// Not supported: filter, DrawableImage, blend-mode and video shaders (their
+// draws are skipped with a debug warning), depth testing, and mip levels
+// below the top one. 3D meshes are drawn with affine texture mapping.
+//
+// Drawing is deferred until the rasterizer queue fills, the render target
+// changes, a texture in use is updated, or EndScene; call Flush before
+// reading the frame buffer at other times.
+//
+// For a throughput benchmark, pass a Soft::HAL initialized with
+// HALInitParams(ImageSize(1920, 1080)) to Platform::BenchmarkRunner, and
+// read GetRasterizerStats for the pixel and binning counts.
+
+// Soft::HALInitParams provides Soft-specific rendering initialization
+// parameters for HAL::InitHAL. The command log is disabled by default.
+
+struct HALInitParams : public Null::HALInitParams
+{
+    unsigned    ThreadCount;        // Rasterizer threads, including the render thread; 0 uses the CPU count.
+
+    HALInitParams(const ImageSize& bufferSize = ImageSize(1280, 720),
+                  UInt32 halConfigFlags = Null::HALConfig_NoCommandLog,
+                  ThreadId renderThreadId = ThreadId(),
+                  unsigned threadCount = 0) :
+        Null::HALInitParams(bufferSize, halConfigFlags, renderThreadId),
+        ThreadCount(threadCount)
+    { }
+};
+
+class HAL : public Null::HAL
+{
+    typedef Null::HAL BaseHAL;
+public:
+
+    HAL(ThreadCommandQueue* commandQueue);
+    virtual ~HAL();
+
+    virtual bool        InitHAL(const Render::HALInitParams& params);
+    virtual bool        ShutdownHAL();
+
+    virtual bool        EndScene();
+
+    // Draws all queued triangles.
+    void                Flush();
+
+    // The default render target, R8G8B8A8 with rows top to bottom.
+    // Complete after EndScene or Flush.
+    RawImage*           GetFrameBuffer() const          { return pFrameBuffer; }
+
+    void                GetRasterizerStats(Rasterizer::Stats* pstats) const { Raster.GetStats(pstats); }
+    void                ResetRasterizerStats()          { Raster.ResetStats(); }
+
+    // Returns the number of pixels in which any channel differs by more
+    // than tolerance, for comparing output against a reference (such as a
+    // GL screenshot). Both images must be R8G8B8A8 or B8G8R8A8 (matched
+    // channel order) and of the same size; otherwise returns ~0.
+    static UPInt        CountDifferentPixels(const ImageData& image0, const ImageData& image1, unsigned tolerance);
+
+protected:
+
+    virtual void        updateViewport();
+    virtual bool        createDefaultRenderBuffer();
+    virtual void        setRenderTargetImpl(Render::RenderTargetData* data, unsigned flags, const Color &clearColor);
+
+    virtual bool        checkDepthStencilBufferCaps();
+    virtual void        applyDepthStencilMode(DepthStencilMode mode, unsigned stencilRef);
+    virtual void        applyBlendModeImpl(BlendMode mode, bool sourceAc = false, bool forceAc = false);
+    virtual void        applyBlendModeEnableImpl(bool enabled);
+
+    virtual void        drawPrimitive(unsigned indexCount, unsigned meshCount);
+    virtual void        drawIndexedPrimitive(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset );
+    virtual void        drawIndexedInstanced(unsigned indexCount, unsigned vertexCount, unsigned meshCount, UPInt indexPtr, UPInt vertexOffset );
+
+    virtual void        beginTextureUpdate(Null::Texture* ptexture);
+
+    // Decodes the current shader and queues the triangles of one draw.
+    // pindices may be null, for sequential vertices; instanceCount is 0 for
+    // draws that aren't instanced.
+    void                submitDraw(const IndexType* pindices, unsigned indexCount,
+                                   unsigned vertexCount, unsigned instanceCount);
+    bool                setupDrawState(unsigned batch, unsigned flags, DrawState* pstate);
+    void                freeStencilBuffers(bool keepDefault);
+
+    // Stencil of a render target. pData is only compared, never used; it
+    // may be stale after the target is released. Plain data, since it is
+    // kept in a POD array (ImageSize has a user-defined assignment).
+    struct StencilBuffer
+    {
+        const Render::RenderTargetData* pData;
+        bool                            Default;
+        UInt32                          Width, Height;
+        UByte*                          pStencil;
+    };
+
+    Rasterizer                  Raster;
+    Ptr<RawImage>               pFrameBuffer;
+    ArrayLH_POD<StencilBuffer>  StencilBuffers;
+    // Transformed vertices of the current draw, and their batch indices
+    // (0xFF for vertices behind the eye).
+    ArrayLH_POD<Vertex, StatRender_RenderPipeline_Mem, ArrayConstPolicy<0, 256, true> > Vertices;
+    ArrayLH_POD<UByte, StatRender_RenderPipeline_Mem, ArrayConstPolicy<0, 256, true> >  VertexBatches;
+    const Null::Texture*        pTargetTexture;     // Texture of the current render target; null for the default one.
+
+    // Pipeline state, copied into each DrawState.
+    Rect<int>                   ViewportRect;       // Maps normalized device coordinates, in target pixels.
+    Rect<int>                   ClipRect;           // Viewport clipped to the scissor rectangle.
+    DrawState                   BaseState;
+};
+
+}}} // Scaleform::Render::Soft
+
+#endif // INC_SF_Render_Soft_HAL_H
@@ -0,0 +1,973 @@
+/**************************************************************************
+
+Filename    :   Soft_Rasterizer.cpp
+Content     :   Tiled, multithreaded triangle rasterizer used by the
+                software HAL.
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#include "Render/Soft/Soft_Rasterizer.h"
+#include "Kernel/SF_SIMD.h"
+#include "Kernel/SF_Alg.h"
+#include "Kernel/SF_Timer.h"
+#include "Kernel/SF_Trace.h"
+#include "Kernel/SF_HeapNew.h"
+#include "Kernel/SF_Debug.h"
+
+#include <math.h>
+
+namespace Scaleform { namespace Render { namespace Soft {
+
+// Triangles reaching further than this from the origin, in pixels, are
+// clipped before setup. This keeps 28.4 edge functions within 64 bits at
+// setup, and within 32 bits once restricted to a tile.
+static const float  Rasterizer_GuardBand = 8192.0f;
+
+static const UPInt  Rasterizer_StackSize = 128 * 1024;
+
+
+// ***** Four pixel vectors
+
+// Pixels are shaded in groups of four horizontally adjacent pixels; each
+// Rasterizer_Lane holds one value (a channel or varying) for all four.
+
+#if defined(SF_ENABLE_SIMD)
+
+typedef SIMD::Vector4f Rasterizer_Lane;
+
+struct Rasterizer_LaneOps
+{
+    typedef Rasterizer_Lane Lane;
+    static Lane Load(const float* p)            { return SIMD::IS::LoadAligned(p); }
+    static void Store(float* p, Lane v)         { SIMD::IS::StoreAligned(p, v); }
+    static Lane Add(Lane a, Lane b)             { return SIMD::IS::Add(a, b); }
+    static Lane Sub(Lane a, Lane b)             { return SIMD::IS::Subtract(a, b); }
+    static Lane Mul(Lane a, Lane b)             { return SIMD::IS::Multiply(a, b); }
+    static Lane MulAdd(Lane a, Lane b, Lane c)  { return SIMD::IS::MultiplyAdd(a, b, c); }
+    static Lane Min(Lane a, Lane b)             { return SIMD::IS::Min(a, b); }
+    static Lane Max(Lane a, Lane b)             { return SIMD::IS::Max(a, b); }
+};
+
+#else
+
+struct Rasterizer_Lane
+{
+    float V[4];
+};
+
+struct Rasterizer_LaneOps
+{
+    typedef Rasterizer_Lane Lane;
+    static Lane Load(const float* p)            { Lane r; for (int i = 0; i < 4; i++) r.V[i] = p[i]; return r; }
+    static void Store(float* p, Lane v)         { for (int i = 0; i < 4; i++) p[i] = v.V[i]; }
+    static Lane Add(Lane a, Lane b)             { for (int i = 0; i < 4; i++) a.V[i] += b.V[i]; return a; }
+    static Lane Sub(Lane a, Lane b)             { for (int i = 0; i < 4; i++) a.V[i] -= b.V[i]; return a; }
+    static Lane Mul(Lane a, Lane b)             { for (int i = 0; i < 4; i++) a.V[i] *= b.V[i]; return a; }
+    static Lane MulAdd(Lane a, Lane b, Lane c)  { for (int i = 0; i < 4; i++) a.V[i] = a.V[i] * b.V[i] + c.V[i]; return a; }
+    static Lane Min(Lane a, Lane b)             { for (int i = 0; i < 4; i++) a.V[i] = Alg::Min(a.V[i], b.V[i]); return a; }
+    static Lane Max(Lane a, Lane b)             { for (int i = 0; i < 4; i++) a.V[i] = Alg::Max(a.V[i], b.V[i]); return a; }
+};
+
+#endif
+
+typedef Rasterizer_LaneOps L;
+
+static inline Rasterizer_Lane Rasterizer_Splat(float v)
+{
+    SF_SIMD_ALIGN(float t[4]) = { v, v, v, v };
+    return L::Load(t);
+}
+
+// GLSL mix(a, b, f).
+static inline Rasterizer_Lane Rasterizer_Mix(Rasterizer_Lane a, Rasterizer_Lane b, Rasterizer_Lane f)
+{
+    return L::MulAdd(L::Sub(b, a), f, a);
+}
+
+static inline UByte Rasterizer_ToByte(float v)
+{
+    return (UByte)(v * 255.0f + 0.5f);
+}
+
+
+// ***** Texture sampling
+
+static inline int Rasterizer_WrapCoord(int i, int size, bool clamp)
+{
+    if (clamp)
+        return Alg::Clamp(i, 0, size - 1);
+    i %= size;
+    return (i < 0) ? i + size : i;
+}
+
+static inline void Rasterizer_FetchTexel(const Sampler& s, int x, int y, float* prgba)
+{
+    const float  k = 1.0f / 255.0f;
+    const UByte* p = s.pData + y * s.Pitch + x * s.BytesPerPixel;
+    if (s.BytesPerPixel == 4)
+    {
+        prgba[0] = p[0] * k;
+        prgba[1] = p[1] * k;
+        prgba[2] = p[2] * k;
+        prgba[3] = p[3] * k;
+    }
+    else if (s.AlphaPlane)
+    {
+        prgba[0] = prgba[1] = prgba[2] = 0.0f;
+        prgba[3] = p[0] * k;
+    }
+    else
+    {
+        prgba[0] = p[0] * k;
+        prgba[1] = prgba[2] = 0.0f;
+        prgba[3] = 1.0f;
+    }
+}
+
+static void Rasterizer_Sample(const Sampler& s, float u, float v, float* prgba)
+{
+    if (!s.pData)
+    {
+        prgba[0] = prgba[1] = prgba[2] = prgba[3] = 0.0f;
+        return;
+    }
+
+    int   w = (int)s.Width, h = (int)s.Height;
+    float fu = u * w, fv = v * h;
+    // Keeps the integer conversion defined for degenerate coordinates.
+    if (!(fu > -1e6f && fu < 1e6f)) fu = 0.0f;
+    if (!(fv > -1e6f && fv < 1e6f)) fv = 0.0f;
+
+    if (!s.Linear)
+    {
+        Rasterizer_FetchTexel(s, Rasterizer_WrapCoord((int)floorf(fu), w, s.Clamp != 0),
+                                 Rasterizer_WrapCoord((int)floorf(fv), h, s.Clamp != 0), prgba);
+        return;
+    }
+
+    fu -= 0.5f;
+    fv -= 0.5f;
+    float fx = floorf(fu), fy = floorf(fv);
+    float ax = fu - fx,    ay = fv - fy;
+    int   x0 = Rasterizer_WrapCoord((int)fx,     w, s.Clamp != 0),
+          x1 = Rasterizer_WrapCoord((int)fx + 1, w, s.Clamp != 0),
+          y0 = Rasterizer_WrapCoord((int)fy,     h, s.Clamp != 0),
+          y1 = Rasterizer_WrapCoord((int)fy + 1, h, s.Clamp != 0);
+
+    float t00[4], t10[4], t01[4], t11[4];
+    Rasterizer_FetchTexel(s, x0, y0, t00);
+    Rasterizer_FetchTexel(s, x1, y0, t10);
+    Rasterizer_FetchTexel(s, x0, y1, t01);
+    Rasterizer_FetchTexel(s, x1, y1, t11);
+    for (unsigned c = 0; c < 4; c++)
+    {
+        float top    = t00[c] + (t10[c] - t00[c]) * ax;
+        float bottom = t01[c] + (t11[c] - t01[c]) * ax;
+        prgba[c] = top + (bottom - top) * ay;
+    }
+}
+
+// Samples the covered pixels of a quad; prgba receives one lane per channel.
+static void Rasterizer_SampleQuad(const Sampler& s, Rasterizer_Lane u, Rasterizer_Lane v,
+                                  unsigned mask, Rasterizer_Lane* prgba)
+{
+    SF_SIMD_ALIGN(float us[4]);
+    SF_SIMD_ALIGN(float vs[4]);
+    SF_SIMD_ALIGN(float out[4][4]) = { { 0 } };
+    L::Store(us, u);
+    L::Store(vs, v);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        if (mask & (1 << i))
+        {
+            float texel[4];
+            Rasterizer_Sample(s, us[i], vs[i], texel);
+            out[0][i] = texel[0];
+            out[1][i] = texel[1];
+            out[2][i] = texel[2];
+            out[3][i] = texel[3];
+        }
+    }
+    for (unsigned c = 0; c < 4; c++)
+        prgba[c] = L::Load(out[c]);
+}
+
+// Color from one sampler, alpha from the red channel of the next.
+static void Rasterizer_SampleQuadATex(const Sampler* ps, Rasterizer_Lane u, Rasterizer_Lane v,
+                                      unsigned mask, Rasterizer_Lane* prgba)
+{
+    Rasterizer_Lane alpha[4];
+    Rasterizer_SampleQuad(ps[0], u, v, mask, prgba);
+    Rasterizer_SampleQuad(ps[1], u, v, mask, alpha);
+    prgba[3] = alpha[0];
+}
+
+
+// ***** Stencil and blending
+
+static inline bool Rasterizer_StencilTest(unsigned func, unsigned ref, unsigned value)
+{
+    // Same convention as glStencilFunc: reference on the left.
+    switch (func)
+    {
+    case StencilFunc_Never:         return false;
+    case StencilFunc_Less:          return ref <  value;
+    case StencilFunc_Equal:         return ref == value;
+    case StencilFunc_LessEqual:     return ref <= value;
+    case StencilFunc_Greater:       return ref >  value;
+    case StencilFunc_NotEqual:      return ref != value;
+    case StencilFunc_GreaterEqual:  return ref >= value;
+    default:                        return true;
+    }
+}
+
+static inline UByte Rasterizer_StencilApply(unsigned op, unsigned ref, unsigned value)
+{
+    switch (op)
+    {
+    case Stencil_Replace:     return (UByte)ref;
+    case Stencil_Increment:   return (UByte)Alg::Min(value + 1, 255u);
+    default:                    return (UByte)value;
+    }
+}
+
+static inline Rasterizer_Lane Rasterizer_BlendFactor(unsigned factor, Rasterizer_Lane srcAlpha, Rasterizer_Lane dest,
+                                                     Rasterizer_Lane zero, Rasterizer_Lane one)
+{
+    switch (factor)
+    {
+    case Factor_Zero:           return zero;
+    case Factor_SrcAlpha:       return srcAlpha;
+    case Factor_InvSrcAlpha:    return L::Sub(one, srcAlpha);
+    case Factor_DestColor:      return dest;
+    case Factor_InvDestColor:   return L::Sub(one, dest);
+    default:                    return one;
+    }
+}
+
+static inline Rasterizer_Lane Rasterizer_Blend(unsigned op, Rasterizer_Lane src, Rasterizer_Lane srcFactor,
+                                               Rasterizer_Lane dest, Rasterizer_Lane destFactor)
+{
+    // Like GL, MIN and MAX ignore the blend factors.
+    switch (op)
+    {
+    case Op_Max:            return L::Max(src, dest);
+    case Op_Min:            return L::Min(src, dest);
+    case Op_RevSubtract:    return L::Sub(L::Mul(dest, destFactor), L::Mul(src, srcFactor));
+    default:                return L::MulAdd(src, srcFactor, L::Mul(dest, destFactor));
+    }
+}
+
+// Returns the mask of varyings the pixel pipeline reads.
+static unsigned Rasterizer_VaryingMask(unsigned flags)
+{
+    const unsigned color = (1 << Var_R) | (1 << Var_G) | (1 << Var_B) | (1 << Var_A);
+    const unsigned tc0   = (1 << Var_U0) | (1 << Var_V0);
+    const unsigned tc1   = (1 << Var_U1) | (1 << Var_V1);
+    const unsigned mix   = 1 << Var_Factor;
+    unsigned mask = 0;
+
+    switch (flags & Pixel_SourceMask)
+    {
+    case Pixel_Vertex:      mask = color; break;
+    case Pixel_Tex:
+    case Pixel_ATex:        mask = tc0; break;
+    case Pixel_TexTex:
+    case Pixel_ATexATex:    mask = tc0 | tc1 | mix; break;
+    case Pixel_TexVertex:
+    case Pixel_ATexVertex:  mask = color | tc0 | mix; break;
+    case Pixel_Text:        mask = color | tc0; break;
+    default:                break;
+    }
+    if (flags & Pixel_EAlpha)
+        mask |= 1 << Var_FactorAlpha;
+    return mask;
+}
+
+
+// ***** Rasterizer::WorkerThread
+
+#ifdef SF_ENABLE_THREADS
+
+class Rasterizer::WorkerThread : public Thread
+{
+public:
+    WorkerThread(Rasterizer* prasterizer, unsigned index)
+        : Thread(Rasterizer_StackSize), pRasterizer(prasterizer), Index(index) { }
+
+    virtual int Run()
+    {
+        Rasterizer* pr      = pRasterizer;
+        unsigned    lastJob = 0;
+        SF_TRACE_CODE(Trace::SetThreadName("Soft::Rasterizer"));
+
+        while (1)
+        {
+            {
+                Mutex::Locker lock(&pr->JobMutex);
+                while (pr->JobId == lastJob && !pr->Exiting)
+                    pr->JobStart.Wait(&pr->JobMutex);
+                if (pr->Exiting)
+                    break;
+                lastJob = pr->JobId;
+            }
+
+            pr->doJob(Index);
+
+            Mutex::Locker lock(&pr->JobMutex);
+            if (--pr->PendingWorkers == 0)
+                pr->JobDone.NotifyAll();
+        }
+        return 0;
+    }
+
+private:
+    // Not AddRef-ed; the rasterizer joins its workers in Shutdown.
+    Rasterizer* pRasterizer;
+    unsigned    Index;
+};
+
+#endif // SF_ENABLE_THREADS
+
+
+// ***** Rasterizer
+
+Rasterizer::Rasterizer()
+    : pHeap(0), ThreadCount(1), TilesX(0), TilesY(0), CurrentJob(Job_Bin)
+{
+#ifdef SF_ENABLE_THREADS
+    JobId          = 0;
+    PendingWorkers = 0;
+    Exiting        = false;
+#endif
+    WorkerPixels.PushBack(0);
+    ResetStats();
+}
+
+Rasterizer::~Rasterizer()
+{
+    Shutdown();
+}
+
+void Rasterizer::Initialize(MemoryHeap* pheap, unsigned threadCount)
+{
+    Shutdown();
+    pHeap = pheap ? pheap : Memory::GetHeapByAddress(this);
+
+#ifdef SF_ENABLE_THREADS
+    if (threadCount == 0)
+        threadCount = (unsigned)Alg::Max(Thread::GetCPUCount(), 1);
+    Exiting = false;
+#else
+    threadCount = 1;
+#endif
+    ThreadCount = threadCount;
+
+#ifdef SF_ENABLE_THREADS
+    for (unsigned i = 1; i < ThreadCount; i++)
+    {
+        Ptr<WorkerThread> pworker = *SF_HEAP_NEW(pHeap) WorkerThread(this, i);
+        if (!pworker->Start())
+        {
+            // Slices and tiles are only handed to workers that exist.
+            ThreadCount = i;
+            break;
+        }
+        Workers.PushBack(pworker);
+    }
+#endif
+
+    WorkerPixels.Resize(ThreadCount);
+    for (unsigned i = 0; i < ThreadCount; i++)
+        WorkerPixels[i] = 0;
+    Bins.Resize(ThreadCount * TilesX * TilesY);
+}
+
+void Rasterizer::Shutdown()
+{
+    Triangles.Clear();
+    DrawStates.Clear();
+
+#ifdef SF_ENABLE_THREADS
+    if (Workers.GetSize())
+    {
+        {
+            Mutex::Locker lock(&JobMutex);
+            Exiting = true;
+            JobStart.NotifyAll();
+        }
+        for (UPInt i = 0; i < Workers.GetSize(); i++)
+            Workers[i]->Wait();
+        Workers.Clear();
+    }
+#endif
+    ThreadCount = 1;
+    Surf        = Surface();
+    TilesX      = TilesY = 0;
+    Bins.Clear();
+}
+
+void Rasterizer::SetSurface(const Surface& surface)
+{
+    Flush();
+    Surf   = surface;
+    TilesX = (Surf.Width  + TileSize - 1) >> TileSizeShift;
+    TilesY = (Surf.Height + TileSize - 1) >> TileSizeShift;
+    Bins.Resize(ThreadCount * TilesX * TilesY);
+}
+
+void Rasterizer::ClearColor(const Color& color)
+{
+    Flush();
+    if (!Surf.pColor)
+        return;
+
+    UByte rgba[4] = { color.GetRed(), color.GetGreen(), color.GetBlue(), color.GetAlpha() };
+    for (unsigned y = 0; y < Surf.Height; y++)
+    {
+        UByte* p = Surf.pColor + y * Surf.ColorPitch;
+        for (unsigned x = 0; x < Surf.Width; x++, p += 4)
+            memcpy(p, rgba, 4);
+    }
+}
+
+unsigned Rasterizer::AddDrawState(const DrawState& state)
+{
+    DrawStates.PushBack(state);
+    return (unsigned)DrawStates.GetSize() - 1;
+}
+
+void Rasterizer::AddTriangle(unsigned state, const Vertex& v0, const Vertex& v1, const Vertex& v2)
+{
+    const float gb = Rasterizer_GuardBand;
+    const Vertex* pv[3] = { &v0, &v1, &v2 };
+    bool inside = true;
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        // NaN positions (from a degenerate transform) can't be drawn.
+        if (pv[i]->X != pv[i]->X || pv[i]->Y != pv[i]->Y)
+            return;
+        if (pv[i]->X < -gb || pv[i]->X > gb || pv[i]->Y < -gb || pv[i]->Y > gb)
+            inside = false;
+    }
+    if (inside)
+    {
+        addClippedTriangle(state, v0, v1, v2);
+        return;
+    }
+
+    // Sutherland-Hodgman against the four guard band edges. Varyings are
+    // interpolated linearly, as they are across the triangle itself.
+    Vertex   poly[2][9];
+    unsigned count = 3;
+    poly[0][0] = v0;
+    poly[0][1] = v1;
+    poly[0][2] = v2;
+
+    for (unsigned plane = 0; plane < 4; plane++)
+    {
+        const Vertex* pin  = poly[plane & 1];
+        Vertex*       pout = poly[(plane + 1) & 1];
+        unsigned      outCount = 0;
+        float         sign = (plane & 1) ? -1.0f : 1.0f;
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            const Vertex& a = pin[i];
+            const Vertex& b = pin[(i + 1) % count];
+            float da = gb - sign * ((plane & 2) ? a.Y : a.X);
+            float db = gb - sign * ((plane & 2) ? b.Y : b.X);
+
+            if (da >= 0.0f)
+                pout[outCount++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float   t = da / (da - db);
+                Vertex& v = pout[outCount++];
+                v.X = a.X + (b.X - a.X) * t;
+                v.Y = a.Y + (b.Y - a.Y) * t;
+                for (unsigned j = 0; j < Var_Count; j++)
+                    v.V[j] = a.V[j] + (b.V[j] - a.V[j]) * t;
+            }
+        }
+        count = outCount;
+        if (count < 3)
+            return;
+    }
+
+    // After four planes the result is back in poly[0].
+    for (unsigned i = 1; i + 1 < count; i++)
+        addClippedTriangle(state, poly[0][0], poly[0][i], poly[0][i + 1]);
+}
+
+void Rasterizer::addClippedTriangle(unsigned state, const Vertex& v0, const Vertex& v1, const Vertex& v2)
+{
+    Triangle& tri = Triangles.PushDefault();
+    const Vertex* pv[3] = { &v0, &v1, &v2 };
+    for (unsigned i = 0; i < 3; i++)
+    {
+        tri.X[i] = pv[i]->X;
+        tri.Y[i] = pv[i]->Y;
+        for (unsigned j = 0; j < Var_Count; j++)
+            tri.Attr[j][i] = pv[i]->V[j];
+    }
+    tri.State = state;
+    RStats.Triangles++;
+}
+
+bool Rasterizer::References(const void* psource) const
+{
+    for (UPInt i = 0; i < DrawStates.GetSize(); i++)
+    {
+        for (unsigned s = 0; s < 4; s++)
+        {
+            if (DrawStates[i].Samplers[s].pSource == psource)
+                return true;
+        }
+    }
+    return false;
+}
+
+void Rasterizer::ResetStats()
+{
+    memset(&RStats, 0, sizeof(RStats));
+}
+
+void Rasterizer::Flush()
+{
+    if (Triangles.GetSize() == 0 || !Surf.pColor)
+    {
+        Triangles.Clear();
+        DrawStates.Clear();
+        return;
+    }
+    SF_TRACE_SCOPE(TraceCat_Render, "Soft::Rasterizer::Flush");
+
+    UInt64 startTicks = Timer::GetTicks();
+    runJob(Job_Bin);
+    UInt64 binTicks = Timer::GetTicks();
+    runJob(Job_Raster);
+    UInt64 endTicks = Timer::GetTicks();
+
+    RStats.Flushes++;
+    RStats.BinTicks    += binTicks - startTicks;
+    RStats.RasterTicks += endTicks - binTicks;
+    for (unsigned i = 0; i < ThreadCount; i++)
+    {
+        RStats.Pixels  += WorkerPixels[i];
+        WorkerPixels[i] = 0;
+    }
+
+    Triangles.Clear();
+    DrawStates.Clear();
+}
+
+void Rasterizer::runJob(JobType job)
+{
+    CurrentJob = job;
+    NextTile   = 0;
+
+#ifdef SF_ENABLE_THREADS
+    if (ThreadCount > 1)
+    {
+        {
+            Mutex::Locker lock(&JobMutex);
+            PendingWorkers = ThreadCount - 1;
+            // Never 0, which is the workers' initial "seen" value.
+            if (++JobId == 0)
+                JobId = 1;
+            JobStart.NotifyAll();
+        }
+
+        doJob(0);
+
+        Mutex::Locker lock(&JobMutex);
+        while (PendingWorkers > 0)
+            JobDone.Wait(&JobMutex);
+        return;
+    }
+#endif
+    doJob(0);
+}
+
+void Rasterizer::doJob(unsigned worker)
+{
+    if (CurrentJob == Job_Bin)
+        binTriangles(worker);
+    else
+        rasterizeTiles(worker);
+}
+
+void Rasterizer::binTriangles(unsigned worker)
+{
+    SF_TRACE_SCOPE(TraceCat_Render, "Soft::Rasterizer::Bin");
+
+    const UPInt    count     = Triangles.GetSize();
+    const UPInt    start     = count * worker / ThreadCount;
+    const UPInt    end       = count * (worker + 1) / ThreadCount;
+    const unsigned tileCount = TilesX * TilesY;
+    BinType*       pbins     = tileCount ? &Bins[worker * tileCount] : 0;
+
+    for (unsigned i = 0; i < tileCount; i++)
+        pbins[i].Clear();
+
+    for (UPInt i = start; i < end; i++)
+    {
+        Triangle& tri = Triangles[i];
+        tri.Bounds.SetRect(0, 0, 0, 0);
+
+        for (unsigned v = 0; v < 3; v++)
+        {
+            tri.FX[v] = (SInt32)floorf(tri.X[v] * 16.0f + 0.5f);
+            tri.FY[v] = (SInt32)floorf(tri.Y[v] * 16.0f + 0.5f);
+        }
+
+        SInt64 area = (SInt64)(tri.FX[1] - tri.FX[0]) * (tri.FY[2] - tri.FY[0]) -
+                      (SInt64)(tri.FY[1] - tri.FY[0]) * (tri.FX[2] - tri.FX[0]);
+        if (area == 0)
+            continue;
+
+        // Varying planes, from the snapped positions so they agree with the
+        // edge functions.
+        float x0 = tri.FX[0] / 16.0f, y0 = tri.FY[0] / 16.0f;
+        float dx1 = tri.FX[1] / 16.0f - x0, dy1 = tri.FY[1] / 16.0f - y0;
+        float dx2 = tri.FX[2] / 16.0f - x0, dy2 = tri.FY[2] / 16.0f - y0;
+        float invArea = 1.0f / (dx1 * dy2 - dy1 * dx2);
+        for (unsigned j = 0; j < Var_Count; j++)
+        {
+            float* pa = tri.Attr[j];
+            float  d1 = pa[1] - pa[0], d2 = pa[2] - pa[0];
+            float  b  = (d1 * dy2 - d2 * dy1) * invArea;
+            float  c  = (d2 * dx1 - d1 * dx2) * invArea;
+            pa[0] = pa[0] - b * x0 - c * y0;
+            pa[1] = b;
+            pa[2] = c;
+        }
+
+        // Edge functions expect a positive area.
+        if (area < 0)
+        {
+            Alg::Swap(tri.FX[1], tri.FX[2]);
+            Alg::Swap(tri.FY[1], tri.FY[2]);
+        }
+
+        // Pixels whose centers may be covered, clipped to the draw.
+        const Rect<int>& clip = DrawStates[tri.State].Clip;
+        SInt32 minX = Alg::Min(tri.FX[0], Alg::Min(tri.FX[1], tri.FX[2])),
+               maxX = Alg::Max(tri.FX[0], Alg::Max(tri.FX[1], tri.FX[2])),
+               minY = Alg::Min(tri.FY[0], Alg::Min(tri.FY[1], tri.FY[2])),
+               maxY = Alg::Max(tri.FY[0], Alg::Max(tri.FY[1], tri.FY[2]));
+        int x1 = Alg::Max(Alg::Max((minX + 7) >> 4, clip.x1), 0),
+            y1 = Alg::Max(Alg::Max((minY + 7) >> 4, clip.y1), 0),
+            x2 = Alg::Min(Alg::Min(((maxX - 8) >> 4) + 1, clip.x2), (int)Surf.Width),
+            y2 = Alg::Min(Alg::Min(((maxY - 8) >> 4) + 1, clip.y2), (int)Surf.Height);
+        if (x1 >= x2 || y1 >= y2)
+            continue;
+        tri.Bounds.SetRect(x1, y1, x2, y2);
+
+        for (int ty = y1 >> TileSizeShift; ty <= ((y2 - 1) >> TileSizeShift); ty++)
+        {
+            for (int tx = x1 >> TileSizeShift; tx <= ((x2 - 1) >> TileSizeShift); tx++)
+                pbins[ty * TilesX + tx].PushBack((UInt32)i);
+        }
+    }
+}
+
+void Rasterizer::rasterizeTiles(unsigned worker)
+{
+    SF_TRACE_SCOPE(TraceCat_Render, "Soft::Rasterizer::Raster");
+
+    const SInt32 tileCount = (SInt32)(TilesX * TilesY);
+    while (1)
+    {
+        SInt32 tile = NextTile.ExchangeAdd_NoSync(1);
+        if (tile >= tileCount)
+            break;
+
+        int x = (tile % TilesX) << TileSizeShift,
+            y = (tile / TilesX) << TileSizeShift;
+        Rect<int> tileRect(x, y, Alg::Min(x + (int)TileSize, (int)Surf.Width),
+                                 Alg::Min(y + (int)TileSize, (int)Surf.Height));
+
+        // Bins are filled from consecutive slices, so reading them in worker
+        // order keeps submission order.
+        for (unsigned w = 0; w < ThreadCount; w++)
+        {
+            const BinType& bin = Bins[w * tileCount + tile];
+            for (UPInt i = 0; i < bin.GetSize(); i++)
+                drawTriangle(Triangles[bin[i]], tileRect, worker);
+        }
+    }
+}
+
+void Rasterizer::drawTriangle(const Triangle& tri, const Rect<int>& tileRect, unsigned worker)
+{
+    Rect<int> r(Alg::Max(tri.Bounds.x1, tileRect.x1), Alg::Max(tri.Bounds.y1, tileRect.y1),
+                Alg::Min(tri.Bounds.x2, tileRect.x2), Alg::Min(tri.Bounds.y2, tileRect.y2));
+    if (r.x1 >= r.x2 || r.y1 >= r.y2)
+        return;
+
+    // Edge functions at the first pixel center. An edge passes pixels with
+    // E >= 0; the bias turns that into E > 0 for edges that are neither top
+    // nor left.
+    SInt32 edge[3], stepX[3], stepY[3];
+    for (unsigned i = 0; i < 3; i++)
+    {
+        unsigned j  = (i + 1) % 3;
+        SInt64   dx = tri.FX[j] - tri.FX[i],
+                 dy = tri.FY[j] - tri.FY[i];
+        SInt64   px = (SInt64)r.x1 * 16 + 8 - tri.FX[i],
+                 py = (SInt64)r.y1 * 16 + 8 - tri.FY[i];
+        SInt64   e  = dx * py - dy * px;
+        if (!((dy < 0) || (dy == 0 && dx > 0)))
+            e -= 1;
+
+        SInt64 sx = -dy * 16, sy = dx * 16;
+        SInt64 w  = r.x2 - r.x1 - 1, h = r.y2 - r.y1 - 1;
+        SInt64 emin = e + Alg::Min<SInt64>(0, sx * w) + Alg::Min<SInt64>(0, sy * h);
+        SInt64 emax = e + Alg::Max<SInt64>(0, sx * w) + Alg::Max<SInt64>(0, sy * h);
+
+        if (emax < 0)
+            return;
+        if (emin >= 0)
+        {
+            // The edge doesn't cross this rectangle.
+            e = sx = sy = 0;
+        }
+        // Crossing edges span at most 128 pixel steps here, which fits in
+        // 32 bits for coordinates within the guard band.
+        edge[i]  = (SInt32)e;
+        stepX[i] = (SInt32)sx;
+        stepY[i] = (SInt32)sy;
+    }
+
+    const DrawState& st     = DrawStates[tri.State];
+    const unsigned   flags  = st.Flags;
+    const unsigned   source = flags & Pixel_SourceMask;
+    const bool       useStencil = st.StencilEnable && Surf.pStencil;
+    const unsigned   varMask    = Rasterizer_VaryingMask(flags);
+
+    typedef Rasterizer_Lane Lane;
+    SF_SIMD_ALIGN(static const float rampValues[4]) = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const Lane ramp = L::Load(rampValues);
+    const Lane zero = Rasterizer_Splat(0.0f);
+    const Lane one  = Rasterizer_Splat(1.0f);
+
+    // Varyings at the first quad of the row, and their steps.
+    Lane rowVar[Var_Count], quadStep[Var_Count], rowStep[Var_Count], cur[Var_Count];
+    for (unsigned j = 0; j < Var_Count; j++)
+    {
+        if (!(varMask & (1 << j)))
+            continue;
+        const float* p = tri.Attr[j];
+        float base  = p[0] + p[1] * (r.x1 + 0.5f) + p[2] * (r.y1 + 0.5f);
+        rowVar[j]   = L::MulAdd(Rasterizer_Splat(p[1]), ramp, Rasterizer_Splat(base));
+        quadStep[j] = Rasterizer_Splat(p[1] * 4.0f);
+        rowStep[j]  = Rasterizer_Splat(p[2]);
+    }
+
+    Lane solid[4], cxMul[4], cxAdd[4];
+    for (unsigned c = 0; c < 4; c++)
+    {
+        solid[c] = Rasterizer_Splat(st.Color[c]);
+        cxMul[c] = Rasterizer_Splat(st.Cxform[0][c]);
+        cxAdd[c] = Rasterizer_Splat(st.Cxform[1][c]);
+    }
+
+    UByte*   pcolorRow   = Surf.pColor + r.y1 * Surf.ColorPitch;
+    UByte*   pstencilRow = Surf.pStencil ? Surf.pStencil + r.y1 * Surf.StencilPitch : 0;
+    UInt64   pixels      = 0;
+
+    for (int y = r.y1; y < r.y2; y++)
+    {
+        SInt32 e0 = edge[0], e1 = edge[1], e2 = edge[2];
+        for (unsigned j = 0; j < Var_Count; j++)
+        {
+            if (varMask & (1 << j))
+                cur[j] = rowVar[j];
+        }
+
+        for (int x = r.x1; x < r.x2; x += 4)
+        {
+            // Coverage; the sign bit of the OR is set if any edge fails.
+            unsigned mask  = 0;
+            int      count = Alg::Min(4, r.x2 - x);
+            SInt32   a0 = e0, a1 = e1, a2 = e2;
+            for (int k = 0; k < count; k++)
+            {
+                if ((a0 | a1 | a2) >= 0)
+                    mask |= 1 << k;
+                a0 += stepX[0];
+                a1 += stepX[1];
+                a2 += stepX[2];
+            }
+            e0 += stepX[0] * 4;
+            e1 += stepX[1] * 4;
+            e2 += stepX[2] * 4;
+
+            if (mask && useStencil)
+            {
+                UByte* ps = pstencilRow + x;
+                for (int k = 0; k < count; k++)
+                {
+                    if (!(mask & (1 << k)))
+                        continue;
+                    unsigned value = ps[k];
+                    bool     pass  = Rasterizer_StencilTest(st.StencilFunc, st.StencilRef, value);
+                    ps[k] = Rasterizer_StencilApply(pass ? st.StencilPassOp : st.StencilFailOp, st.StencilRef, value);
+                    if (!pass)
+                        mask &= ~(1u << k);
+                }
+            }
+
+            if (mask && st.ColorWrite)
+            {
+                Lane c[4], t[4];
+                switch (source)
+                {
+                case Pixel_Vertex:
+                    c[0] = cur[Var_R]; c[1] = cur[Var_G]; c[2] = cur[Var_B]; c[3] = cur[Var_A];
+                    break;
+                case Pixel_Tex:
+                    Rasterizer_SampleQuad(st.Samplers[0], cur[Var_U0], cur[Var_V0], mask, c);
+                    break;
+                case Pixel_ATex:
+                    Rasterizer_SampleQuadATex(st.Samplers, cur[Var_U0], cur[Var_V0], mask, c);
+                    break;
+                case Pixel_TexTex:
+                    Rasterizer_SampleQuad(st.Samplers[0], cur[Var_U0], cur[Var_V0], mask, t);
+                    Rasterizer_SampleQuad(st.Samplers[1], cur[Var_U1], cur[Var_V1], mask, c);
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = Rasterizer_Mix(c[ch], t[ch], cur[Var_Factor]);
+                    break;
+                case Pixel_ATexATex:
+                    Rasterizer_SampleQuadATex(st.Samplers,     cur[Var_U0], cur[Var_V0], mask, t);
+                    Rasterizer_SampleQuadATex(st.Samplers + 2, cur[Var_U1], cur[Var_V1], mask, c);
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = Rasterizer_Mix(c[ch], t[ch], cur[Var_Factor]);
+                    break;
+                case Pixel_TexVertex:
+                case Pixel_ATexVertex:
+                    if (source == Pixel_TexVertex)
+                        Rasterizer_SampleQuad(st.Samplers[0], cur[Var_U0], cur[Var_V0], mask, t);
+                    else
+                        Rasterizer_SampleQuadATex(st.Samplers, cur[Var_U0], cur[Var_V0], mask, t);
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = Rasterizer_Mix(cur[Var_R + ch], t[ch], cur[Var_Factor]);
+                    break;
+                case Pixel_Text:
+                    Rasterizer_SampleQuad(st.Samplers[0], cur[Var_U0], cur[Var_V0], mask, t);
+                    c[0] = cur[Var_R]; c[1] = cur[Var_G]; c[2] = cur[Var_B];
+                    c[3] = L::Mul(cur[Var_A], t[3]);
+                    break;
+                default:
+                    c[0] = solid[0]; c[1] = solid[1]; c[2] = solid[2]; c[3] = solid[3];
+                    break;
+                }
+
+                if (flags & Pixel_Cxform)
+                {
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = L::MulAdd(c[ch], cxMul[ch], cxAdd[ch]);
+                }
+                else if (flags & Pixel_CxformAc)
+                {
+                    // c = (c * vec4(mul.rgb, 1)) * mul.a; c += add * c.a
+                    for (unsigned ch = 0; ch < 3; ch++)
+                        c[ch] = L::Mul(c[ch], cxMul[ch]);
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = L::Mul(c[ch], cxMul[3]);
+                    Lane alpha = c[3];
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = L::MulAdd(cxAdd[ch], alpha, c[ch]);
+                }
+                if (flags & Pixel_EAlpha)
+                    c[3] = L::Mul(c[3], cur[Var_FactorAlpha]);
+                if (flags & Pixel_Inv)
+                    c[0] = c[1] = c[2] = c[3];
+                else if (flags & Pixel_Mul)
+                {
+                    for (unsigned ch = 0; ch < 3; ch++)
+                        c[ch] = L::Mul(c[ch], c[3]);
+                }
+
+                // Fragment output is clamped, as for a fixed point target.
+                for (unsigned ch = 0; ch < 4; ch++)
+                    c[ch] = L::Min(L::Max(c[ch], zero), one);
+
+                UByte* pc = pcolorRow + x * 4;
+                if (st.BlendEnable)
+                {
+                    const float k = 1.0f / 255.0f;
+                    SF_SIMD_ALIGN(float dest[4][4]) = { { 0 } };
+                    for (int i = 0; i < count; i++)
+                    {
+                        for (unsigned ch = 0; ch < 4; ch++)
+                            dest[ch][i] = pc[i * 4 + ch] * k;
+                    }
+
+                    Lane d[4];
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        d[ch] = L::Load(dest[ch]);
+
+                    Lane srcAlpha = c[3];
+                    for (unsigned ch = 0; ch < 3; ch++)
+                    {
+                        c[ch] = Rasterizer_Blend(st.BlendColorOp,
+                                    c[ch], Rasterizer_BlendFactor(st.SourceColor, srcAlpha, d[ch], zero, one),
+                                    d[ch], Rasterizer_BlendFactor(st.DestColor, srcAlpha, d[ch], zero, one));
+                    }
+                    c[3] = Rasterizer_Blend(st.BlendAlphaOp,
+                                c[3], Rasterizer_BlendFactor(st.SourceAlpha, srcAlpha, d[3], zero, one),
+                                d[3], Rasterizer_BlendFactor(st.DestAlpha, srcAlpha, d[3], zero, one));
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        c[ch] = L::Min(L::Max(c[ch], zero), one);
+                }
+
+                SF_SIMD_ALIGN(float out[4][4]);
+                for (unsigned ch = 0; ch < 4; ch++)
+                    L::Store(out[ch], c[ch]);
+                for (int i = 0; i < count; i++)
+                {
+                    if (!(mask & (1 << i)))
+                        continue;
+                    for (unsigned ch = 0; ch < 4; ch++)
+                        pc[i * 4 + ch] = Rasterizer_ToByte(out[ch][i]);
+                    pixels++;
+                }
+            }
+
+            for (unsigned j = 0; j < Var_Count; j++)
+            {
+                if (varMask & (1 << j))
+                    cur[j] = L::Add(cur[j], quadStep[j]);
+            }
+        }
+
+        edge[0] += stepY[0];
+        edge[1] += stepY[1];
+        edge[2] += stepY[2];
+        for (unsigned j = 0; j < Var_Count; j++)
+        {
+            if (varMask & (1 << j))
+                rowVar[j] = L::Add(rowVar[j], rowStep[j]);
+        }
+        pcolorRow += Surf.ColorPitch;
+        if (pstencilRow)
+            pstencilRow += Surf.StencilPitch;
+    }
+
+    WorkerPixels[worker] += pixels;
+}
+
+}}} // Scaleform::Render::Soft
@@ -0,0 +1,285 @@
+/**************************************************************************
+
+Filename    :   Soft_Rasterizer.h
+Content     :   Tiled, multithreaded triangle rasterizer used by the
+                software HAL.
+Created     :   
+Authors     :   
+
+Copyright   :   Copyright 2011 Autodesk, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Autodesk license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+**************************************************************************/
+
+#ifndef INC_SF_Render_Soft_Rasterizer_H
+#define INC_SF_Render_Soft_Rasterizer_H
+
+#include "Kernel/SF_Types.h"
+#include "Kernel/SF_Array.h"
+#include "Kernel/SF_Threads.h"
+#include "Kernel/SF_Atomic.h"
+#include "Render/Render_Types2D.h"
+#include "Render/Render_Color.h"
+#include "Render/Render_Stats.h"
+
+namespace Scaleform { namespace Render { namespace Soft {
+
+// Rasterizer draws the triangles queued by Soft::HAL into a Surface.
+//
+// Triangles are only queued by AddTriangle; Flush does the work in two
+// passes, both spread over the worker threads:
+//  1. Setup and binning. Each worker takes a contiguous slice of the queue,
+//     computes edge functions and varying planes, and appends the triangle
+//     to its own bin for every 64x64 tile it touches.
+//  2. Rasterization. Workers take whole tiles; a tile reads the bins of all
+//     workers in slice order, so triangles are drawn in submission order and
+//     the output doesn't depend on the thread count.
+//
+// Edges use 28.4 fixed point with the top-left fill rule, so shared edges
+// are never drawn twice. Pixels are shaded four at a time, with the color
+// math done on SIMD::IS vectors when SF_ENABLE_SIMD is defined.
+//
+// The surface, and the textures referenced by queued DrawStates, must not
+// change until Flush returns.
+
+// Interpolated per-vertex values.
+enum VaryingIndex
+{
+    Var_R, Var_G, Var_B, Var_A,     // Vertex color.
+    Var_U0, Var_V0,                 // First texture coordinate.
+    Var_U1, Var_V1,                 // Second texture coordinate.
+    Var_Factor,                     // Texture/vertex color mix weight.
+    Var_FactorAlpha,                // Edge anti-aliasing alpha.
+    Var_Count
+};
+
+// Pixel pipeline description, decoded by the HAL from the shader type.
+enum PixelFlags
+{
+    Pixel_Solid         = 0,        // Constant color (DrawState::Color).
+    Pixel_Vertex        = 1,        // Vertex color.
+    Pixel_Tex           = 2,        // Sampler 0 at coordinate 0.
+    Pixel_ATex          = 3,        // Sampler 0, alpha from sampler 1.
+    Pixel_TexTex        = 4,        // Sampler 0 at coordinate 0 mixed with sampler 1 at coordinate 1.
+    Pixel_ATexATex      = 5,        // Samplers 0/1 at coordinate 0 mixed with samplers 2/3 at coordinate 1.
+    Pixel_TexVertex     = 6,        // Sampler 0 mixed with the vertex color.
+    Pixel_ATexVertex    = 7,        // Samplers 0/1 mixed with the vertex color.
+    Pixel_Text          = 8,        // Vertex color, alpha modulated by sampler 0 alpha.
+    Pixel_SourceMask    = 0x0F,
+
+    Pixel_Cxform        = 0x10,     // c = c * mul + add
+    Pixel_CxformAc      = 0x20,     // Alpha-composite color transform.
+    Pixel_EAlpha        = 0x40,     // Alpha multiplied by Var_FactorAlpha.
+    Pixel_Mul           = 0x80,     // Color premultiplied by alpha.
+    Pixel_Inv           = 0x100,    // Color replaced by alpha.
+};
+
+enum BlendFactor
+{
+    Factor_Zero,
+    Factor_One,
+    Factor_SrcAlpha,
+    Factor_InvSrcAlpha,
+    Factor_DestColor,
+    Factor_InvDestColor
+};
+
+enum BlendOp
+{
+    Op_Add,
+    Op_Max,
+    Op_Min,
+    Op_RevSubtract
+};
+
+enum StencilTest
+{
+    StencilFunc_Never,
+    StencilFunc_Less,
+    StencilFunc_Equal,
+    StencilFunc_LessEqual,
+    StencilFunc_Greater,
+    StencilFunc_NotEqual,
+    StencilFunc_GreaterEqual,
+    StencilFunc_Always
+};
+
+enum StencilOperation
+{
+    Stencil_Keep,
+    Stencil_Replace,
+    Stencil_Increment
+};
+
+// Render target memory. Color is R8G8B8A8, stencil one byte per pixel;
+// pStencil may be null, in which case stencil testing is skipped.
+struct Surface
+{
+    UByte*      pColor;
+    UPInt       ColorPitch;
+    UByte*      pStencil;
+    UPInt       StencilPitch;
+    unsigned    Width, Height;
+
+    Surface() : pColor(0), ColorPitch(0), pStencil(0), StencilPitch(0), Width(0), Height(0) { }
+};
+
+// A texture plane, always sampled from its top mip level.
+struct Sampler
+{
+    const void*     pSource;        // Owner of the data (the texture), used by References.
+    const UByte*    pData;
+    UPInt           Pitch;
+    unsigned        Width, Height;
+    UByte           BytesPerPixel;  // 4 for R8G8B8A8, 1 for single channel planes.
+    UByte           AlphaPlane;     // Single channel holds alpha (0,0,0,a) rather than red (r,0,0,1).
+    UByte           Clamp;
+    UByte           Linear;
+};
+
+// State shared by the triangles of one draw (and batch index). All values
+// are plain data, copied when the draw is queued.
+struct DrawState
+{
+    unsigned        Flags;                  // PixelFlags
+    float           Color[4];               // Pixel_Solid color.
+    float           Cxform[2][4];           // Multiply, add.
+    Sampler         Samplers[4];
+    Rect<int>       Clip;                   // Viewport and scissor, in surface pixels.
+
+    UByte           BlendEnable;
+    UByte           BlendColorOp, SourceColor, DestColor;
+    UByte           BlendAlphaOp, SourceAlpha, DestAlpha;
+    UByte           ColorWrite;
+    UByte           StencilEnable;
+    UByte           StencilFunc, StencilPassOp, StencilFailOp;
+    UByte           StencilRef;
+};
+
+// A transformed vertex, in surface pixels (pixel centers at +0.5).
+struct Vertex
+{
+    float           X, Y;
+    float           V[Var_Count];
+};
+
+class Rasterizer
+{
+public:
+    enum
+    {
+        TileSizeShift       = 6,
+        TileSize            = 1 << TileSizeShift,
+        // Triangles queued before an automatic flush.
+        MaxQueuedTriangles  = 64 * 1024
+    };
+
+    struct Stats
+    {
+        unsigned    Flushes;
+        UInt64      Triangles;      // Triangles queued, after guard band clipping.
+        UInt64      Pixels;         // Pixels that passed coverage and stencil tests.
+        UInt64      BinTicks;       // Time spent in setup and binning, in microseconds.
+        UInt64      RasterTicks;    // Time spent in rasterization, in microseconds.
+    };
+
+    Rasterizer();
+    ~Rasterizer();
+
+    // Starts the workers; threadCount includes the calling thread, 0 uses
+    // the CPU count.
+    void            Initialize(MemoryHeap* pheap, unsigned threadCount = 0);
+    void            Shutdown();
+    unsigned        GetThreadCount() const      { return ThreadCount; }
+
+    // Flushes queued triangles, then draws to the new surface.
+    void            SetSurface(const Surface& surface);
+    const Surface&  GetSurface() const          { return Surf; }
+    bool            HasSurface() const          { return Surf.pColor != 0; }
+
+    // Fills the whole surface with the color, flushing first.
+    void            ClearColor(const Color& color);
+
+    // Queues a DrawState and returns its index for AddTriangle. States are
+    // released at Flush.
+    unsigned        AddDrawState(const DrawState& state);
+    // Queues a triangle. Triangles far outside the surface are clipped to a
+    // guard band first.
+    void            AddTriangle(unsigned state, const Vertex& v0, const Vertex& v1, const Vertex& v2);
+    // True if AddTriangle would exceed MaxQueuedTriangles; the caller should
+    // Flush, which also drops its DrawStates.
+    bool            IsQueueFull() const         { return Triangles.GetSize() >= MaxQueuedTriangles; }
+    bool            IsQueueEmpty() const        { return Triangles.GetSize() == 0; }
+
+    // True if a queued DrawState samples from the given source.
+    bool            References(const void* psource) const;
+
+    // Draws all queued triangles and waits for them.
+    void            Flush();
+
+    void            GetStats(Stats* pstats) const { *pstats = RStats; }
+    void            ResetStats();
+
+private:
+    struct Triangle
+    {
+        float       X[3], Y[3];
+        // Per-vertex values, replaced during setup by the varying plane
+        // (value = [0] + [1]*x + [2]*y).
+        float       Attr[Var_Count][3];
+        SInt32      FX[3], FY[3];   // 28.4 fixed point, counter-clockwise in surface space.
+        Rect<int>   Bounds;         // Covered pixels, clipped; empty if culled.
+        UInt32      State;
+    };
+
+    enum JobType
+    {
+        Job_Bin,
+        Job_Raster
+    };
+
+    class WorkerThread;
+    friend class WorkerThread;
+
+    typedef ArrayLH_POD<UInt32, StatRender_RenderPipeline_Mem, ArrayConstPolicy<0, 64, true> > BinType;
+
+    void            addClippedTriangle(unsigned state, const Vertex& v0, const Vertex& v1, const Vertex& v2);
+    void            runJob(JobType job);
+    void            doJob(unsigned worker);
+    void            binTriangles(unsigned worker);
+    void            rasterizeTiles(unsigned worker);
+    void            drawTriangle(const Triangle& tri, const Rect<int>& tileRect, unsigned worker);
+
+    MemoryHeap*             pHeap;
+    unsigned                ThreadCount;
+    Surface                 Surf;
+    unsigned                TilesX, TilesY;
+
+    ArrayLH_POD<Triangle, StatRender_RenderPipeline_Mem, ArrayConstPolicy<0, 1024, true> > Triangles;
+    ArrayLH_POD<DrawState, StatRender_RenderPipeline_Mem, ArrayConstPolicy<0, 64, true> >  DrawStates;
+    // Indexed by worker * TileCount + tile.
+    ArrayLH<BinType>        Bins;
+    // Indexed by worker.
+    ArrayLH_POD<UInt64>     WorkerPixels;
+
+    JobType                 CurrentJob;
+    AtomicInt<SInt32>       NextTile;
+    Stats                   RStats;
+
+#ifdef SF_ENABLE_THREADS
+    ArrayLH<Ptr<WorkerThread> > Workers;
+    Mutex                   JobMutex;
+    WaitCondition           JobStart;
+    WaitCondition           JobDone;
+    unsigned                JobId;
+    unsigned                PendingWorkers;
+    bool                    Exiting;
+#endif
+};
+
+}}} // Scaleform::Render::Soft
+
+#endif // INC_SF_Render_Soft_Rasterizer_H